@@ -77,6 +77,22 @@ namespace SCXCoreLib
     
     };
 
+    /*----------------------------------------------------------------------------*/
+    /**
+     * Receives the output of a process as it arrives, without it being collected
+     * in a stream first
+     */
+    class SCXProcessOutputSink
+    {
+    public:
+        virtual ~SCXProcessOutputSink() {}
+
+        //! Called for every chunk read from the process
+        //! \param[in]  data    Output; only valid during the call
+        //! \param[in]  size    Number of bytes at data
+        virtual void Write(const char* data, size_t size) = 0;
+    };
+
     /*----------------------------------------------------------------------------*/
     /**
         Represents a reference to a process. 
@@ -97,6 +113,8 @@ namespace SCXCoreLib
         static int Run(const std::vector<std::wstring> &myargv, std::istream &mystdin, std::ostream &mystdout, std::ostream &mystderr, 
                        unsigned timeout = 0, const SCXFilePath& cwd = SCXFilePath(), const SCXFilePath& chrootPath = SCXFilePath());
         static int Run(SCXProcess& process, std::istream &mystdin, std::ostream &mystdout, std::ostream &mystderr, unsigned timeout = 0);
+        static int Run(const std::wstring &command, std::istream &mystdin, SCXProcessOutputSink &mystdout, SCXProcessOutputSink &mystderr,
+                       unsigned timeout = 0, const SCXFilePath& cwd = SCXFilePath(), const SCXFilePath& chrootPath = SCXFilePath());
         
         SCXProcess(const std::vector<std::wstring> myargv, const SCXFilePath& cwd = SCXFilePath(), const SCXFilePath& chrootPath = SCXFilePath());
         bool SendInput(std::istream &mystdin);
@@ -106,6 +124,7 @@ namespace SCXCoreLib
         virtual ~SCXProcess();
         void Kill();
         unsigned GetEffectiveTimeout(unsigned timeout);
+        static void ForceFork(bool forceFork);
 
     protected:
         virtual bool ReadToStream(int fd, std::ostream& stream);
@@ -115,6 +134,8 @@ namespace SCXCoreLib
         virtual void CloseAndDie();
 
     private:
+        friend class SCXProcessLoop;          //!< Drives the pipes and pid from its own event loop
+
         //!< Index of file descriptors for a pipe
         enum Direction {
             R,           //!< in
@@ -135,6 +156,10 @@ namespace SCXCoreLib
         bool m_stdoutActive;                  //!< The child process may write to its stdout
         bool m_stderrActive;                  //!< The child process may write to its stderr
         size_t m_timeoutOverhead;             //!< The amount of overhead in waiting for the child process to begin.
+        static bool s_forceFork;              //!< Launch with fork() even where a vfork-style clone is available
+
+        bool SpawnChild(const std::string& cwd, const std::string& chrootPath);
+        void SetUpParentPipes();
 #endif
     };
 } /* namespace SCXCoreLib */
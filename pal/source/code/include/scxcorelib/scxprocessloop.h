@@ -0,0 +1,157 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+    \file
+
+    \brief       Defines an event loop that runs many child processes from a
+                 single thread.
+
+    \date        2026-10-17 10:00:00
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef SCXPROCESSLOOP_H
+#define SCXPROCESSLOOP_H
+
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxfilepath.h>
+#include <scxcorelib/scxhandle.h>
+#include <scxcorelib/scxlog.h>
+#include <scxcorelib/scxprocess.h>
+#include <scxcorelib/scxprocesstimeout.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(linux)
+
+namespace SCXCoreLib
+{
+    /*----------------------------------------------------------------------------*/
+    /**
+       Outcome of a process run by SCXProcessLoop. Acts as a future: the loop
+       fills it in and sets completed when the process has been reaped.
+    */
+    struct SCXProcessResult
+    {
+        SCXProcessResult()
+            : pid(0), completed(false), exited(false), timedOut(false), exitCode(-1)
+        {
+        }
+
+        SCXProcessId pid;           //!< Pid of the process
+        bool completed;             //!< The process has terminated and all fields are final
+        bool exited;                //!< The process exited normally (and was not killed by a signal)
+        bool timedOut;              //!< The process was killed because it ran past its timeout
+        int exitCode;               //!< Exit code of the process if it exited, otherwise -1
+        std::string stdoutData;     //!< Everything the process wrote to stdout
+        std::string stderrData;     //!< Everything the process wrote to stderr
+    };
+
+    /*----------------------------------------------------------------------------*/
+    /**
+       Callback for processes run by SCXProcessLoop. Called from the thread that
+       runs the loop once the result is complete.
+    */
+    class SCXProcessCompletion
+    {
+    public:
+        virtual ~SCXProcessCompletion() {}
+
+        /*----------------------------------------------------------------------------*/
+        /**
+           The process has terminated
+
+           \param[in] result   Final result of the process
+        */
+        virtual void ProcessCompleted(const SCXProcessResult& result) = 0;
+    };
+
+    /*----------------------------------------------------------------------------*/
+    /**
+       Runs many child processes concurrently from one thread.
+
+       Pipes of all children are registered on one epoll instance. Exit is
+       signalled through a pidfd per child where the kernel supports it; older
+       kernels fall back to reaping with waitpid on a short tick. Timeouts are
+       registered with SCXProcessTimeoutService, the same single thread that
+       serves SCXProcess::Run, and cancelled before the child is reaped so a
+       late deadline never hits a reused pid.
+
+       The loop is not thread safe: start processes and drive the loop from the
+       same thread.
+
+       Not wired into the agent yet; only the spawnlatency tool uses it. The
+       run-once commands still go through CommandExecutor on a thread pool,
+       since the loop buffers all output of a child in its result while
+       CommandExecutor streams it to log sinks and keeps only a bounded tail.
+       Moving them over needs incremental output callbacks on the loop first.
+    */
+    class SCXProcessLoop
+    {
+    public:
+        SCXProcessLoop();
+        virtual ~SCXProcessLoop();
+
+        SCXHandle<SCXProcessResult> Start(const std::vector<std::wstring>& myargv,
+                                          const std::string& input = std::string(),
+                                          unsigned timeout = 0,
+                                          SCXHandle<SCXProcessCompletion> completion = SCXHandle<SCXProcessCompletion>(0),
+                                          const SCXFilePath& cwd = SCXFilePath(),
+                                          const SCXFilePath& chrootPath = SCXFilePath());
+        size_t Poll(int waitMs);
+        void Run();
+        size_t Pending() const;
+
+    private:
+        SCXProcessLoop(const SCXProcessLoop&);              //!< Intentionally not implemented
+        SCXProcessLoop& operator=(const SCXProcessLoop&);   //!< Intentionally not implemented
+
+        //! A process the loop is running
+        struct Child
+        {
+            SCXHandle<SCXProcess> process;                  //!< Pipes and pid of the child
+            SCXHandle<SCXProcessResult> result;             //!< Result being collected
+            SCXHandle<SCXProcessCompletion> completion;     //!< Callback, may be null
+            std::string input;                              //!< Data for stdin of the child
+            size_t inputSent;                               //!< Bytes of input written so far
+            int pidFd;                                      //!< pidfd of the child, -1 if not available
+            SCXProcessTimeoutId timeoutId;                  //!< Registered deadline, 0 if the child has no timeout
+        };
+
+        SCXLogHandle m_logHandle;                           //!< Log handle
+        int m_epollFd;                                      //!< epoll instance for all pipes and pidfds
+        std::map<SCXProcessId, Child> m_children;           //!< Running children
+        std::map<int, SCXProcessId> m_fds;                  //!< Registered descriptor to the child it belongs to
+        size_t m_polledChildren;                            //!< Children without pidfd that need reaping by waitpid
+
+        void Watch(int fd, SCXProcessId pid, unsigned int events);
+        void Unwatch(int& fd);
+        int NextTimeout(int waitMs) const;
+        void SendInput(Child& child);
+        void ReadOutput(int& fd, std::string& data);
+        bool Reap(SCXProcessId pid);
+    };
+} /* namespace SCXCoreLib */
+
+#endif /* linux */
+
+#endif /* SCXPROCESSLOOP_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -0,0 +1,107 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+    \file
+
+    \brief       Defines the process-wide service that kills child processes
+                 running past their timeout.
+
+    \date        2026-10-17 14:00:00
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef SCXPROCESSTIMEOUT_H
+#define SCXPROCESSTIMEOUT_H
+
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxcondition.h>
+#include <scxcorelib/scxhandle.h>
+#include <scxcorelib/scxlog.h>
+#include <scxcorelib/scxprocess.h>
+#include <scxcorelib/scxsingleton.h>
+#include <scxcorelib/scxthread.h>
+
+#include <map>
+#include <queue>
+#include <vector>
+
+namespace SCXCoreLib
+{
+    /** Identifies a deadline registered with SCXProcessTimeoutService. */
+    typedef scxulong SCXProcessTimeoutId;
+
+    /*----------------------------------------------------------------------------*/
+    /**
+       Kills the process group of children that run past their deadline.
+
+       Deadlines of all timed processes are kept in one min-heap that a single
+       thread services, instead of a watchdog thread per process. Cancelled
+       deadlines are dropped lazily when they reach the top of the heap.
+    */
+    class SCXProcessTimeoutService : public SCXSingleton<SCXProcessTimeoutService>
+    {
+        friend class SCXSingleton<SCXProcessTimeoutService>;
+
+    public:
+        virtual ~SCXProcessTimeoutService();
+
+        SCXProcessTimeoutId Register(SCXProcess& process, unsigned timeout);
+        bool Cancel(SCXProcessTimeoutId id);
+
+        scxulong GetExpiredCount() const;
+        scxulong GetCancelledCount() const;
+        size_t GetPendingCount() const;
+
+    private:
+        SCXProcessTimeoutService();
+        SCXProcessTimeoutService(const SCXProcessTimeoutService&);              //!< Intentionally not implemented
+        SCXProcessTimeoutService& operator=(const SCXProcessTimeoutService&);   //!< Intentionally not implemented
+
+        //! A deadline on the heap
+        struct Deadline
+        {
+            scxulong when;              //!< Monotonic time in ms the deadline expires
+            SCXProcessTimeoutId id;     //!< Registration it belongs to
+
+            //! Orders the heap so the earliest deadline is on top
+            bool operator<(const Deadline& other) const
+            {
+                return when > other.when;
+            }
+        };
+
+        SCXLogHandle m_logHandle;                                   //!< Log handle
+        mutable SCXCondition m_cond;                                //!< Protects the members, wakes the thread
+        std::priority_queue<Deadline> m_heap;                       //!< Deadlines, earliest on top
+        std::map<SCXProcessTimeoutId, SCXProcess*> m_processes;     //!< Processes of deadlines not yet expired or cancelled
+        SCXProcessTimeoutId m_nextId;                               //!< Id of the next registration
+        scxulong m_expired;                                         //!< Deadlines that expired
+        scxulong m_cancelled;                                       //!< Deadlines cancelled before expiring
+        bool m_terminate;                                           //!< Tells the thread to stop
+        SCXHandle<SCXThread> m_thread;                              //!< Thread that expires the deadlines
+
+        static void ThreadBody(SCXThreadParamHandle& param);
+        void Service();
+        void Compact();
+        static scxulong NowMs();
+    };
+} /* namespace SCXCoreLib */
+
+#endif /* SCXPROCESSTIMEOUT_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -0,0 +1,120 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+    \file        CodeUnitScan.h
+
+    \brief       Contains the vector scanning kernels for UTF-16 code units
+
+    \date        2026-10-17 18:00:00
+
+*/
+/*----------------------------------------------------------------------------*/
+
+#ifndef CODEUNITSCAN_H
+#define CODEUNITSCAN_H
+
+#include <util/Unicode.h>
+#include <stddef.h>
+
+namespace SCX
+{
+    namespace Util
+    {
+        /*----------------------------------------------------------------------------*/
+        /**
+           Searches UTF-16 code units for the characters XMLReader stops at and for
+           the surrogates that Utf16String has to validate.
+
+           Each kernel has a scalar version and, on x86, SSE2 and AVX2 versions
+           that compare 8 or 16 code units at a time. The best version the CPU
+           supports is selected on first use; all versions return the same
+           results, which SetLevel allows to check.
+        */
+        class CodeUnitScan
+        {
+        public:
+            /** Kernel versions, in order of preference */
+            enum Level
+            {
+                LevelScalar = 0,
+                LevelSSE2,
+                LevelAVX2
+            };
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Find the first code unit that equals any of three values
+
+               \param [in] p First code unit to look at
+               \param [in] n Number of code units to look at
+               \param [in] a, b, c Code units to stop at; may repeat
+               \param [in,out] newlines Incremented by the number of '\n' before the stop
+               \returns Index of the first matching code unit, n if there is none
+            */
+            static size_t FindAny(const Utf16Char* p, size_t n,
+                                  Utf16Char a, Utf16Char b, Utf16Char c,
+                                  size_t& newlines);
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Find the first code unit that is not XML whitespace (space, tab, CR, LF)
+
+               \param [in] p First code unit to look at
+               \param [in] n Number of code units to look at
+               \param [in,out] newlines Incremented by the number of '\n' skipped
+               \returns Index of the first code unit that is not whitespace, n if there is none
+            */
+            static size_t SkipSpaces(const Utf16Char* p, size_t n, size_t& newlines);
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Find the first high or low surrogate (0xD800 to 0xDFFF)
+
+               \param [in] p First code unit to look at
+               \param [in] n Number of code units to look at
+               \returns Index of the first surrogate, n if there is none
+            */
+            static size_t FindSurrogate(const Utf16Char* p, size_t n);
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Get the kernel version in use
+            */
+            static Level GetLevel();
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Get the best kernel version this build and CPU support
+            */
+            static Level GetBestLevel();
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Select the kernel version to use, for comparing versions
+
+               \param [in] level Requested version; lowered to GetBestLevel() if not supported
+               \returns The version now in use
+            */
+            static Level SetLevel(Level level);
+        };
+    }
+}
+#endif /* CODEUNITSCAN_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
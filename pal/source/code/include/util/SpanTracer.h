@@ -0,0 +1,184 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+\file        SpanTracer.h
+
+\brief       Records timed, nested spans and writes them as a Chrome trace
+             (Trace Event Format) that loads in chrome://tracing and Perfetto.
+
+*/
+/*----------------------------------------------------------------------------*/
+
+#ifndef SPANTRACER_H
+#define SPANTRACER_H
+
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxsingleton.h>
+#include <scxcorelib/scxthreadlock.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace SCX
+{
+    namespace Util
+    {
+
+        class SpanTracer : public SCXCoreLib::SCXSingleton<SpanTracer>
+        {
+
+            // Making the class a friend to enable destruction
+            friend class SCXCoreLib::SCXSingleton<SpanTracer>;
+
+        public:
+
+            SpanTracer();
+
+            ~SpanTracer()
+            {}
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Start recording spans. Until this is called spans are dropped.
+
+               \param [in]  traceFile   File written by Flush
+
+            */
+            void Enable(const std::string& traceFile);
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Is recording enabled?
+
+            */
+            bool IsEnabled() const
+            {
+                return m_enabled;
+            }
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Open a span on the calling thread
+
+               \param [in]  name        Name shown in the trace viewer
+               \param [in]  category    Category used for filtering in the viewer
+
+               \Return             Id to pass to End, 0 if recording is disabled
+
+            */
+            unsigned long Begin(const std::string& name, const std::string& category);
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Close a span opened by Begin
+
+               \param [in]  id          Id returned by Begin
+
+            */
+            void End(unsigned long id);
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Write all spans recorded so far to the trace file. Spans still open are
+               written as ending now, so a flush right before the process exits still
+               shows what it was in the middle of. The file is replaced atomically, so
+               this can be called again whenever more spans were added.
+
+               \Return             false if the file could not be written
+
+            */
+            bool Flush();
+
+            /*----------------------------------------------------------------------------*/
+            /**
+               Monotonic clock in microseconds
+
+            */
+            static scxulong Now();
+
+        private:
+
+            /** A span; durationUs is only valid once it was closed */
+            struct Span
+            {
+                std::string         name;
+                std::string         category;
+                scxulong            startUs;
+                scxulong            durationUs;
+                long                threadId;
+            };
+
+            // Recording enabled?
+            bool                                   m_enabled;
+
+            // Destination of Flush
+            std::string                            m_traceFile;
+
+            // Timestamps in the trace are relative to this
+            scxulong                               m_originUs;
+
+            // Closed spans in the order they ended
+            std::vector<Span>                      m_spans;
+
+            // Open spans by id
+            std::map<unsigned long, Span>          m_openSpans;
+
+            // Id of the next span
+            unsigned long                          m_nextId;
+
+            // Lock for the span list
+            SCXCoreLib::SCXThreadLockHandle        m_lockHandle;
+        };
+
+        /*----------------------------------------------------------------------------*/
+        /**
+           Times the enclosing scope. Spans nest by time on the same thread, so
+           scopes inside scopes show up as children in the trace viewer.
+        */
+        class ScopedSpan
+        {
+        public:
+
+            ScopedSpan(const std::string& name, const std::string& category)
+              : m_id(SpanTracer::Instance().Begin(name, category))
+            {}
+
+            ~ScopedSpan()
+            {
+                if (0 != m_id)
+                {
+                    SpanTracer::Instance().End(m_id);
+                }
+            }
+
+        private:
+
+            unsigned long       m_id;
+
+            // Spans are tied to a scope
+            ScopedSpan(const ScopedSpan&);
+            ScopedSpan& operator=(const ScopedSpan&);
+        };
+    }
+}
+
+#endif /* SPANTRACER_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
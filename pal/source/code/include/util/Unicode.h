@@ -752,7 +752,7 @@ namespace SCX
 
              \throws        SCXCoreLib::SCXIllegalIndexException<size_t>
             */
-            bool Compare(size_t pos, size_t n, Utf16String& str, bool caseInsensitive = false)
+            bool Compare(size_t pos, size_t n, const Utf16String& str, bool caseInsensitive = false) const
             {
                 if (&str == this)
                 {
@@ -0,0 +1,344 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+    \file        XArenaDocument.h
+
+    \brief       Contains a read-only XML DOM whose nodes live in a single arena
+                 and whose strings point into the parsed buffer
+
+    \date        2026-10-17 16:00:00
+
+*/
+/*----------------------------------------------------------------------------*/
+
+#ifndef XARENADOCUMENT_H
+#define XARENADOCUMENT_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace SCX
+{
+    namespace Util
+    {
+        namespace Xml
+        {
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Bump allocator. Memory is handed out from large blocks and is only
+                   released all at once, by Clear() or the destructor.
+                */
+                class XArena
+                {
+                public:
+                    XArena();
+                    ~XArena();
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Allocate memory that stays valid until the arena is cleared
+
+                       \param [in] size Number of bytes
+                       \return Memory aligned for any of the node types
+                    */
+                    void* Allocate(size_t size);
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Release all memory handed out by the arena
+                    */
+                    void Clear();
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the number of bytes the arena holds from the heap
+                    */
+                    size_t GetReservedSize() const { return m_reserved; }
+
+                private:
+                    XArena(const XArena&);              //!< Intentionally not implemented
+                    XArena& operator=(const XArena&);   //!< Intentionally not implemented
+
+                    // Blocks obtained from the heap
+                    std::vector<char*> m_blocks;
+
+                    // Next free byte and end of the current block
+                    char* m_next;
+                    char* m_end;
+
+                    // Total size of m_blocks
+                    size_t m_reserved;
+                };
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   A string inside the buffer a XArenaDocument was loaded from. The raw
+                   bytes are kept as they appear in the XML; entity and character
+                   references are only decoded when the string is converted.
+                */
+                class XStringView
+                {
+                public:
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the raw bytes, which are not null terminated
+                    */
+                    const char* GetData() const { return m_data; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the number of raw bytes
+                    */
+                    size_t GetSize() const { return m_size; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Determine if the string is empty
+                    */
+                    bool Empty() const { return 0 == m_size; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Determine if the raw bytes contain references that Str() decodes
+                    */
+                    bool HasReferences() const { return m_references; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the string with all references decoded
+
+                       \return The UTF-8 string
+                    */
+                    std::string Str() const;
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Compare the decoded string with a null terminated one
+
+                       \param [in] str UTF-8 string to compare with
+                       \return true if the strings are equal
+                    */
+                    bool Equals(const char* str) const;
+
+                private:
+                    friend class XArenaDocument;
+
+                    const char* m_data;     //!< First raw byte
+                    size_t m_size;          //!< Number of raw bytes
+                    bool m_references;      //!< The raw bytes contain '&'
+                };
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   An attribute of a XArenaElement
+                */
+                class XArenaAttribute
+                {
+                public:
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the name of the attribute
+                    */
+                    const XStringView& GetName() const { return m_name; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the value of the attribute
+                    */
+                    const XStringView& GetValue() const { return m_value; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the next attribute of the same element, NULL after the last one
+                    */
+                    const XArenaAttribute* GetNext() const { return m_next; }
+
+                private:
+                    friend class XArenaDocument;
+
+                    XStringView m_name;             //!< Name, with the prefix stripped if requested
+                    XStringView m_value;            //!< Value
+                    XArenaAttribute* m_next;        //!< Next attribute of the element
+                };
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   An element of a XArenaDocument. Elements are linked to their first
+                   child and next sibling, so walking the tree allocates nothing.
+                */
+                class XArenaElement
+                {
+                public:
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the name of the element
+                    */
+                    const XStringView& GetName() const { return m_name; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the content of the element. As with XElement::Load this is the
+                       last run of character data in the element.
+                    */
+                    const XStringView& GetContent() const { return m_content; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the parent element, NULL for the root
+                    */
+                    const XArenaElement* GetParent() const { return m_parent; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the first child element, NULL if there are none
+                    */
+                    const XArenaElement* GetFirstChild() const { return m_firstChild; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the next element with the same parent, NULL after the last one
+                    */
+                    const XArenaElement* GetNextSibling() const { return m_nextSibling; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the first attribute, NULL if there are none
+                    */
+                    const XArenaAttribute* GetFirstAttribute() const { return m_firstAttribute; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the number of child elements
+                    */
+                    size_t GetChildCount() const { return m_childCount; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the first child element with a name
+
+                       \param [in] name Name of the child
+                       \return The child, NULL if there is none with that name
+                    */
+                    const XArenaElement* GetChild(const char* name) const;
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the value of an attribute
+
+                       \param [in] name Name of the attribute
+                       \return The attribute value, NULL if the element has no such attribute
+                    */
+                    const XStringView* GetAttributeValue(const char* name) const;
+
+                private:
+                    friend class XArenaDocument;
+
+                    XStringView m_name;                     //!< Name, with the prefix stripped if requested
+                    size_t m_prefixSize;                    //!< Bytes stripped from the front of the name
+                    XStringView m_content;                  //!< Last run of character data
+                    XArenaElement* m_parent;                //!< Parent element
+                    XArenaElement* m_firstChild;            //!< First child element
+                    XArenaElement* m_lastChild;             //!< Last child element, to append in constant time
+                    XArenaElement* m_nextSibling;           //!< Next element with the same parent
+                    XArenaAttribute* m_firstAttribute;      //!< First attribute
+                    XArenaAttribute* m_lastAttribute;       //!< Last attribute, to append in constant time
+                    size_t m_childCount;                    //!< Number of child elements
+                };
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Read-only alternative to XElement::Load for large documents.
+
+                   All elements and attributes of a document are allocated from one
+                   XArena and freed together when the document is cleared or destroyed.
+                   Names, values and content are XStringViews into the loaded buffer
+                   instead of copies, so the buffer must outlive the document.
+
+                   Names are handled as XElement::Load handles them: prefixes are
+                   stripped if requested, a default xmlns attribute is dropped and
+                   prefixed xmlns attributes are kept as they are. Comments, processing
+                   instructions and the DOCTYPE are skipped.
+                */
+                class XArenaDocument
+                {
+                public:
+                    XArenaDocument();
+                    ~XArenaDocument();
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Parse a document, replacing the one loaded before
+
+                       \param [in] data UTF-8 XML; must stay unchanged while the document is used
+                       \param [in] size Number of bytes in data
+                       \param [in] stripNamespaces Strip the prefixes of names as they are loaded
+                       \throws XmlException if the XML is not well formed
+                    */
+                    void Load(const char* data, size_t size, bool stripNamespaces = true);
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Release the elements of the loaded document
+                    */
+                    void Clear();
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the root element, NULL if nothing is loaded
+                    */
+                    const XArenaElement* GetRoot() const { return m_root; }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                       Get the number of bytes the document holds from the heap
+                    */
+                    size_t GetReservedSize() const { return m_arena.GetReservedSize(); }
+
+                private:
+                    XArenaDocument(const XArenaDocument&);              //!< Intentionally not implemented
+                    XArenaDocument& operator=(const XArenaDocument&);   //!< Intentionally not implemented
+
+                    XArena m_arena;                 //!< Holds all elements and attributes
+                    const XArenaElement* m_root;    //!< Root element
+
+                    // Parser state, only valid during Load
+                    const char* m_begin;
+                    const char* m_pos;
+                    const char* m_end;
+                    bool m_stripNamespaces;
+
+                    void Parse();
+                    void Raise(const char* message) const;
+                    void SkipSpaces();
+                    bool StartsWith(const char* str) const;
+                    void SkipPast(const char* str);
+                    void SkipDoctype();
+                    XStringView ParseName();
+                    void StripPrefix(XStringView& name, size_t& prefixSize) const;
+                    XStringView ParseText(char stop);
+                    XArenaElement* ParseStartTag(XArenaElement* parent, bool& empty);
+                    void ParseEndTag(const XArenaElement* elem);
+                };
+        }
+    }
+}
+#endif /* XARENADOCUMENT_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -78,8 +78,7 @@ namespace SCX
                    Most the requirements for the XML processing for the client requires a lot of
                    in memory processing. In memory processing are applicable for small XML files.
                    
-                   \warning There are two outstanding bugs that will be fixed in the future
-                   \li The static method Load needs to be made thread safe
+                   \warning There is an outstanding bug that will be fixed in the future
                    \li Protect against adding looping children
                 */
                 class XElement
@@ -227,8 +226,8 @@ namespace SCX
                        \param [out] element The loaded xml's root element
                        \param [in] Strip namespaces as they are loaded
 
-                       This is a static method and is thread safe. The thread safety might cause the
-                       loading of "large" xml files slow.
+                       This is a static method and is thread safe. Each call parses with its own
+                       reader, so documents loaded on different threads are parsed in parallel.
                     */
                     static void Load(const Utf8String& xmlString, XElementPtr& element, bool stripNamespaces = true);
                     
@@ -438,8 +437,6 @@ namespace SCX
                     // Faulty XML Component(XML string, name, value, attribute) thats causing the exception
                     Utf8String m_xmlComponent;
                 };
-
-                static SCXCoreLib::SCXThreadLockHandle XElementLoadLock(L"XElement::Load");
         }
     }
 }
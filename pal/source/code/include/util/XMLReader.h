@@ -28,7 +28,7 @@
 /*----------------------------------------------------------------------------*/
 
 
-#ifndef _XML_READER_H_
+#ifndef XML_READER_H_
 #define XML_READER_H_
 
 #include <util/Unicode.h>
@@ -111,6 +111,57 @@ namespace SCX {
                 };
                 typedef SCXCoreLib::SCXHandle<XML_NameSpace> pXML_NameSpace;
 
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Kinds of events produced by XMLReader::XML_NextEvent
+                */
+                enum XML_EventType
+                {
+                    XML_EVENT_START = 0,    // Start tag; the attributes follow as separate events
+                    XML_EVENT_ATTRIBUTE,    // Attribute of the element that was just started
+                    XML_EVENT_TEXT,         // Character data (including CDATA) of the current element
+                    XML_EVENT_END           // End tag, also produced for empty tags (<foo/>)
+                };
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   A single event of the streaming interface of XMLReader.  Comments and
+                   processing instructions do not produce events.
+                */
+                struct XML_Event
+                {
+                    // What happened
+                    XML_EventType type;
+
+                    // Element name for START, ATTRIBUTE and END, attribute name for ATTRIBUTE
+                    Utf8String name;
+
+                    // Attribute value for ATTRIBUTE, the character data for TEXT
+                    Utf8String value;
+
+                    // Nesting level of the element the event belongs to; the root is at 1
+                    size_t depth;
+                };
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Callback interface for XMLReader::XML_Parse
+                */
+                class XML_EventHandler
+                {
+                    public:
+                        virtual ~XML_EventHandler() {};
+
+                        /*----------------------------------------------------------------------------*/
+                        /**
+                           Handle the next event of the document
+
+                           \param [in] event - The event
+                           \returns    false to stop parsing, true to continue
+                        */
+                        virtual bool XML_OnEvent(const XML_Event& event) = 0;
+                };
+
                 /*----------------------------------------------------------------------------*/
                 /**
                    This is the primary class for the reading side of the parser.  It
@@ -119,6 +170,10 @@ namespace SCX {
                    pCXElement objects, which are the individual elements of the input XML.
 
                    The input XML is destroyed during processing.
+
+                   All parser state, including the namespace tables, lives in the instance,
+                   so separate readers can parse on separate threads at the same time.  A
+                   single reader must not be shared between threads.
                    
                    \date        11-13-11 16:01:13
                 */
@@ -199,10 +254,29 @@ namespace SCX {
                         // Strip the namespace name from the element (default TRUE)
                         bool m_stripNamespaces;
 
+                        // Element that XML_NextEvent parses into
+                        pCXElement m_EventElem;
+
+                        // Attributes of m_EventElem that XML_NextEvent has still to return
+                        size_t m_EventAttr;
+                        size_t m_EventAttrCount;
+
                     protected:
-                        // SCX Log Handle
+                        // SCX Log Handle, only valid once LogHandle() has been called
                         SCXCoreLib::SCXLogHandle m_logHandle;
 
+                        // Has m_logHandle been looked up?
+                        bool m_logHandleSet;
+
+                        /*----------------------------------------------------------------------------*/
+                        /**
+                           Get the log handle, looking it up on first use
+                       
+                           \returns    The log handle
+                       
+                        */
+                        const SCXCoreLib::SCXLogHandle& LogHandle( void );
+
                     private:
                         /*----------------------------------------------------------------------------*/
                         /**
@@ -254,6 +328,22 @@ namespace SCX {
                         void _SkipSpacesAux(Utf8String& p);
                         void _SkipSpaces(Utf8String& p);
 
+                        /*----------------------------------------------------------------------------*/
+                        /**
+                           Advance the pointer to the first of three characters or the end of input,
+                           counting the new lines passed
+
+                           \param [in] a, b, c - The characters to stop at
+                        */
+                        void _ScanTo(Utf16Char a, Utf16Char b, Utf16Char c);
+
+                        /*----------------------------------------------------------------------------*/
+                        /**
+                           Get the code units from the current position to the end of input
+                        */
+                        const Utf16Char* _Cursor( void ) { return m_InternalString.data() + m_CharPos; };
+                        size_t _Remaining( void ) { return m_CharPos < m_InternalString.Size() ? m_InternalString.Size() - m_CharPos : 0; };
+
                         /*----------------------------------------------------------------------------*/
                         /**
                            Change an entity string to the single dharacter it represents
@@ -433,7 +523,9 @@ namespace SCX {
                              XML_NAMESPACE_NONE(0),
                              m_CharStartPos(m_InternalString.Begin()),
                              m_CharPos(0),
-                             m_logHandle(LogHandleCache::Instance().GetLogHandle(std::string("scx.client.utilities.xml.XMLReader"))) {};
+                             m_EventAttr(0),
+                             m_EventAttrCount(0),
+                             m_logHandleSet(false) {};
 
                         /*----------------------------------------------------------------------------*/
                         /**
@@ -482,6 +574,26 @@ namespace SCX {
                         */
                         int XML_Next(pCXElement& elem);
 
+                        /*----------------------------------------------------------------------------*/
+                        /**
+                           Process the string up to the next event.  Only the open tags are kept,
+                           so scanning a document this way needs memory proportional to its depth
+                           rather than to its size, and the caller may stop at any event.
+
+                           \param [out] event - The event that was read
+                           \returns    0 = an event was read, 1 = done, -1 = error
+                        */
+                        int XML_NextEvent(XML_Event& event);
+
+                        /*----------------------------------------------------------------------------*/
+                        /**
+                           Pass all events of the string to a handler until it asks to stop
+
+                           \param [in] handler - Receives the events
+                           \returns    0 = the handler stopped early, 1 = done, -1 = error
+                        */
+                        int XML_Parse(XML_EventHandler& handler);
+
                         /*----------------------------------------------------------------------------*/
                         /**
                            Make sure that the next element in the string is the required type and has the correct name
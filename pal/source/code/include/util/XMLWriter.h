@@ -339,6 +339,17 @@ namespace SCX {
                         */
                         inline void ClearChild( void ) { m_listChild.clear(); };
 
+                        /*----------------------------------------------------------------------------*/
+                        /**
+                           Encode text the way Save writes element text and attribute values
+                       
+                           \param [in/out] sOut   - The string to which the encoded text will be appended
+                           \param [in]     TextIn - The string containing the text to be encoded
+                           \returns        None
+                       
+                        */
+                        static void EncodeText(Utf8String& sOut, const Utf8String& TextIn);
+
                     private:
                         // information about an attribute
                         class CXAttribute
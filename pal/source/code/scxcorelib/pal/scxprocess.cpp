@@ -33,6 +33,7 @@
 #endif
 #include <scxcorelib/scxcmn.h>
 #include <scxcorelib/scxprocess.h>
+#include <scxcorelib/scxprocesstimeout.h>
 #include <scxcorelib/scxoserror.h>
 #include <scxcorelib/stringaid.h>
 #include <scxcorelib/scxmath.h>
@@ -40,6 +41,7 @@
 #include <scxcorelib/scxexception.h>
 
 #include <iostream>
+#include <streambuf>
 #include <stdio.h>
 #include <vector>
 #include <stdio.h>
@@ -60,8 +62,183 @@
 #include <signal.h>
 #endif
 
+#if defined(linux)
+#include <sched.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#endif
+
 #include <errno.h>
 
+#if !defined(WIN32)
+namespace
+{
+    //! Create a pipe with both ends close-on-exec
+    bool CreateCloseOnExecPipe(int fds[2])
+    {
+#if defined(linux)
+        return 0 == pipe2(fds, O_CLOEXEC);
+#else
+        if (0 != pipe(fds))
+        {
+            return false;
+        }
+        if (-1 == fcntl(fds[0], F_SETFD, FD_CLOEXEC) || -1 == fcntl(fds[1], F_SETFD, FD_CLOEXEC))
+        {
+            int err = errno;
+            close(fds[0]);
+            close(fds[1]);
+            errno = err;
+            return false;
+        }
+        return true;
+#endif
+    }
+}
+#endif
+
+#if defined(linux)
+namespace
+{
+    //! Everything the child of a vfork-style clone needs, prepared by the parent
+    //! because the child shares the parent's memory and must not allocate
+    struct VforkChildArgs
+    {
+        char* const* argv;          //!< Arguments, null terminated
+        int stdinFd;                //!< Read end of the stdin pipe
+        int stdoutFd;               //!< Write end of the stdout pipe
+        int stderrFd;               //!< Write end of the stderr pipe
+        const char* cwd;            //!< Working directory or NULL
+        const char* chrootPath;     //!< Root directory or NULL
+        sigset_t sigmask;           //!< Signal mask to restore before exec
+    };
+
+    //! Append a string to a fixed buffer, truncating at its end
+    void VforkChildAppend(char* buffer, size_t size, size_t& length, const char* str)
+    {
+        for (; '\0' != *str && length + 1 < size; ++str)
+        {
+            buffer[length++] = *str;
+        }
+        buffer[length] = '\0';
+    }
+
+    //! Report a failure on stderr of the child and exit the way CloseAndDie() does.
+    //! snprintf is not async-signal-safe, so the message is put together by hand
+    //! as "<what>[ '<name>'] errno=<err>".
+    void VforkChildDie(const char* what, const char* name, int err)
+    {
+        char error_msg[1024];
+        size_t length = 0;
+        error_msg[0] = '\0';
+
+        VforkChildAppend(error_msg, sizeof(error_msg), length, what);
+        if (NULL != name)
+        {
+            VforkChildAppend(error_msg, sizeof(error_msg), length, " '");
+            VforkChildAppend(error_msg, sizeof(error_msg), length, name);
+            VforkChildAppend(error_msg, sizeof(error_msg), length, "'");
+        }
+        VforkChildAppend(error_msg, sizeof(error_msg), length, " errno=");
+
+        char digits[16];
+        size_t count = 0;
+        unsigned int value = err < 0 ? 0 : static_cast<unsigned int>(err);
+        do
+        {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (0 != value && count < sizeof(digits));
+        while (count > 0 && length + 1 < sizeof(error_msg))
+        {
+            error_msg[length++] = digits[--count];
+        }
+        error_msg[length] = '\0';
+
+        ssize_t ret = write(STDERR_FILENO, error_msg, length);
+        (void) ret;
+        _exit(1);
+    }
+
+    //! Close all file descriptors from fd up
+    void CloseFrom(int fd)
+    {
+#if defined(__NR_close_range)
+        if (0 == syscall(__NR_close_range, fd, ~0U, 0))
+        {
+            return;
+        }
+#endif
+        // Kernels before 5.9: same limit as the fork() path
+        int fdLimit = getdtablesize();
+        if (fdLimit > 2500)
+        {
+            fdLimit = 2500;
+        }
+        for (; fd < fdLimit; ++fd)
+        {
+            close(fd);
+        }
+    }
+
+    //! Child side of SCXProcess::SpawnChild. The parent is suspended until
+    //! this execs or exits. Only async-signal-safe calls are made here.
+    int VforkChild(void* param)
+    {
+        VforkChildArgs* args = static_cast<VforkChildArgs*>(param);
+
+        // Handlers of the parent must not run in the child; the signal
+        // table is not shared, so this does not affect the parent
+        for (int sig = 1; sig < _NSIG; ++sig)
+        {
+            struct sigaction sa;
+            if (0 == sigaction(sig, NULL, &sa) &&
+                SIG_IGN != sa.sa_handler && SIG_DFL != sa.sa_handler)
+            {
+                sa.sa_handler = SIG_DFL;
+                sa.sa_flags = 0;
+                sigemptyset(&sa.sa_mask);
+                sigaction(sig, &sa, NULL);
+            }
+        }
+
+        // Own process group, so that Kill() reaches the whole tree. The
+        // parent resumes after exec, so it cannot observe it unset.
+        setpgid(0, 0);
+
+        // The pipes are close-on-exec; the duplicates are not
+        dup2(args->stdinFd, STDIN_FILENO);
+        dup2(args->stdoutFd, STDOUT_FILENO);
+        dup2(args->stderrFd, STDERR_FILENO);
+
+        if (NULL != args->chrootPath)
+        {
+            if (0 != ::chroot(args->chrootPath))
+            {
+                VforkChildDie("Failed to chroot", args->chrootPath, errno);
+            }
+            if (0 != ::chdir("/"))
+            {
+                VforkChildDie("Failed to change root directory.", NULL, errno);
+            }
+        }
+        if (NULL != args->cwd && 0 != ::chdir(args->cwd))
+        {
+            VforkChildDie("Failed to change cwd.", NULL, errno);
+        }
+
+        CloseFrom(3);
+
+        sigprocmask(SIG_SETMASK, &args->sigmask, NULL);
+
+        execvp(args->argv[0], args->argv);
+        VforkChildDie("Failed to start child process", args->argv[0], errno);
+        return 1;
+    }
+}
+#endif
+
 namespace SCXCoreLib
 {
  
@@ -223,78 +400,6 @@ namespace SCXCoreLib
     }
     
 
-    /**********************************************************************************/
-    //! Class for running a process with an option to timeout 
-    class ProcessThreadParam : public SCXThreadParam
-    {   
-    public:
-        //! Constructor that starts a process
-        //! \param[in]  process     Process to monitor
-        //! \param[in]  timeout     Accepted wait before process terminates
-        ProcessThreadParam(SCXProcess *process, unsigned timeout)
-            : m_process(process), m_processTerminated(false), m_timeout(timeout)
-        {
-        }
-
-        /**********************************************************************************/
-        //! Wait for the process to terminate
-        //! \param[in]  mystdin     Represents stdin of process
-        //! \param[in]  mystdout    Represents stdout of process
-        //! \param[in]  mystderr    Represents stderr of process
-        //! \returns Return code from process being run.
-        int WaitForReturn(std::istream &mystdin, std::ostream &mystdout, std::ostream &mystderr)
-        {               
-            int returnCode = -1;
-            try 
-            {
-                returnCode =  m_process->WaitForReturn(mystdin, mystdout, mystderr);
-                m_processTerminated = true;
-            }
-            catch (...)
-            {
-                m_processTerminated = true;
-                throw;
-            }
-            return returnCode;
-        }
-
-        /**********************************************************************************/
-        //! Wait a limited amount of time for the process to terminate.
-        void WaitForReturn() 
-        {
-            // Good enough way of waiting for the process
-            int timeoutLeft = m_timeout;             
-            while (timeoutLeft > 0 && !m_processTerminated)
-            {
-                const int timeBetweenChecks = 1000;
-                SCXThread::Sleep(timeBetweenChecks);
-                timeoutLeft -= timeBetweenChecks;
-            }
-            if (!m_processTerminated)
-            {
-                m_process->Kill();
-            }
-        }
-
-    private:
-        ProcessThreadParam(const ProcessThreadParam &);             //!< Prevent copying               
-        ProcessThreadParam &operator=(const ProcessThreadParam &);  //!< Prevent assignment
-
-        SCXProcess *m_process;      //!< Process to run
-        bool m_processTerminated;   //!< True iff the process has terminated
-        unsigned m_timeout;              //!< Accepted wait before termination
-    };
-
-    /**********************************************************************************/
-    //! Monitors the process
-    //! \param[in]  handle      Parameters of thread
-    //! \note Meant to be called in a separate thread by being passed as argument to Thread constructor
-    void WaitForReturnFn(SCXCoreLib::SCXThreadParamHandle& handle)
-    {        
-        ProcessThreadParam* param = static_cast<ProcessThreadParam *>(handle.GetData());
-        param->WaitForReturn();
-    }
-
     /**********************************************************************************/
     //! Helper function to determine effective timeout duration.
     //! \param[in]  timeout   The specified timeout duration set by the creator of the SCXProcess
@@ -345,24 +450,102 @@ namespace SCXCoreLib
     int SCXProcess::Run(SCXProcess& process, 
                         std::istream &mystdin, std::ostream &mystdout, std::ostream &mystderr, unsigned timeout /*= 0*/)
     {
-        int returnCode = -1;
         if (timeout <= 0)
+        {
+            return process.WaitForReturn(mystdin, mystdout, mystderr);
+        }
+
+        // One shared thread kills the process group if the deadline passes
+        SCXProcessTimeoutService& timeouts = SCXProcessTimeoutService::Instance();
+        SCXProcessTimeoutId deadline = timeouts.Register(process, timeout);
+        int returnCode = -1;
+        try
         {
             returnCode = process.WaitForReturn(mystdin, mystdout, mystderr);
         }
-        else
+        catch (...)
         {
-            ProcessThreadParam *ptp = new ProcessThreadParam(&process, timeout);
-            //ptp = 0;
-            SCXThreadParamHandle tph(ptp);
-
-            SCXThread t(WaitForReturnFn, tph);
-            returnCode = ptp->WaitForReturn(mystdin, mystdout, mystderr);
-            t.Wait();
+            timeouts.Cancel(deadline);
+            throw;
         }
+        timeouts.Cancel(deadline);
         return returnCode;
     }
 
+    namespace
+    {
+        //! Unbuffered stream buffer that passes everything written to it on to a sink
+        class SinkStreamBuf : public std::streambuf
+        {
+        public:
+            //! Constructor
+            //! \param[in]  sink    Receiver of the data
+            SinkStreamBuf(SCXProcessOutputSink& sink)
+                : m_sink(sink)
+            {
+            }
+
+        protected:
+            //! Pass a block on without copying it
+            virtual std::streamsize xsputn(const char* s, std::streamsize n)
+            {
+                m_sink.Write(s, static_cast<size_t>(n));
+                return n;
+            }
+
+            //! Pass a single character on
+            virtual int_type overflow(int_type c)
+            {
+                if (!traits_type::eq_int_type(c, traits_type::eof()))
+                {
+                    char ch = traits_type::to_char_type(c);
+                    m_sink.Write(&ch, 1);
+                }
+                return traits_type::not_eof(c);
+            }
+
+        private:
+            SCXProcessOutputSink& m_sink;     //!< Receiver of the data
+        };
+    }
+
+    /**********************************************************************************/
+    //! Run a process, handing its output to sinks as it arrives instead of collecting it
+    //! \param[in]  command     Corresponding to what would be entered by a user in a command shell
+    //! \param[in]  mystdin     stdin for the process
+    //! \param[in]  mystdout    Receives stdout of the process
+    //! \param[in]  mystderr    Receives stderr of the process
+    //! \param[in]  timeout     Max number of milliseconds the process is allowed to run (0 means no limit)
+    //! \param[in]  cwd         Directory to be set as current working directory for process.
+    //! \param[in]  chrootPath  Directory to be used for chrooting process.
+    //! \returns exit code of run process.
+    //! \throws     SCXInternalErrorException           Failure that could not be prevented
+    //! \note   The sinks are called from the calling thread and should not block.
+    int SCXProcess::Run(const std::wstring &command,
+                        std::istream &mystdin,
+                        SCXProcessOutputSink &mystdout,
+                        SCXProcessOutputSink &mystderr,
+                        unsigned timeout,
+                        const SCXFilePath& cwd/* = SCXFilePath()*/,
+                        const SCXFilePath& chrootPath /* = SCXFilePath() */)
+    {
+        SinkStreamBuf stdoutBuf(mystdout);
+        SinkStreamBuf stderrBuf(mystderr);
+        std::ostream stdoutStream(&stdoutBuf);
+        std::ostream stderrStream(&stderrBuf);
+        return Run(SplitCommand(command), mystdin, stdoutStream, stderrStream, timeout, cwd, chrootPath);
+    }
+
+    bool SCXProcess::s_forceFork = false;
+
+    /**********************************************************************************/
+    //! Select how child processes are launched, e.g. to compare the two
+    //! \param[in]  forceFork   Always use fork(), even where a vfork-style clone is available
+    void SCXProcess::ForceFork(bool forceFork)
+    {
+        s_forceFork = forceFork;
+    }
+
     /**********************************************************************************/
     //! Constructor
     //! \param[in]  myargv       Arguments to process
@@ -390,17 +573,28 @@ namespace SCXCoreLib
         }
         m_cargv.push_back(0);
         
-        // Create pipes for communicating with the child process
-        if ( -1 == pipe(m_inForChild) ) {
+        // Create pipes for communicating with the child process. They are
+        // close-on-exec from the start, so children launched elsewhere in the
+        // process never hold them open and hide the end of the output.
+        if ( !CreateCloseOnExecPipe(m_inForChild) ) {
                throw SCXInternalErrorException(L"Failed to open pipe for m_inForChild", SCXSRCLOCATION);
         }
-        if (-1 == pipe(m_outForChild) ) {
+        if ( !CreateCloseOnExecPipe(m_outForChild) ) {
                throw SCXInternalErrorException(L"Failed to open pipe for m_outForChild", SCXSRCLOCATION);
         }
-        if ( -1 == pipe(m_errForChild) ) {
+        if ( !CreateCloseOnExecPipe(m_errForChild) ) {
                throw SCXInternalErrorException(L"Failed to open pipe for m_errForChild", SCXSRCLOCATION);
         }
 
+#if defined(linux)
+        // Launch without duplicating the address space where possible
+        if (!s_forceFork && SpawnChild(StrToMultibyte(cwd.Get()), StrToMultibyte(chrootPath.Get())))
+        {
+            SetUpParentPipes();
+            return;
+        }
+#endif
+
         // A 'magic number' that is passed to the parent to signify that this process has had its pgid set.
         const char * c_magicGUID = "b4360097-03d5-4d1d-9514-176428bcd88f";
         const ssize_t c_magicGUID_length = 36;
@@ -483,40 +677,7 @@ namespace SCXCoreLib
         else
         {
             // Same (parent) process.
-            // All file descriptors were duplicated in the child process by "fork"
-            close(m_inForChild[R]);                   // Only the child process reads from its stdin
-            close(m_outForChild[W]);                  // Only the child process writes to its stdout
-            close(m_errForChild[W]);                  // Only the child process writes to its stderr
-            if (m_pid < 0)
-            {
-                // Free remaining resources held by the parent process
-                // The child process manages its own resources
-                close(m_inForChild[W]);
-                close(m_outForChild[R]);
-                close(m_errForChild[R]);
-
-                // Free everything except the terminating NULL
-                for (std::vector<char *>::size_type i = 0; i < m_cargv.size() - 1; i++)
-                {
-                    free(m_cargv[i]);
-                }
-                //  No child process was created
-                throw SCXInternalErrorException(UnexpectedErrno(L"Process communication failed", errno), SCXSRCLOCATION);
-            }
-
-            // Set non-blocking I/O for the output and error channels
-            // We need to use this to insure we have all our data from
-            // the subprocess ...
-
-            if (-1 == fcntl(m_outForChild[R], F_SETFL, O_NONBLOCK))
-            {
-                throw SCXInternalErrorException(UnexpectedErrno(L"Failed to set non-blocking I/O on stdout pipe", errno), SCXSRCLOCATION);
-            }
-
-            if (-1 == fcntl(m_errForChild[R], F_SETFL, O_NONBLOCK))
-            {
-                throw SCXInternalErrorException(UnexpectedErrno(L"Failed to set non-blocking I/O on stderr pipe", errno), SCXSRCLOCATION);
-            }
+            SetUpParentPipes();
 
             // Block until c_magicGUID is written to the child's stdout. This is to prevent a race condition
             // where the parent process attempts to kill the child's process group before the child process
@@ -563,6 +724,91 @@ namespace SCXCoreLib
         }
     }
 
+    /**********************************************************************************/
+    //! Close the child's ends of the pipes and prepare ours for reading
+    //! \throws SCXInternalErrorException if no child process was created
+    void SCXProcess::SetUpParentPipes()
+    {
+        // All file descriptors were duplicated in the child process
+        close(m_inForChild[R]);                   // Only the child process reads from its stdin
+        close(m_outForChild[W]);                  // Only the child process writes to its stdout
+        close(m_errForChild[W]);                  // Only the child process writes to its stderr
+        if (m_pid < 0)
+        {
+            int err = errno;
+
+            // Free remaining resources held by the parent process
+            // The child process manages its own resources
+            close(m_inForChild[W]);
+            close(m_outForChild[R]);
+            close(m_errForChild[R]);
+
+            // Free everything except the terminating NULL
+            for (std::vector<char *>::size_type i = 0; i < m_cargv.size() - 1; i++)
+            {
+                free(m_cargv[i]);
+            }
+            //  No child process was created
+            throw SCXInternalErrorException(UnexpectedErrno(L"Process communication failed", err), SCXSRCLOCATION);
+        }
+
+        // Set non-blocking I/O for the output and error channels
+        // We need to use this to insure we have all our data from
+        // the subprocess ...
+
+        if (-1 == fcntl(m_outForChild[R], F_SETFL, O_NONBLOCK))
+        {
+            throw SCXInternalErrorException(UnexpectedErrno(L"Failed to set non-blocking I/O on stdout pipe", errno), SCXSRCLOCATION);
+        }
+
+        if (-1 == fcntl(m_errForChild[R], F_SETFL, O_NONBLOCK))
+        {
+            throw SCXInternalErrorException(UnexpectedErrno(L"Failed to set non-blocking I/O on stderr pipe", errno), SCXSRCLOCATION);
+        }
+    }
+
+#if defined(linux)
+    /**********************************************************************************/
+    //! Launch the child with clone(CLONE_VM | CLONE_VFORK): nothing is copied, and
+    //! the calling thread resumes once the child has exec'ed, with its process
+    //! group already set.
+    //! \param[in]  cwd         Working directory, empty for the current one
+    //! \param[in]  chrootPath  Root directory, empty for no chroot
+    //! \returns false if the clone failed; fall back to fork()
+    bool SCXProcess::SpawnChild(const std::string& cwd, const std::string& chrootPath)
+    {
+        VforkChildArgs args;
+        args.argv = &m_cargv[0];
+        args.stdinFd = m_inForChild[R];
+        args.stdoutFd = m_outForChild[W];
+        args.stderrFd = m_errForChild[W];
+        args.cwd = cwd.empty() ? NULL : cwd.c_str();
+        args.chrootPath = chrootPath.empty() ? NULL : chrootPath.c_str();
+
+        // The child runs on its own stack in our address space; execvp needs
+        // room for the PATH search
+        std::vector<char> stack(64 * 1024);
+
+        // No signal handler may run in the child before it has reset them
+        sigset_t all;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &args.sigmask);
+
+        pid_t pid = clone(VforkChild, &stack[0] + stack.size(),
+                          CLONE_VM | CLONE_VFORK | SIGCHLD, &args);
+
+        pthread_sigmask(SIG_SETMASK, &args.sigmask, NULL);
+
+        if (pid < 0)
+        {
+            return false;
+        }
+
+        m_pid = pid;
+        return true;
+    }
+#endif
+
     /**********************************************************************************/
     //! Send input to process
     //! \param[in]  mystdin     Source
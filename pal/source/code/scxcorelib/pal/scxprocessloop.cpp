@@ -0,0 +1,503 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+    \file
+
+    \brief       Implements the event loop that runs many child processes from
+                 a single thread.
+
+    \date        2026-10-17 10:00:00
+
+*/
+/*----------------------------------------------------------------------------*/
+
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxexception.h>
+#include <scxcorelib/scxoserror.h>
+#include <scxcorelib/scxprocessloop.h>
+#include <scxcorelib/stringaid.h>
+
+#if defined(linux)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    const int cReapTickMs = 50;             //!< How often children without pidfd are checked for exit
+    const int cMaxEvents = 64;              //!< Events handled per epoll_wait
+
+    //! Open a descriptor that becomes readable when the process exits
+    //! \returns The descriptor, or -1 if the kernel does not support pidfds
+    int PidFdOpen(pid_t pid)
+    {
+#if defined(__NR_pidfd_open)
+        return static_cast<int>(syscall(__NR_pidfd_open, pid, 0));
+#else
+        (void) pid;
+        return -1;
+#endif
+    }
+}
+
+namespace SCXCoreLib
+{
+    /*----------------------------------------------------------------------------*/
+    /**
+        Constructor.
+
+        \throws SCXInternalErrorException if the epoll instance cannot be created
+    */
+    SCXProcessLoop::SCXProcessLoop()
+        : m_logHandle(SCXLogHandleFactory::GetLogHandle(L"scx.core.common.pal.processloop")),
+          m_epollFd(-1),
+          m_polledChildren(0)
+    {
+        m_epollFd = epoll_create(cMaxEvents);
+        if (m_epollFd < 0)
+        {
+            throw SCXInternalErrorException(UnexpectedErrno(L"Failed to create epoll instance", errno), SCXSRCLOCATION);
+        }
+        fcntl(m_epollFd, F_SETFD, FD_CLOEXEC);
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Destructor. Kills and reaps the children that are still running; their
+        completion callbacks are not called.
+    */
+    SCXProcessLoop::~SCXProcessLoop()
+    {
+        for (std::map<SCXProcessId, Child>::iterator it = m_children.begin(); it != m_children.end(); ++it)
+        {
+            SCX_LOGWARNING(m_logHandle, StrAppend(L"Killing child process left in the loop, pid ", it->first));
+            if (0 != it->second.timeoutId)
+            {
+                SCXProcessTimeoutService::Instance().Cancel(it->second.timeoutId);
+            }
+            try
+            {
+                it->second.process->Kill();
+            }
+            catch (SCXException& e)
+            {
+                SCX_LOGWARNING(m_logHandle, e.What());
+            }
+            it->second.process->DoWaitPID(NULL, true);
+            if (it->second.pidFd >= 0)
+            {
+                close(it->second.pidFd);
+            }
+        }
+        close(m_epollFd);
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Start a process. It runs while the loop is polled.
+
+        \param[in] myargv       Arguments of the process, the first one being the program
+        \param[in] input        Data written to stdin of the process, which is closed after
+        \param[in] timeout      Milliseconds after which the process group is killed, 0 for no limit
+        \param[in] completion   Called when the process has terminated, may be null
+        \param[in] cwd          Working directory of the process
+        \param[in] chrootPath   Directory to chroot the process to
+        \returns Result of the process, completed once it has terminated
+        \throws SCXInternalErrorException if the process cannot be started
+    */
+    SCXHandle<SCXProcessResult> SCXProcessLoop::Start(const std::vector<std::wstring>& myargv,
+                                                      const std::string& input,
+                                                      unsigned timeout,
+                                                      SCXHandle<SCXProcessCompletion> completion,
+                                                      const SCXFilePath& cwd,
+                                                      const SCXFilePath& chrootPath)
+    {
+        SCXHandle<SCXProcess> process(new SCXProcess(myargv, cwd, chrootPath));
+        SCXProcessId pid = process->m_pid;
+
+        Child& child = m_children[pid];
+        child.process = process;
+        child.result = new SCXProcessResult();
+        child.result->pid = pid;
+        child.completion = completion;
+        child.input = input;
+        child.inputSent = 0;
+        child.pidFd = PidFdOpen(pid);
+        child.timeoutId = 0;
+
+        try
+        {
+            int flags = fcntl(process->m_inForChild[SCXProcess::W], F_GETFL, 0);
+            fcntl(process->m_inForChild[SCXProcess::W], F_SETFL, flags | O_NONBLOCK);
+
+            if (input.empty())
+            {
+                Unwatch(process->m_inForChild[SCXProcess::W]);
+            }
+            else
+            {
+                Watch(process->m_inForChild[SCXProcess::W], pid, EPOLLOUT);
+            }
+            Watch(process->m_outForChild[SCXProcess::R], pid, EPOLLIN);
+            Watch(process->m_errForChild[SCXProcess::R], pid, EPOLLIN);
+            if (child.pidFd >= 0)
+            {
+                Watch(child.pidFd, pid, EPOLLIN);
+            }
+        }
+        catch (SCXException&)
+        {
+            Unwatch(process->m_inForChild[SCXProcess::W]);
+            Unwatch(process->m_outForChild[SCXProcess::R]);
+            Unwatch(process->m_errForChild[SCXProcess::R]);
+            Unwatch(child.pidFd);
+            process->Kill();
+            process->DoWaitPID(NULL, true);
+            m_children.erase(pid);
+            throw;
+        }
+
+        if (child.pidFd < 0)
+        {
+            m_polledChildren++;
+        }
+        if (timeout > 0)
+        {
+            child.timeoutId = SCXProcessTimeoutService::Instance().Register(*process, timeout);
+        }
+
+        SCX_LOGTRACE(m_logHandle, StrAppend(L"Started child process, pid ", pid));
+        return child.result;
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Wait for events of the children and handle them. Completion callbacks of
+        children that terminated are called before returning.
+
+        \param[in] waitMs   Longest time to wait for an event, -1 to wait until one arrives
+        \returns Number of children still running
+        \throws SCXInternalErrorException if waiting for events fails
+    */
+    size_t SCXProcessLoop::Poll(int waitMs)
+    {
+        if (m_children.empty())
+        {
+            return 0;
+        }
+
+        struct epoll_event events[cMaxEvents];
+        int count = epoll_wait(m_epollFd, events, cMaxEvents, NextTimeout(waitMs));
+        if (count < 0)
+        {
+            if (EINTR != errno)
+            {
+                throw SCXInternalErrorException(UnexpectedErrno(L"Failed to wait for child process events", errno), SCXSRCLOCATION);
+            }
+            count = 0;
+        }
+
+        std::vector<SCXProcessId> exited;
+        for (int i = 0; i < count; i++)
+        {
+            std::map<int, SCXProcessId>::const_iterator fd = m_fds.find(events[i].data.fd);
+            if (fd == m_fds.end())
+            {
+                continue;
+            }
+
+            Child& child = m_children[fd->second];
+            SCXProcess& process = *child.process;
+            if (fd->first == child.pidFd)
+            {
+                exited.push_back(fd->second);
+            }
+            else if (fd->first == process.m_inForChild[SCXProcess::W])
+            {
+                SendInput(child);
+            }
+            else if (fd->first == process.m_outForChild[SCXProcess::R])
+            {
+                ReadOutput(process.m_outForChild[SCXProcess::R], child.result->stdoutData);
+            }
+            else
+            {
+                ReadOutput(process.m_errForChild[SCXProcess::R], child.result->stderrData);
+            }
+        }
+
+        // Reaping closes descriptors, so it waits until all events of this
+        // round have been handled and none of them can refer to a reused number
+        std::vector<std::pair<SCXHandle<SCXProcessResult>, SCXHandle<SCXProcessCompletion> > > completed;
+        for (std::map<SCXProcessId, Child>::iterator it = m_children.begin(); it != m_children.end(); )
+        {
+            std::map<SCXProcessId, Child>::iterator child = it++;
+            bool check = child->second.pidFd < 0;
+            for (size_t i = 0; !check && i < exited.size(); i++)
+            {
+                check = exited[i] == child->first;
+            }
+            if (check && Reap(child->first))
+            {
+                completed.push_back(std::make_pair(child->second.result, child->second.completion));
+                m_children.erase(child);
+            }
+        }
+
+        // Callbacks may start new children, so they run after the loop state is final
+        for (size_t i = 0; i < completed.size(); i++)
+        {
+            if (NULL != completed[i].second.GetData())
+            {
+                completed[i].second->ProcessCompleted(*completed[i].first);
+            }
+        }
+
+        return m_children.size();
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Poll until all children have terminated, including the ones started by
+        completion callbacks.
+    */
+    void SCXProcessLoop::Run()
+    {
+        while (Poll(-1) > 0)
+        {
+        }
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Number of children that have not terminated yet.
+    */
+    size_t SCXProcessLoop::Pending() const
+    {
+        return m_children.size();
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Register a descriptor of a child on the epoll instance.
+
+        \throws SCXInternalErrorException if the descriptor cannot be registered
+    */
+    void SCXProcessLoop::Watch(int fd, SCXProcessId pid, unsigned int events)
+    {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            throw SCXInternalErrorException(UnexpectedErrno(L"Failed to watch child process descriptor", errno), SCXSRCLOCATION);
+        }
+        m_fds[fd] = pid;
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Stop watching a descriptor and close it.
+
+        \param[in,out] fd   Descriptor, set to -1 so its owner does not close it again
+    */
+    void SCXProcessLoop::Unwatch(int& fd)
+    {
+        if (fd < 0)
+        {
+            return;
+        }
+        if (m_fds.erase(fd) > 0)
+        {
+            epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, NULL);
+        }
+        close(fd);
+        fd = -1;
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        How long epoll_wait may block without missing a reap tick. Timeouts need
+        no tick: a killed child wakes the loop through its pidfd or pipes.
+
+        \param[in] waitMs   Longest wait requested by the caller, -1 for no limit
+    */
+    int SCXProcessLoop::NextTimeout(int waitMs) const
+    {
+        int timeout = waitMs;
+        if (m_polledChildren > 0 && (timeout < 0 || cReapTickMs < timeout))
+        {
+            timeout = cReapTickMs;
+        }
+        return timeout;
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Write as much of the pending input as the stdin pipe of the child takes.
+        Closes the pipe once all input is written or the child closed its end.
+    */
+    void SCXProcessLoop::SendInput(Child& child)
+    {
+        int& fd = child.process->m_inForChild[SCXProcess::W];
+        while (child.inputSent < child.input.size())
+        {
+            ssize_t written = write(fd, child.input.data() + child.inputSent, child.input.size() - child.inputSent);
+            if (written < 0)
+            {
+                if (EAGAIN == errno)
+                {
+                    return;
+                }
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                SCX_LOGTRACE(m_logHandle, StrAppend(L"Child process stopped reading its input, pid ", child.result->pid));
+                break;
+            }
+            child.inputSent += static_cast<size_t>(written);
+        }
+        Unwatch(fd);
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Read everything available from an output pipe of a child. Closes the
+        pipe at end of file.
+
+        \param[in,out] fd     Read end of the pipe
+        \param[out]    data   Receives the output
+    */
+    void SCXProcessLoop::ReadOutput(int& fd, std::string& data)
+    {
+        char buffer[4096];
+        while (fd >= 0)
+        {
+            ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
+            if (bytesRead > 0)
+            {
+                data.append(buffer, static_cast<size_t>(bytesRead));
+            }
+            else if (bytesRead < 0 && EINTR == errno)
+            {
+                continue;
+            }
+            else if (bytesRead < 0 && EAGAIN == errno)
+            {
+                return;
+            }
+            else
+            {
+                if (bytesRead < 0)
+                {
+                    SCX_LOGWARNING(m_logHandle, UnexpectedErrno(L"Failed to read child process output", errno));
+                }
+                Unwatch(fd);
+            }
+        }
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Collect the exit status of a child if it has terminated, together with the
+        output still in its pipes, and release its descriptors.
+
+        \returns true if the child has terminated and its result is complete
+    */
+    bool SCXProcessLoop::Reap(SCXProcessId pid)
+    {
+        Child& child = m_children[pid];
+        SCXProcess& process = *child.process;
+
+        // Look without reaping: the zombie keeps the pid from being reused
+        // until the deadline is cancelled and the service lets go of it
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOHANG | WNOWAIT) < 0)
+        {
+            if (EINTR == errno)
+            {
+                return false;
+            }
+        }
+        else if (0 == info.si_pid)
+        {
+            return false;
+        }
+
+        bool expired = false;
+        if (0 != child.timeoutId)
+        {
+            expired = !SCXProcessTimeoutService::Instance().Cancel(child.timeoutId);
+            child.timeoutId = 0;
+        }
+
+        int status = 0;
+        int waited = process.DoWaitPID(&status, true);
+
+        // Output of the child is in the pipes by now; output of grandchildren
+        // that keep the pipes open is not waited for, as with SCXProcess::Run
+        ReadOutput(process.m_outForChild[SCXProcess::R], child.result->stdoutData);
+        ReadOutput(process.m_errForChild[SCXProcess::R], child.result->stderrData);
+        Unwatch(process.m_outForChild[SCXProcess::R]);
+        Unwatch(process.m_errForChild[SCXProcess::R]);
+        Unwatch(process.m_inForChild[SCXProcess::W]);
+        if (child.pidFd >= 0)
+        {
+            Unwatch(child.pidFd);
+        }
+        else
+        {
+            m_polledChildren--;
+        }
+
+        if (waited < 0)
+        {
+            SCX_LOGWARNING(m_logHandle, UnexpectedErrno(StrAppend(L"Failed to wait for child process ", pid), errno));
+        }
+        else if (WIFEXITED(status))
+        {
+            child.result->exited = true;
+            child.result->exitCode = WEXITSTATUS(status);
+        }
+        // A deadline that expired after the child exited on its own killed nothing
+        if (expired && !child.result->exited)
+        {
+            SCX_LOGINFO(m_logHandle, StrAppend(L"Child process was killed by its timeout, pid ", pid));
+            child.result->timedOut = true;
+        }
+        child.result->completed = true;
+        SCX_LOGTRACE(m_logHandle, StrAppend(StrAppend(L"Child process terminated, pid ", pid),
+                                            StrAppend(L", exit code ", child.result->exitCode)));
+        return true;
+    }
+} /* namespace SCXCoreLib */
+
+#endif /* linux */
+
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -0,0 +1,251 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+    \file
+
+    \brief       Implements the process-wide service that kills child processes
+                 running past their timeout.
+
+    \date        2026-10-17 14:00:00
+
+*/
+/*----------------------------------------------------------------------------*/
+
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxexception.h>
+#include <scxcorelib/scxprocesstimeout.h>
+#include <scxcorelib/stringaid.h>
+
+#include <algorithm>
+#include <time.h>
+
+namespace
+{
+    //! Parameters of the thread of the timeout service
+    class TimeoutThreadParam : public SCXCoreLib::SCXThreadParam
+    {
+    public:
+        //! Constructor
+        //! \param[in]  service     Service the thread works for
+        TimeoutThreadParam(SCXCoreLib::SCXProcessTimeoutService* service)
+            : m_service(service)
+        {
+        }
+
+        SCXCoreLib::SCXProcessTimeoutService* m_service;    //!< Service the thread works for
+    };
+
+    //! Cancelled deadlines tolerated on the heap before it is rebuilt
+    const size_t cMaxStaleDeadlines = 64;
+}
+
+namespace SCXCoreLib
+{
+    /*----------------------------------------------------------------------------*/
+    /**
+        Constructor. Starts the thread that expires the deadlines.
+    */
+    SCXProcessTimeoutService::SCXProcessTimeoutService()
+        : m_logHandle(SCXLogHandleFactory::GetLogHandle(L"scx.core.common.pal.processtimeout")),
+          m_nextId(1),
+          m_expired(0),
+          m_cancelled(0),
+          m_terminate(false)
+    {
+        m_cond.SetSleep(0);
+        m_thread = new SCXThread(ThreadBody, new TimeoutThreadParam(this));
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Destructor. Stops the thread; deadlines still registered do not expire.
+    */
+    SCXProcessTimeoutService::~SCXProcessTimeoutService()
+    {
+        {
+            SCXConditionHandle h(m_cond);
+            m_terminate = true;
+            h.Signal();
+        }
+        m_thread->Wait();
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Kill the process group of a process unless the deadline is cancelled first.
+
+        \param[in]  process     Process to kill; must stay alive until the deadline is cancelled
+        \param[in]  timeout     Milliseconds from now the deadline expires
+        \returns Id to cancel the deadline with
+    */
+    SCXProcessTimeoutId SCXProcessTimeoutService::Register(SCXProcess& process, unsigned timeout)
+    {
+        Deadline deadline;
+        deadline.when = NowMs() + timeout;
+
+        SCXConditionHandle h(m_cond);
+        deadline.id = m_nextId++;
+        m_processes[deadline.id] = &process;
+
+        // Only an earlier deadline changes how long the thread has to sleep
+        bool earliest = m_heap.empty() || deadline.when < m_heap.top().when;
+        m_heap.push(deadline);
+        if (earliest)
+        {
+            h.Signal();
+        }
+        return deadline.id;
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Cancel a deadline. Once this returns the service no longer touches the process.
+
+        \param[in]  id      Id returned by Register
+        \returns false if the deadline already expired and the process was killed
+    */
+    bool SCXProcessTimeoutService::Cancel(SCXProcessTimeoutId id)
+    {
+        SCXConditionHandle h(m_cond);
+        if (0 == m_processes.erase(id))
+        {
+            return false;
+        }
+
+        m_cancelled++;
+        Compact();
+        return true;
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Number of deadlines that expired and had their process killed.
+    */
+    scxulong SCXProcessTimeoutService::GetExpiredCount() const
+    {
+        SCXConditionHandle h(m_cond);
+        return m_expired;
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Number of deadlines cancelled before they expired.
+    */
+    scxulong SCXProcessTimeoutService::GetCancelledCount() const
+    {
+        SCXConditionHandle h(m_cond);
+        return m_cancelled;
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Number of deadlines neither expired nor cancelled.
+    */
+    size_t SCXProcessTimeoutService::GetPendingCount() const
+    {
+        SCXConditionHandle h(m_cond);
+        return m_processes.size();
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Body of the thread of the service.
+    */
+    void SCXProcessTimeoutService::ThreadBody(SCXThreadParamHandle& param)
+    {
+        static_cast<TimeoutThreadParam*>(param.GetData())->m_service->Service();
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Expire deadlines as they pass, sleeping until the earliest one otherwise.
+    */
+    void SCXProcessTimeoutService::Service()
+    {
+        SCXConditionHandle h(m_cond);
+        while (!m_terminate)
+        {
+            scxulong now = NowMs();
+            while (!m_heap.empty() && m_heap.top().when <= now)
+            {
+                std::map<SCXProcessTimeoutId, SCXProcess*>::iterator process = m_processes.find(m_heap.top().id);
+                m_heap.pop();
+                if (process == m_processes.end())
+                {
+                    continue;
+                }
+
+                try
+                {
+                    process->second->Kill();
+                }
+                catch (SCXException& e)
+                {
+                    SCX_LOGWARNING(m_logHandle, e.What());
+                }
+                m_processes.erase(process);
+                m_expired++;
+                SCX_LOGTRACE(m_logHandle, StrAppend(L"Process timeout expired, killed the process group. Expired so far: ", m_expired));
+            }
+
+            // A sleep of 0 waits until signalled
+            m_cond.SetSleep(m_heap.empty() ? 0 : std::max<scxulong>(m_heap.top().when - now, 1));
+            h.Wait();
+        }
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Rebuild the heap without cancelled deadlines once they pile up, so long
+        timeouts that are cancelled early do not accumulate. Called locked.
+    */
+    void SCXProcessTimeoutService::Compact()
+    {
+        if (m_heap.size() < m_processes.size() + cMaxStaleDeadlines)
+        {
+            return;
+        }
+
+        std::vector<Deadline> live;
+        live.reserve(m_processes.size());
+        while (!m_heap.empty())
+        {
+            if (m_processes.find(m_heap.top().id) != m_processes.end())
+            {
+                live.push_back(m_heap.top());
+            }
+            m_heap.pop();
+        }
+        m_heap = std::priority_queue<Deadline>(live.begin(), live.end());
+    }
+
+    /*----------------------------------------------------------------------------*/
+    /**
+        Monotonic time in milliseconds.
+    */
+    scxulong SCXProcessTimeoutService::NowMs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<scxulong>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+} /* namespace SCXCoreLib */
+
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
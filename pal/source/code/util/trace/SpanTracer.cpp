@@ -0,0 +1,195 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+#include <util/SpanTracer.h>
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace SCX::Util;
+
+namespace
+{
+
+/** Escape a string for use inside a JSON string literal */
+std::string
+JsonEscape(const std::string& in)
+{
+    std::string out;
+    out.reserve(in.length());
+
+    for (std::string::const_iterator iter = in.begin(); iter != in.end(); ++iter)
+    {
+        unsigned char ch = static_cast<unsigned char>(*iter);
+        if ('"' == ch || '\\' == ch)
+        {
+            out.push_back('\\');
+            out.push_back(static_cast<char>(ch));
+        }
+        else if (ch < 0x20)
+        {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+            out.append(buffer);
+        }
+        else
+        {
+            out.push_back(static_cast<char>(ch));
+        }
+    }
+
+    return out;
+}
+
+}
+
+SpanTracer::SpanTracer()
+  : m_enabled(false)
+  , m_traceFile()
+  , m_originUs(Now())
+  , m_spans()
+  , m_openSpans()
+  , m_nextId(1)
+  , m_lockHandle(SCXCoreLib::ThreadLockHandleGet())
+{
+}
+
+void SpanTracer::Enable(const std::string& traceFile)
+{
+    SCXCoreLib::SCXThreadLock lock(m_lockHandle);
+
+    m_traceFile = traceFile;
+    m_enabled = true;
+}
+
+unsigned long SpanTracer::Begin(
+    const std::string& name,
+    const std::string& category)
+{
+    if (!m_enabled)
+    {
+        return 0;
+    }
+
+    Span span;
+    span.name = name;
+    span.category = category;
+    span.startUs = Now();
+    span.durationUs = 0;
+    span.threadId = static_cast<long>(syscall(SYS_gettid));
+
+    SCXCoreLib::SCXThreadLock lock(m_lockHandle);
+    unsigned long id = m_nextId++;
+    m_openSpans.insert(std::make_pair(id, span));
+    return id;
+}
+
+void SpanTracer::End(unsigned long id)
+{
+    scxulong now = Now();
+
+    SCXCoreLib::SCXThreadLock lock(m_lockHandle);
+    std::map<unsigned long, Span>::iterator iter = m_openSpans.find(id);
+    if (m_openSpans.end() == iter)
+    {
+        return;
+    }
+
+    Span& span = iter->second;
+    span.durationUs = now > span.startUs ? now - span.startUs : 0;
+    // A span that crossed a fork ends on the surviving thread
+    span.threadId = static_cast<long>(syscall(SYS_gettid));
+    m_spans.push_back(span);
+    m_openSpans.erase(iter);
+}
+
+bool SpanTracer::Flush()
+{
+    SCXCoreLib::SCXThreadLock lock(m_lockHandle);
+
+    if (!m_enabled || m_traceFile.empty())
+    {
+        return false;
+    }
+
+    // The agent daemonizes, so the pid is only known at this point
+    long pid = static_cast<long>(getpid());
+
+    std::ostringstream strm;
+    strm << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+    strm << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+         << ",\"tid\":" << pid << ",\"args\":{\"name\":\"scvmmguestagent\"}}";
+
+    std::vector<Span> spans(m_spans);
+    scxulong now = Now();
+    for (std::map<unsigned long, Span>::const_iterator iter = m_openSpans.begin();
+         iter != m_openSpans.end(); ++iter)
+    {
+        Span span = iter->second;
+        span.durationUs = now > span.startUs ? now - span.startUs : 0;
+        spans.push_back(span);
+    }
+
+    for (std::vector<Span>::const_iterator iter = spans.begin();
+         iter != spans.end(); ++iter)
+    {
+        scxulong ts = iter->startUs > m_originUs ? iter->startUs - m_originUs : 0;
+
+        strm << "," << std::endl
+             << "{\"name\":\"" << JsonEscape(iter->name)
+             << "\",\"cat\":\"" << JsonEscape(iter->category)
+             << "\",\"ph\":\"X\",\"ts\":" << ts
+             << ",\"dur\":" << iter->durationUs
+             << ",\"pid\":" << pid
+             << ",\"tid\":" << iter->threadId << "}";
+    }
+
+    strm << std::endl << "]}" << std::endl;
+
+    // Write next to the target and rename so readers never see a partial trace
+    std::string tempFile = m_traceFile + ".tmp";
+    std::ofstream fileStream(tempFile.c_str(), std::ios::out | std::ios::trunc);
+    if (!fileStream.is_open())
+    {
+        return false;
+    }
+
+    fileStream << strm.str();
+    fileStream.close();
+    if (fileStream.fail())
+    {
+        unlink(tempFile.c_str());
+        return false;
+    }
+
+    return 0 == rename(tempFile.c_str(), m_traceFile.c_str());
+}
+
+scxulong SpanTracer::Now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<scxulong>(ts.tv_sec) * 1000000 +
+        static_cast<scxulong>(ts.tv_nsec) / 1000;
+}
@@ -0,0 +1,343 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+#include "scxcorelib/scxcmn.h"
+#include <util/CodeUnitScan.h>
+
+// SSE2 is part of every x86_64 CPU; AVX2 is compiled per function and only
+// called after the CPU has been checked for it
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define CODEUNITSCAN_SSE2 1
+#include <emmintrin.h>
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define CODEUNITSCAN_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+using namespace SCX::Util;
+
+namespace
+{
+
+const Utf16Char c_NewLine = '\n';
+
+/** Determine if a code unit is XML whitespace */
+inline bool
+IsSpace(Utf16Char u)
+{
+    return ' ' == u || '\t' == u || '\r' == u || '\n' == u;
+}
+
+/** One version of every kernel */
+struct Kernels
+{
+    CodeUnitScan::Level level;
+    size_t (*findAny)(const Utf16Char* p, size_t n, Utf16Char a, Utf16Char b, Utf16Char c, size_t& newlines);
+    size_t (*skipSpaces)(const Utf16Char* p, size_t n, size_t& newlines);
+    size_t (*findSurrogate)(const Utf16Char* p, size_t n);
+};
+
+/*----------------------------------------------------------------------------*/
+
+size_t
+FindAnyScalar(const Utf16Char* p, size_t n, Utf16Char a, Utf16Char b, Utf16Char c, size_t& newlines)
+{
+    size_t i = 0;
+    for (; i < n; ++i)
+    {
+        Utf16Char u = p[i];
+        if (u == a || u == b || u == c)
+        {
+            break;
+        }
+        if (c_NewLine == u)
+        {
+            newlines++;
+        }
+    }
+    return i;
+}
+
+size_t
+SkipSpacesScalar(const Utf16Char* p, size_t n, size_t& newlines)
+{
+    size_t i = 0;
+    for (; i < n && IsSpace(p[i]); ++i)
+    {
+        if (c_NewLine == p[i])
+        {
+            newlines++;
+        }
+    }
+    return i;
+}
+
+size_t
+FindSurrogateScalar(const Utf16Char* p, size_t n)
+{
+    size_t i = 0;
+    while (i < n && 0xD800 != (p[i] & 0xF800))
+    {
+        ++i;
+    }
+    return i;
+}
+
+const Kernels c_Scalar = { CodeUnitScan::LevelScalar, FindAnyScalar, SkipSpacesScalar, FindSurrogateScalar };
+
+/*----------------------------------------------------------------------------*/
+
+#if defined(CODEUNITSCAN_SSE2)
+
+// movemask yields two bits per 16-bit code unit, hence the halving below
+
+size_t
+FindAnySSE2(const Utf16Char* p, size_t n, Utf16Char a, Utf16Char b, Utf16Char c, size_t& newlines)
+{
+    const __m128i va = _mm_set1_epi16(static_cast<short>(a));
+    const __m128i vb = _mm_set1_epi16(static_cast<short>(b));
+    const __m128i vc = _mm_set1_epi16(static_cast<short>(c));
+    const __m128i vnl = _mm_set1_epi16(c_NewLine);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(v, va), _mm_cmpeq_epi16(v, vb)),
+                                   _mm_cmpeq_epi16(v, vc));
+        unsigned int hits = static_cast<unsigned int>(_mm_movemask_epi8(hit));
+        unsigned int lines = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi16(v, vnl)));
+        if (0 != hits)
+        {
+            unsigned int bit = __builtin_ctz(hits);
+            newlines += __builtin_popcount(lines & ((1u << bit) - 1)) / 2;
+            return i + bit / 2;
+        }
+        newlines += __builtin_popcount(lines) / 2;
+    }
+    return i + FindAnyScalar(p + i, n - i, a, b, c, newlines);
+}
+
+size_t
+SkipSpacesSSE2(const Utf16Char* p, size_t n, size_t& newlines)
+{
+    const __m128i vsp = _mm_set1_epi16(' ');
+    const __m128i vtab = _mm_set1_epi16('\t');
+    const __m128i vcr = _mm_set1_epi16('\r');
+    const __m128i vnl = _mm_set1_epi16(c_NewLine);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i nl = _mm_cmpeq_epi16(v, vnl);
+        __m128i space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(v, vsp), _mm_cmpeq_epi16(v, vtab)),
+                                     _mm_or_si128(_mm_cmpeq_epi16(v, vcr), nl));
+        unsigned int others = ~static_cast<unsigned int>(_mm_movemask_epi8(space)) & 0xFFFFu;
+        unsigned int lines = static_cast<unsigned int>(_mm_movemask_epi8(nl));
+        if (0 != others)
+        {
+            unsigned int bit = __builtin_ctz(others);
+            newlines += __builtin_popcount(lines & ((1u << bit) - 1)) / 2;
+            return i + bit / 2;
+        }
+        newlines += __builtin_popcount(lines) / 2;
+    }
+    return i + SkipSpacesScalar(p + i, n - i, newlines);
+}
+
+size_t
+FindSurrogateSSE2(const Utf16Char* p, size_t n)
+{
+    const __m128i mask = _mm_set1_epi16(static_cast<short>(0xF800));
+    const __m128i surrogate = _mm_set1_epi16(static_cast<short>(0xD800));
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        unsigned int hits = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), surrogate)));
+        if (0 != hits)
+        {
+            return i + __builtin_ctz(hits) / 2;
+        }
+    }
+    return i + FindSurrogateScalar(p + i, n - i);
+}
+
+const Kernels c_SSE2 = { CodeUnitScan::LevelSSE2, FindAnySSE2, SkipSpacesSSE2, FindSurrogateSSE2 };
+
+#endif /* CODEUNITSCAN_SSE2 */
+
+/*----------------------------------------------------------------------------*/
+
+#if defined(CODEUNITSCAN_AVX2)
+
+__attribute__((target("avx2,popcnt"))) size_t
+FindAnyAVX2(const Utf16Char* p, size_t n, Utf16Char a, Utf16Char b, Utf16Char c, size_t& newlines)
+{
+    const __m256i va = _mm256_set1_epi16(static_cast<short>(a));
+    const __m256i vb = _mm256_set1_epi16(static_cast<short>(b));
+    const __m256i vc = _mm256_set1_epi16(static_cast<short>(c));
+    const __m256i vnl = _mm256_set1_epi16(c_NewLine);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi16(v, va), _mm256_cmpeq_epi16(v, vb)),
+                                      _mm256_cmpeq_epi16(v, vc));
+        unsigned int hits = static_cast<unsigned int>(_mm256_movemask_epi8(hit));
+        unsigned int lines = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(v, vnl)));
+        if (0 != hits)
+        {
+            unsigned int bit = __builtin_ctz(hits);
+            newlines += __builtin_popcount(lines & ((1u << bit) - 1)) / 2;
+            return i + bit / 2;
+        }
+        newlines += __builtin_popcount(lines) / 2;
+    }
+    return i + FindAnySSE2(p + i, n - i, a, b, c, newlines);
+}
+
+__attribute__((target("avx2,popcnt"))) size_t
+SkipSpacesAVX2(const Utf16Char* p, size_t n, size_t& newlines)
+{
+    const __m256i vsp = _mm256_set1_epi16(' ');
+    const __m256i vtab = _mm256_set1_epi16('\t');
+    const __m256i vcr = _mm256_set1_epi16('\r');
+    const __m256i vnl = _mm256_set1_epi16(c_NewLine);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i nl = _mm256_cmpeq_epi16(v, vnl);
+        __m256i space = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi16(v, vsp), _mm256_cmpeq_epi16(v, vtab)),
+                                        _mm256_or_si256(_mm256_cmpeq_epi16(v, vcr), nl));
+        unsigned int others = ~static_cast<unsigned int>(_mm256_movemask_epi8(space));
+        unsigned int lines = static_cast<unsigned int>(_mm256_movemask_epi8(nl));
+        if (0 != others)
+        {
+            unsigned int bit = __builtin_ctz(others);
+            newlines += __builtin_popcount(lines & ((1u << bit) - 1)) / 2;
+            return i + bit / 2;
+        }
+        newlines += __builtin_popcount(lines) / 2;
+    }
+    return i + SkipSpacesSSE2(p + i, n - i, newlines);
+}
+
+__attribute__((target("avx2,popcnt"))) size_t
+FindSurrogateAVX2(const Utf16Char* p, size_t n)
+{
+    const __m256i mask = _mm256_set1_epi16(static_cast<short>(0xF800));
+    const __m256i surrogate = _mm256_set1_epi16(static_cast<short>(0xD800));
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        unsigned int hits = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(v, mask), surrogate)));
+        if (0 != hits)
+        {
+            return i + __builtin_ctz(hits) / 2;
+        }
+    }
+    return i + FindSurrogateSSE2(p + i, n - i);
+}
+
+const Kernels c_AVX2 = { CodeUnitScan::LevelAVX2, FindAnyAVX2, SkipSpacesAVX2, FindSurrogateAVX2 };
+
+#endif /* CODEUNITSCAN_AVX2 */
+
+/*----------------------------------------------------------------------------*/
+
+const Kernels*
+KernelsFor(CodeUnitScan::Level level)
+{
+#if defined(CODEUNITSCAN_AVX2)
+    if (level >= CodeUnitScan::LevelAVX2)
+    {
+        return &c_AVX2;
+    }
+#endif
+#if defined(CODEUNITSCAN_SSE2)
+    if (level >= CodeUnitScan::LevelSSE2)
+    {
+        return &c_SSE2;
+    }
+#endif
+    (void) level;
+    return &c_Scalar;
+}
+
+/** The kernels in use; the first call picks the best supported ones */
+const Kernels*&
+Active()
+{
+    static const Kernels* active = KernelsFor(CodeUnitScan::GetBestLevel());
+    return active;
+}
+
+}
+
+size_t CodeUnitScan::FindAny(const Utf16Char* p, size_t n, Utf16Char a, Utf16Char b, Utf16Char c, size_t& newlines)
+{
+    return Active()->findAny(p, n, a, b, c, newlines);
+}
+
+size_t CodeUnitScan::SkipSpaces(const Utf16Char* p, size_t n, size_t& newlines)
+{
+    return Active()->skipSpaces(p, n, newlines);
+}
+
+size_t CodeUnitScan::FindSurrogate(const Utf16Char* p, size_t n)
+{
+    return Active()->findSurrogate(p, n);
+}
+
+CodeUnitScan::Level CodeUnitScan::GetLevel()
+{
+    return Active()->level;
+}
+
+CodeUnitScan::Level CodeUnitScan::GetBestLevel()
+{
+#if defined(CODEUNITSCAN_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+    {
+        return LevelAVX2;
+    }
+#endif
+#if defined(CODEUNITSCAN_SSE2)
+    return LevelSSE2;
+#else
+    return LevelScalar;
+#endif
+}
+
+CodeUnitScan::Level CodeUnitScan::SetLevel(Level level)
+{
+    Level best = GetBestLevel();
+    Active() = KernelsFor(level < best ? level : best);
+    return GetLevel();
+}
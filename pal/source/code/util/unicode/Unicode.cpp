@@ -21,6 +21,7 @@
 
 #include <string>
 #include <util/Unicode.h>
+#include <util/CodeUnitScan.h>
 
 using namespace SCX::Util;
 using namespace SCX::Util::Encoding;
@@ -76,6 +77,12 @@ static size_t Utf16StringCheck(
         {
             if (pos < (size_t)words)
             {
+                // Only surrogates need a closer look
+                pos += CodeUnitScan::FindSurrogate(str + pos, (size_t)words - pos);
+                if (pos == (size_t)words)
+                {
+                    break;
+                }
                 ch = *(str + pos);
             }
             else
@@ -0,0 +1,694 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+#include "scxcorelib/scxcmn.h"
+#include <util/XArenaDocument.h>
+#include <util/XElement.h>
+#include <util/SpanTracer.h>
+
+#include <new>
+#include <sstream>
+#include <string.h>
+
+using namespace SCX::Util;
+using namespace SCX::Util::Xml;
+
+namespace
+{
+
+// Size of the blocks the arena takes from the heap
+const size_t c_BlockSize = 64 * 1024;
+
+// Every allocation is rounded up to this, enough for pointers and size_t
+const size_t c_Alignment = 2 * sizeof(void*);
+
+// Longest reference that is accepted (&#x10FFFF;)
+const size_t c_MaxReference = 10;
+
+/** Determine if a byte is XML whitespace */
+inline bool
+IsSpace(char c)
+{
+    return ' ' == c || '\t' == c || '\n' == c || '\r' == c;
+}
+
+/** Determine if a byte may start a name; multibyte characters are accepted as is */
+inline bool
+IsNameStart(char c)
+{
+    unsigned char u = static_cast<unsigned char>(c);
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || '_' == u || ':' == u || u >= 0x80;
+}
+
+/** Determine if a byte may appear in a name after the first one */
+inline bool
+IsNameChar(char c)
+{
+    unsigned char u = static_cast<unsigned char>(c);
+    return IsNameStart(c) || (u >= '0' && u <= '9') || '-' == u || '.' == u;
+}
+
+/** Append a code point to a UTF-8 string */
+void
+AppendUtf8(unsigned long cp, std::string& out)
+{
+    if (cp < 0x80)
+    {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800)
+    {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+/**
+   Read an entity or character reference.
+
+   \param [in] p Points at the '&'
+   \param [in] end End of the buffer
+   \param [out] out Receives the decoded character; NULL to only validate
+   \returns Number of bytes in the reference, 0 if it is not valid
+*/
+size_t
+ReadReference(const char* p, const char* end, std::string* out)
+{
+    size_t avail = static_cast<size_t>(end - p);
+    const char* semi = static_cast<const char*>(memchr(p, ';', avail < c_MaxReference ? avail : c_MaxReference));
+    if (NULL == semi)
+    {
+        return 0;
+    }
+
+    const char* name = p + 1;
+    size_t size = static_cast<size_t>(semi - name);
+    size_t length = size + 2;
+
+    static const struct { const char* name; size_t size; char c; } entities[] =
+    {
+        { "lt", 2, '<' }, { "gt", 2, '>' }, { "amp", 3, '&' }, { "quot", 4, '"' }, { "apos", 4, '\'' }
+    };
+    for (size_t i = 0; i < sizeof(entities) / sizeof(entities[0]); ++i)
+    {
+        if (size == entities[i].size && 0 == memcmp(name, entities[i].name, size))
+        {
+            if (out != NULL)
+            {
+                *out += entities[i].c;
+            }
+            return length;
+        }
+    }
+
+    if (size < 2 || '#' != name[0])
+    {
+        return 0;
+    }
+
+    unsigned long cp = 0;
+    bool hex = 'x' == name[1];
+    const char* digit = name + (hex ? 2 : 1);
+    if (digit == semi)
+    {
+        return 0;
+    }
+    for (; digit < semi; ++digit)
+    {
+        char c = *digit;
+        if (c >= '0' && c <= '9')
+        {
+            cp = cp * (hex ? 16 : 10) + (c - '0');
+        }
+        else if (hex && c >= 'a' && c <= 'f')
+        {
+            cp = cp * 16 + (c - 'a' + 10);
+        }
+        else if (hex && c >= 'A' && c <= 'F')
+        {
+            cp = cp * 16 + (c - 'A' + 10);
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    if (0 == cp || cp > 0x10FFFF)
+    {
+        return 0;
+    }
+
+    if (out != NULL)
+    {
+        AppendUtf8(cp, *out);
+    }
+    return length;
+}
+
+}
+
+/*----------------------------------------------------------------------------*/
+
+XArena::XArena() :
+    m_next(NULL),
+    m_end(NULL),
+    m_reserved(0)
+{
+}
+
+XArena::~XArena()
+{
+    Clear();
+}
+
+void* XArena::Allocate(size_t size)
+{
+    size = (size + c_Alignment - 1) & ~(c_Alignment - 1);
+
+    if (static_cast<size_t>(m_end - m_next) < size)
+    {
+        // A new block; whatever is left of the current one is abandoned
+        size_t blockSize = size > c_BlockSize ? size : c_BlockSize;
+        char* block = new char[blockSize];
+        m_blocks.push_back(block);
+        m_reserved += blockSize;
+        m_next = block;
+        m_end = block + blockSize;
+    }
+
+    void* mem = m_next;
+    m_next += size;
+    return mem;
+}
+
+void XArena::Clear()
+{
+    for (std::vector<char*>::iterator block = m_blocks.begin(); block != m_blocks.end(); ++block)
+    {
+        delete[] *block;
+    }
+    m_blocks.clear();
+    m_next = NULL;
+    m_end = NULL;
+    m_reserved = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+std::string XStringView::Str() const
+{
+    if (!m_references)
+    {
+        return std::string(m_data, m_size);
+    }
+
+    std::string out;
+    out.reserve(m_size);
+
+    const char* p = m_data;
+    const char* end = m_data + m_size;
+    while (p < end)
+    {
+        const char* amp = static_cast<const char*>(memchr(p, '&', end - p));
+        if (NULL == amp)
+        {
+            out.append(p, end);
+            break;
+        }
+        out.append(p, amp);
+
+        // References were validated when the document was loaded
+        p = amp + ReadReference(amp, end, &out);
+    }
+    return out;
+}
+
+bool XStringView::Equals(const char* str) const
+{
+    if (m_references)
+    {
+        return Str() == str;
+    }
+    return strlen(str) == m_size && 0 == memcmp(m_data, str, m_size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+const XArenaElement* XArenaElement::GetChild(const char* name) const
+{
+    for (const XArenaElement* child = m_firstChild; child != NULL; child = child->m_nextSibling)
+    {
+        if (child->m_name.Equals(name))
+        {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+const XStringView* XArenaElement::GetAttributeValue(const char* name) const
+{
+    for (const XArenaAttribute* attr = m_firstAttribute; attr != NULL; attr = attr->GetNext())
+    {
+        if (attr->GetName().Equals(name))
+        {
+            return &attr->GetValue();
+        }
+    }
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+
+XArenaDocument::XArenaDocument() :
+    m_root(NULL),
+    m_begin(NULL),
+    m_pos(NULL),
+    m_end(NULL),
+    m_stripNamespaces(true)
+{
+}
+
+XArenaDocument::~XArenaDocument()
+{
+}
+
+void XArenaDocument::Clear()
+{
+    m_root = NULL;
+    m_arena.Clear();
+}
+
+void XArenaDocument::Load(const char* data, size_t size, bool stripNamespaces /* = true */)
+{
+    SCX::Util::ScopedSpan span("XArenaDocument::Load", "xml");
+
+    Clear();
+    if (0 == size)
+    {
+        throw XmlException("The input xml string is empty", Utf8String(""));
+    }
+
+    m_begin = data;
+    m_pos = data;
+    m_end = data + size;
+    m_stripNamespaces = stripNamespaces;
+
+    try
+    {
+        Parse();
+    }
+    catch (...)
+    {
+        Clear();
+        throw;
+    }
+}
+
+void XArenaDocument::Parse()
+{
+    XArenaElement* root = NULL;
+    XArenaElement* current = NULL;
+
+    SkipSpaces();
+    while (m_pos < m_end)
+    {
+        if ('<' != *m_pos)
+        {
+            Raise(NULL == root ? "expected opening angle bracket" : "markup outside root element");
+        }
+
+        if (StartsWith("</"))
+        {
+            if (NULL == current)
+            {
+                Raise("markup outside root element");
+            }
+            ParseEndTag(current);
+            current = current->m_parent;
+        }
+        else if (StartsWith("<?"))
+        {
+            SkipPast("?>");
+        }
+        else if (StartsWith("<!--"))
+        {
+            SkipPast("-->");
+        }
+        else if (StartsWith("<![CDATA["))
+        {
+            if (NULL == current)
+            {
+                Raise("markup outside root element");
+            }
+            m_pos += 9;
+            const char* start = m_pos;
+            SkipPast("]]>");
+
+            // CDATA is taken literally, references and all
+            current->m_content.m_data = start;
+            current->m_content.m_size = static_cast<size_t>(m_pos - 3 - start);
+            current->m_content.m_references = false;
+        }
+        else if (StartsWith("<!DOCTYPE") && NULL == root)
+        {
+            SkipDoctype();
+        }
+        else if (StartsWith("<!"))
+        {
+            Raise("expected comment, CDATA, or DOCTYPE");
+        }
+        else
+        {
+            if (NULL != root && NULL == current)
+            {
+                Raise("markup outside root element");
+            }
+
+            bool empty;
+            XArenaElement* elem = ParseStartTag(current, empty);
+            if (NULL == root)
+            {
+                root = elem;
+            }
+            if (!empty)
+            {
+                current = elem;
+            }
+        }
+
+        if (NULL != current)
+        {
+            // As with XMLReader, leading spaces are skipped and a later run replaces an earlier one
+            SkipSpaces();
+            XStringView text = ParseText('<');
+            if (!text.Empty())
+            {
+                current->m_content = text;
+            }
+        }
+        else
+        {
+            SkipSpaces();
+        }
+    }
+
+    if (NULL == root)
+    {
+        Raise("no root element");
+    }
+    if (NULL != current)
+    {
+        Raise("premature end of input");
+    }
+    m_root = root;
+}
+
+void XArenaDocument::Raise(const char* message) const
+{
+    std::ostringstream what;
+    what << message << " at offset " << (m_pos - m_begin);
+
+    size_t avail = static_cast<size_t>(m_end - m_pos);
+    throw XmlException(what.str(), Utf8String(std::string(m_pos, avail < 40 ? avail : 40)));
+}
+
+void XArenaDocument::SkipSpaces()
+{
+    while (m_pos < m_end && IsSpace(*m_pos))
+    {
+        m_pos++;
+    }
+}
+
+bool XArenaDocument::StartsWith(const char* str) const
+{
+    size_t size = strlen(str);
+    return static_cast<size_t>(m_end - m_pos) >= size && 0 == memcmp(m_pos, str, size);
+}
+
+void XArenaDocument::SkipPast(const char* str)
+{
+    size_t size = strlen(str);
+    for (const char* p = m_pos; static_cast<size_t>(m_end - p) >= size; ++p)
+    {
+        p = static_cast<const char*>(memchr(p, str[0], m_end - p));
+        if (NULL == p || static_cast<size_t>(m_end - p) < size)
+        {
+            break;
+        }
+        if (0 == memcmp(p, str, size))
+        {
+            m_pos = p + size;
+            return;
+        }
+    }
+    m_pos = m_end;
+    Raise("premature end of input");
+}
+
+void XArenaDocument::SkipDoctype()
+{
+    // The internal subset in brackets may contain '>'
+    int brackets = 0;
+    for (m_pos += 9; m_pos < m_end; ++m_pos)
+    {
+        if ('[' == *m_pos)
+        {
+            brackets++;
+        }
+        else if (']' == *m_pos)
+        {
+            brackets--;
+        }
+        else if ('>' == *m_pos && brackets <= 0)
+        {
+            m_pos++;
+            return;
+        }
+    }
+    Raise("premature end of input");
+}
+
+XStringView XArenaDocument::ParseName()
+{
+    if (m_pos >= m_end || !IsNameStart(*m_pos))
+    {
+        Raise("expected element name");
+    }
+
+    XStringView name;
+    name.m_data = m_pos;
+    name.m_references = false;
+    while (m_pos < m_end && IsNameChar(*m_pos))
+    {
+        m_pos++;
+    }
+    name.m_size = static_cast<size_t>(m_pos - name.m_data);
+    return name;
+}
+
+void XArenaDocument::StripPrefix(XStringView& name, size_t& prefixSize) const
+{
+    prefixSize = 0;
+    if (!m_stripNamespaces)
+    {
+        return;
+    }
+
+    const char* colon = static_cast<const char*>(memchr(name.m_data, ':', name.m_size));
+    if (NULL != colon)
+    {
+        prefixSize = static_cast<size_t>(colon + 1 - name.m_data);
+        name.m_data += prefixSize;
+        name.m_size -= prefixSize;
+    }
+}
+
+XStringView XArenaDocument::ParseText(char stop)
+{
+    XStringView text;
+    text.m_data = m_pos;
+
+    const char* found = static_cast<const char*>(memchr(m_pos, stop, m_end - m_pos));
+    if (NULL == found)
+    {
+        if ('<' == stop)
+        {
+            // Only the end of input can follow; let the caller report it
+            found = m_end;
+        }
+        else
+        {
+            m_pos = m_end;
+            Raise("premature end of input");
+        }
+    }
+    text.m_size = static_cast<size_t>(found - m_pos);
+
+    if ('<' != stop && NULL != memchr(m_pos, '<', text.m_size))
+    {
+        m_pos = static_cast<const char*>(memchr(m_pos, '<', text.m_size));
+        Raise("'<' in attribute value");
+    }
+
+    // References are only checked here; they are decoded when the string is used
+    const char* amp = static_cast<const char*>(memchr(m_pos, '&', text.m_size));
+    text.m_references = NULL != amp;
+    while (NULL != amp)
+    {
+        size_t length = ReadReference(amp, found, NULL);
+        if (0 == length)
+        {
+            m_pos = amp;
+            Raise("bad character reference");
+        }
+        amp += length;
+        amp = static_cast<const char*>(memchr(amp, '&', found - amp));
+    }
+
+    m_pos = found;
+    return text;
+}
+
+XArenaElement* XArenaDocument::ParseStartTag(XArenaElement* parent, bool& empty)
+{
+    m_pos++;
+
+    XArenaElement* elem = new (m_arena.Allocate(sizeof(XArenaElement))) XArenaElement();
+    elem->m_name = ParseName();
+    StripPrefix(elem->m_name, elem->m_prefixSize);
+    elem->m_parent = parent;
+
+    for (;;)
+    {
+        SkipSpaces();
+        if (m_pos >= m_end)
+        {
+            Raise("premature end of input");
+        }
+        if ('>' == *m_pos)
+        {
+            m_pos++;
+            empty = false;
+            break;
+        }
+        if ('/' == *m_pos)
+        {
+            m_pos++;
+            if (m_pos >= m_end || '>' != *m_pos)
+            {
+                Raise("expected closing angle bracket");
+            }
+            m_pos++;
+            empty = true;
+            break;
+        }
+
+        XStringView name = ParseName();
+        SkipSpaces();
+        if (m_pos >= m_end || '=' != *m_pos)
+        {
+            Raise("expected = character");
+        }
+        m_pos++;
+        SkipSpaces();
+        if (m_pos >= m_end || ('"' != *m_pos && '\'' != *m_pos))
+        {
+            Raise("expected opening quote");
+        }
+        char quote = *m_pos++;
+        XStringView value = ParseText(quote);
+        m_pos++;
+
+        // XMLReader drops the default namespace and keeps prefixed declarations whole
+        bool xmlns = name.m_size >= 5 && 0 == memcmp(name.m_data, "xmlns", 5);
+        if (xmlns && (5 == name.m_size || ':' != name.m_data[5]))
+        {
+            continue;
+        }
+        if (!xmlns)
+        {
+            size_t prefixSize;
+            StripPrefix(name, prefixSize);
+        }
+
+        XArenaAttribute* attr = new (m_arena.Allocate(sizeof(XArenaAttribute))) XArenaAttribute();
+        attr->m_name = name;
+        attr->m_value = value;
+        if (NULL == elem->m_lastAttribute)
+        {
+            elem->m_firstAttribute = attr;
+        }
+        else
+        {
+            elem->m_lastAttribute->m_next = attr;
+        }
+        elem->m_lastAttribute = attr;
+    }
+
+    if (NULL != parent)
+    {
+        if (NULL == parent->m_lastChild)
+        {
+            parent->m_firstChild = elem;
+        }
+        else
+        {
+            parent->m_lastChild->m_nextSibling = elem;
+        }
+        parent->m_lastChild = elem;
+        parent->m_childCount++;
+    }
+    return elem;
+}
+
+void XArenaDocument::ParseEndTag(const XArenaElement* elem)
+{
+    m_pos += 2;
+    XStringView name = ParseName();
+
+    // Compare with the name as written, prefix included
+    size_t size = elem->m_name.m_size + elem->m_prefixSize;
+    if (name.m_size != size || 0 != memcmp(name.m_data, elem->m_name.m_data - elem->m_prefixSize, size))
+    {
+        m_pos = name.m_data;
+        Raise("open/close tag mismatch");
+    }
+
+    SkipSpaces();
+    if (m_pos >= m_end || '>' != *m_pos)
+    {
+        Raise("expected closing angle bracket");
+    }
+    m_pos++;
+}
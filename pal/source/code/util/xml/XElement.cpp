@@ -19,6 +19,7 @@
 
 #include "scxcorelib/scxcmn.h"
 #include <util/XElement.h>
+#include <util/SpanTracer.h>
 #include <stack>
 #include <assert.h>
 #include <cctype>
@@ -446,7 +447,7 @@ void XElement::ToString(Utf8String& xmlString, bool enableLineSeperators)
 
 void XElement::Load(const Utf8String& xmlString, XElementPtr& rootElement, bool stripNamespaces /* = true */)
 {
-    SCXCoreLib::SCXThreadLock Lock(XElementLoadLock);
+    SCX::Util::ScopedSpan span("XElement::Load", "xml");
 
     // Create a stack of ElementPtr
     std::stack<XElementPtr> elementStack;
@@ -456,29 +457,18 @@ void XElement::Load(const Utf8String& xmlString, XElementPtr& rootElement, bool
         throw XmlException(XElement::EXCEPTION_MESSAGE_INPUT_EMPTY, xmlString);
     }
     
-    XMLReader* reader = new XMLReader();
-    pCXElement parseElement(new CXElement());
+    // The reader keeps all of its state, so parses on other threads do not interfere
+    XMLReader reader;
+    XML_Event event;
 
-    reader->XML_Init(stripNamespaces);
-    reader->XML_SetText(xmlString);
+    reader.XML_Init(stripNamespaces);
+    reader.XML_SetText(xmlString);
     
     XElementPtr currentElement(NULL);
-    int stat;
-    while(1)
+    while (reader.XML_NextEvent(event) == 0)
     {
-        stat = reader->XML_Next(parseElement);
-
-        if (stat != 0)
-        {
-            break;
-        }
-
-        XML_Type elemType = parseElement->GetType();
-
-        if (elemType ==  XML_START /* || elemType == XML_INSTRUCTION -- JWF -- NOT YET */)
+        if (event.type == XML_EVENT_START)
         {
-            size_t attributeCount;
-    
             // if current element is not NULL, then this is a child element
             // push the current element to the stack
             if (currentElement != NULL)
@@ -486,37 +476,23 @@ void XElement::Load(const Utf8String& xmlString, XElementPtr& rootElement, bool
                 elementStack.push(currentElement);
             }
   
-            // Create the ElementPtr
-            Utf8String parseElementName = parseElement->GetName();
-            currentElement = new XElement(parseElementName);
-            
-            attributeCount = parseElement->GetAttributeCount();
-            
-            // Loop through the attributes and add them
-            for (size_t i = 0; i < attributeCount; ++i)
-            {
-                currentElement->SetAttributeValue(parseElement->GetAttributeName(static_cast<int>(i)),
-                                                  parseElement->GetAttributeValue(static_cast<int>(i)));
-            }
-
-            if (elemType == XML_INSTRUCTION)
-            {
-                currentElement->m_IsProcessingInstruction = true;
-            }
+            currentElement = new XElement(event.name);
         } 
-        else if (elemType ==  XML_CHARS)
+        else if (event.type == XML_EVENT_ATTRIBUTE)
+        {
+            currentElement->SetAttributeValue(event.name, event.value);
+        }
+        else if (event.type == XML_EVENT_TEXT)
         {
             // If Chars was found add it as content to the current element
-            currentElement->SetContent(parseElement->GetText());
+            currentElement->SetContent(event.value);
         }
-        else if (elemType ==  XML_END)
+        else if (event.type == XML_EVENT_END)
         {
             // The end tag should match to the current tag. The error condition should
             // have been caught by the reader. In case it is not, it would be a bug on that
             // library. So setting an assert
-            Utf8String currentName = currentElement->GetName();
-            Utf8String parseName = parseElement->GetName();
-            assert(currentName == parseName);
+            assert(currentElement->GetName() == event.name);
             
             // The current element is complete. The top of the stack contains the parent
             // If the stack is empty then the current element is the root
@@ -538,15 +514,11 @@ void XElement::Load(const Utf8String& xmlString, XElementPtr& rootElement, bool
     }
     
     //Check for errors if any throw exception
-    if (reader->XML_GetError())
+    if (reader.XML_GetError())
     {
-        std::string errorMsg(reader->XML_GetErrorMessage());
-        delete reader;
-        throw XmlException(errorMsg, xmlString);
+        throw XmlException(reader.XML_GetErrorMessage(), xmlString);
     }
 
-    delete reader;
-
     rootElement = currentElement;
 }
 
@@ -19,6 +19,7 @@
 
 #include <util/Unicode.h>
 #include <util/XMLReader.h>
+#include <util/CodeUnitScan.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -37,24 +38,24 @@ using namespace SCX::Util::Xml;
 **
 **==============================================================================
 */
-static char c_LessThan    = '<';
-static char c_GreaterThan = '>';
-static char c_EqualTo     = '=';
-static char c_Ampersand   = '&';
-static char c_PoundSign   = '#';
-static char c_Colon       = ':';
-static char c_SemiColon   = ';';
-static char c_x           = 'x';
-static char c_NewLine     = '\n';
-static char c_Apos        = '\'';
-static char c_Quote       = '"';
-static char c_Question    = '?';
-static char c_Slash       = '/';
-static char c_Bang        = '!';
-static char c_Dash        = '-';
-static char c_NullChar    = '\0';
-static Utf8String c_CDATA("[CDATA[");
-static Utf8String c_DOCTYPE("DOCTYPE");
+static const char c_LessThan    = '<';
+static const char c_GreaterThan = '>';
+static const char c_EqualTo     = '=';
+static const char c_Ampersand   = '&';
+static const char c_PoundSign   = '#';
+static const char c_Colon       = ':';
+static const char c_SemiColon   = ';';
+static const char c_x           = 'x';
+static const char c_NewLine     = '\n';
+static const char c_Apos        = '\'';
+static const char c_Quote       = '"';
+static const char c_Question    = '?';
+static const char c_Slash       = '/';
+static const char c_Bang        = '!';
+static const char c_Dash        = '-';
+static const char c_NullChar    = '\0';
+static const Utf8String c_CDATA("[CDATA[");
+static const Utf8String c_DOCTYPE("DOCTYPE");
 
 /*
 **==============================================================================
@@ -70,7 +71,7 @@ static Utf8String c_DOCTYPE("DOCTYPE");
  * Note that ISO 8859-1 character 0xA0, No Break Space, is not a
  * space character here.
  */
-static unsigned char _spaceChar[256] =
+static const unsigned char _spaceChar[256] =
 {
     0,0,0,0,0,0,0,0,0,2,1,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
     2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
@@ -94,7 +95,7 @@ unsigned int XMLReader::_IsSpace(CodePoint uc)
 {
     // If this is a multi-byte character then ignore as there no multi-byte
     // spaces
-    if (uc > 0x00000100)
+    if (uc >= 0x00000100)
     {
         return 0;
     }
@@ -109,7 +110,7 @@ unsigned int XMLReader::_IsSpace(CodePoint uc)
  *     _nameChar[A-Za-z_] => 2 (first character)
  *     _nameChar[A-Za-z0-9_-.:] => 1 or 2 (inner character)
  
-static unsigned char _nameChar[256] =
+static const unsigned char _nameChar[256] =
 {
     0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
     0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,0,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,
@@ -226,19 +227,28 @@ void XMLReader::_SkipSpacesAux(Utf8String& /* unused */)
 */
 void XMLReader::_SkipSpaces(Utf8String& /*unused*/)
 {
-    int n = 0;
-    while (_IsSpace(*m_CharStartPos))
-    { 
-        if (*m_CharStartPos == c_NewLine)
-            m_Line++; 
-        m_CharStartPos++;
-        ++m_CharPos;
-        n++; 
-    } 
+    size_t count = CodeUnitScan::SkipSpaces(_Cursor(), _Remaining(), m_Line);
+    m_CharStartPos += count;
+    m_CharPos += count;
     return;
 }
 
 
+/*
+**==============================================================================
+**
+** Advance to the first of three characters, or to the end of input
+**
+**==============================================================================
+*/
+void XMLReader::_ScanTo(Utf16Char a, Utf16Char b, Utf16Char c)
+{
+    size_t count = CodeUnitScan::FindAny(_Cursor(), _Remaining(), a, b, c, m_Line);
+    m_CharStartPos += count;
+    m_CharPos += count;
+}
+
+
 /*
 **==============================================================================
 **
@@ -438,7 +448,7 @@ Utf8String XMLReader::_ReduceAttrValue(/*Utf8String& pInOut,*/ Utf8String::Char
      * yeild 2, except for '\n', which yields 1 
      */
 #if 0
-    static unsigned char _match[256] =
+    static const unsigned char _match[256] =
     {
         0,1,1,1,1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
         1,1,0,1,1,1,0,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
@@ -481,8 +491,8 @@ Utf8String XMLReader::_ReduceAttrValue(/*Utf8String& pInOut,*/ Utf8String::Char
 */
 
     // Now that we know where the string end is, we have to run through the string
-    // a character at a timne and do string expansion/contraction.
-    int n = 0;
+    // and do string expansion/contraction.
+    size_t n = 0;
     while (m_CharPos <= m_InternalString.Size() && *m_CharStartPos != '\"')
     {
         if (m_CharPos == m_InternalString.Size())
@@ -518,15 +528,13 @@ Utf8String XMLReader::_ReduceAttrValue(/*Utf8String& pInOut,*/ Utf8String::Char
         }
         else
         {
-            // Count cones
-            if (*m_CharStartPos == c_NewLine)
-                n++;
-
-            // No conversion -- add to the output
-            end.Append(*m_CharStartPos);
+            // No conversion -- add everything up to the next quote or reference to the output
+            size_t count = CodeUnitScan::FindAny(_Cursor(), _Remaining(),
+                                            c_Quote, static_cast<Utf16Char>(eos), c_Ampersand, n);
+            end.append(m_InternalString, m_CharPos, count);
 
-            *m_CharStartPos++;
-            m_CharPos++;
+            m_CharStartPos += count;
+            m_CharPos += count;
         }
     }
 
@@ -544,20 +552,6 @@ Utf8String XMLReader::_ReduceAttrValue(/*Utf8String& pInOut,*/ Utf8String::Char
 */
 Utf8String XMLReader::_ReduceCharData( void )
 {
-    /* Match all but these: '\0', '<', '&', '\n' */
-    static unsigned char _match[256] =
-    {
-        0,1,1,1,1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-        1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,1,1,1,
-        1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-        1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-        1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-        1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-        1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-        1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-    };
-    size_t n = 0;
-    size_t index = 0;
     Utf8String end("");
 
     if (m_InternalString.Size()  < (m_CharPos + 1) || *m_CharStartPos == '\0')
@@ -565,38 +559,9 @@ Utf8String XMLReader::_ReduceCharData( void )
         return  Utf8String("");
     }
 
+    // Find the end of the string, counting the new lines on the way
     size_t oldStart = m_CharPos;
-    for (;;)
-    {
-        // Find the end of the string
-        CodePoint cp = (CodePoint)*m_CharStartPos;
-        while (1)
-        {
-            if (cp < 256)
-            {
-                if (!_match[cp])
-                {
-                    break;
-                }
-            }
-
-            // Value was either > 256 (Multibyte) or ASCII and not an XML control character
-            m_CharStartPos++;
-            m_CharPos++;
-            cp = (CodePoint)*m_CharStartPos;
-        }
-
-        // If it wasn't a new Line, break
-        if (*m_CharStartPos != c_NewLine)
-            break;
-        
-        // Skip over the new line
-        m_Line++;
-
-                m_CharStartPos++;
-        m_CharPos++;
-        cp = (CodePoint)*m_CharStartPos;
-    }
+    _ScanTo(c_LessThan, c_Ampersand, c_NullChar);
 
     // If index was set, clear the "end" string from the point of the existing 
     // string.  The result will be the first set of characters in the string, which
@@ -611,13 +576,11 @@ Utf8String XMLReader::_ReduceCharData( void )
     // Can we return now? 
     if (*m_CharStartPos == c_LessThan)
     {
-        m_Line += n;
         return  end;
     }
     
     // Well, looks like we got a string with embedded XML
     // We have to seek the next start tag, building the text from the current location.
-    index = 0;
 
     // Seek next tag start
     while (m_CharPos < m_InternalString.Size() && *m_CharStartPos != c_LessThan)
@@ -638,33 +601,11 @@ Utf8String XMLReader::_ReduceCharData( void )
         else
         {
             size_t oldStart2 = m_CharPos;
-            for (;;)
+            _ScanTo(c_LessThan, c_Ampersand, c_NullChar);
+            if (m_CharPos == oldStart2)
             {
-                CodePoint cp = (CodePoint)*m_CharStartPos;
-                while (1)
-                {
-                    if (cp < 256)
-                    {
-                        if (!_match[cp])
-                        {
-                            break;
-                        }
-                    }
-
-                    index++;
-                    ++m_CharStartPos;
-                    ++m_CharPos;
-                    cp = (CodePoint)*m_CharStartPos;
-                }
-    
-                if (*m_CharStartPos != c_NewLine)
-                {
-                    break;
-                }
-
-                m_CharStartPos++;
-                m_CharPos++;
-                m_Line++;
+                // Stopped at a NUL inside the input, which is reported below
+                break;
             }
             end.Append(m_InternalString.SubStr(oldStart2, m_CharPos - oldStart2));
         }
@@ -676,8 +617,6 @@ Utf8String XMLReader::_ReduceCharData( void )
         return Utf8String("");
     }
 
-    m_Line += n;
-
     return end;
 }
 
@@ -1057,6 +996,9 @@ void XMLReader::_ParseStartTag(pCXElement& elem)
     Utf8String name;
     size_t colonLoc;
 
+    // The caller may pass the element of the previous tag
+    elem->ClearAttributes();
+
     // Found the root
     m_FoundRoot = 1;
 
@@ -1307,6 +1249,7 @@ void XMLReader::_ParseEndTag(pCXElement& elem)
     if (n)
     {
         m_NameSpacesSize -= n;
+        m_NameSpaces.resize(m_NameSpacesSize);
 
         // Clear single-entry cache
         if (m_NameSpacesCacheIndex >= m_NameSpacesSize)
@@ -1395,7 +1338,7 @@ void XMLReader::_ParseCDATA(pCXElement& elem)
     size_t startPos = m_CharPos;
     Utf8String start;
 
-    static Utf8String cdataEnd("]]>");
+    static const Utf8String cdataEnd("]]>");
 
     while ((m_InternalString.Size() > m_CharPos) && *m_CharStartPos != '\0')
     {
@@ -1602,6 +1545,12 @@ void XML_NameSpace::XML_NameSpace_Dump( void )
 */
 void XMLReader::XML_Init( bool stripNamespaces /* = true */ )
 {
+    // Nothing may survive from a previous document parsed with this reader
+    m_Stack.clear();
+    m_ElemStack.clear();
+    m_NameSpaces.clear();
+    m_RegisteredNameSpaces.clear();
+
     m_InternalString = "";
     m_Line = 0;
     m_Status = 0;
@@ -1617,6 +1566,9 @@ void XMLReader::XML_Init( bool stripNamespaces /* = true */ )
     m_CharStartPos = m_InternalString.Begin();
     m_CharPos = 0;
     m_stripNamespaces = stripNamespaces;
+    m_EventElem = new CXElement();
+    m_EventAttr = 0;
+    m_EventAttrCount = 0;
 }
 
 
@@ -1768,6 +1720,98 @@ int XMLReader::XML_Next(pCXElement& elem)
 }
 
 
+/*
+**==============================================================================
+**
+** STREAMING INTERFACE
+**
+** Turns the elements returned by XML_Next into events.  The attributes of a
+** start tag are returned one by one on the calls following its START event.
+**
+**==============================================================================
+*/
+int XMLReader::XML_NextEvent(XML_Event& event)
+{
+    if (m_EventAttr < m_EventAttrCount)
+    {
+        int index = static_cast<int>(m_EventAttr++);
+        event.type = XML_EVENT_ATTRIBUTE;
+        event.name = m_EventElem->GetAttributeName(index);
+        event.value = m_EventElem->GetAttributeValue(index);
+        event.depth = m_Nesting;
+        return 0;
+    }
+    m_EventAttr = 0;
+    m_EventAttrCount = 0;
+
+    while (1)
+    {
+        int stat = XML_Next(m_EventElem);
+        if (stat != 0)
+        {
+            return stat;
+        }
+
+        switch (m_EventElem->GetType())
+        {
+            case XML_START:
+                // m_Nesting already counts the new element
+                event.type = XML_EVENT_START;
+                event.name = m_EventElem->GetName();
+                event.value.Clear();
+                event.depth = m_Nesting;
+                m_EventAttrCount = static_cast<size_t>(m_EventElem->GetAttributeCount());
+                return 0;
+
+            case XML_CHARS:
+                event.type = XML_EVENT_TEXT;
+                event.name.Clear();
+                event.value = m_EventElem->GetText();
+                event.depth = m_Nesting;
+                return 0;
+
+            case XML_END:
+                // m_Nesting no longer counts the closed element
+                event.type = XML_EVENT_END;
+                event.name = m_EventElem->GetName();
+                event.value.Clear();
+                event.depth = m_Nesting + 1;
+                return 0;
+
+            case XML_NONE:
+            case XML_INSTRUCTION:
+            case XML_COMMENT:
+                // Comments and processing instructions are skipped
+                break;
+        }
+    }
+}
+
+
+/*
+**==============================================================================
+**
+** Pass the events of the whole string to a handler
+**
+**==============================================================================
+*/
+int XMLReader::XML_Parse(XML_EventHandler& handler)
+{
+    XML_Event event;
+    int stat;
+
+    while ((stat = XML_NextEvent(event)) == 0)
+    {
+        if (!handler.XML_OnEvent(event))
+        {
+            return 0;
+        }
+    }
+
+    return stat;
+}
+
+
 /*
 **==============================================================================
 **
@@ -1865,8 +1909,8 @@ void XMLReader::XML_Dump( void )
   
     size_t i;
 
-    SCX_LOGINFO(m_logHandle, "==== XML:\n");
-    SCX_LOGINFO(m_logHandle, "m_NameSpaces:\n");
+    SCX_LOGINFO(LogHandle(), "==== XML:\n");
+    SCX_LOGINFO(LogHandle(), "m_NameSpaces:\n");
 
     for (i = 0; i < m_NameSpacesSize; i++)
     {
@@ -1878,6 +1922,25 @@ void XMLReader::XML_Dump( void )
 }
 
 
+/*
+**==============================================================================
+**
+** Log handle of the reader.  Looked up on first use, as readers that hit no
+** errors never log and should not contend on the log handle cache
+**
+**==============================================================================
+*/
+const SCXCoreLib::SCXLogHandle& XMLReader::LogHandle( void )
+{
+    if (!m_logHandleSet)
+    {
+        m_logHandle = LogHandleCache::Instance().GetLogHandle(std::string("scx.client.utilities.xml.XMLReader"));
+        m_logHandleSet = true;
+    }
+    return m_logHandle;
+}
+
+
 /*
 **==============================================================================
 **
@@ -1889,7 +1952,7 @@ void XMLReader::XML_PutError( void )
 {
   
     if (m_Status == -1)
-        SCX_LOGERROR(m_logHandle, m_Message);
+        SCX_LOGERROR(LogHandle(), m_Message);
   
 }
 
@@ -1913,6 +1976,6 @@ void XMLReader::XML_Raise(const char* format, ...)
 	vsnprintf(m_Message, sizeof(m_Message), format, ap);
     va_end(ap);
 
-    SCX_LOGINFO(m_logHandle, ("XML_Raise called...") + std::string(m_Message));
-    SCX_LOGINFO(m_logHandle, m_Message);
+    SCX_LOGINFO(LogHandle(), ("XML_Raise called...") + std::string(m_Message));
+    SCX_LOGINFO(LogHandle(), m_Message);
 }
@@ -267,21 +267,35 @@ void CXElement::AddChild(pCXElement& child)
 */
 void CXElement::PutText(Utf8String& sOut, Utf8String& TextIn)
 {
-    if (!TextIn.Empty())
+    EncodeText(sOut, TextIn);
+}
+
+/*
+**==============================================================================
+**
+**  Encode each character of a string and append it to the output string
+**
+**==============================================================================
+*/
+void CXElement::EncodeText(Utf8String& sOut, const Utf8String& TextIn)
+{
+    std::basic_string<Utf16Char>::const_iterator start = TextIn.begin();
+    std::basic_string<Utf16Char>::const_iterator end = TextIn.end();
+    Utf8String encodedStr;
+    for (; start != end; ++start)
     {
-        // Encode each character of the input string and add it to the output
-        // string.
-        Utf8String replacementString;
-        Utf8String::Iterator start = TextIn.Begin();
-        Utf8String::Iterator end = TextIn.End();
-        for (; start != end; ++start)
+        // Printable ASCII other than the reserved characters encodes as itself
+        Utf16Char c = *start;
+        if (c >= 0x20 && c < 0x80 && c != '&' && c != '<' && c != '>' && c != '\'' && c != '\"')
         {
-            Utf8String encodedStr;
-            EncodeChar (*start, encodedStr);
-            replacementString.Append(encodedStr);
+            sOut.push_back(c);
+            continue;
         }
 
-        sOut += replacementString;
+        // EncodeChar leaves the output alone for characters it drops
+        encodedStr.Clear();
+        EncodeChar (c, encodedStr);
+        sOut.Append(encodedStr);
     }
 }
 
@@ -0,0 +1,116 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        agentversion.cpp
+
+   \brief       Agent version of the form major.minor.patch.build, compared the
+                same way the install script does
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <agentversion.h>
+
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+
+using VMM::GuestAgent::Fetcher::AgentVersion;
+
+AgentVersion::AgentVersion()
+{
+    for (int i = 0; i < FieldCount; ++i)
+    {
+        m_fields[i] = 0;
+    }
+}
+
+bool AgentVersion::Parse(const std::string& text)
+{
+    std::string::size_type begin = text.find_first_not_of(" \t\r\n");
+    std::string::size_type end = text.find_last_not_of(" \t\r\n");
+    if (std::string::npos == begin)
+    {
+        return false;
+    }
+
+    unsigned long fields[FieldCount];
+    const char* pos = text.c_str() + begin;
+    const char* last = text.c_str() + end + 1;
+    for (int i = 0; i < FieldCount; ++i)
+    {
+        if (i > 0)
+        {
+            if (pos == last || '.' != *pos)
+            {
+                return false;
+            }
+            ++pos;
+        }
+
+        // strtoul would accept signs and leading blanks, the script would not
+        if (pos == last || !isdigit(static_cast<unsigned char>(*pos)))
+        {
+            return false;
+        }
+        char* fieldEnd = NULL;
+        errno = 0;
+        fields[i] = strtoul(pos, &fieldEnd, 10);
+        if (ERANGE == errno)
+        {
+            return false;
+        }
+        pos = fieldEnd;
+    }
+    if (pos != last)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < FieldCount; ++i)
+    {
+        m_fields[i] = fields[i];
+    }
+    return true;
+}
+
+bool AgentVersion::Read(const std::string& path)
+{
+    std::ifstream manifest(path.c_str());
+    std::string line;
+    if (!std::getline(manifest, line))
+    {
+        return false;
+    }
+    return Parse(line);
+}
+
+int AgentVersion::Compare(const AgentVersion& other) const
+{
+    for (int i = 0; i < FieldCount; ++i)
+    {
+        if (m_fields[i] != other.m_fields[i])
+        {
+            return m_fields[i] < other.m_fields[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        agentversion.h
+
+   \brief       Agent version of the form major.minor.patch.build, compared the
+                same way the install script does
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef AGENTVERSION_H
+#define AGENTVERSION_H
+
+#include <string>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace Fetcher
+        {
+
+            class AgentVersion
+            {
+
+            public:
+
+                /** Number of fields in a version */
+                static const int FieldCount = 4;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Constructor for AgentVersion; the version is 0.0.0.0
+
+                */
+                AgentVersion();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Parse a version
+
+                   \param   text    Version as major.minor.patch.build; surrounding
+                                    white space is ignored
+
+                   \return  False if text is not a version with four numeric fields
+
+                */
+                bool Parse(const std::string& text);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Read the version manifest the installer leaves in etc/version
+
+                   \param   path    Path of the manifest
+
+                   \return  False if the file is missing or holds no valid version
+
+                */
+                bool Read(const std::string& path);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Compare field by field, major first
+
+                   \return  Negative, zero or positive when this version is lower,
+                            equal or higher than other
+
+                */
+                int Compare(const AgentVersion& other) const;
+
+            private:
+
+                /** major, minor, patch and build */
+                unsigned long   m_fields[FieldCount];
+
+            }; // End of AgentVersion class
+
+        } // End of Fetcher namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* AGENTVERSION_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -0,0 +1,313 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        deviceprober.cpp
+
+   \brief       Looks for the specialization file on several devices at once.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <deviceprober.h>
+
+#include <util/LogHandleCache.h>
+#include <util/SpanTracer.h>
+#include <scxcorelib/scxcondition.h>
+#include <scxcorelib/stringaid.h>
+
+#include <time.h>
+
+#include <sstream>
+
+using VMM::GuestAgent::Fetcher::DeviceProber;
+using VMM::GuestAgent::Fetcher::ISO9660Reader;
+
+namespace
+{
+
+unsigned long long
+MonotonicMilliseconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<unsigned long long>(ts.tv_sec) * 1000 +
+        static_cast<unsigned long long>(ts.tv_nsec) / 1000000;
+}
+
+const char*
+ResultName(ISO9660Reader::Result result)
+{
+    switch (result)
+    {
+    case ISO9660Reader::FileFound:
+        return "found";
+    case ISO9660Reader::FileNotFound:
+        return "not found";
+    case ISO9660Reader::Unsupported:
+        return "unsupported";
+    case ISO9660Reader::ReadError:
+        return "read error";
+    }
+    return "unknown";
+}
+
+}
+
+/**
+   State of one Probe() call, shared by its tasks. Tasks that are still
+   running when Probe() returns keep it alive through their handle.
+*/
+class DeviceProber::ProbeBatch
+{
+public:
+    ProbeBatch(size_t pending)
+      : m_pending(pending)
+      , m_found(false)
+      , m_abandoned(false)
+    {
+        m_cond.SetSleep(0);
+    }
+
+    /** Guards all other members and signals completed probes */
+    SCXCoreLib::SCXCondition                   m_cond;
+
+    /** Probes queued or running */
+    size_t                                     m_pending;
+
+    /** Set by the first probe that reads the file; cancels the others */
+    bool                                       m_found;
+
+    /** Set when Probe() stopped waiting at its timeout; cancels the others */
+    bool                                       m_abandoned;
+
+    /** Device the file was read from */
+    std::string                                m_device;
+
+    /** Contents of the file */
+    std::vector<unsigned char>                 m_data;
+
+    /** Devices that did not yield the file */
+    std::vector<DeviceProber::Outcome>         m_outcomes;
+};
+
+namespace
+{
+
+class ProbeTaskParam : public SCXCoreLib::SCXThreadParam
+{
+public:
+    ProbeTaskParam(SCXCoreLib::SCXHandle<DeviceProber::ProbeBatch> batch,
+                   const std::string& device,
+                   const std::string& fileName,
+                   SCXCoreLib::SCXLogHandle& logHandle)
+      : m_batch(batch)
+      , m_device(device)
+      , m_fileName(fileName)
+      , m_logHandle(logHandle)
+    {
+    }
+
+    SCXCoreLib::SCXHandle<DeviceProber::ProbeBatch> m_batch;
+    std::string                         m_device;
+    std::string                         m_fileName;
+    SCXCoreLib::SCXLogHandle            m_logHandle;
+};
+
+}
+
+
+DeviceProber::DeviceProber(const std::string& fileName, long threadLimit)
+  : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
+                    "scx.vmmguestagent.src.fetcher.deviceprober"))
+  , m_fileName(fileName)
+  , m_pool(new SCXCoreLib::SCXThreadPool())
+  , m_unfinished()
+{
+    m_pool->SetThreadLimit(threadLimit);
+    m_pool->Start();
+}
+
+DeviceProber::~DeviceProber()
+{
+    size_t running = 0;
+    for (std::vector<SCXCoreLib::SCXHandle<ProbeBatch> >::const_iterator iter = m_unfinished.begin();
+         iter != m_unfinished.end(); ++iter)
+    {
+        SCXCoreLib::SCXConditionHandle h((*iter)->m_cond);
+        running += (*iter)->m_pending;
+    }
+
+    if (0 != running)
+    {
+        // A read on a hung device cannot be interrupted, and joining its worker
+        // would block the agent from exiting; the workers go with the process.
+        std::ostringstream strm;
+        strm << "Abandoning " << running << " probe(s) that are still reading";
+        SCX_LOGWARNING(m_logHandle, strm.str());
+        return;
+    }
+
+    m_pool->Shutdown();
+    delete m_pool;
+}
+
+bool DeviceProber::Probe(
+    const std::vector<std::string>& devices,
+    unsigned long long timeoutMs,
+    std::string& device,
+    std::vector<unsigned char>& data,
+    std::vector<Outcome>& outcomes)
+{
+    outcomes.clear();
+    DropFinishedBatches();
+    if (devices.empty())
+    {
+        return false;
+    }
+
+    SCXCoreLib::SCXHandle<ProbeBatch> batch(new ProbeBatch(devices.size()));
+
+    for (std::vector<std::string>::const_iterator iter = devices.begin();
+         iter != devices.end(); ++iter)
+    {
+        SCX_LOGINFO(m_logHandle, "Probing " + *iter + " for " + m_fileName);
+
+        SCXCoreLib::SCXThreadParamHandle param(
+            new ProbeTaskParam(batch, *iter, m_fileName, m_logHandle));
+        m_pool->QueueTask(SCXCoreLib::SCXThreadPoolTaskHandle(
+            new SCXCoreLib::SCXThreadPoolTask(ProbeTask, param)));
+    }
+
+    unsigned long long deadline = MonotonicMilliseconds() + timeoutMs;
+
+    SCXCoreLib::SCXConditionHandle h(batch->m_cond);
+    while (!batch->m_found && 0 != batch->m_pending)
+    {
+        unsigned long long now = MonotonicMilliseconds();
+        if (now >= deadline)
+        {
+            std::ostringstream strm;
+            strm << "Deadline passed with " << batch->m_pending << " probe(s) outstanding";
+            SCX_LOGWARNING(m_logHandle, strm.str());
+            batch->m_abandoned = true;
+            break;
+        }
+
+        batch->m_cond.SetSleep(deadline - now);
+        h.Wait();
+    }
+    batch->m_cond.SetSleep(0);
+
+    // Keep track of probes that may never return, for the destructor
+    if (0 != batch->m_pending)
+    {
+        m_unfinished.push_back(batch);
+    }
+
+    if (batch->m_found)
+    {
+        if (0 != batch->m_pending)
+        {
+            std::ostringstream strm;
+            strm << "Cancelling " << batch->m_pending << " outstanding probe(s)";
+            SCX_LOGINFO(m_logHandle, strm.str());
+        }
+
+        device = batch->m_device;
+        data.swap(batch->m_data);
+        return true;
+    }
+
+    outcomes = batch->m_outcomes;
+    return false;
+}
+
+void DeviceProber::DropFinishedBatches()
+{
+    std::vector<SCXCoreLib::SCXHandle<ProbeBatch> >::iterator iter = m_unfinished.begin();
+    while (iter != m_unfinished.end())
+    {
+        bool finished;
+        {
+            SCXCoreLib::SCXConditionHandle h((*iter)->m_cond);
+            finished = 0 == (*iter)->m_pending;
+        }
+
+        if (finished)
+        {
+            iter = m_unfinished.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+}
+
+void DeviceProber::ProbeTask(SCXCoreLib::SCXThreadParamHandle& param)
+{
+    ProbeTaskParam* p = static_cast<ProbeTaskParam*>(param.GetData());
+    ProbeBatch& batch = *p->m_batch;
+
+    {
+        SCXCoreLib::SCXConditionHandle h(batch.m_cond);
+        if (batch.m_found || batch.m_abandoned)
+        {
+            SCX_LOGINFO(p->m_logHandle, "Probe of " + p->m_device + " cancelled");
+            --batch.m_pending;
+            h.Signal();
+            return;
+        }
+    }
+
+    SCX::Util::ScopedSpan span("probe " + p->m_device, "fetcher");
+    unsigned long long start = MonotonicMilliseconds();
+
+    std::vector<unsigned char> data;
+    ISO9660Reader reader(p->m_device);
+    ISO9660Reader::Result result = reader.ReadRootFile(p->m_fileName, data);
+
+    std::ostringstream strm;
+    strm << "Probe of " << p->m_device << ": " << ResultName(result)
+         << " in " << (MonotonicMilliseconds() - start) << " ms";
+
+    SCXCoreLib::SCXConditionHandle h(batch.m_cond);
+    --batch.m_pending;
+
+    if (batch.m_found || batch.m_abandoned)
+    {
+        strm << ", discarded";
+    }
+    else if (ISO9660Reader::FileFound == result)
+    {
+        batch.m_found = true;
+        batch.m_device = p->m_device;
+        batch.m_data.swap(data);
+    }
+    else
+    {
+        DeviceProber::Outcome outcome;
+        outcome.device = p->m_device;
+        outcome.result = result;
+        batch.m_outcomes.push_back(outcome);
+    }
+
+    SCX_LOGINFO(p->m_logHandle, strm.str());
+    h.Signal();
+}
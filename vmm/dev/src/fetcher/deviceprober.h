@@ -0,0 +1,151 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        deviceprober.h
+
+   \brief       Looks for the specialization file on several devices at once,
+                one thread pool task per device.
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef DEVICEPROBER_H
+#define DEVICEPROBER_H
+
+#include <string>
+#include <vector>
+
+#include <scxcorelib/scxlog.h>
+#include <scxcorelib/scxthreadpool.h>
+
+#include <iso9660reader.h>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace Fetcher
+        {
+
+            class DeviceProber
+            {
+
+            public:
+
+                /** Result of a probe that did not produce the file */
+                struct Outcome
+                {
+                    /** Device path that was probed */
+                    std::string               device;
+
+                    /** What the reader reported for it */
+                    ISO9660Reader::Result     result;
+                };
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Constructor for DeviceProber
+
+                   \param   fileName       Name of the file to look for in the root directory
+                   \param   threadLimit    Maximum number of devices probed at the same time
+
+                */
+                DeviceProber(const std::string& fileName, long threadLimit);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Destructor for DeviceProber. Probes still blocked in a read are
+                   abandoned together with the thread pool rather than joined.
+
+                */
+                ~DeviceProber();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Probe all devices concurrently. Returns as soon as one of them yields
+                   the file, or when the timeout passes; probes that have not started
+                   yet are cancelled and the results of those still running are discarded.
+
+                   \param   devices     Device paths to probe
+                   \param   timeoutMs   Milliseconds to wait for the probes at most
+                   \param   device      Receives the device the file was read from
+                   \param   data        Receives the file contents
+                   \param   outcomes    Receives the devices that did not yield the file,
+                                        only filled when no device did; devices still
+                                        being read at the timeout are left out
+
+                   \return  bool        True if the file was found
+
+                */
+                bool Probe(const std::vector<std::string>& devices,
+                           unsigned long long timeoutMs,
+                           std::string& device,
+                           std::vector<unsigned char>& data,
+                           std::vector<Outcome>& outcomes);
+
+                /** State of one Probe() call, shared with its tasks */
+                class ProbeBatch;
+
+            private:
+
+                /** Log Handle */
+                SCXCoreLib::SCXLogHandle          m_logHandle;
+
+                /** File looked for on each device */
+                std::string                       m_fileName;
+
+                /** Workers running the probes; leaked if a probe never returns */
+                SCXCoreLib::SCXThreadPool*        m_pool;
+
+                /** Batches of earlier calls with probes still queued or running */
+                std::vector<SCXCoreLib::SCXHandle<ProbeBatch> > m_unfinished;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Forget batches in m_unfinished whose probes have all returned since.
+
+                */
+                void DropFinishedBatches();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Thread pool entry point for a single device probe
+
+                   \param   param    ProbeTaskParam of the device to probe
+
+                */
+                static void ProbeTask(SCXCoreLib::SCXThreadParamHandle& param);
+
+                /** Prevent copying of the thread pool */
+                DeviceProber(const DeviceProber&);
+                DeviceProber& operator=(const DeviceProber&);
+
+            }; // End of DeviceProber class
+
+        } // End of Fetcher namespace
+
+    } // End of GuestAgent
+
+} // End of VMM
+
+#endif /* DEVICEPROBER_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -0,0 +1,296 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        devicewatcher.cpp
+
+   \brief       Reports candidate block devices as soon as they show up.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <devicewatcher.h>
+
+#include <util/LogHandleCache.h>
+#include <scxcorelib/stringaid.h>
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+using VMM::GuestAgent::Fetcher::DeviceWatcher;
+
+namespace
+{
+
+// Devices that exist but were missed by inotify (or when inotify is not
+// available at all) are picked up by a rescan at this interval.
+int const RESCAN_INTERVAL_MS = 2000;
+
+size_t const EVENT_BUFFER_SIZE = 4096;
+
+unsigned long long
+MonotonicMilliseconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<unsigned long long>(ts.tv_sec) * 1000 +
+        static_cast<unsigned long long>(ts.tv_nsec) / 1000000;
+}
+
+std::string
+DirName(const std::string& path)
+{
+    std::string::size_type pos = path.rfind('/');
+    if (std::string::npos == pos || 0 == pos)
+    {
+        return "/";
+    }
+    return path.substr(0, pos);
+}
+
+}
+
+
+DeviceWatcher::DeviceWatcher(
+    const std::vector<std::string>& candidates,
+    unsigned int timeoutSecs)
+  : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
+                    "scx.vmmguestagent.src.fetcher.devicewatcher"))
+  , m_candidates(candidates)
+  , m_reported()
+  , m_inotifyFd(-1)
+  , m_watchDirs()
+  , m_deadline(MonotonicMilliseconds() +
+               static_cast<unsigned long long>(timeoutSecs) * 1000)
+  , m_nextRescan(MonotonicMilliseconds() + RESCAN_INTERVAL_MS)
+{
+    m_inotifyFd = inotify_init();
+    if (-1 == m_inotifyFd)
+    {
+        SCX_LOGWARNING(m_logHandle, "inotify_init failed, falling back to rescanning. errno: " +
+                       SCXCoreLib::StrToUTF8(SCXCoreLib::StrFrom(errno)));
+        return;
+    }
+
+    std::set<std::string> dirs;
+    for (std::vector<std::string>::const_iterator iter = m_candidates.begin();
+         iter != m_candidates.end(); ++iter)
+    {
+        dirs.insert(DirName(*iter));
+    }
+
+    // udev creates the /dev/cdrom* links (IN_CREATE) and may move them in
+    // place (IN_MOVED_TO); it fixes up permissions afterwards (IN_ATTRIB).
+    for (std::set<std::string>::const_iterator iter = dirs.begin();
+         iter != dirs.end(); ++iter)
+    {
+        int wd = inotify_add_watch(m_inotifyFd, iter->c_str(),
+                                   IN_CREATE | IN_MOVED_TO | IN_ATTRIB);
+        if (-1 == wd)
+        {
+            SCX_LOGWARNING(m_logHandle, "Unable to watch " + *iter + " errno: " +
+                           SCXCoreLib::StrToUTF8(SCXCoreLib::StrFrom(errno)));
+            continue;
+        }
+        m_watchDirs[wd] = *iter;
+    }
+}
+
+DeviceWatcher::~DeviceWatcher()
+{
+    if (-1 != m_inotifyFd)
+    {
+        close(m_inotifyFd);
+    }
+}
+
+void DeviceWatcher::GetPresentDevices(std::vector<std::string>& devices)
+{
+    devices.clear();
+    CheckPresentDevices(devices);
+}
+
+void DeviceWatcher::CheckPresentDevices(std::vector<std::string>& devices)
+{
+    for (std::vector<std::string>::const_iterator iter = m_candidates.begin();
+         iter != m_candidates.end(); ++iter)
+    {
+        CheckDevice(*iter, devices);
+    }
+}
+
+bool DeviceWatcher::WaitForDevices(std::vector<std::string>& devices)
+{
+    devices.clear();
+
+    while (devices.empty())
+    {
+        unsigned long long now = MonotonicMilliseconds();
+        if (now >= m_deadline)
+        {
+            SCX_LOGINFO(m_logHandle, "Deadline passed while waiting for devices");
+            return false;
+        }
+
+        // Wake up for whichever comes first, the rescan or the deadline
+        unsigned long long wakeup = std::min(m_deadline, std::max(m_nextRescan, now));
+        int timeout = static_cast<int>(wakeup - now);
+
+        int status = 0;
+        if (-1 != m_inotifyFd)
+        {
+            struct pollfd pfd;
+            pfd.fd = m_inotifyFd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            status = poll(&pfd, 1, timeout);
+        }
+        else
+        {
+            usleep(static_cast<useconds_t>(timeout) * 1000);
+        }
+
+        if (status > 0)
+        {
+            ReadEvents(devices);
+        }
+        else if (status < 0 && errno != EINTR)
+        {
+            SCX_LOGERROR(m_logHandle, "poll on inotify failed. errno: " +
+                         SCXCoreLib::StrToUTF8(SCXCoreLib::StrFrom(errno)));
+            close(m_inotifyFd);
+            m_inotifyFd = -1;
+        }
+
+        // Checked after every wakeup: a steady stream of unrelated events in
+        // the watched directories must not hold off rescanning re-armed devices.
+        now = MonotonicMilliseconds();
+        if (now >= m_nextRescan)
+        {
+            m_nextRescan = now + RESCAN_INTERVAL_MS;
+            CheckPresentDevices(devices);
+        }
+    }
+
+    return true;
+}
+
+void DeviceWatcher::Rearm(const std::string& device)
+{
+    m_reported.erase(device);
+}
+
+void DeviceWatcher::SetTimeout(unsigned int timeoutSecs)
+{
+    m_deadline = MonotonicMilliseconds() +
+        static_cast<unsigned long long>(timeoutSecs) * 1000;
+}
+
+unsigned long long DeviceWatcher::GetRemainingMilliseconds() const
+{
+    unsigned long long now = MonotonicMilliseconds();
+    return now < m_deadline ? m_deadline - now : 0;
+}
+
+void DeviceWatcher::ReadEvents(std::vector<std::string>& devices)
+{
+    char buffer[EVENT_BUFFER_SIZE]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    ssize_t len = read(m_inotifyFd, buffer, sizeof(buffer));
+    if (len <= 0)
+    {
+        return;
+    }
+
+    for (char* ptr = buffer; ptr < buffer + len; )
+    {
+        struct inotify_event* event = reinterpret_cast<struct inotify_event*>(ptr);
+        ptr += sizeof(struct inotify_event) + event->len;
+
+        if (IN_Q_OVERFLOW & event->mask)
+        {
+            // Events were lost; fall back to a full scan. Devices this read
+            // already reported stay in the list, and the scan does not skip
+            // reported ones as the lost events may have been about them.
+            RescanDevices(devices);
+            continue;
+        }
+
+        std::map<int, std::string>::const_iterator dir = m_watchDirs.find(event->wd);
+        if (m_watchDirs.end() == dir || 0 == event->len)
+        {
+            continue;
+        }
+
+        std::string path = dir->second;
+        if ('/' != path[path.length() - 1])
+        {
+            path.push_back('/');
+        }
+        path.append(event->name);
+
+        if (m_candidates.end() != std::find(m_candidates.begin(), m_candidates.end(), path))
+        {
+            CheckDevice(path, devices);
+        }
+    }
+}
+
+void DeviceWatcher::CheckDevice(const std::string& device,
+                                std::vector<std::string>& devices)
+{
+    if (m_reported.end() != m_reported.find(device))
+    {
+        return;
+    }
+
+    struct stat statbuf;
+    if (0 != stat(device.c_str(), &statbuf))
+    {
+        return;
+    }
+
+    SCX_LOGINFO(m_logHandle, "Device present: " + device);
+    m_reported.insert(device);
+    devices.push_back(device);
+}
+
+void DeviceWatcher::RescanDevices(std::vector<std::string>& devices)
+{
+    for (std::vector<std::string>::const_iterator iter = m_candidates.begin();
+         iter != m_candidates.end(); ++iter)
+    {
+        struct stat statbuf;
+        if (0 != stat(iter->c_str(), &statbuf) ||
+            devices.end() != std::find(devices.begin(), devices.end(), *iter))
+        {
+            continue;
+        }
+
+        SCX_LOGINFO(m_logHandle, "Device present after rescan: " + *iter);
+        m_reported.insert(*iter);
+        devices.push_back(*iter);
+    }
+}
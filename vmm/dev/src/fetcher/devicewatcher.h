@@ -0,0 +1,198 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        devicewatcher.h
+
+   \brief       Reports candidate block devices as soon as they show up, using
+                inotify on their parent directories with a periodic rescan as
+                fallback.
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef DEVICEWATCHER_H
+#define DEVICEWATCHER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <scxcorelib/scxlog.h>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace Fetcher
+        {
+
+            class DeviceWatcher
+            {
+
+            public:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Constructor for DeviceWatcher. Watching starts immediately so that
+                   no device created after construction can be missed.
+
+                   \param   candidates    Device paths to look for
+                   \param   timeoutSecs   Seconds from now after which WaitForDevices gives up
+
+                */
+                DeviceWatcher(const std::vector<std::string>& candidates,
+                              unsigned int timeoutSecs);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Destructor for DeviceWatcher
+
+                */
+                ~DeviceWatcher();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Collect the candidates that exist right now and were not reported yet
+
+                   \param   devices    Receives the newly found device paths
+
+                */
+                void GetPresentDevices(std::vector<std::string>& devices);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Block until at least one unreported candidate appears
+
+                   \param   devices    Receives the newly found device paths
+
+                   \return  bool       False if the deadline passed without a new device
+
+                */
+                bool WaitForDevices(std::vector<std::string>& devices);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Allow a device that was already reported to be reported again, e.g.
+                   when it exists but could not be mounted yet
+
+                   \param   device    Device path to re-arm
+
+                */
+                void Rearm(const std::string& device);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Move the deadline, e.g. when a driver was loaded and its devices
+                   need longer to show up
+
+                   \param   timeoutSecs   Seconds from now after which WaitForDevices gives up
+
+                */
+                void SetTimeout(unsigned int timeoutSecs);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Time left until the deadline
+
+                   \return  unsigned long long   Milliseconds until WaitForDevices gives up,
+                                                 0 once the deadline has passed
+
+                */
+                unsigned long long GetRemainingMilliseconds() const;
+
+            private:
+
+                /** Log Handle */
+                SCXCoreLib::SCXLogHandle          m_logHandle;
+
+                /** Device paths being looked for */
+                std::vector<std::string>          m_candidates;
+
+                /** Device paths already handed out */
+                std::set<std::string>             m_reported;
+
+                /** inotify instance, -1 when only rescanning is available */
+                int                               m_inotifyFd;
+
+                /** Watched directory for every inotify watch descriptor */
+                std::map<int, std::string>        m_watchDirs;
+
+                /** Monotonic deadline in milliseconds */
+                unsigned long long                m_deadline;
+
+                /** Monotonic time in milliseconds of the next rescan for re-armed or missed devices */
+                unsigned long long                m_nextRescan;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Drain pending inotify events and collect matching candidates
+
+                   \param   devices    Receives the newly found device paths
+
+                */
+                void ReadEvents(std::vector<std::string>& devices);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Add the candidates that exist and were not reported yet
+
+                   \param   devices    Receives the newly found device paths
+
+                */
+                void CheckPresentDevices(std::vector<std::string>& devices);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Report a candidate if it exists and was not reported before
+
+                   \param   device     Device path to check
+                   \param   devices    Receives the device path if reported
+
+                */
+                void CheckDevice(const std::string& device,
+                                 std::vector<std::string>& devices);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Report every candidate that exists, reported before or not, for
+                   when inotify events were lost
+
+                   \param   devices    Receives the device paths not already in it
+
+                */
+                void RescanDevices(std::vector<std::string>& devices);
+
+                /** Prevent copying of the inotify descriptor */
+                DeviceWatcher(const DeviceWatcher&);
+                DeviceWatcher& operator=(const DeviceWatcher&);
+
+            }; // End of DeviceWatcher class
+
+        } // End of Fetcher namespace
+
+    } // End of GuestAgent
+
+} // End of VMM
+
+#endif /* DEVICEWATCHER_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -0,0 +1,175 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        grubenv.cpp
+
+   \brief       Reads and writes the GRUB environment block without the grub tools
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <grubenv.h>
+#include <filewriter.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+
+namespace
+{
+
+// First line of every environment block, as grub-editenv writes it
+std::string const Signature = "# GRUB Environment Block\n";
+
+// Directories grub keeps its environment in; grub2 is the Red Hat naming
+char const* const GrubEnvPaths[] = {
+    "/boot/grub/grubenv",
+    "/boot/grub2/grubenv",
+    NULL
+};
+
+}
+
+using VMM::GuestAgent::Fetcher::GrubEnv;
+using VMM::GuestAgent::Utilities::FileWriter;
+
+std::string GrubEnv::Find()
+{
+    for (int i = 0; NULL != GrubEnvPaths[i]; ++i)
+    {
+        struct stat statbuf;
+        if (0 == stat(GrubEnvPaths[i], &statbuf) && S_ISREG(statbuf.st_mode))
+        {
+            return GrubEnvPaths[i];
+        }
+    }
+    return std::string();
+}
+
+bool GrubEnv::Load(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "r");
+    if (NULL == file)
+    {
+        return false;
+    }
+    char buffer[BlockSize + 1];
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+    bool failed = 0 != ferror(file);
+    fclose(file);
+
+    std::string block(buffer, size);
+    if (failed || BlockSize != size || 0 != block.compare(0, Signature.length(), Signature))
+    {
+        return false;
+    }
+
+    // name=value lines, with backslash and newline escaped by a backslash, up
+    // to the '#' padding
+    m_variables.clear();
+    std::string::size_type pos = Signature.length();
+    while (pos < block.length() && '#' != block[pos])
+    {
+        std::string line;
+        for (; pos < block.length() && '\n' != block[pos]; ++pos)
+        {
+            if ('\\' == block[pos] && pos + 1 < block.length())
+            {
+                ++pos;
+            }
+            line += block[pos];
+        }
+        ++pos;
+
+        std::string::size_type equals = line.find('=');
+        if (std::string::npos != equals)
+        {
+            m_variables.push_back(std::make_pair(line.substr(0, equals), line.substr(equals + 1)));
+        }
+    }
+    return true;
+}
+
+bool GrubEnv::Get(const std::string& name, std::string& value) const
+{
+    for (size_t i = 0; i < m_variables.size(); ++i)
+    {
+        if (m_variables[i].first == name)
+        {
+            value = m_variables[i].second;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GrubEnv::Set(const std::string& name, const std::string& value)
+{
+    for (size_t i = 0; i < m_variables.size(); ++i)
+    {
+        if (m_variables[i].first == name)
+        {
+            if (m_variables[i].second == value)
+            {
+                return false;
+            }
+            m_variables[i].second = value;
+            return true;
+        }
+    }
+    m_variables.push_back(std::make_pair(name, value));
+    return true;
+}
+
+bool GrubEnv::Save(const std::string& path) const
+{
+    std::string block(Signature);
+    for (size_t i = 0; i < m_variables.size(); ++i)
+    {
+        block += m_variables[i].first;
+        block += '=';
+        const std::string& value = m_variables[i].second;
+        for (size_t c = 0; c < value.length(); ++c)
+        {
+            if ('\\' == value[c] || '\n' == value[c])
+            {
+                block += '\\';
+            }
+            block += value[c];
+        }
+        block += '\n';
+    }
+    if (block.length() > BlockSize)
+    {
+        errno = ENOSPC;
+        return false;
+    }
+    block.append(BlockSize - block.length(), '#');
+
+    // Some distros link grubenv into the EFI partition; replace the target
+    char resolved[PATH_MAX];
+    std::string target = NULL != realpath(path.c_str(), resolved) ? std::string(resolved) : path;
+
+    // The new block takes over mode, owner and SELinux context of the one
+    // it replaces; distros that keep grubenv 0600 must not end up with it
+    // world readable
+    return FileWriter::Replace(target, block);
+}
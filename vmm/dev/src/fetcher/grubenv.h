@@ -0,0 +1,119 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        grubenv.h
+
+   \brief       Reads and writes the GRUB environment block without the grub tools
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef GRUBENV_H
+#define GRUBENV_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace Fetcher
+        {
+
+            class GrubEnv
+            {
+
+            public:
+
+                /** Size of the environment block; grub reads it as one fixed block */
+                static const size_t BlockSize = 1024;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Find the environment block in the standard grub directories
+
+                   \return  Path of the first grubenv found, empty if there is none
+
+                */
+                static std::string Find();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Read an environment block
+
+                   \param   path    Path of the grubenv file
+
+                   \return  False if the file cannot be read or is not an environment block
+
+                */
+                bool Load(const std::string& path);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Get a variable
+
+                   \param   name     Name of the variable
+                   \param   value    Receives the value if the variable is set
+
+                   \return  False if the variable is not set
+
+                */
+                bool Get(const std::string& name, std::string& value) const;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Set a variable, keeping its place if it is set already
+
+                   \return  False if the value did not change
+
+                */
+                bool Set(const std::string& name, const std::string& value);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Write the environment block, replacing the file atomically and
+                   syncing it to disk. A symbolic link is followed, not replaced.
+
+                   \param   path    Path of the grubenv file
+
+                   \return  False if the variables do not fit the block or the
+                            file cannot be written; errno tells why
+
+                */
+                bool Save(const std::string& path) const;
+
+            private:
+
+                /** Variables in the order of the block */
+                std::vector<std::pair<std::string, std::string> >  m_variables;
+
+            }; // End of GrubEnv class
+
+        } // End of Fetcher namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* GRUBENV_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -0,0 +1,340 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        iso9660reader.cpp
+
+   \brief       Reads a file from the root directory of an ISO9660/Joliet image
+                without mounting it. Layout follows ECMA-119 and the Joliet
+                specification.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <iso9660reader.h>
+
+#include <util/LogHandleCache.h>
+#include <scxcorelib/stringaid.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+using VMM::GuestAgent::Fetcher::ISO9660Reader;
+
+namespace
+{
+
+size_t const SECTOR_SIZE = 2048;
+
+// Logical blocks are a power of two from 512 bytes up to the sector size
+unsigned int const MIN_LOGICAL_BLOCK_SIZE = 512;
+
+// Volume descriptors start at sector 16
+unsigned int const FIRST_DESCRIPTOR_SECTOR = 16;
+unsigned int const MAX_DESCRIPTORS = 32;
+
+unsigned char const DESCRIPTOR_PRIMARY = 1;
+unsigned char const DESCRIPTOR_SUPPLEMENTARY = 2;
+unsigned char const DESCRIPTOR_TERMINATOR = 255;
+
+// Offsets within a volume descriptor
+size_t const VD_ESCAPE_SEQUENCES = 88;
+size_t const VD_LOGICAL_BLOCK_SIZE = 128;
+size_t const VD_ROOT_DIRECTORY_RECORD = 156;
+
+// Offsets within a directory record
+size_t const DR_LENGTH = 0;
+size_t const DR_EXTENT_LOCATION = 2;
+size_t const DR_DATA_LENGTH = 10;
+size_t const DR_FLAGS = 25;
+size_t const DR_IDENTIFIER_LENGTH = 32;
+size_t const DR_IDENTIFIER = 33;
+
+unsigned char const DR_FLAG_DIRECTORY = 0x02;
+
+// Sanity limits; the specialization file and the root directory are small
+unsigned int const MAX_DIRECTORY_SIZE = 1024 * 1024;
+unsigned int const MAX_FILE_SIZE = 16 * 1024 * 1024;
+
+inline unsigned int
+ReadLE32(const unsigned char* p)
+{
+    return static_cast<unsigned int>(p[0]) |
+        (static_cast<unsigned int>(p[1]) << 8) |
+        (static_cast<unsigned int>(p[2]) << 16) |
+        (static_cast<unsigned int>(p[3]) << 24);
+}
+
+inline unsigned int
+ReadLE16(const unsigned char* p)
+{
+    return static_cast<unsigned int>(p[0]) |
+        (static_cast<unsigned int>(p[1]) << 8);
+}
+
+bool
+IsJolietDescriptor(const unsigned char* descriptor)
+{
+    const unsigned char* esc = descriptor + VD_ESCAPE_SEQUENCES;
+    return 0x25 == esc[0] && 0x2F == esc[1] &&
+        (0x40 == esc[2] || 0x43 == esc[2] || 0x45 == esc[2]);
+}
+
+/** Lower-case the name and drop the ";1" version and a trailing dot */
+std::string
+NormalizeName(const std::string& name)
+{
+    std::string result(name);
+
+    std::string::size_type pos = result.find(';');
+    if (std::string::npos != pos)
+    {
+        result.erase(pos);
+    }
+    if (!result.empty() && '.' == result[result.length() - 1])
+    {
+        result.erase(result.length() - 1);
+    }
+    for (std::string::size_type i = 0; i < result.length(); ++i)
+    {
+        result[i] = static_cast<char>(tolower(static_cast<unsigned char>(result[i])));
+    }
+
+    return result;
+}
+
+}
+
+
+ISO9660Reader::ISO9660Reader(const std::string& device)
+  : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
+                    "scx.vmmguestagent.src.fetcher.iso9660reader"))
+  , m_device(device)
+  , m_fd(-1)
+{
+}
+
+ISO9660Reader::~ISO9660Reader()
+{
+    if (-1 != m_fd)
+    {
+        close(m_fd);
+    }
+}
+
+ISO9660Reader::Result
+ISO9660Reader::ReadRootFile(
+    const std::string& fileName,
+    std::vector<unsigned char>& data)
+{
+    data.clear();
+
+    if (-1 == m_fd)
+    {
+        m_fd = open(m_device.c_str(), O_RDONLY);
+        if (-1 == m_fd)
+        {
+            SCX_LOGERROR(m_logHandle, "Unable to open " + m_device + " errno: " +
+                         SCXCoreLib::StrToUTF8(SCXCoreLib::StrFrom(errno)));
+            return ReadError;
+        }
+    }
+
+    // Walk the volume descriptor set, remembering the primary root and,
+    // preferably, the Joliet root which carries the real (long) names.
+    unsigned char descriptor[SECTOR_SIZE];
+    unsigned char root[DR_IDENTIFIER] = { 0 };
+    unsigned int blockSize = 0;
+    bool foundVolume = false;
+    bool joliet = false;
+
+    for (unsigned int i = 0; i < MAX_DESCRIPTORS; ++i)
+    {
+        if (!ReadAt(static_cast<unsigned long long>(FIRST_DESCRIPTOR_SECTOR + i) * SECTOR_SIZE,
+                    SECTOR_SIZE, descriptor))
+        {
+            return 0 == i ? ReadError : Unsupported;
+        }
+
+        if (0 != memcmp(descriptor + 1, "CD001", 5))
+        {
+            break;
+        }
+
+        if (DESCRIPTOR_TERMINATOR == descriptor[0])
+        {
+            break;
+        }
+
+        if ((DESCRIPTOR_PRIMARY == descriptor[0] && !joliet) ||
+            (DESCRIPTOR_SUPPLEMENTARY == descriptor[0] && IsJolietDescriptor(descriptor)))
+        {
+            joliet = DESCRIPTOR_SUPPLEMENTARY == descriptor[0];
+            foundVolume = true;
+            blockSize = ReadLE16(descriptor + VD_LOGICAL_BLOCK_SIZE);
+            memcpy(root, descriptor + VD_ROOT_DIRECTORY_RECORD, sizeof(root));
+        }
+    }
+
+    if (!foundVolume || 0 == blockSize)
+    {
+        SCX_LOGINFO(m_logHandle, "No ISO9660 volume descriptor on " + m_device);
+        return Unsupported;
+    }
+
+    if (blockSize < MIN_LOGICAL_BLOCK_SIZE || SECTOR_SIZE < blockSize || 0 != (blockSize & (blockSize - 1)))
+    {
+        SCX_LOGERROR(m_logHandle, "Unexpected logical block size " +
+                     SCXCoreLib::StrToUTF8(SCXCoreLib::StrFrom(blockSize)) + " on " + m_device);
+        return Unsupported;
+    }
+
+    unsigned int rootLocation = ReadLE32(root + DR_EXTENT_LOCATION);
+    unsigned int rootLength = ReadLE32(root + DR_DATA_LENGTH);
+    if (0 == rootLength || MAX_DIRECTORY_SIZE < rootLength)
+    {
+        SCX_LOGERROR(m_logHandle, "Unexpected root directory size on " + m_device);
+        return Unsupported;
+    }
+
+    std::vector<unsigned char> extent(rootLength);
+    if (!ReadAt(static_cast<unsigned long long>(rootLocation) * blockSize,
+                rootLength, &extent[0]))
+    {
+        return ReadError;
+    }
+
+    unsigned int fileLocation = 0;
+    unsigned int fileLength = 0;
+    if (!FindEntry(extent, blockSize, joliet, fileName, fileLocation, fileLength))
+    {
+        // Without Joliet the primary names may be 8.3-truncated; the mounted
+        // view (e.g. with Rock Ridge) is authoritative then.
+        return joliet ? FileNotFound : Unsupported;
+    }
+
+    if (MAX_FILE_SIZE < fileLength)
+    {
+        SCX_LOGERROR(m_logHandle, fileName + " is too large on " + m_device);
+        return Unsupported;
+    }
+
+    data.resize(fileLength);
+    if (0 != fileLength &&
+        !ReadAt(static_cast<unsigned long long>(fileLocation) * blockSize,
+                fileLength, &data[0]))
+    {
+        data.clear();
+        return ReadError;
+    }
+
+    return FileFound;
+}
+
+bool ISO9660Reader::ReadAt(
+    unsigned long long offset,
+    size_t count,
+    unsigned char* buffer)
+{
+    size_t done = 0;
+    while (done < count)
+    {
+        ssize_t got = pread(m_fd, buffer + done, count - done,
+                            static_cast<off_t>(offset + done));
+        if (got < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            SCX_LOGERROR(m_logHandle, "Read from " + m_device + " failed. errno: " +
+                         SCXCoreLib::StrToUTF8(SCXCoreLib::StrFrom(errno)));
+            return false;
+        }
+        done += static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool ISO9660Reader::FindEntry(
+    const std::vector<unsigned char>& extent,
+    unsigned int blockSize,
+    bool joliet,
+    const std::string& fileName,
+    unsigned int& location,
+    unsigned int& length)
+{
+    std::string wanted = NormalizeName(fileName);
+    size_t pos = 0;
+
+    while (pos + DR_IDENTIFIER <= extent.size())
+    {
+        size_t recordLength = extent[pos + DR_LENGTH];
+        if (0 == recordLength)
+        {
+            // Records never span logical blocks; the rest of this one is padding.
+            pos = (pos / blockSize + 1) * blockSize;
+            continue;
+        }
+
+        size_t idLength = extent[pos + DR_IDENTIFIER_LENGTH];
+        if (pos + recordLength > extent.size() ||
+            DR_IDENTIFIER + idLength > recordLength)
+        {
+            SCX_LOGERROR(m_logHandle, "Malformed directory record on " + m_device);
+            return false;
+        }
+
+        const unsigned char* id = &extent[pos + DR_IDENTIFIER];
+        bool isDirectory = 0 != (extent[pos + DR_FLAGS] & DR_FLAG_DIRECTORY);
+
+        // Identifiers 0x00 and 0x01 are "." and ".."
+        if (!isDirectory && !(1 == idLength && id[0] <= 1))
+        {
+            std::string name;
+            if (joliet)
+            {
+                // UCS-2 big endian; anything outside ASCII cannot match
+                for (size_t i = 0; i + 1 < idLength; i += 2)
+                {
+                    unsigned int ch = (static_cast<unsigned int>(id[i]) << 8) | id[i + 1];
+                    name.push_back(ch < 0x80 ? static_cast<char>(ch) : '?');
+                }
+            }
+            else
+            {
+                name.assign(reinterpret_cast<const char*>(id), idLength);
+            }
+
+            if (NormalizeName(name) == wanted)
+            {
+                location = ReadLE32(&extent[pos + DR_EXTENT_LOCATION]);
+                length = ReadLE32(&extent[pos + DR_DATA_LENGTH]);
+                return true;
+            }
+        }
+
+        pos += recordLength;
+    }
+
+    return false;
+}
@@ -28,31 +28,52 @@
    
 */
 /*----------------------------------------------------------------------------*/
+#include <agentversion.h>
+#include <argumentmanager.h>
+#include <checkpoint.h>
 #include <commandexecutor.h>
+#include <deviceprober.h>
+#include <devicewatcher.h>
+#include <grubenv.h>
 #include <isofetcher.h>
 #include <isofetcherexception.h>
+#include <iso9660reader.h>
+#include <moduleloader.h>
 #include <osspecializationreader.h>
 #include <statusmessage.h>
 #include <statusmessagestrings.h>
+#include <terminatesetupexception.h>
+
+#include <util/SpanTracer.h>
 
 #include <unistd.h>
 #include <sys/mount.h>
-#include <sys/utsname.h>
 #include <sys/stat.h>
 
 #include <iostream>
 #include <string>
+#include <sstream>
 #include <fstream>
 #include <vector>
 #include <cerrno>
 
 #include <scxcorelib/scxdirectoryinfo.h>
 
+using VMM::GuestAgent::Fetcher::DeviceProber;
+using VMM::GuestAgent::Fetcher::AgentVersion;
+using VMM::GuestAgent::Fetcher::DeviceWatcher;
+using VMM::GuestAgent::Fetcher::GrubEnv;
 using VMM::GuestAgent::Fetcher::ISOFetcher;
 using VMM::GuestAgent::Fetcher::ISOFetcherException;
+using VMM::GuestAgent::Fetcher::ISO9660Reader;
+using VMM::GuestAgent::Fetcher::ModuleLoader;
+using VMM::GuestAgent::Fetcher::TerminateSetupException;
 using VMM::GuestAgent::SpecializationReader::OSSpecializationReader;
+using VMM::GuestAgent::StatusManager::Checkpoint;
 using VMM::GuestAgent::StatusManager::StatusMessage;
+using VMM::GuestAgent::Utilities::ArgumentManager;
 using VMM::GuestAgent::Utilities::CommandExecutor;
+using VMM::GuestAgent::Utilities::readConfig;
 
 using SCX::Util::Xml::XElement;
 using SCX::Util::Xml::XElementPtr;
@@ -64,9 +85,32 @@ using namespace VMM::GuestAgent::StatusManager;
 std::string const MOUNT_POINT = "/mnt/vmmcdrom/";
 std::string const LINUX_OS_CONFIG_FILE = "linuxosconfiguration.xml";
 std::string const INSTALL_UPGRADE = "setsid /mnt/vmmcdrom/install -u -v ";
-std::string const GRUB_COMMAND = "grub-editenv - set recordfail=0";
-std::string const GRUB_FILE = "/usr/bin/grub-editenv";
+// Version manifest of the installed agent, relative to the agent home
+std::string const INSTALLED_VERSION_FILE = "/etc/version";
+// Driver loaded when no storage controller without a driver is found
+std::string const DEFAULT_CONTROLLER_MODULE = "ata_piix";
+std::string const DEVICE_TIMEOUT_FILE = "/opt/microsoft/scvmmguestagent/etc/devicetimeout";
+
+// Overall time to wait for a device carrying the specialization file. These
+// match the fixed sleeps they replace: one 30 second pass when a device was
+// present, three when a driver had to be injected first.
+unsigned int const DEFAULT_DEVICE_TIMEOUT = 30;
+unsigned int const DRIVER_DEVICE_TIMEOUT = 90;
+
+
+ISOFetcher::ISOFetcher()
+    : m_logHandle(
+          SCX::Util::LogHandleCache::Instance().GetLogHandle(
+          "scx.vmmguestagent.src.fetcher.isofetcher"))
+    , m_targetMounted(false)
+    , m_foundOSSpecializationFile(false)
+    , m_deferTermination(false)
+{
+}
 
+ISOFetcher::~ISOFetcher()
+{
+}
 
 void ISOFetcher::ObtainMountPoint()
 {
@@ -89,88 +133,59 @@ void ISOFetcher::ObtainMountPoint()
         "/dev/hdc"
     };
 
-    // check for the existence of any cdrom device.  If none are found,
-    // load the driver.
     int size = sizeof(possibleDevices)/sizeof(char*);
-    bool deviceFound = false;
-    for (int i=0; i<size; i++)
+    std::vector<std::string> candidates(possibleDevices, possibleDevices + size);
+
+    // 0 when the file is missing or invalid, as readConfig never returns 0 for a value
+    unsigned int configuredTimeout = readConfig(DEVICE_TIMEOUT_FILE.c_str(), 0);
+    unsigned int timeout = DEFAULT_DEVICE_TIMEOUT;
+    if (0 != configuredTimeout)
     {
-        struct stat statbuf;
+        timeout = configuredTimeout;
+        std::ostringstream strm;
+        strm << "Device discovery timeout overridden to " << timeout << " seconds";
+        SCX_LOGINFO(m_logHandle, strm.str());
+    }
 
-        int status = stat(possibleDevices[i], &statbuf);
+    // Start watching before the first scan so that a device showing up in
+    // between is not missed.
+    DeviceWatcher watcher(candidates, timeout);
 
-        if (status != 0)
-        {
-            continue;
-        }
-        else
-        {
-            deviceFound = true;
-        }
+    // The prober outlives this call so that a device stuck in a read does not
+    // hold up the specialization once another device has won.
+    if (0 == m_prober.GetData())
+    {
+        m_prober = SCXCoreLib::SCXHandle<DeviceProber>(
+            new DeviceProber(LINUX_OS_CONFIG_FILE, static_cast<long>(candidates.size())));
     }
 
-    int numRetries = 1;
+    // check for the existence of any cdrom device.  If none are found,
+    // load the driver.
+    std::vector<std::string> devices;
+    watcher.GetPresentDevices(devices);
 
-    if (deviceFound == false)
+    if (devices.empty())
     {
         SCX_LOGINFO(m_logHandle, "CD ROM device not found, injecting driver");
 
-        if (!InvokeInsmod())
+        if (!LoadControllerDrivers())
         {
             SCX_LOGERROR(m_logHandle, "Could not inject driver");
             return;
         }
 
-        numRetries = 3;
-    }
-
-    int retryCount = 0;
-    bool foundSpecialization = false;
-    while (retryCount < numRetries && (!foundSpecialization))
-    {
-        for (int i=0; i<size; i++)
+        if (0 == configuredTimeout)
         {
-            struct stat statbuf;
-
-            int status = stat(possibleDevices[i], &statbuf);
-
-            if (status != 0)
-            {
-                SCX_LOGERROR(
-                    m_logHandle, SCXCoreLib::StrFromMultibyte(
-                    std::string("Unable to stat ") +
-                    std::string(possibleDevices[i]) + 
-                    std::string(" errno: ") + 
-                    SCXCoreLib::StrToUTF8(SCXCoreLib::StrFrom(errno))));
-                continue;
-            }
-            else
-            {
-                SCX_LOGINFO(m_logHandle, SCXCoreLib::StrFromMultibyte(
-                            "CD ROM device already present:" + 
-                            std::string(possibleDevices[i]) +
-                            ", checking for OSSpecialization file"));
-                m_mountSource = possibleDevices[i];
-                if (MountISO() && ReadDataFromMountPoint())
-                {
-                    foundSpecialization = true;
-                    break;
-                }
-                else
-                {
-                    if (m_targetMounted)
-                    {
-                        UnmountISO();
-                    }
-                    continue;
-                }
-            }
-            
+            watcher.SetTimeout(DRIVER_DEVICE_TIMEOUT);
         }
+    }
 
-        // Sleep and retry - insmod sometimes takes time and does not make the device available immediately.
-        sleep (30);
-        retryCount++;
+    // Probe the devices as soon as they show up - a loaded driver sometimes takes time and
+    // does not make the device available immediately.
+    bool foundSpecialization = ProbeDevices(devices, watcher);
+    while (!foundSpecialization && watcher.WaitForDevices(devices))
+    {
+        foundSpecialization = ProbeDevices(devices, watcher);
     }
 
     if (!foundSpecialization)
@@ -186,6 +201,79 @@ void ISOFetcher::ObtainMountPoint()
     }
 }
 
+bool ISOFetcher::ProbeDevices(const std::vector<std::string>& devices,
+                              DeviceWatcher& watcher)
+{
+    if (devices.empty())
+    {
+        return false;
+    }
+
+    // Read the file straight off every device at once; only images the
+    // reader cannot handle fall through to mounting. A device that hangs
+    // in a read is given up on at the overall device deadline.
+    std::string device;
+    std::vector<unsigned char> data;
+    std::vector<DeviceProber::Outcome> outcomes;
+    if (m_prober->Probe(devices, watcher.GetRemainingMilliseconds(),
+                         device, data, outcomes))
+    {
+        m_mountSource = device;
+        SetSpecializationData(data);
+        return true;
+    }
+
+    // There is a single mount point, so the fallback stays sequential.
+    for (std::vector<DeviceProber::Outcome>::const_iterator iter = outcomes.begin();
+         iter != outcomes.end(); ++iter)
+    {
+        if (ISO9660Reader::FileNotFound == iter->result)
+        {
+            continue;
+        }
+        else if (ISO9660Reader::ReadError == iter->result)
+        {
+            // The node exists but the media may not be ready yet; let the
+            // watcher hand it out again on its next rescan.
+            watcher.Rearm(iter->device);
+            continue;
+        }
+
+        SCX_LOGINFO(m_logHandle, SCXCoreLib::StrFromMultibyte(
+                    "CD ROM device present:" + iter->device +
+                    ", checking for OSSpecialization file"));
+        m_mountSource = iter->device;
+
+        if (!MountISO())
+        {
+            watcher.Rearm(iter->device);
+            continue;
+        }
+
+        if (ReadDataFromMountPoint())
+        {
+            return true;
+        }
+
+        if (m_targetMounted)
+        {
+            UnmountISO();
+        }
+    }
+
+    return false;
+}
+
+bool ISOFetcher::EnsureMounted()
+{
+    if (m_targetMounted)
+    {
+        return true;
+    }
+
+    return MountISO();
+}
+
 bool ISOFetcher::MountISO()
 {
     SCX_LOGINFO(m_logHandle, "Mounting CD ROM");
@@ -233,75 +321,97 @@ void ISOFetcher::UnmountISO()
     std::string tagValue;
     bool insModPerformed = StatusMessage::Instance().ReadChildOfRoot(StatusMessageStrings::InsmodStatus, tagValue);
 
-    SCX_LOGINFO(m_logHandle, "Unmounting CD ROM");
-
-    if (umount(MOUNT_POINT.c_str()) != 0)
+    if (m_targetMounted)
     {
-        SCX_LOGERROR(m_logHandle, "umount /mnt/vmmcdrom failed");
-        return;
-    }
+        SCX_LOGINFO(m_logHandle, "Unmounting CD ROM");
 
-    if (rmdir(MOUNT_POINT.c_str()) != 0)
-    {
-        SCX_LOGERROR(m_logHandle, "rmdir /mnt/vmmcdrom failed");
+        if (umount(MOUNT_POINT.c_str()) != 0)
+        {
+            SCX_LOGERROR(m_logHandle, "umount /mnt/vmmcdrom failed");
+            return;
+        }
+        m_targetMounted = false;
+
+        if (rmdir(MOUNT_POINT.c_str()) != 0)
+        {
+            SCX_LOGERROR(m_logHandle, "rmdir /mnt/vmmcdrom failed");
+        }
     }
 
     if (insModPerformed)
     {
-        InvokeRmmod();
+        UnloadControllerDrivers(tagValue);
     }
 
 }
 
-bool ISOFetcher::InvokeInsmod()
+bool ISOFetcher::LoadControllerDrivers()
 {
-    SCX_LOGINFO(m_logHandle, "Invoking insmod");
-
-    struct utsname un;
+    SCX_LOGINFO(m_logHandle, "Loading storage controller drivers");
 
-    if (uname(&un) == -1)
+    ModuleLoader loader;
+    std::vector<std::string> modules;
+    loader.FindControllerModules(modules);
+    if (modules.empty())
     {
-        SCX_LOGERROR(m_logHandle, "uname failed");
-        return false;
+        modules.push_back(DEFAULT_CONTROLLER_MODULE);
     }
 
-    std::string insModCommand = "insmod /lib/modules/" + std::string(un.release) + "/kernel/drivers/ata/ata_piix.ko";
-    CommandExecutor ce;
+    std::vector<std::string> loaded;
+    bool anyLoaded = false;
+    for (std::vector<std::string>::const_iterator module = modules.begin();
+         module != modules.end(); ++module)
+    {
+        if (loader.Load(*module, loaded))
+        {
+            anyLoaded = true;
+        }
+    }
 
-    if (ce.Execute(SCXCoreLib::StrFromMultibyte(insModCommand), "insmod") != 0)
+    if (!anyLoaded)
     {
-        SCX_LOGERROR(m_logHandle, "insmod failed");
+        SCX_LOGERROR(m_logHandle, "Loading the storage controller drivers failed");
         return false;
     }
 
-    StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement(StatusMessageStrings::InsmodStatus, 
-        StatusMessageStrings::InsmodCommandComplete)));
+    // Remember what to unload, also across a restart of the agent
+    if (!loaded.empty())
+    {
+        std::string names;
+        for (std::vector<std::string>::const_iterator module = loaded.begin();
+             module != loaded.end(); ++module)
+        {
+            names += (names.empty() ? "" : " ") + *module;
+        }
+        StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement(StatusMessageStrings::InsmodStatus,
+            names)));
+    }
 
     return true;
 }
 
-bool ISOFetcher::InvokeRmmod()
+bool ISOFetcher::UnloadControllerDrivers(const std::string& loaded)
 {
-    SCX_LOGINFO(m_logHandle, "Invoking rmmod");
-
-    struct utsname un;
+    SCX_LOGINFO(m_logHandle, "Unloading storage controller drivers");
 
-    if (uname(&un) == -1)
+    std::vector<std::string> modules;
+    if (StatusMessageStrings::InsmodCommandComplete == loaded)
     {
-        SCX_LOGERROR(m_logHandle, "uname failed");
-        return false;
+        // Recorded by agents that always injected ata_piix with insmod
+        modules.push_back(DEFAULT_CONTROLLER_MODULE);
     }
-
-    std::string rmModCommand = "rmmod /lib/modules/" + std::string(un.release) + "/kernel/drivers/ata/ata_piix.ko";
-    CommandExecutor ce;
-
-    if (ce.Execute(SCXCoreLib::StrFromMultibyte(rmModCommand), "rmmod") != 0)
+    else
     {
-        SCX_LOGERROR(m_logHandle, "rmmod failed");
-        return false;
+        std::istringstream names(loaded);
+        std::string module;
+        while (names >> module)
+        {
+            modules.push_back(module);
+        }
     }
 
-    return true;
+    ModuleLoader loader;
+    return loader.Unload(modules);
 }
 
 bool isConfigFile(SCXCoreLib::SCXFilePath const& filepath)
@@ -363,6 +473,20 @@ ISOFetcher::ReadDataFromMountPoint()
     return m_foundOSSpecializationFile;
 }
 
+void
+ISOFetcher::SetSpecializationData(const std::vector<unsigned char>& data)
+{
+    // The install script and the rest of the tree are reached through the
+    // mount point once the CD is mounted on demand.
+    m_osConfigurationXMLPath = SCXCoreLib::StrFromMultibyte(MOUNT_POINT);
+    m_osConfigurationXMLString = SCX::Util::Utf8String(data);
+    SCX_LOGINFO(
+        m_logHandle,
+        "Specialization file read from " + m_mountSource + ", len:" +
+        SCXCoreLib::StrToMultibyte(SCXCoreLib::StrFrom(m_osConfigurationXMLString.Size())));
+    m_foundOSSpecializationFile = true;
+}
+
 int
 ISOFetcher::ReadConfigFile(
     std::wstring const& path)
@@ -432,11 +556,34 @@ void ISOFetcher::InstallOrUpgradeAgent()
         std::string installUpgradeCommand = INSTALL_UPGRADE + newAgentVersion;
 
 
-        if (newAgentVersion != "")
+        Checkpoint checkpoint("InstallOrUpgradeAgent", newAgentVersion);
+
+        if (newAgentVersion != "" && !checkpoint.IsCompleted())
         {
+            // The common case: neither the cd nor the script is needed
+            if (!IsUpgradeRequired(newAgentVersion))
+            {
+                SCX_LOGINFO(m_logHandle, ("No upgrade was required - its the same version"));
+                checkpoint.MarkCompleted();
+                return;
+            }
+
+            if (!EnsureMounted())
+            {
+                SCX_LOGERROR(m_logHandle, ("Unable to mount CD ROM for Install/Upgrade"));
+                return;
+            }
 
             CommandExecutor ce;
             int ret = ce.Execute(SCXCoreLib::StrFromMultibyte(installUpgradeCommand), "Install/Upgrade");
+
+            // Only the script's own success codes complete the step; anything
+            // else, e.g. a shell that failed to run it, is retried
+            if (0 == ret || 1 == ret)
+            {
+                checkpoint.MarkCompleted();
+            }
+
             if (ret == 0)
             {
                 SCX_LOGINFO(m_logHandle, ("No upgrade was required - its the same version"));
@@ -458,6 +605,27 @@ void ISOFetcher::InstallOrUpgradeAgent()
     }
 }
 
+bool ISOFetcher::IsUpgradeRequired(const std::string& newAgentVersion)
+{
+    std::string manifest = ArgumentManager::Instance().GetVMMHome() + INSTALLED_VERSION_FILE;
+
+    AgentVersion installed;
+    if (!installed.Read(manifest))
+    {
+        SCX_LOGINFO(m_logHandle, "Unable to read the installed agent version from " + manifest);
+        return true;
+    }
+
+    AgentVersion available;
+    if (!available.Parse(newAgentVersion))
+    {
+        SCX_LOGWARNING(m_logHandle, "Unable to parse agent version " + newAgentVersion);
+        return true;
+    }
+
+    return available.Compare(installed) > 0;
+}
+
 
 std::string ISOFetcher::GetNewAgentVersion()
 {
@@ -486,6 +654,12 @@ std::string ISOFetcher::GetNewAgentVersion()
 
 void ISOFetcher::TerminateSetup()
 {
+    if (m_deferTermination)
+    {
+        SCX_LOGINFO(m_logHandle, ("TerminateSetup deferred"));
+        throw TerminateSetupException();
+    }
+
     SCX_LOGINFO(m_logHandle, ("Entering TerminateSetup"));
 
     std::string tagValue;
@@ -493,8 +667,19 @@ void ISOFetcher::TerminateSetup()
     bool specializationComplete = StatusMessage::Instance().ReadChildOfRoot(
         StatusMessageStrings::SpecializationComplete, tagValue);
 
+    // The process does not return from here; write the status file now
+    StatusMessage::Instance().Flush();
+
+    std::wstring path = SCXCoreLib::StrFromMultibyte(MOUNT_POINT);
+    bool onCDROM = 0 == m_osConfigurationXMLPath.compare(0, path.length(), path);
+
     if (specializationComplete)
     {
+        if (onCDROM && !EnsureMounted())
+        {
+            SCX_LOGERROR(m_logHandle, ("Unable to mount CD ROM for daemon removal"));
+        }
+
         CommandExecutor ce;
         
         if (0 != ce.Execute(m_osConfigurationXMLPath +
@@ -509,9 +694,7 @@ void ISOFetcher::TerminateSetup()
         }
     }
 
-    // working here
-    std::wstring path = SCXCoreLib::StrFromMultibyte(MOUNT_POINT);
-    if (0 == m_osConfigurationXMLPath.compare(0, path.length(), path))
+    if (onCDROM)
     {
         UnmountISO();
     }
@@ -522,6 +705,8 @@ void ISOFetcher::TerminateSetup()
         // bug workaround for ubuntu
         ModifyGrub();
 
+        SCX::Util::SpanTracer::Instance().Flush();
+
         char const* args[] = { "shutdown", "-h", "now", 0 };
 
         execv ("/sbin/shutdown", const_cast<char* const*>(args));
@@ -533,6 +718,7 @@ void ISOFetcher::TerminateSetup()
     else
     {
         SCX_LOGERROR(m_logHandle, ("Terminating abnormally due to a failed specialization step."));
+        SCX::Util::SpanTracer::Instance().Flush();
         exit(-1);
     }
 }
@@ -541,29 +727,33 @@ void ISOFetcher::ModifyGrub()
 {
     // On some of the distros, mainly Ubuntu, grub menu shows up after reboot. So, forcing
     // record fail to 0 will fix this issue. This is a documented bug.
-    struct stat statbuf;
+    std::string grubEnvFile = GrubEnv::Find();
+    if (grubEnvFile.empty())
+    {
+        SCX_LOGTRACE(m_logHandle, L"grubenv not found on this system");
+        return;
+    }
 
-    int status = stat(GRUB_FILE.c_str(), &statbuf);
-    if (status == 0)
+    GrubEnv grubEnv;
+    if (!grubEnv.Load(grubEnvFile))
     {
-        CommandExecutor ce;
-        int ret = ce.Execute(SCXCoreLib::StrFromMultibyte(GRUB_COMMAND), "grub-editenv");
-        if (ret != 0)
-        {
-            SCX_LOGERROR(
-                m_logHandle,
-                "failed to set recordfail=0 in /boot/grub/grubenv errno=" +
-                SCXCoreLib::StrToMultibyte(SCXCoreLib::StrFrom(ret)));
-        }
-        else
-        {
-            SCX_LOGINFO(m_logHandle, ("set recordfail=0 in /boot/grub/grubenv"));
-        }
+        SCX_LOGERROR(m_logHandle, "failed to read the grub environment block " + grubEnvFile);
+        return;
+    }
+
+    if (!grubEnv.Set("recordfail", "0"))
+    {
+        SCX_LOGTRACE(m_logHandle, "recordfail is 0 already in " + grubEnvFile);
+    }
+    else if (!grubEnv.Save(grubEnvFile))
+    {
+        SCX_LOGERROR(
+            m_logHandle,
+            "failed to set recordfail=0 in " + grubEnvFile + " errno=" +
+            SCXCoreLib::StrToMultibyte(SCXCoreLib::StrFrom(errno)));
     }
     else
     {
-        //TODO: this meant to assist with internal debugging, may want to remove prior to field release
-        SCX_LOGTRACE(m_logHandle, SCXCoreLib::StrFromMultibyte(GRUB_FILE) +
-                     L" not found on this system");
+        SCX_LOGINFO(m_logHandle, "set recordfail=0 in " + grubEnvFile);
     }
 }
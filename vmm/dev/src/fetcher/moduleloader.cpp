@@ -0,0 +1,420 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        moduleloader.cpp
+
+   \brief       Loads and unloads kernel modules in-process, resolving them
+                through modules.alias and modules.dep like modprobe does
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <moduleloader.h>
+#include <commandexecutor.h>
+
+#include <util/LogHandleCache.h>
+#include <scxcorelib/stringaid.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+
+using VMM::GuestAgent::Fetcher::ModuleLoader;
+using VMM::GuestAgent::Utilities::CommandExecutor;
+
+namespace
+{
+
+// finit_module flag for modules compressed with xz, gzip or zstd (Linux 5.17)
+unsigned int const MODULE_INIT_COMPRESSED_FILE = 4;
+
+// PCI base class of mass storage controllers, as in the sysfs class file
+std::string const STORAGE_CLASS_PREFIX = "0x01";
+
+std::string
+ReadLine(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// Module name as the kernel knows it: the file name without the .ko suffix
+// (and any compression suffix), dashes turned into underscores
+std::string
+ModuleName(const std::string& path)
+{
+    std::string::size_type slash = path.rfind('/');
+    std::string name = path.substr(std::string::npos == slash ? 0 : slash + 1);
+    std::string::size_type suffix = name.find(".ko");
+    if (std::string::npos != suffix)
+    {
+        name.erase(suffix);
+    }
+    std::replace(name.begin(), name.end(), '-', '_');
+    return name;
+}
+
+bool
+IsCompressed(const std::string& path)
+{
+    std::string::size_type suffix = path.rfind(".ko");
+    return std::string::npos != suffix && suffix + 3 != path.size();
+}
+
+std::string
+ErrnoText(int err)
+{
+    std::ostringstream strm;
+    strm << " errno: " << err;
+    return strm.str();
+}
+
+}
+
+ModuleLoader::ModuleLoader()
+  : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
+                    "scx.vmmguestagent.src.fetcher.moduleloader"))
+  , m_sysDir("/sys")
+  , m_builtinRead(false)
+{
+    struct utsname un;
+    if (uname(&un) == -1)
+    {
+        SCX_LOGERROR(m_logHandle, "uname failed" + ErrnoText(errno));
+        return;
+    }
+    m_moduleDir = "/lib/modules/" + std::string(un.release);
+}
+
+ModuleLoader::ModuleLoader(const std::string& moduleDir, const std::string& sysDir)
+  : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
+                    "scx.vmmguestagent.src.fetcher.moduleloader"))
+  , m_moduleDir(moduleDir)
+  , m_sysDir(sysDir)
+  , m_builtinRead(false)
+{
+}
+
+void ModuleLoader::FindControllerModules(std::vector<std::string>& modules)
+{
+    modules.clear();
+
+    std::string devicesDir = m_sysDir + "/bus/pci/devices";
+    DIR* dir = opendir(devicesDir.c_str());
+    if (NULL == dir)
+    {
+        SCX_LOGWARNING(m_logHandle, "Unable to list " + devicesDir + ErrnoText(errno));
+        return;
+    }
+
+    std::vector<std::string> modaliases;
+    struct dirent* entry;
+    while (NULL != (entry = readdir(dir)))
+    {
+        if ('.' == entry->d_name[0])
+        {
+            continue;
+        }
+
+        std::string device = devicesDir + "/" + entry->d_name;
+        if (0 != ReadLine(device + "/class").compare(0, STORAGE_CLASS_PREFIX.size(), STORAGE_CLASS_PREFIX) ||
+            0 == access((device + "/driver").c_str(), F_OK))
+        {
+            continue;
+        }
+
+        std::string modalias = ReadLine(device + "/modalias");
+        if (!modalias.empty())
+        {
+            SCX_LOGINFO(m_logHandle, "Storage controller without driver: " + modalias);
+            modaliases.push_back(modalias);
+        }
+    }
+    closedir(dir);
+
+    if (modaliases.empty() || !ReadAliases())
+    {
+        return;
+    }
+
+    for (std::vector<std::pair<std::string, std::string> >::const_iterator alias = m_aliases.begin();
+         alias != m_aliases.end(); ++alias)
+    {
+        for (std::vector<std::string>::const_iterator modalias = modaliases.begin();
+             modalias != modaliases.end(); ++modalias)
+        {
+            if (0 == fnmatch(alias->first.c_str(), modalias->c_str(), 0) &&
+                modules.end() == std::find(modules.begin(), modules.end(), alias->second))
+            {
+                modules.push_back(alias->second);
+            }
+        }
+    }
+}
+
+bool ModuleLoader::Load(const std::string& module, std::vector<std::string>& loaded)
+{
+    if (IsLoaded(module))
+    {
+        SCX_LOGINFO(m_logHandle, "Module already loaded: " + module);
+        return true;
+    }
+
+    // Built-in drivers have no file in modules.dep and need no loading
+    if (IsBuiltin(module))
+    {
+        SCX_LOGINFO(m_logHandle, "Module built into the kernel: " + module);
+        return true;
+    }
+
+    if (!ReadDependencies())
+    {
+        return false;
+    }
+
+    std::map<std::string, Dependency>::const_iterator dependency = m_dependencies.find(module);
+    if (m_dependencies.end() == dependency)
+    {
+        SCX_LOGERROR(m_logHandle, "Module not found in modules.dep: " + module);
+        return false;
+    }
+
+    // modules.dep lists the dependencies of dependencies last, so load from the back
+    std::vector<std::string> files(dependency->second.dependencies.rbegin(),
+                                   dependency->second.dependencies.rend());
+    files.push_back(dependency->second.path);
+
+    for (std::vector<std::string>::const_iterator file = files.begin(); file != files.end(); ++file)
+    {
+        std::string name = ModuleName(*file);
+        if (IsLoaded(name))
+        {
+            continue;
+        }
+        if (!LoadFile(ModulePath(*file)))
+        {
+            return false;
+        }
+        SCX_LOGINFO(m_logHandle, "Loaded module " + name);
+        loaded.push_back(name);
+    }
+
+    return true;
+}
+
+bool ModuleLoader::Unload(const std::vector<std::string>& loaded)
+{
+    bool result = true;
+    for (std::vector<std::string>::const_reverse_iterator module = loaded.rbegin();
+         module != loaded.rend(); ++module)
+    {
+        if (!IsLoaded(*module))
+        {
+            continue;
+        }
+#if defined(__NR_delete_module)
+        if (0 != syscall(__NR_delete_module, module->c_str(), O_NONBLOCK))
+        {
+            SCX_LOGWARNING(m_logHandle, "Unable to unload module " + *module + ErrnoText(errno));
+            result = false;
+            continue;
+        }
+#endif
+        SCX_LOGINFO(m_logHandle, "Unloaded module " + *module);
+    }
+    return result;
+}
+
+bool ModuleLoader::ReadDependencies()
+{
+    if (!m_dependencies.empty())
+    {
+        return true;
+    }
+
+    std::string path = m_moduleDir + "/modules.dep";
+    std::ifstream file(path.c_str());
+    if (!file.good())
+    {
+        SCX_LOGERROR(m_logHandle, "Unable to read " + path);
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::string::size_type colon = line.find(':');
+        if (std::string::npos == colon)
+        {
+            continue;
+        }
+
+        Dependency& dependency = m_dependencies[ModuleName(line.substr(0, colon))];
+        dependency.path = line.substr(0, colon);
+
+        std::istringstream dependencies(line.substr(colon + 1));
+        std::string dependencyPath;
+        while (dependencies >> dependencyPath)
+        {
+            dependency.dependencies.push_back(dependencyPath);
+        }
+    }
+    return true;
+}
+
+bool ModuleLoader::ReadAliases()
+{
+    if (!m_aliases.empty())
+    {
+        return true;
+    }
+
+    std::string path = m_moduleDir + "/modules.alias";
+    std::ifstream file(path.c_str());
+    if (!file.good())
+    {
+        SCX_LOGERROR(m_logHandle, "Unable to read " + path);
+        return false;
+    }
+
+    // Only PCI aliases can match a controller; the rest would just take memory
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string keyword, pattern, module;
+        if (fields >> keyword >> pattern >> module &&
+            "alias" == keyword && 0 == pattern.compare(0, 4, "pci:"))
+        {
+            std::replace(module.begin(), module.end(), '-', '_');
+            m_aliases.push_back(std::make_pair(pattern, module));
+        }
+    }
+    return true;
+}
+
+bool ModuleLoader::IsBuiltin(const std::string& module)
+{
+    if (!m_builtinRead)
+    {
+        m_builtinRead = true;
+
+        // Kernels before 3.4 do not install the file; then nothing is built in
+        // as far as the loader can tell
+        std::ifstream file((m_moduleDir + "/modules.builtin").c_str());
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (!line.empty())
+            {
+                m_builtin.insert(ModuleName(line));
+            }
+        }
+    }
+    return m_builtin.end() != m_builtin.find(module);
+}
+
+bool ModuleLoader::IsLoaded(const std::string& module) const
+{
+    return 0 == access((m_sysDir + "/module/" + module).c_str(), F_OK);
+}
+
+bool ModuleLoader::LoadFile(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        SCX_LOGERROR(m_logHandle, "Unable to open module " + path + ErrnoText(errno));
+        return false;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    bool compressed = IsCompressed(path);
+    long ret = -1;
+    errno = ENOSYS;
+#if defined(__NR_finit_module)
+    ret = syscall(__NR_finit_module, fd, "", compressed ? MODULE_INIT_COMPRESSED_FILE : 0);
+#endif
+#if defined(__NR_init_module)
+    // Kernels before 3.8 only take the module image from memory
+    if (0 != ret && ENOSYS == errno && !compressed)
+    {
+        struct stat st;
+        if (0 == fstat(fd, &st) && st.st_size > 0)
+        {
+            std::vector<char> image(static_cast<size_t>(st.st_size));
+            if (static_cast<ssize_t>(image.size()) == pread(fd, &image[0], image.size(), 0))
+            {
+                ret = syscall(__NR_init_module, &image[0], image.size(), "");
+            }
+        }
+    }
+#endif
+    int err = errno;
+    close(fd);
+
+    // Kernels before 5.17 reject the flag, and kernels built without module
+    // decompression reject the file; insmod decompresses it in userspace
+    if (0 != ret && compressed && (EINVAL == err || ENOSYS == err || EOPNOTSUPP == err))
+    {
+        SCX_LOGINFO(m_logHandle, "Kernel cannot load compressed module " + path + ErrnoText(err) +
+                    ", falling back to insmod");
+        return InsmodFile(path);
+    }
+
+    if (0 != ret && EEXIST != err)
+    {
+        SCX_LOGERROR(m_logHandle, "Unable to load module " + path + ErrnoText(err));
+        return false;
+    }
+    return true;
+}
+
+bool ModuleLoader::InsmodFile(const std::string& path)
+{
+    CommandExecutor ce;
+    if (0 != ce.Execute(SCXCoreLib::StrFromMultibyte("insmod '" + path + "'"), "insmod") &&
+        !IsLoaded(ModuleName(path)))
+    {
+        SCX_LOGERROR(m_logHandle, "insmod failed for module " + path);
+        return false;
+    }
+    return true;
+}
+
+std::string ModuleLoader::ModulePath(const std::string& path) const
+{
+    // Older depmod versions write absolute paths
+    if (!path.empty() && '/' == path[0])
+    {
+        return path;
+    }
+    return m_moduleDir + "/" + path;
+}
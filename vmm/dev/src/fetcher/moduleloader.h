@@ -0,0 +1,196 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        moduleloader.h
+
+   \brief       Loads and unloads kernel modules in-process, resolving them
+                through modules.alias and modules.dep like modprobe does
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef MODULELOADER_H
+#define MODULELOADER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <scxcorelib/scxlog.h>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace Fetcher
+        {
+
+            class ModuleLoader
+            {
+
+            public:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Constructor for ModuleLoader, for the modules of the running kernel
+
+                */
+                ModuleLoader();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Constructor for ModuleLoader
+
+                   \param   moduleDir   Directory with modules.dep, modules.alias and
+                                        modules.builtin
+                   \param   sysDir      Mount point of sysfs
+
+                */
+                ModuleLoader(const std::string& moduleDir, const std::string& sysDir);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Find the modules that drive the PCI storage controllers which
+                   have no driver bound yet
+
+                   \param   modules    Receives the module names, without duplicates
+
+                */
+                void FindControllerModules(std::vector<std::string>& modules);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Load a module after the modules it depends on
+
+                   \param   module    Name of the module
+                   \param   loaded    Receives the modules this call loaded, in load
+                                      order; modules already in the kernel are left out
+
+                   \return  False if the module or one of its dependencies could
+                            not be loaded; true for modules built into the kernel
+
+                */
+                bool Load(const std::string& module, std::vector<std::string>& loaded);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Unload modules in the reverse of the order they were loaded
+
+                   \param   loaded    Modules as returned by Load
+
+                   \return  False if a module could not be unloaded
+
+                */
+                bool Unload(const std::vector<std::string>& loaded);
+
+            private:
+
+                /** A module file and the files it depends on, from modules.dep */
+                struct Dependency
+                {
+                    std::string                 path;
+                    std::vector<std::string>    dependencies;
+                };
+
+                /** Log Handle */
+                SCXCoreLib::SCXLogHandle    m_logHandle;
+
+                /** Directory with modules.dep, modules.alias and modules.builtin */
+                std::string                 m_moduleDir;
+
+                /** Mount point of sysfs */
+                std::string                 m_sysDir;
+
+                /** Module name to its file and dependencies; read on first use */
+                std::map<std::string, Dependency>   m_dependencies;
+
+                /** PCI modalias patterns and their module; read on first use */
+                std::vector<std::pair<std::string, std::string> >   m_aliases;
+
+                /** Modules built into the kernel, from modules.builtin */
+                std::set<std::string>       m_builtin;
+
+                /** Has modules.builtin been read? */
+                bool                        m_builtinRead;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Read modules.dep unless it has been read
+
+                */
+                bool ReadDependencies();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Read the PCI aliases of modules.alias unless they have been read
+
+                */
+                bool ReadAliases();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Is the module built into the kernel? Reads modules.builtin on first use
+
+                */
+                bool IsBuiltin(const std::string& module);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Is the module in the kernel already?
+
+                */
+                bool IsLoaded(const std::string& module) const;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Load one module file with finit_module, or init_module on kernels
+                   without it. Compressed files the kernel cannot take are passed
+                   to insmod.
+
+                */
+                bool LoadFile(const std::string& path);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Load one module file with insmod
+
+                */
+                bool InsmodFile(const std::string& path);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Absolute path of a module file listed in modules.dep
+
+                */
+                std::string ModulePath(const std::string& path) const;
+
+            }; // End of ModuleLoader class
+
+        } // End of Fetcher namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* MODULELOADER_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -74,9 +74,14 @@ public:
     std::string const& GetVMMHome() const;
     std::string const& GetConfigFilename() const;
 
+    /// @return false if completed steps of an interrupted specialization
+    ///         must be run again (noresume)
+    bool IsResumeEnabled() const;
+
 private:
     std::string m_vmmHome;
     std::string m_configFilename;
+    bool m_resume;
 };
 
 
@@ -92,6 +97,12 @@ ArgumentManager::GetConfigFilename() const
     return m_configFilename;
 }
 
+inline bool
+ArgumentManager::IsResumeEnabled() const
+{
+    return m_resume;
+}
+
 
 } // namespace Utilities
 } // namespace GuestAgent
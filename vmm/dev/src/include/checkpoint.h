@@ -0,0 +1,113 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        checkpoint.h
+
+   \brief       Records the completion of a specialization step in the status
+                document, so that a restarted agent can skip it
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+
+#include <scxcorelib/scxlog.h>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace StatusManager
+        {
+
+            class Checkpoint
+            {
+
+            public:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Constructor for Checkpoint
+
+                   \param   step     Name of the step, unique within the specialization
+                   \param   input    Everything the step reads from the specialization;
+                                     a completed step whose input changed runs again.
+                                     Its hash is kept in the status document, so it
+                                     must not contain secrets
+
+                */
+                Checkpoint(const std::string& step, const std::string& input);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Forget the completed steps if they completed for a different
+                   specialization, so that a re-specialization runs every step again.
+                   Called once before the first step.
+
+                   \param   input    Identifies the specialization. Its hash is kept in
+                                     the status document, so it must not contain secrets
+
+                */
+                static void BeginSpecialization(const std::string& input);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Has the step completed with the same input before? Always false
+                   when resuming is disabled on the command line.
+
+                   \return  bool    True if the step can be skipped
+
+                */
+                bool IsCompleted() const;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Record that the step completed
+
+                   \return  None
+
+                */
+                void MarkCompleted();
+
+            private:
+
+                /** Log Handle */
+                SCXCoreLib::SCXLogHandle    m_logHandle;
+
+                /** Status element recording the step */
+                std::string                 m_elementName;
+
+                /** Hash of the input of the step */
+                std::string                 m_inputHash;
+
+            }; // End of Checkpoint class
+
+        } // End of StatusManager namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* CHECKPOINT_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -36,6 +36,8 @@
 
 #include <util/LogHandleCache.h>
 
+#include <logoutputsink.h>
+
 #include <climits>
 
 
@@ -53,6 +55,13 @@ namespace VMM
             char const CONFIG_FILE_NAME[] =
                 "/opt/microsoft/scvmmguestagent/etc/commandtimeout";
 
+            /** KB of stdout and stderr kept of every command for the status report */
+            unsigned int const DEFAULT_OUTPUT_TAIL_KB = 4;
+            unsigned int const MINIMUM_OUTPUT_TAIL_KB = 0;
+            unsigned int const MAXIMUM_OUTPUT_TAIL_KB = 1024;
+            char const OUTPUT_TAIL_FILE_NAME[] =
+                "/opt/microsoft/scvmmguestagent/etc/commandoutputtail";
+
             /**
               \brief Attempts to open and read a timeout value from
                      CONFIG_FILE_NAME.  The value is also clamped between
@@ -65,6 +74,27 @@ namespace VMM
               */
             unsigned int readConfig ();
 
+            /**
+              \brief Same as readConfig () but reads the value from fileName
+                     and falls back to defaultTimeout.
+
+              \return The clamped value read from fileName, or defaultTimeout.
+              */
+            unsigned int readConfig (char const* fileName,
+                                     unsigned int const defaultTimeout);
+
+            /**
+              \brief Same as readConfig (fileName, defaultValue) but clamps the
+                     value to (minimum ... maximum), for settings that are not
+                     timeouts.
+
+              \return The clamped value read from fileName, or defaultValue.
+              */
+            unsigned int readConfig (char const* fileName,
+                                     unsigned int const defaultValue,
+                                     unsigned int const minimum,
+                                     unsigned int const maximum);
+
             class CommandExecutor 
             {
 
@@ -73,19 +103,57 @@ namespace VMM
                 /** Log Handle */
                 SCXCoreLib::SCXLogHandle m_logHandle;
 
+                /** Bytes of stdout and stderr kept by the sinks this executor creates */
+                size_t m_outputTailBytes;
+
             public:
 
                 /*----------------------------------------------------------------------------*/
                 /**
                    
-                   Constructor for Command executor
+                   Constructor for Command executor, reading the tail size from
+                   OUTPUT_TAIL_FILE_NAME
 
                 */
                 CommandExecutor()
                   : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
                                       "scx.vmmguestagent.osconfigurator.commandexecutor"))
+                  , m_outputTailBytes(ReadOutputTailBytes())
                 {}
 
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Constructor for Command executor, for callers running many
+                   commands that read the tail size once
+
+                   \param outputTailBytes Bytes of stdout and stderr the sinks keep,
+                                          as returned by ReadOutputTailBytes
+
+                */
+                explicit CommandExecutor(size_t outputTailBytes)
+                  : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
+                                      "scx.vmmguestagent.osconfigurator.commandexecutor"))
+                  , m_outputTailBytes(outputTailBytes)
+                {}
+
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Read the tail size from OUTPUT_TAIL_FILE_NAME, clamped to
+                   (MINIMUM_OUTPUT_TAIL_KB ... MAXIMUM_OUTPUT_TAIL_KB)
+
+                   \return Bytes of stdout and stderr kept of a command
+
+                */
+                static size_t ReadOutputTailBytes()
+                {
+                    return static_cast<size_t>(readConfig(OUTPUT_TAIL_FILE_NAME,
+                                                          DEFAULT_OUTPUT_TAIL_KB,
+                                                          MINIMUM_OUTPUT_TAIL_KB,
+                                                          MAXIMUM_OUTPUT_TAIL_KB)) * 1024;
+                }
+
                 /*----------------------------------------------------------------------------*/
                 /**
                    
@@ -109,6 +177,41 @@ namespace VMM
                             const std::string& component,
                             unsigned int const timeoutSecs = DEFAULT_TIMEOUT);
 
+                /**
+                  \brief Runs a script, streaming its output to sinks as it
+                         arrives instead of collecting it.
+
+                  \param command The script to run
+                  \param component Text identifier used in log output
+                  \param stdoutSink Receives stdout of the script
+                  \param stderrSink Receives stderr of the script
+                  \param timeoutSecs The time to wait for the script to
+                                     run in seconds
+
+                  \return int Return value of the command executed
+                  */
+                int Execute(const std::wstring& command,
+                            const std::string& component,
+                            LogOutputSink& stdoutSink,
+                            LogOutputSink& stderrSink,
+                            unsigned int const timeoutSecs = DEFAULT_TIMEOUT);
+
+                /**
+                  \brief Creates a sink that logs stdout of a script line by
+                         line at info level
+
+                  \param component Text identifier used in log output
+                  */
+                LogOutputSink CreateStdoutSink(const std::string& component) const;
+
+                /**
+                  \brief Creates a sink that logs stderr of a script line by
+                         line at warning level
+
+                  \param component Text identifier used in log output
+                  */
+                LogOutputSink CreateStderrSink(const std::string& component) const;
+
 
             }; // End of CommandExecutor class
 
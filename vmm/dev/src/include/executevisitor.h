@@ -145,6 +145,17 @@ namespace VMM
 
             }; // End of ExecuteVisitor base class
 
+            /*----------------------------------------------------------------------------*/
+            /**
+               Forget the steps completed for a different specialization. Called
+               before the first step, including the agent install or upgrade.
+
+               \param     xmlConfigurator    Configuration of the specialization
+
+            */
+            void BeginSpecialization(const VMM::GuestAgent::SpecializationReader::OSSpecializationReader::OSConfiguration&
+                                     xmlConfigurator);
+
             void CreateOSConfigurators(const VMM::GuestAgent::SpecializationReader::OSSpecializationReader::OSConfiguration& 
                                               xmlConfigurator);
         } // End of OSConfigurator namespace
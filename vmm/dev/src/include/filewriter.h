@@ -0,0 +1,88 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        filewriter.h
+
+   \brief       Writes files for the agent libraries that keep files on disk
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef FILEWRITER_H
+#define FILEWRITER_H
+
+#include <string>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace Utilities
+        {
+
+            class FileWriter
+            {
+
+            public:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Write all of a buffer, retrying on interrupts and short writes
+
+                   \param   fd      Descriptor to write to
+                   \param   data    Bytes to write
+
+                   \return  False if a write failed; errno tells why
+
+                */
+                static bool WriteAll(int fd, const std::string& data);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Replace a file with new contents. The contents go to a temporary
+                   file next to it that is renamed over the file, so readers see
+                   either the old or the new file. Mode, owner and SELinux context
+                   of an existing file are kept.
+
+                   \param   path    Path of the file
+                   \param   data    New contents
+                   \param   mode    Mode if the file does not exist yet
+                   \param   sync    Sync the file and its directory so the new contents
+                                    survive a crash
+
+                   \return  False if the file could not be replaced; errno tells why
+
+                */
+                static bool Replace(const std::string& path,
+                                    const std::string& data,
+                                    unsigned int mode = 0644,
+                                    bool sync = true);
+
+            }; // End of FileWriter class
+
+        } // End of Utilities namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* FILEWRITER_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
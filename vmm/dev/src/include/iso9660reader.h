@@ -0,0 +1,146 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        iso9660reader.h
+
+   \brief       Reads a file from the root directory of an ISO9660/Joliet
+                image straight from the block device (or image file),
+                without mounting it.
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef ISO9660READER_H
+#define ISO9660READER_H
+
+#include <string>
+#include <vector>
+
+#include <scxcorelib/scxlog.h>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace Fetcher
+        {
+
+            class ISO9660Reader
+            {
+
+            public:
+
+                /** Outcome of a read */
+                enum Result
+                {
+                    FileFound,          //!< The file was read
+                    FileNotFound,       //!< Joliet root directory does not hold the file
+                    Unsupported,        //!< Not ISO9660, or only 8.3 names to go by; mount instead
+                    ReadError           //!< Device could not be opened or read
+                };
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Constructor for ISO9660Reader
+
+                   \param   device    Block device or image file to read from
+
+                */
+                explicit ISO9660Reader(const std::string& device);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Destructor for ISO9660Reader
+
+                */
+                ~ISO9660Reader();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Read a file from the root directory of the image. The Joliet
+                   directory is used when present, the primary one otherwise; names
+                   are compared case-insensitively and without version suffix.
+
+                   \param   fileName    Name of the file in the root directory
+                   \param   data        Receives the file contents
+
+                   \return  Result      See Result
+
+                */
+                Result ReadRootFile(const std::string& fileName,
+                                    std::vector<unsigned char>& data);
+
+            private:
+
+                /** Log Handle */
+                SCXCoreLib::SCXLogHandle m_logHandle;
+
+                /** Device path */
+                std::string              m_device;
+
+                /** Open descriptor of the device, -1 if not open */
+                int                      m_fd;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Read exactly count bytes at offset
+
+                   \return  bool    False on error or short read
+
+                */
+                bool ReadAt(unsigned long long offset, size_t count, unsigned char* buffer);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Search a directory extent for fileName
+
+                   \param   extent      Directory contents
+                   \param   blockSize   Logical block size of the volume
+                   \param   joliet      Whether identifiers are UCS-2 (Joliet)
+                   \param   fileName    Name to look for
+                   \param   location    Receives the file extent location in blocks
+                   \param   length      Receives the file length in bytes
+
+                   \return  bool        True if the file was found
+
+                */
+                bool FindEntry(const std::vector<unsigned char>& extent,
+                               unsigned int blockSize,
+                               bool joliet,
+                               const std::string& fileName,
+                               unsigned int& location,
+                               unsigned int& length);
+
+                /** Prevent copying of the descriptor */
+                ISO9660Reader(const ISO9660Reader&);
+                ISO9660Reader& operator=(const ISO9660Reader&);
+
+            }; // End of ISO9660Reader class
+
+        } // End of Fetcher namespace
+
+    } // End of GuestAgent
+
+} // End of VMM
+
+#endif /* ISO9660READER_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
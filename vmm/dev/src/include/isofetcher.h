@@ -35,9 +35,11 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 
 #include <util/LogHandleCache.h>
 
+#include <scxcorelib/scxhandle.h>
 #include <scxcorelib/scxsingleton.h>
 #include <util/Unicode.h>
 
@@ -50,6 +52,9 @@ namespace VMM
         namespace Fetcher
         {
 
+            class DeviceProber;
+            class DeviceWatcher;
+
             class ISOFetcher : public SCXCoreLib::SCXSingleton<ISOFetcher>
             {
                 
@@ -141,9 +146,25 @@ namespace VMM
                    
                    clean up from completed or aborted setup
 
+                   \throws     TerminateSetupException if termination is deferred
+
                 */
                 void TerminateSetup();
 
+                /*----------------------------------------------------------------------------*/
+                /**
+                   While deferred, TerminateSetup throws TerminateSetupException instead
+                   of ending the process; the caller must then call it again once it is
+                   safe to terminate.
+
+                   \param      defer    Defer termination?
+
+                */
+                inline void DeferTermination(bool defer)
+                {
+                    m_deferTermination = defer;
+                }
+
                 /*----------------------------------------------------------------------------*/
                 /**
                    
@@ -172,21 +193,22 @@ namespace VMM
                 /** did we find the specialization file? */
                 bool                      m_foundOSSpecializationFile;
 
+                /** should TerminateSetup throw instead of ending the process? */
+                bool                      m_deferTermination;
+
                 /** CD Rom device (usually /dev/cdrom) */
                 std::string               m_mountSource;
 
+                /** Probes candidate devices concurrently */
+                SCXCoreLib::SCXHandle<DeviceProber> m_prober;
+
                 /*----------------------------------------------------------------------------*/
                 /**
                    
                    Constructor for ISOFetcher
 
                 */
-                ISOFetcher() 
-                    : m_logHandle(
-                          SCX::Util::LogHandleCache::Instance().GetLogHandle(
-                          "scx.vmmguestagent.src.fetcher.isofetcher"))
-                {
-                }
+                ISOFetcher();
 
                 /*----------------------------------------------------------------------------*/
                 /**
@@ -199,18 +221,53 @@ namespace VMM
                 /*----------------------------------------------------------------------------*/
                 /**
                    
-                   Invoke the insmod command
+                   Mount the cd rom unless it is mounted already
+
+                */
+                bool EnsureMounted();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Read the specialization file from all devices concurrently, then mount
+                   in turn the devices whose image could not be read directly
+
+                   \param   devices    Device paths to probe
+                   \param   watcher    Watcher to re-arm devices that were not ready
+
+                   \return  bool       True if the specialization file was found
 
                 */
-                bool InvokeInsmod();
+                bool ProbeDevices(const std::vector<std::string>& devices,
+                                  DeviceWatcher& watcher);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Take over the specialization file read from m_mountSource; the rest
+                   of the CD is reached through the mount point once it is mounted
+
+                   \param   data       Contents of the specialization file
+
+                */
+                void SetSpecializationData(const std::vector<unsigned char>& data);
 
                 /*----------------------------------------------------------------------------*/
                 /**
                    
-                   Invoke the rmmod command
+                   Load the drivers of storage controllers that have none, or
+                   ata_piix if no such controller is found
 
                 */
-                bool InvokeRmmod();
+                bool LoadControllerDrivers();
+                
+                /*----------------------------------------------------------------------------*/
+                /**
+                   
+                   Unload the drivers LoadControllerDrivers loaded
+
+                   \param   loaded    Modules recorded in the status message
+
+                */
+                bool UnloadControllerDrivers(const std::string& loaded);
                 
                 /*----------------------------------------------------------------------------*/
                 /**
@@ -220,8 +277,21 @@ namespace VMM
                 */
                 std::string GetNewAgentVersion();
 
+                /*----------------------------------------------------------------------------*/
+                /**
+                   
+                   Compare the agent version on the cd with the installed one
+
+                   \param   newAgentVersion   Agent version on the cd
+
+                   \return  False only if the installed agent is known to be the
+                            same or newer; the install script decides otherwise
+
+                */
+                bool IsUpgradeRequired(const std::string& newAgentVersion);
+
 			public:
-				virtual /*dtor*/ ~ISOFetcher () {}
+				virtual /*dtor*/ ~ISOFetcher ();
             }; // End of ISOFetcher class
 
         } // End of Fetcher namespace
@@ -0,0 +1,173 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        logoutputsink.h
+
+   \brief       Output sink that logs the output of a command line by line and
+                keeps only its tail
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef LOGOUTPUTSINK_H
+#define LOGOUTPUTSINK_H
+
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlog.h>
+#include <scxcorelib/scxprocess.h>
+
+#include <string>
+#include <vector>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace Utilities
+        {
+
+            class LogOutputSink : public SCXCoreLib::SCXProcessOutputSink
+            {
+
+            public:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Constructor for LogOutputSink
+
+                   \param   logHandle    Log to write the lines to
+                   \param   prefix       Put in front of every logged line
+                   \param   severity     Severity the lines are logged with
+                   \param   tailBytes    Number of bytes of the output to keep
+
+                */
+                LogOutputSink(const SCXCoreLib::SCXLogHandle& logHandle,
+                              const std::string& prefix,
+                              SCXCoreLib::SCXLogSeverity severity,
+                              size_t tailBytes);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Virtual Destructor for LogOutputSink
+
+                */
+                virtual ~LogOutputSink()
+                {}
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Log the complete lines of a chunk of output and add it to the tail
+
+                */
+                virtual void Write(const char* data, size_t size);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Log the last line if the output did not end with a newline
+
+                */
+                void Flush();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Last bytes of the output, at most the tail size, made valid UTF-8
+                   without the control characters XML does not allow, so it can go
+                   into the status report. A partial UTF-8 sequence at the start is
+                   dropped; other invalid bytes and the control characters are
+                   replaced by '?'.
+
+                */
+                std::string GetTail() const;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Number of bytes written to the sink
+
+                */
+                scxulong GetByteCount() const
+                {
+                    return m_bytes;
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Number of lines logged
+
+                */
+                scxulong GetLineCount() const
+                {
+                    return m_lines;
+                }
+
+            private:
+
+                /** Log Handle */
+                SCXCoreLib::SCXLogHandle    m_logHandle;
+
+                /** Put in front of every logged line */
+                std::string                 m_prefix;
+
+                /** Severity the lines are logged with */
+                SCXCoreLib::SCXLogSeverity  m_severity;
+
+                /** Start of a line whose end has not arrived yet */
+                std::string                 m_partial;
+
+                /** Ring buffer with the tail of the output */
+                std::vector<char>           m_tail;
+
+                /** Position in m_tail the next byte goes to */
+                size_t                      m_tailPos;
+
+                /** Has the ring buffer wrapped around? */
+                bool                        m_tailFull;
+
+                /** Bytes written */
+                scxulong                    m_bytes;
+
+                /** Lines logged */
+                scxulong                    m_lines;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Log one line, which may be split over m_partial and data
+
+                */
+                void LogLine(const char* data, size_t size);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Add output to the ring buffer
+
+                */
+                void AddToTail(const char* data, size_t size);
+
+            }; // End of LogOutputSink class
+
+        } // End of Utilities namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* LOGOUTPUTSINK_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
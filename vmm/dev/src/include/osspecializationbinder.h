@@ -0,0 +1,193 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+        \file        osspecializationbinder.h
+
+        \brief       Binds the specialization XML into the OSSpecializationReader
+                     classes in a single pass over the parser events
+
+        \date        10-17-26 20:00:00
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef OSSPECIALIZATIONBINDER_H
+#define OSSPECIALIZATIONBINDER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <osspecializationreader.h>
+#include <osspecializationbinding.h>
+
+#include <scxcorelib/scxlog.h>
+#include <util/Unicode.h>
+
+namespace VMM
+{
+    namespace GuestAgent
+    {
+        namespace SpecializationReader
+        {
+            /*----------------------------------------------------------------------------*/
+            /**
+                Binds the specialization XML without building a tree of it.
+
+                The dispatch on element names (BindStart, BindAttribute and BindEnd)
+                is generated from LinuxOSSpecialization.xsd into osspecializationbinding.cpp;
+                this class keeps the stack of open elements and implements what the
+                schema leaves to hooks.
+
+                Validation errors are only thrown once the whole document has been
+                read, so a document that is not well formed is reported as such
+                even if it is also invalid, as when it was loaded into a tree first.
+            */
+            class OSSpecializationBinder
+            {
+            public:
+                /*----------------------------------------------------------------------------*/
+                /**
+                    OSSpecializationBinder constructor
+                */
+                OSSpecializationBinder();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                    Bind a document
+
+                    \param [in]  xmlString       the specialization XML
+                    \param [out] specialization  object to bind into, expected to be empty
+                    \throws XmlException if the XML is not well formed
+                    \throws OSSpecializationParserException if it does not match the schema
+                */
+                void Bind(const SCX::Util::Utf8String& xmlString,
+                          OSSpecializationReader::LinuxOSSpecialization& specialization);
+
+            private:
+                /*----------------------------------------------------------------------------*/
+                /**
+                    An open element
+                */
+                struct Frame
+                {
+                    Binding::Tag tag;                   //!< Name of the element, TagNone if not in the schema
+                    Binding::Type type;                 //!< Content that dispatches the children, TypeNone to ignore them
+                    Binding::Field field;               //!< Element within the parent's content, FieldNone if not bound
+                    void* target;                       //!< Object the children bind into
+                    SCX::Util::Utf8String name;         //!< Name of the element
+                    SCX::Util::Utf8String content;      //!< Last run of character data
+
+                    SCX::Util::Utf8String attributes[Binding::AttributeCount]; //!< Attributes of the content, by Binding::AttributeIndex
+                    unsigned int attributeMask;         //!< Bit per attribute that is set
+
+                    bool capture;                       //!< The element is serialized for a section
+                    std::map<SCX::Util::Utf8String, SCX::Util::Utf8String> captureAttributes; //!< All attributes, when capturing
+                    SCX::Util::Utf8String xml;          //!< Serialized children, then the element itself
+
+                    bool deferUnexpected;               //!< Keep an unexpected child for a hook instead of failing
+                    SCX::Util::Utf8String unexpected;   //!< First unexpected child
+                    std::string unexpectedLog;          //!< Log text for the first unexpected child
+                    int count;                          //!< For use by hooks
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                        Get an attribute kept on the frame
+
+                        \param [in]  index  Binding::AttributeIndex of the attribute
+                        \param [out] value  the value
+                        \returns true if the element has the attribute
+                    */
+                    bool GetAttribute(int index, SCX::Util::Utf8String& value) const
+                    {
+                        if (0 == (attributeMask & (1u << index)))
+                        {
+                            return false;
+                        }
+                        value = attributes[index];
+                        return true;
+                    }
+
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                        Keep an attribute on the frame
+                    */
+                    void SetAttribute(int index, const SCX::Util::Utf8String& value)
+                    {
+                        attributes[index] = value;
+                        attributeMask |= 1u << index;
+                    }
+                };
+
+                OSSpecializationBinder(const OSSpecializationBinder&);             //!< Intentionally not implemented
+                OSSpecializationBinder& operator=(const OSSpecializationBinder&);  //!< Intentionally not implemented
+
+                Frame& Push(const SCX::Util::Utf8String& name);
+                void Start(const SCX::Util::Utf8String& name);
+                void Attribute(const SCX::Util::Utf8String& name, const SCX::Util::Utf8String& value);
+                void End();
+                void AppendElement(SCX::Util::Utf8String& out, const Frame& frame) const;
+                void Unexpected(Frame& parent, const Frame& child, const char* log);
+                void Fail(const std::string& log, const std::string& message);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                    Generated dispatch, see osspecializationbinding.cpp
+                */
+                void BindStart(Frame& parent, Frame& child);
+                void BindAttribute(Frame& frame, Binding::Tag tag, const SCX::Util::Utf8String& value);
+                void BindEnd(Frame& parent, Frame& child);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                    Hooks named by the schema
+                */
+                void BeginUsers(Frame& parent, Frame& child);
+                void BeginUser(Frame& parent, Frame& child);
+                void EndUser(Frame& parent, Frame& child);
+                void EndUserName(Frame& parent, Frame& child);
+                void EndRunOnceCommand(Frame& parent, Frame& child);
+                void BeginStaticIP(Frame& parent, Frame& child);
+                void OnAddressType(Frame& frame, Binding::AddressType addressType, const SCX::Util::Utf8String& value);
+
+                SCXCoreLib::SCXLogHandle m_logHandle;
+
+                OSSpecializationReader::LinuxOSSpecialization* m_specialization;
+
+                // Open elements; frames above m_depth are kept to reuse their strings
+                std::vector<Frame> m_frames;
+                size_t m_depth;
+                bool m_rootFound;
+
+                // First validation error, thrown once the document is read
+                bool m_failed;
+                std::string m_failLog;
+                std::string m_failMessage;
+
+                // User being read, merged into the root user if it is root
+                OSSpecializationReader::User m_user;
+
+                // The first UserName of the user being read is "root"
+                bool m_userIsRoot;
+            };
+         } // namespace SpecializationReader
+    } // namespace GuestAgent
+} // namespace VMM
+
+#endif // OSSPECIALIZATIONBINDER_H
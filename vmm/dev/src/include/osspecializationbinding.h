@@ -0,0 +1,190 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+        \file        osspecializationbinding.h
+
+        \brief       Names, contents and fields of LinuxOSSpecialization.xsd for
+                     OSSpecializationBinder
+
+        Generated by xsdbindgen from LinuxOSSpecialization.xsd; do not edit, run
+        "make gen" in dev/tools/xsdbindgen instead.  @migen@
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef OSSPECIALIZATIONBINDING_H
+#define OSSPECIALIZATIONBINDING_H
+
+#include <util/Unicode.h>
+
+namespace VMM
+{
+    namespace GuestAgent
+    {
+        namespace SpecializationReader
+        {
+            namespace Binding
+            {
+                /** Element and attribute names of the schema */
+                enum Tag
+                {
+                    TagNone = -1,
+                    TagAddress,
+                    TagAddressType,
+                    TagAgentVersion,
+                    TagDNSDomainName,
+                    TagDNSSearchSuffix,
+                    TagDNSSearchSuffixes,
+                    TagGateway,
+                    TagGateways,
+                    TagGroupID,
+                    TagHostName,
+                    TagIPV4Property,
+                    TagIPV6Property,
+                    TagLinuxOSSpecialization,
+                    TagMACAddress,
+                    TagMetric,
+                    TagNameServer,
+                    TagNameServers,
+                    TagOSConfiguration,
+                    TagParallelGroup,
+                    TagPassword,
+                    TagPrimaryGroup,
+                    TagRunOnceCommand,
+                    TagRunOnceCommands,
+                    TagSSHKey,
+                    TagSchemaVersion,
+                    TagSequence,
+                    TagStaticIP,
+                    TagTimeZone,
+                    TagUID,
+                    TagUser,
+                    TagUserName,
+                    TagUsers,
+                    TagVNetAdapter,
+                    TagVNetAdapters,
+                    TagCount
+                };
+
+                /** Contents that dispatch the children and attributes of their elements */
+                enum Type
+                {
+                    TypeNone = 0,
+                    TypeLinuxOSSpecialization,
+                    TypeOSConfiguration,
+                    TypeVNetAdapters,
+                    TypeVNetAdapter,
+                    TypeNetworkProperties,
+                    TypeStaticNetworkProperties,
+                    TypeNameServers,
+                    TypeGateways,
+                    TypeGateway,
+                    TypeDNSSearchSuffixes,
+                    TypeUsers,
+                    TypeUser,
+                    TypeRunOnceCommands,
+                    TypeRunOnceCommand
+                };
+
+                /** Elements bound within the content of their parent */
+                enum Field
+                {
+                    FieldNone = 0,
+                    FieldLinuxOSSpecializationSchemaVersion,
+                    FieldLinuxOSSpecializationAgentVersion,
+                    FieldLinuxOSSpecializationOSConfiguration,
+                    FieldOSConfigurationHostName,
+                    FieldOSConfigurationDNSDomainName,
+                    FieldOSConfigurationTimeZone,
+                    FieldOSConfigurationVNetAdapters,
+                    FieldOSConfigurationUsers,
+                    FieldOSConfigurationRunOnceCommands,
+                    FieldVNetAdaptersVNetAdapter,
+                    FieldVNetAdapterMACAddress,
+                    FieldVNetAdapterIPV4Property,
+                    FieldVNetAdapterIPV6Property,
+                    FieldVNetAdapterNameServers,
+                    FieldVNetAdapterGateways,
+                    FieldVNetAdapterDNSSearchSuffixes,
+                    FieldNetworkPropertiesStaticIP,
+                    FieldStaticNetworkPropertiesAddress,
+                    FieldNameServersNameServer,
+                    FieldGatewaysGateway,
+                    FieldGatewayAddress,
+                    FieldGatewayMetric,
+                    FieldDNSSearchSuffixesDNSSearchSuffix,
+                    FieldUsersUser,
+                    FieldUserUserName,
+                    FieldUserPassword,
+                    FieldUserSSHKey,
+                    FieldUserUID,
+                    FieldUserGroupID,
+                    FieldUserPrimaryGroup,
+                    FieldRunOnceCommandsRunOnceCommand
+                };
+
+                /** Attributes kept on the frame of their element, numbered within each content */
+                enum AttributeIndex
+                {
+                    AttributeNetworkPropertiesAddressType = 0,
+                    AttributeRunOnceCommandSequence = 0,
+                    AttributeRunOnceCommandParallelGroup = 1,
+                    AttributeCount = 2
+                };
+
+                /** Values of the AddressType enumeration */
+                enum AddressType
+                {
+                    AddressTypeNone = -1,
+                    AddressTypeDHCP,
+                    AddressTypeSTATIC
+                };
+
+                const Tag RootTag = TagLinuxOSSpecialization;  //!< Element the document starts with
+                const Type RootType = TypeLinuxOSSpecialization;  //!< Content of the root element
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                    Look up a name with the perfect hash of the schema names
+
+                    \param [in] name  element or attribute name
+                    \returns the tag of the name, TagNone if the schema does not have it
+                */
+                Tag LookupTag(const SCX::Util::Utf8String& name);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                    Get the name of a tag
+                */
+                const char* GetTagName(Tag tag);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                    Look up a value of the AddressType enumeration
+
+                    \param [in] value  attribute value
+                    \returns the value, AddressTypeNone if the enumeration does not have it
+                */
+                AddressType LookupAddressType(const SCX::Util::Utf8String& value);
+            } // namespace Binding
+        } // namespace SpecializationReader
+    } // namespace GuestAgent
+} // namespace VMM
+
+#endif // OSSPECIALIZATIONBINDING_H
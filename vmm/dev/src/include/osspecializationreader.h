@@ -108,6 +108,8 @@ namespace VMM
 
             typedef Optional<SCX::Util::Utf8String> OptionalString;
 
+            class OSSpecializationBinder;
+
             /*----------------------------------------------------------------------------*/
             /**
                 class which reads the VMM OS Specialization XML, defining nested 
@@ -133,12 +135,10 @@ namespace VMM
                 */
                 class Gateway
                 {
+                    /** Making the binder a friend to let it set the members as it reads the XML */
+                    friend class OSSpecializationBinder;
+
                 public:
-                    /*----------------------------------------------------------------------------*/
-                    /**
-                        read from node tree
-                    */
-                    void Read(const SCX::Util::Xml::XElementPtr& ptr);
                     /*----------------------------------------------------------------------------*/
                     /**
                         get gateway address
@@ -161,13 +161,16 @@ namespace VMM
                 */
                 class NetworkProperties
                 {
-                public:
+                    /** Making the binder a friend to let it set the members as it reads the XML */
+                    friend class OSSpecializationBinder;
 
+                public:
                     /*----------------------------------------------------------------------------*/
                     /**
-                        read from node tree
+                        NetworkProperties constructor
                     */
-                    void Read(const SCX::Util::Xml::XElementPtr& ptr);
+                    NetworkProperties() : m_isStatic(false) {}
+
                     /*----------------------------------------------------------------------------*/
                     /**
                         return static IP if exists
@@ -190,12 +193,10 @@ namespace VMM
                 */
                 class VNetAdapter
                 {
+                    /** Making the binder a friend to let it set the members as it reads the XML */
+                    friend class OSSpecializationBinder;
+
                 public:
-                    /*----------------------------------------------------------------------------*/
-                    /**
-                        read from node tree
-                    */
-                    void Read(const SCX::Util::Xml::XElementPtr& ptr);
                     /*----------------------------------------------------------------------------*/
                     /**
                         return MAC Address if exists
@@ -229,8 +230,6 @@ namespace VMM
                     std::vector<SCX::Util::Utf8String> DNSSearchSuffixes;
 
                 private:
-                    void ReadGateways(const SCX::Util::Xml::XElementPtr& ptr);
-
                     OptionalString                m_macAddress;
                     Optional<NetworkProperties>   m_ipV4;
                     Optional<NetworkProperties>   m_ipV6;
@@ -242,12 +241,10 @@ namespace VMM
                 */
                 class User
                 {
+                    /** Making the binder a friend to let it set the members as it reads the XML */
+                    friend class OSSpecializationBinder;
+
                 public:
-                    /*----------------------------------------------------------------------------*/
-                    /**
-                        read from node tree
-                    */
-                    void Read(const SCX::Util::Xml::XElementPtr& xElementPtr);
                     /*----------------------------------------------------------------------------*/
                     /**
                         return user name if exists
@@ -294,12 +291,10 @@ namespace VMM
                 */
                 class OSConfiguration
                 {
+                    /** Making the binder a friend to let it set the members as it reads the XML */
+                    friend class OSSpecializationBinder;
+
                 public:
-                    /*----------------------------------------------------------------------------*/
-                    /**
-                        read from node tree
-                    */
-                    void Read(const SCX::Util::Xml::XElementPtr& xElementPtr);
 
                     /*----------------------------------------------------------------------------*/
                     /**
@@ -322,25 +317,34 @@ namespace VMM
                     */
                     inline bool GetRoot(User& val) const { return m_root.TryGet(val); }
 
+                    /*----------------------------------------------------------------------------*/
+                    /**
+                        return the XML of a child element if exists, e.g. to detect
+                        that it changed between runs
+                    */
+                    bool GetSection(const std::string& name, SCX::Util::Utf8String& val) const;
+
                     /*----------------------------------------------------------------------------*/
                     /**
                         list of Run Once commands
                     */
                     std::map<int, SCX::Util::Utf8String> RunOnceCommands;
                     /*----------------------------------------------------------------------------*/
+                    /**
+                        parallel group of the Run Once commands that have one, by sequence
+                    */
+                    std::map<int, int> RunOnceCommandGroups;
+                    /*----------------------------------------------------------------------------*/
                     /**
                         list of VNet adapters
                     */
                     std::vector<VNetAdapter> VNetAdapters;
                 private:
-                    void ReadVNetAdapters(const SCX::Util::Xml::XElementPtr& vNetAdaptersElementPtr);
-                    void ReadRunOnceCommands(const SCX::Util::Xml::XElementPtr& vNetAdaptersElementPtr);
-                    void ReadRootUser(const SCX::Util::Xml::XElementPtr& vNetAdaptersElementPtr);
-
                     OptionalString    m_hostName;
                     OptionalString    m_domainName;
                     Optional<int>     m_timeZone;
                     Optional<User>    m_root;
+                    std::map<std::string, SCX::Util::Utf8String> m_sections;
                 };
 
                 /*----------------------------------------------------------------------------*/
@@ -349,12 +353,10 @@ namespace VMM
                 */
                 class LinuxOSSpecialization
                 {
+                    /** Making the binder a friend to let it set the members as it reads the XML */
+                    friend class OSSpecializationBinder;
+
                 public:
-                    /*----------------------------------------------------------------------------*/
-                    /**
-                        read from node tree
-                    */
-                    void Read(const SCX::Util::Xml::XElementPtr& xElementPtr);
                     /*----------------------------------------------------------------------------*/
                     /**
                         return OS Configuration if exists
@@ -383,9 +385,6 @@ namespace VMM
                 */
                 bool GetLinuxOSSpecialization(LinuxOSSpecialization& val);
 
-                protected:
-                SCX::Util::Xml::XElementPtr  m_pXElementRoot;
-
                 private:
 
                 /*----------------------------------------------------------------------------*/
@@ -394,56 +393,9 @@ namespace VMM
                 */
                 OSSpecializationReader();
 
-                /*----------------------------------------------------------------------------*/
-                /**
-                    load LinuxOSSpecialization object from xml root element 
-                */
-                void Load();
-
                 SCX::Util::Utf8String         m_xmlString;
                 Optional<LinuxOSSpecialization> m_specialization;
 
-                /*----------------------------------------------------------------------------*/
-                /**
-                    xsd schema tag values
-                */
-                static const std::string sLinuxOSSpecialization;
-                static const std::string sAgentVersion;
-                static const std::string sSchemaVersion;
-                static const std::string sOSConfiguration;
-                static const std::string sHostName;
-                static const std::string sDomainName;
-                static const std::string sTimeZone;
-                static const std::string sVNetAdapters;
-                static const std::string sRunOnceCommands;
-                static const std::string sRunOnceCommand;
-                static const std::string sCommandSequence;
-                static const std::string sVNetAdapter;
-                static const std::string sMACAddress;
-                static const std::string sAddressType;
-                static const std::string sGateways;
-                static const std::string sGateway;
-                static const std::string sAddress;
-                static const std::string sSTATIC;
-                static const std::string sDHCP;
-                static const std::string sIPV4Property;
-                static const std::string sIPV6Property;
-                static const std::string sStaticIP;
-                static const std::string sMetric;
-                static const std::string sNameServers;
-                static const std::string sNameServer;
-                static const std::string sUsers;
-                static const std::string sUser;
-                static const std::string sRoot;
-                static const std::string sUserName;
-                static const std::string sPassword;
-                static const std::string sSSHKey;
-                static const std::string sUID;
-                static const std::string sGroupID;
-                static const std::string sPrimaryGroup;
-                static const std::string sDNSSearchSuffixes;
-                static const std::string sDNSSearchSuffix;
-
 			public:
 				virtual /*dtor*/ ~OSSpecializationReader () {}
              }; // class OSSpecializationReader
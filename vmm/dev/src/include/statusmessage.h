@@ -32,6 +32,7 @@
 #define STATUSMESSAGE_H
 
 #include <scxcorelib/stringaid.h>
+#include <scxcorelib/scxthreadlock.h>
 
 #include <util/XElement.h>
 #include <util/Unicode.h>
@@ -62,7 +63,11 @@ namespace VMM
                   : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
                                     "scx.vmmguestagent.statusmanager.statusmessage"))
                   , mp_xelementRoot(NULL)
-                    
+                  , m_lockHandle(SCXCoreLib::ThreadLockHandleGet())
+                  , m_journalFd(-1)
+                  , m_sequence(0)
+                  , m_journalRecords(0)
+                  , m_dirty(false)
                 {
                     SetUp();
                 }
@@ -73,14 +78,17 @@ namespace VMM
                    Virtual Destructor for StatusMessage
 
                 */
-                virtual ~StatusMessage() 
-                {}
+                virtual ~StatusMessage();
 
                 /*----------------------------------------------------------------------------*/
                 /**
-                   Add Status Element to root
+                   Add Status Element to root. The element is committed to the
+                   journal before it is added to the document. If the journal
+                   could not be opened, the element is added and the whole
+                   document is written out instead.
 
-                   \return     None
+                   \return     False if the element could not be persisted; with
+                               a journal the document is left unchanged
 
                 */
                 bool AddChildToRoot(const SCX::Util::Xml::XElementPtr& element);
@@ -98,6 +106,44 @@ namespace VMM
                 */
                 bool ReadChildOfRoot(const std::string& elementName, 
                                      std::string&       elementValue);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Read the most recently added element of a name from Root
+
+                   \param   elementName    ElementName being searched
+                   
+                   \param   elementValue   Value of the element being searched
+                   
+                   \return  bool           True if element was found. False otherwise
+
+                */
+                bool ReadLastChildOfRoot(const std::string& elementName, 
+                                         std::string&       elementValue);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Remove the elements of Root whose name ends with a suffix. The
+                   journal only records additions, so the document is persisted as
+                   a new snapshot.
+
+                   \param   nameSuffix     End of the names of the elements to remove
+
+                   \return  bool           False if the removal could not be persisted
+
+                */
+                bool RemoveChildrenOfRoot(const std::string& nameSuffix);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Write the status document to statusmessage.xml if it changed.
+                   Called before the agent exits; the journal already holds every
+                   committed element.
+
+                   \return     None
+
+                */
+                void Flush();
                 
             private:
                 
@@ -110,12 +156,30 @@ namespace VMM
                 /** Pointer to the Root Element */
                 SCX::Util::Xml::XElementPtr  mp_xelementRoot;
 
-                /** XML String */
-                SCX::Util::Utf8String                   m_xmlString;
-
                 /** Status File */
                 std::string                               m_statusFile;
 
+                /** Journal of the elements added since the snapshot */
+                std::string                               m_journalFile;
+
+                /** Document as of a journal sequence number */
+                std::string                               m_snapshotFile;
+
+                /** Serializes updates from configurators running concurrently */
+                SCXCoreLib::SCXThreadLockHandle           m_lockHandle;
+
+                /** Journal opened for appending */
+                int                                       m_journalFd;
+
+                /** Sequence number of the last committed element */
+                unsigned long                             m_sequence;
+
+                /** Records in the journal */
+                unsigned long                             m_journalRecords;
+
+                /** Does the status file lag behind the document? */
+                bool                                      m_dirty;
+
                 /*----------------------------------------------------------------------------*/
                 /**
                    Helper function to set up directories where status will be persisted
@@ -134,6 +198,43 @@ namespace VMM
                 */    
                 void AddRoot();
 
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Load the document from the snapshot and journal, or from the
+                   status file if there is no journal yet
+
+                   \return     None
+
+                */
+                void LoadDocument();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Add the journaled elements newer than the snapshot to the document
+
+                   \return     None
+
+                */
+                void ReplayJournal();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Append an element to the journal and sync it to disk
+
+                   \return     False on failure
+
+                */
+                bool AppendToJournal(const SCX::Util::Xml::XElementPtr& element);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Write the document to the snapshot and empty the journal
+
+                   \return     False if the snapshot could not be written
+
+                */
+                bool Compact();
+
                 /*----------------------------------------------------------------------------*/
                 /**
                    Helper function to read the file as a string
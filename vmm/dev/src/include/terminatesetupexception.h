@@ -0,0 +1,75 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        terminatesetupexception.h
+
+   \brief       Thrown by ISOFetcher::TerminateSetup while termination is deferred,
+                so that a configurator running on a worker thread unwinds instead
+                of ending the process under its siblings
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef TERMINATESETUPEXCEPTION_H
+#define TERMINATESETUPEXCEPTION_H
+
+#include <scxcorelib/scxexception.h>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace Fetcher
+        {
+
+            class TerminateSetupException : public SCXCoreLib::SCXException
+            {
+
+            public:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Construct a TerminateSetupException object
+
+                */
+                TerminateSetupException() {}
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Implementation of What from SCXException
+
+                   \return The Message string
+                */
+                std::wstring What() const
+                {
+                    return L"Setup termination requested";
+                }
+
+            }; // End of TerminateSetupException class
+
+        } // End of Fetcher namespace
+
+    } // End of GuestAgent
+
+} // End of VMM
+
+#endif /* TERMINATESETUPEXCEPTION_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
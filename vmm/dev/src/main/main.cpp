@@ -24,6 +24,7 @@
 
 #include <logpolicy.h>
 #include <util/LogHandleCache.h>
+#include <util/SpanTracer.h>
 
 #include <isofetcher.h>
 #include <isofetcherexception.h>
@@ -32,10 +33,14 @@
 #include <executevisitor.h>
 #include <isofetcher.h>
 #include <argumentmanager.h>
+#include <statusmessage.h>
 
 #include <fcntl.h>
+#include <sys/stat.h>
 
 using SCX::Util::LogHandleCache;
+using SCX::Util::ScopedSpan;
+using SCX::Util::SpanTracer;
 using SCX::Util::Utf8String;
 using VMM::GuestAgent::Fetcher::ISOFetcher;
 using VMM::GuestAgent::Fetcher::ISOFetcherException;
@@ -43,6 +48,30 @@ using VMM::GuestAgent::SpecializationReader::OSSpecializationReader;
 using VMM::GuestAgent::SpecializationReader::OSSpecializationParserException;
 using VMM::GuestAgent::Fetcher::ISOFetcher;
 using VMM::GuestAgent::Utilities::ArgumentManager;
+using VMM::GuestAgent::StatusManager::StatusMessage;
+
+std::string const TraceDir = "trace";
+std::string const BootTraceJson = "boottrace.json";
+
+//
+// Record boot phases to <VMM home>/trace/boottrace.json
+//
+
+void EnableBootTrace(SCXCoreLib::SCXLogHandle& logHandle)
+{
+    std::string traceDir =
+        ArgumentManager::Instance().GetVMMHome() + std::string("/") + TraceDir;
+
+    struct stat statBuff;
+    if (stat(traceDir.c_str(), &statBuff) == -1 &&
+        mkdir(traceDir.c_str(), S_IRWXU) != 0)
+    {
+        SCX_LOGERROR(logHandle, "Unable to create trace dir " + traceDir);
+        return;
+    }
+
+    SpanTracer::Instance().Enable(traceDir + std::string("/") + BootTraceJson);
+}
 
 //
 // Support making us a daemon
@@ -114,23 +143,31 @@ InitializeSystem(
         // parse commandline
         argMgr.LoadArgs(argc, argv, logHandle);
 
-        if (Process_Daemonize() == -1)
+        EnableBootTrace(logHandle);
+        ScopedSpan initSpan("InitializeSystem", "phase");
+
         {
-            SCX_LOGERROR(
-                logHandle,
-                "Error converting the agent process to a daemon.  errno=" +
-                    SCXCoreLib::StrToUTF8(SCXCoreLib::StrFrom(errno)));
-            exit (1);
+            ScopedSpan span("Daemonize", "phase");
+            if (Process_Daemonize() == -1)
+            {
+                SCX_LOGERROR(
+                    logHandle,
+                    "Error converting the agent process to a daemon.  errno=" +
+                        SCXCoreLib::StrToUTF8(SCXCoreLib::StrFrom(errno)));
+                exit (1);
+            }
         }
 
         if (!argMgr.GetConfigFilename().empty())
         {
+            ScopedSpan span("ReadConfigFile", "phase");
             fetcher.ReadConfigFile(SCXCoreLib::StrFromMultibyte(
                 argMgr.GetConfigFilename()));
         }
         else
         {
             // obtain a cdrom mountpoint
+            ScopedSpan span("ObtainMountPoint", "phase");
             fetcher.ObtainMountPoint();
         }
 
@@ -139,12 +176,9 @@ InitializeSystem(
             // Fetch specialization XML String
             const Utf8String osSpecializationString =
                 fetcher.GetOSConfigurationXMLString();
-            OSSpecializationReader::Instance().LoadXML(osSpecializationString);
-
-            // upgrade if new agent is present
-            if (argMgr.GetConfigFilename().empty())
             {
-                fetcher.InstallOrUpgradeAgent();
+                ScopedSpan span("LoadXML", "phase");
+                OSSpecializationReader::Instance().LoadXML(osSpecializationString);
             }
 
             // Get OSSpecialization
@@ -155,8 +189,21 @@ InitializeSystem(
             OSSpecializationReader::OSConfiguration osconf;
             spec.GetOSConfiguration(osconf);
 
+            // Steps completed for an earlier specialization run again
+            VMM::GuestAgent::OSConfigurator::BeginSpecialization(osconf);
+
+            // upgrade if new agent is present
+            if (argMgr.GetConfigFilename().empty())
+            {
+                ScopedSpan span("InstallOrUpgradeAgent", "phase");
+                fetcher.InstallOrUpgradeAgent();
+            }
+
             // Create and execute all configurators
-            VMM::GuestAgent::OSConfigurator::CreateOSConfigurators(osconf);
+            {
+                ScopedSpan span("CreateOSConfigurators", "phase");
+                VMM::GuestAgent::OSConfigurator::CreateOSConfigurators(osconf);
+            }
 
             SCX_LOGINFO(logHandle, "Sucessfully initialized VMM Guest Agent!");
         
@@ -174,6 +221,9 @@ InitializeSystem(
             logHandle,
             "Error Initializing the VMM Guest Agent! Exception:" + e.What());
     }
+
+    StatusMessage::Instance().Flush();
+    SpanTracer::Instance().Flush();
 }
 
 int
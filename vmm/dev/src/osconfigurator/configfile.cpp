@@ -0,0 +1,74 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+/**
+   \file        configfile.cpp
+
+   \brief       Reads system configuration files and replaces them atomically
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <configfile.h>
+#include <filewriter.h>
+
+#include <sys/stat.h>
+
+#include <fstream>
+
+using VMM::GuestAgent::OSConfigurator::ConfigFile;
+using VMM::GuestAgent::Utilities::FileWriter;
+
+bool ConfigFile::Exists(const std::string& path)
+{
+    struct stat statBuff;
+    return 0 == stat(path.c_str(), &statBuff);
+}
+
+bool ConfigFile::ReadLines(const std::string& path, std::vector<std::string>& lines)
+{
+    lines.clear();
+
+    std::ifstream fileStream(path.c_str());
+    if (!fileStream.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(fileStream, line))
+    {
+        lines.push_back(line);
+    }
+    return true;
+}
+
+bool ConfigFile::WriteLines(const std::string& path, const std::vector<std::string>& lines)
+{
+    std::string data;
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        data += *iter;
+        data += '\n';
+    }
+    return Replace(path, data);
+}
+
+bool ConfigFile::Replace(const std::string& path, const std::string& data, unsigned int mode)
+{
+    return FileWriter::Replace(path, data, mode);
+}
@@ -0,0 +1,97 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+/**
+   \file        configfile.h
+
+   \brief       Reads system configuration files and replaces them atomically
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef CONFIGFILE_H
+#define CONFIGFILE_H
+
+#include <string>
+#include <vector>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace OSConfigurator
+        {
+
+            class ConfigFile
+            {
+
+            public:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Does a file exist?
+
+                */
+                static bool Exists(const std::string& path);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Read a file line by line
+
+                   \param   path     Path of the file
+                   \param   lines    Receives the lines, without their newlines
+
+                   \return  False if the file cannot be opened
+
+                */
+                static bool ReadLines(const std::string& path, std::vector<std::string>& lines);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Replace a file with new lines; see Replace
+
+                */
+                static bool WriteLines(const std::string& path, const std::vector<std::string>& lines);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Replace a file with new contents durably, through
+                   FileWriter::Replace. Readers see either the old or the new
+                   file. Mode, owner and SELinux context of an existing file
+                   are kept.
+
+                   \param   path    Path of the file
+                   \param   data    New contents
+                   \param   mode    Mode if the file does not exist yet
+
+                   \return  False if the file could not be replaced; errno tells why
+
+                */
+                static bool Replace(const std::string& path, const std::string& data, unsigned int mode = 0644);
+
+            }; // End of ConfigFile class
+
+        } // End of OSConfigurator namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* CONFIGFILE_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -0,0 +1,291 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        configuratorscheduler.cpp
+
+   \brief       Runs configurators in dependency order, independent ones
+                concurrently
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <configuratorscheduler.h>
+
+#include <stdlib.h>
+
+#include <sstream>
+
+#include <util/LogHandleCache.h>
+#include <scxcorelib/stringaid.h>
+
+#include <isofetcher.h>
+#include <isofetcherexception.h>
+#include <terminatesetupexception.h>
+
+using VMM::GuestAgent::Fetcher::ISOFetcher;
+using VMM::GuestAgent::Fetcher::ISOFetcherException;
+using VMM::GuestAgent::Fetcher::TerminateSetupException;
+using VMM::GuestAgent::OSConfigurator::ConfiguratorIds;
+using VMM::GuestAgent::OSConfigurator::ConfiguratorScheduler;
+using VMM::GuestAgent::OSConfigurator::OSConfigurator;
+
+namespace
+{
+
+const char*
+ConfiguratorName(VMM::GuestAgent::OSConfigurator::ConfiguratorId id)
+{
+    using namespace VMM::GuestAgent::OSConfigurator;
+
+    switch (id)
+    {
+    case PreConfiguratorId:
+        return "Pre-Configurator";
+    case TimeZoneConfiguratorId:
+        return "TimeZone-Configurator";
+    case HostDomainConfiguratorId:
+        return "HostDomain-Configurator";
+    case UsersConfiguratorId:
+        return "User-Configurator";
+    case NetworkConfiguratorId:
+        return "Network-Configurator";
+    case RunOnceCommandConfiguratorId:
+        return "RunOnceCommandConfigurator";
+    case PostConfiguratorId:
+        return "Post-Configurator";
+    }
+    return "unknown configurator";
+}
+
+class SchedulerTaskParam : public SCXCoreLib::SCXThreadParam
+{
+public:
+    SchedulerTaskParam(ConfiguratorScheduler* scheduler, size_t index)
+      : m_scheduler(scheduler)
+      , m_index(index)
+    {
+    }
+
+    ConfiguratorScheduler*   m_scheduler;
+    size_t                   m_index;
+};
+
+}
+
+
+ConfiguratorScheduler::ConfiguratorScheduler(
+    VMM::GuestAgent::OSConfigurator::Visitor& visitor,
+    const std::vector<OSConfigurator*>& configurators)
+  : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
+                    "scx.vmmguestagent.osconfigurator.configuratorscheduler"))
+  , m_visitor(visitor)
+  , m_configurators(configurators)
+  , m_prerequisites(configurators.size())
+  , m_started(configurators.size(), false)
+  , m_finished(configurators.size(), false)
+  , m_running(0)
+  , m_terminateRequested(false)
+  , m_failure()
+{
+    m_cond.SetSleep(0);
+
+    for (size_t i = 0; i < m_configurators.size(); ++i)
+    {
+        ConfiguratorIds dependencies;
+        m_configurators[i]->GetDependencies(dependencies);
+
+        for (ConfiguratorIds::const_iterator iter = dependencies.begin();
+             iter != dependencies.end(); ++iter)
+        {
+            for (size_t j = 0; j < m_configurators.size(); ++j)
+            {
+                if (j != i && *iter == m_configurators[j]->GetId())
+                {
+                    m_prerequisites[i].push_back(j);
+                }
+            }
+        }
+    }
+
+    m_pool.SetThreadLimit(static_cast<long>(m_configurators.size()));
+    m_pool.Start();
+}
+
+ConfiguratorScheduler::~ConfiguratorScheduler()
+{
+    m_pool.Shutdown();
+}
+
+void ConfiguratorScheduler::Run()
+{
+    // The environment of the configurator scripts is set here, once, before
+    // any configurator runs: setenv is not safe while other threads fork and
+    // exec children.
+    if (setenv("HISTIGNORE", "*", 1) != 0)
+    {
+        SCX_LOGERROR(m_logHandle, "failed to set HISTIGNORE");
+    }
+
+    ISOFetcher::Instance().DeferTermination(true);
+
+    {
+        SCXCoreLib::SCXConditionHandle h(m_cond);
+        while (true)
+        {
+            if (!StartReady() && 0 == m_running && !m_terminateRequested && m_failure.empty())
+            {
+                // Nothing running and nothing ready: either all done or the
+                // remaining configurators depend on each other.
+                size_t next = m_configurators.size();
+                for (size_t i = 0; i < m_configurators.size() && next == m_configurators.size(); ++i)
+                {
+                    if (!m_started[i])
+                    {
+                        next = i;
+                    }
+                }
+                if (next == m_configurators.size())
+                {
+                    break;
+                }
+
+                SCX_LOGERROR(m_logHandle, "Configurator dependencies form a cycle, ignoring them");
+                m_prerequisites[next].clear();
+                continue;
+            }
+
+            if (0 == m_running)
+            {
+                break;
+            }
+
+            h.Wait();
+        }
+    }
+
+    ISOFetcher::Instance().DeferTermination(false);
+
+    if (m_terminateRequested)
+    {
+        SCX_LOGINFO(m_logHandle, "All running configurators finished, terminating setup");
+        ISOFetcher::Instance().TerminateSetup();
+    }
+    else if (!m_failure.empty())
+    {
+        throw ISOFetcherException(L"Configurator failed: " + m_failure);
+    }
+}
+
+bool ConfiguratorScheduler::StartReady()
+{
+    bool startedAny = false;
+
+    // After a termination request or a failure only the running
+    // configurators are waited for
+    if (m_terminateRequested || !m_failure.empty())
+    {
+        return startedAny;
+    }
+
+    for (size_t i = 0; i < m_configurators.size(); ++i)
+    {
+        if (m_started[i])
+        {
+            continue;
+        }
+
+        bool ready = true;
+        for (std::vector<size_t>::const_iterator iter = m_prerequisites[i].begin();
+             ready && iter != m_prerequisites[i].end(); ++iter)
+        {
+            ready = m_finished[*iter];
+        }
+
+        if (ready)
+        {
+            std::ostringstream strm;
+            strm << "Starting " << ConfiguratorName(m_configurators[i]->GetId())
+                 << ", " << m_running << " already running";
+            SCX_LOGINFO(m_logHandle, strm.str());
+
+            m_started[i] = true;
+            ++m_running;
+            startedAny = true;
+
+            SCXCoreLib::SCXThreadParamHandle param(new SchedulerTaskParam(this, i));
+            m_pool.QueueTask(SCXCoreLib::SCXThreadPoolTaskHandle(
+                new SCXCoreLib::SCXThreadPoolTask(ExecuteTask, param)));
+        }
+    }
+
+    return startedAny;
+}
+
+void ConfiguratorScheduler::Execute(size_t index)
+{
+    bool terminateRequested = false;
+    std::wstring failure;
+
+    try
+    {
+        m_configurators[index]->Accept(m_visitor);
+    }
+    catch (TerminateSetupException&)
+    {
+        terminateRequested = true;
+    }
+    catch (SCXCoreLib::SCXException& e)
+    {
+        failure = e.What();
+    }
+    catch (std::exception& e)
+    {
+        failure = SCXCoreLib::StrFromUTF8(e.what());
+    }
+    catch (...)
+    {
+        failure = L"unknown exception";
+    }
+
+    if (!failure.empty())
+    {
+        SCX_LOGERROR(m_logHandle, SCXCoreLib::StrFromMultibyte(
+                         ConfiguratorName(m_configurators[index]->GetId())) +
+                     L" threw an exception: " + failure);
+    }
+
+    SCXCoreLib::SCXConditionHandle h(m_cond);
+    --m_running;
+    m_finished[index] = true;
+    if (terminateRequested)
+    {
+        m_terminateRequested = true;
+    }
+    if (!failure.empty() && m_failure.empty())
+    {
+        m_failure = failure;
+    }
+    h.Signal();
+}
+
+void ConfiguratorScheduler::ExecuteTask(SCXCoreLib::SCXThreadParamHandle& param)
+{
+    SchedulerTaskParam* p = static_cast<SchedulerTaskParam*>(param.GetData());
+    p->m_scheduler->Execute(p->m_index);
+}
@@ -0,0 +1,163 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        configuratorscheduler.h
+
+   \brief       Runs configurators as soon as the configurators they depend on
+                have completed, independent ones concurrently on a thread pool
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef CONFIGURATORSCHEDULER_H
+#define CONFIGURATORSCHEDULER_H
+
+#include <string>
+#include <vector>
+
+#include <scxcorelib/scxcondition.h>
+#include <scxcorelib/scxlog.h>
+#include <scxcorelib/scxthreadpool.h>
+
+#include <osconfigurator.h>
+#include <osconfiguratorvisitor.h>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace OSConfigurator
+        {
+
+            class ConfiguratorScheduler
+            {
+
+            public:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Constructor for ConfiguratorScheduler
+
+                   \param   visitor          Visitor applied to every configurator
+                   \param   configurators    Configurators to run; dependencies on ids not
+                                             in this list are considered satisfied
+
+                */
+                ConfiguratorScheduler(VMM::GuestAgent::OSConfigurator::Visitor& visitor,
+                                      const std::vector<OSConfigurator*>& configurators);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Destructor for ConfiguratorScheduler
+
+                */
+                ~ConfiguratorScheduler();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Run all configurators. If one of them calls ISOFetcher::TerminateSetup,
+                   no further configurators are started; once the running ones have
+                   finished, TerminateSetup is called again from this thread.
+
+                   \throws  ISOFetcherException if a configurator threw an exception
+
+                */
+                void Run();
+
+            private:
+
+                /** Log Handle */
+                SCXCoreLib::SCXLogHandle             m_logHandle;
+
+                /** Visitor applied to every configurator */
+                VMM::GuestAgent::OSConfigurator::Visitor& m_visitor;
+
+                /** Configurators to run */
+                std::vector<OSConfigurator*>         m_configurators;
+
+                /** Indexes of the prerequisites of every configurator */
+                std::vector< std::vector<size_t> >   m_prerequisites;
+
+                /** Has the configurator been handed to the pool? */
+                std::vector<bool>                    m_started;
+
+                /** Has the configurator finished? */
+                std::vector<bool>                    m_finished;
+
+                /** Guards the state below and signals finished configurators */
+                SCXCoreLib::SCXCondition             m_cond;
+
+                /** Configurators started but not finished */
+                size_t                               m_running;
+
+                /** Did a configurator ask to terminate the setup? */
+                bool                                 m_terminateRequested;
+
+                /** Message of an exception thrown by a configurator */
+                std::wstring                         m_failure;
+
+                /** Workers running the configurators */
+                SCXCoreLib::SCXThreadPool            m_pool;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Hand every configurator whose prerequisites have finished to the pool.
+                   Starts nothing once a configurator asked to terminate the setup or
+                   failed. Must be called with m_cond locked.
+
+                   \return  bool    True if a configurator was started
+
+                */
+                bool StartReady();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Run one configurator on the calling worker thread
+
+                   \param   index    Index of the configurator
+
+                */
+                void Execute(size_t index);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Thread pool entry point
+
+                   \param   param    SchedulerTaskParam of the configurator to run
+
+                */
+                static void ExecuteTask(SCXCoreLib::SCXThreadParamHandle& param);
+
+                /** Prevent copying of the thread pool */
+                ConfiguratorScheduler(const ConfiguratorScheduler&);
+                ConfiguratorScheduler& operator=(const ConfiguratorScheduler&);
+
+            }; // End of ConfiguratorScheduler class
+
+        } // End of OSConfigurator namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* CONFIGURATORSCHEDULER_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
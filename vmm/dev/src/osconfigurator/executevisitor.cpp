@@ -30,6 +30,10 @@
 */
 /*----------------------------------------------------------------------------*/
 #include <executevisitor.h>
+#include <configuratorscheduler.h>
+#include <checkpoint.h>
+
+#include <util/SpanTracer.h>
 
 using VMM::GuestAgent::OSConfigurator::PreConfigurator;
 using VMM::GuestAgent::OSConfigurator::HostDomainConfigurator;
@@ -39,15 +43,67 @@ using VMM::GuestAgent::OSConfigurator::UsersConfigurator;
 using VMM::GuestAgent::OSConfigurator::RunOnceCommandConfigurator;
 using VMM::GuestAgent::OSConfigurator::PostConfigurator;
 using VMM::GuestAgent::OSConfigurator::ExecuteVisitor;
+using VMM::GuestAgent::OSConfigurator::ConfiguratorScheduler;
+using VMM::GuestAgent::SpecializationReader::OSSpecializationReader;
+using VMM::GuestAgent::StatusManager::Checkpoint;
+using SCX::Util::ScopedSpan;
 using SCX::Util::Utf8String;
 
+namespace
+{
+
+/** XML of the OSConfiguration elements a configurator reads */
+std::string
+Sections(const OSSpecializationReader::OSConfiguration& xmlConfigurator,
+         const char* name,
+         const char* otherName = NULL)
+{
+    std::string sections;
+    Utf8String section;
+
+    if (xmlConfigurator.GetSection(name, section))
+    {
+        sections += section.Str();
+    }
+    if (NULL != otherName && xmlConfigurator.GetSection(otherName, section))
+    {
+        sections += section.Str();
+    }
+
+    return sections;
+}
+
+}
+
+void VMM::GuestAgent::OSConfigurator::BeginSpecialization(
+    const OSSpecializationReader::OSConfiguration& xmlConfigurator)
+{
+    // Users is left out: it holds the root password
+    std::string input = Sections(xmlConfigurator, "HostName", "DNSDomainName") +
+        Sections(xmlConfigurator, "TimeZone") +
+        Sections(xmlConfigurator, "VNetAdapters") +
+        Sections(xmlConfigurator, "RunOnceCommands");
+
+    Checkpoint::BeginSpecialization(input);
+}
+
 void ExecuteVisitor::Visit(PreConfigurator* preconfigurator)
 {
+    ScopedSpan span("PreConfigurator", "configurator");
+
     preconfigurator->Execute();
 }
 
 void ExecuteVisitor::Visit(HostDomainConfigurator* hostDomainConfigurator)
 {
+    ScopedSpan span("HostDomainConfigurator", "configurator");
+
+    Checkpoint checkpoint("HostDomainConfigurator", Sections(m_xmlConfigurator, "HostName", "DNSDomainName"));
+    if (checkpoint.IsCompleted())
+    {
+        return;
+    }
+
     Utf8String hostName;
     Utf8String domainName;
     
@@ -65,30 +121,55 @@ void ExecuteVisitor::Visit(HostDomainConfigurator* hostDomainConfigurator)
     {
         SCX_LOGWARNING(m_logHandle, ("Unable to find hostname/domain name in configuration file."));
     }
+
+    checkpoint.MarkCompleted();
 }
 
 void ExecuteVisitor::Visit(TimeZoneConfigurator* timeZoneConfigurator)
 {
-    int timeZone;
-    if (m_xmlConfigurator.GetTimeZone(timeZone))
+    ScopedSpan span("TimeZoneConfigurator", "configurator");
+
+    Checkpoint checkpoint("TimeZoneConfigurator", Sections(m_xmlConfigurator, "TimeZone"));
+    if (checkpoint.IsCompleted())
     {
-        timeZoneConfigurator->Execute(timeZone);
+        return;
     }
-    else
+
+    int timeZone;
+    if (!m_xmlConfigurator.GetTimeZone(timeZone))
     {
         SCX_LOGWARNING(m_logHandle, ("Unable to find timeZone in configuration file."));
     }
+    else if (!timeZoneConfigurator->Execute(timeZone))
+    {
+        // Not fatal to the specialization, but retried on the next start
+        return;
+    }
+
+    checkpoint.MarkCompleted();
 }
 
 void ExecuteVisitor::Visit(NetworkConfigurator* networkConfigurator)
 {
+    ScopedSpan span("NetworkConfigurator", "configurator");
+
+    Checkpoint checkpoint("NetworkConfigurator", Sections(m_xmlConfigurator, "VNetAdapters"));
+    if (checkpoint.IsCompleted())
+    {
+        return;
+    }
 
     networkConfigurator->Execute(m_xmlConfigurator.VNetAdapters);
-    
+
+    checkpoint.MarkCompleted();
 }
 
 void ExecuteVisitor::Visit(UsersConfigurator* usersConfigurator)
 {
+    ScopedSpan span("UsersConfigurator", "configurator");
+
+    // Not checkpointed: the input holds the root password, and the step is
+    // cheap and safe to repeat
     VMM::GuestAgent::SpecializationReader::OSSpecializationReader::User user;
     if (m_xmlConfigurator.GetRoot(user))
     {
@@ -102,18 +183,31 @@ void ExecuteVisitor::Visit(UsersConfigurator* usersConfigurator)
 
 void ExecuteVisitor::Visit(RunOnceCommandConfigurator* runOnceConfigurator)
 {
+    ScopedSpan span("RunOnceCommandConfigurator", "configurator");
+
+    Checkpoint checkpoint("RunOnceCommandConfigurator", Sections(m_xmlConfigurator, "RunOnceCommands"));
+    if (checkpoint.IsCompleted())
+    {
+        return;
+    }
+
     if (m_xmlConfigurator.RunOnceCommands.size())
     {
-        runOnceConfigurator->Execute(m_xmlConfigurator.RunOnceCommands);
+        runOnceConfigurator->Execute(m_xmlConfigurator.RunOnceCommands,
+                                     m_xmlConfigurator.RunOnceCommandGroups);
     }
     else
     {
         SCX_LOGINFO(m_logHandle, ("Unable to find any run-once commands in configuration file."));
     }
+
+    checkpoint.MarkCompleted();
 }
 
 void ExecuteVisitor::Visit(PostConfigurator* postConfigurator)
 {
+    ScopedSpan span("PostConfigurator", "configurator");
+
     postConfigurator->Execute();
 }
 
@@ -121,7 +215,8 @@ void VMM::GuestAgent::OSConfigurator::CreateOSConfigurators(
 	const VMM::GuestAgent::SpecializationReader::OSSpecializationReader::OSConfiguration& 
 	xmlConfigurator)
 {
-	// Create the configurators. Order is important
+	// Create the configurators. Each one declares what it depends on; the
+	// scheduler runs the independent ones concurrently.
 	VMM::GuestAgent::OSConfigurator::OSConfigurator *configurators[] = 
 		{
 			new VMM::GuestAgent::OSConfigurator::PreConfigurator(), 
@@ -133,15 +228,27 @@ void VMM::GuestAgent::OSConfigurator::CreateOSConfigurators(
 			new VMM::GuestAgent::OSConfigurator::PostConfigurator()
 		};
 	
+	int const count = sizeof(configurators) / sizeof(configurators[0]);
+	std::vector<VMM::GuestAgent::OSConfigurator::OSConfigurator*> configuratorList(configurators, configurators + count);
+
 	// Double dispatch actions
 	VMM::GuestAgent::OSConfigurator::ExecuteVisitor executeVisitor(xmlConfigurator);
-	for (int i = 0; i < 7; i++)
+	try
 	{
-		configurators[i]->Accept(executeVisitor);
+		ConfiguratorScheduler scheduler(executeVisitor, configuratorList);
+		scheduler.Run();
+	}
+	catch (...)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			delete configurators[i];
+		}
+		throw;
 	}
 	
 	// Clean up
-	for (int i = 0; i < 7; i++)
+	for (int i = 0; i < count; i++)
 	{
 		delete configurators[i];
 	} 
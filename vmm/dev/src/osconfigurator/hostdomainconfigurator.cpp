@@ -20,8 +20,8 @@
 /**
    \file        hostdomainconfigurator.cpp
 
-   \brief       This class provides an abstraction layer to execute host/domain configuration
-                scripts based on 
+   \brief       This class sets the host name and DNS domain given in the XML
+                file, in the kernel and in the distro configuration files
                 
    \date        06-24-2012 20:46:03
 
@@ -30,80 +30,107 @@
 */
 /*----------------------------------------------------------------------------*/
 #include <hostdomainconfigurator.h>
+#include <configfile.h>
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include <sstream>
 #include <string>
 
-#include <argumentmanager.h>
-#include <commandexecutor.h>
 #include <isofetcher.h>
 #include <statusmessage.h>
 #include <statusmessagestrings.h>
 
 #include <util/Unicode.h>
-#include <scxcorelib/stringaid.h>
 
+using VMM::GuestAgent::OSConfigurator::ConfigFile;
 using VMM::GuestAgent::OSConfigurator::HostDomainConfigurator;
 using VMM::GuestAgent::Fetcher::ISOFetcher;
 using VMM::GuestAgent::StatusManager::StatusMessage;
-using VMM::GuestAgent::Utilities::ArgumentManager;
 using SCX::Util::Xml::XElement;
 using SCX::Util::Xml::XElementPtr;
 using SCX::Util::Utf8String;
 
 using namespace VMM::GuestAgent::StatusManager;
 
+namespace
+{
+
+/** Longest host name the kernel takes */
+const size_t MaxHostNameLength = 64;
+
+bool
+StartsWith(const std::string& str, const std::string& prefix)
+{
+    return 0 == str.compare(0, prefix.length(), prefix);
+}
+
+}
+
 void HostDomainConfigurator::Execute(Utf8String& hostName, 
                                      Utf8String& domainName)
 {
     
     SCX_LOGINFO(m_logHandle, ("Executing host-domain configuration"));
 
-    if (setenv("HISTIGNORE", "*", 1) != 0)
-    {
-        SCX_LOGERROR(m_logHandle, ("failed to set HISTIGNORE"));
-    }
-
-    std::wstring command;
-
+    std::string newHostName;
     if (hostName == "*")
     {
-        command = SCXCoreLib::StrFromMultibyte(ArgumentManager::Instance().GetVMMHome() + 
-                                               ("/bin/cfghostdomain hostname=") +
-                                               RandomHostName());
+        newHostName = RandomHostName();
     }
     else
     {
-
         SCX_LOGINFO(m_logHandle, "It was not a * hostname");
-        std::wstring wHostName;
-        hostName.ToWideString(wHostName);
-        command = SCXCoreLib::StrFromMultibyte(ArgumentManager::Instance().GetVMMHome() +
-                                               ("/bin/cfghostdomain hostname=")) + 
-        wHostName;
+        newHostName = hostName.Str();
+    }
+    std::string newDomainName = domainName.Str();
 
+    if (!ValidHostName(newHostName))
+    {
+        SCX_LOGERROR(m_logHandle, ("Specified hostname is invalid. Fatal failure."));
+        StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement(StatusMessageStrings::SpecializationStatus, 
+                                                                          StatusMessageStrings::SpecializationFailed)));
+        ISOFetcher::Instance().TerminateSetup();
+        return;
+    }
+
+    // Entries for the old name are dropped before the kernel forgets it
+    char currentName[MaxHostNameLength + 1] = "";
+    if (m_root.empty() && 0 != gethostname(currentName, sizeof(currentName) - 1))
+    {
+        currentName[0] = '\0';
     }
-    // Invoke script
-    if (domainName.Size())
+    if (!RemoveHostsEntries(currentName))
     {
+        SCX_LOGWARNING(m_logHandle, ("Failed to remove old hostnames from /etc/hosts"));
+    }
 
-        std::wstring wDomainName;
-        domainName.ToWideString(wDomainName);
-        command += SCXCoreLib::StrFromMultibyte(" dnsdomainname=") + 
-            wDomainName;
+    bool succeeded = true;
+    if (m_root.empty() && 0 != sethostname(newHostName.c_str(), newHostName.length()))
+    {
+        std::ostringstream oss;
+        oss << "Failed to set runtime hostname errno=" << errno;
+        SCX_LOGERROR(m_logHandle, oss.str());
+        succeeded = false;
+    }
+    if (!WriteHostNameFiles(newHostName))
+    {
+        succeeded = false;
     }
 
-    // Execute the command - scx logger crashes on printing UTF-8
-    //SCX_LOGINFO(m_logHandle, SCXSTRING("Shell command:") + command);
-    
-    // Use execute script
-    VMM::GuestAgent::Utilities::CommandExecutor commandExec;
-    int ret = commandExec.Execute(command, 
-                                  m_componentName);
+    if (!newDomainName.empty() && !WriteResolvConf(newDomainName))
+    {
+        SCX_LOGWARNING(m_logHandle, ("Failed to write search and domain entries to /etc/resolv.conf"));
+    }
 
-    if (ret < 0)
+    if (!succeeded)
     {
         SCX_LOGINFO(m_logHandle, ("Failed to set host/domain. Fatal failure."));
         StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement(StatusMessageStrings::SpecializationStatus, 
@@ -114,31 +141,187 @@ void HostDomainConfigurator::Execute(Utf8String& hostName,
 
 }
 
+bool HostDomainConfigurator::ValidHostName(const std::string& hostName)
+{
+    if (hostName.empty() || hostName.length() > MaxHostNameLength)
+    {
+        return false;
+    }
+
+    // Anything that would split a line or an entry of the config files
+    for (std::string::const_iterator iter = hostName.begin(); iter != hostName.end(); ++iter)
+    {
+        unsigned char c = static_cast<unsigned char>(*iter);
+        if (c <= ' ' || c == 0x7f || c == '#' || c == '/')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HostDomainConfigurator::RemoveHostsEntries(const std::string& currentName)
+{
+    // Never strip the loopback names, whatever the host was called before
+    if (currentName.empty() || StartsWith(currentName, "localhost"))
+    {
+        return true;
+    }
+
+    std::string hostsFile = Path("/etc/hosts");
+    std::vector<std::string> lines;
+    if (!ConfigFile::ReadLines(hostsFile, lines))
+    {
+        return true;
+    }
+
+    SCX_LOGINFO(m_logHandle, "Removing old host entries from /etc/hosts");
+
+    // Names equal to the current name, or qualified forms of it, are dropped
+    // from each entry; entries left without names are dropped altogether
+    bool changed = false;
+    std::vector<std::string> kept;
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        std::string::size_type hash = iter->find('#');
+        std::istringstream entry(iter->substr(0, hash));
+        std::string address;
+        if (!(entry >> address))
+        {
+            kept.push_back(*iter);
+            continue;
+        }
+
+        std::string names;
+        bool removed = false;
+        std::string name;
+        while (entry >> name)
+        {
+            if (name == currentName || StartsWith(name, currentName + "."))
+            {
+                removed = true;
+                continue;
+            }
+            names += " " + name;
+        }
+
+        if (!removed)
+        {
+            kept.push_back(*iter);
+            continue;
+        }
+        changed = true;
+        if (!names.empty())
+        {
+            std::string comment = std::string::npos == hash ? std::string() : " " + iter->substr(hash);
+            kept.push_back(address + names + comment);
+        }
+    }
+
+    return !changed || ConfigFile::WriteLines(hostsFile, kept);
+}
+
+bool HostDomainConfigurator::WriteHostNameFiles(const std::string& hostName)
+{
+    SCX_LOGINFO(m_logHandle, "Setting hostname to " + hostName);
+
+    // Same distro families as GetDistroFamily in the scripts
+    struct utsname name;
+    bool ubuntu = m_root.empty() && 0 == uname(&name) && 0 != strstr(name.version, "Ubuntu");
+
+    if (ubuntu || ConfigFile::Exists(Path("/etc/debian_version")))
+    {
+        if (!ConfigFile::Replace(Path("/etc/hostname"), hostName + "\n"))
+        {
+            SCX_LOGERROR(m_logHandle, "Failed to write hostname to /etc/hostname");
+            return false;
+        }
+        return true;
+    }
+
+    if (!ConfigFile::Exists(Path("/etc/sysconfig/networking")) && !ConfigFile::Exists(Path("/etc/sysconfig/network-scripts")))
+    {
+        if (!ConfigFile::Replace(Path("/etc/HOSTNAME"), hostName + "\n"))
+        {
+            SCX_LOGERROR(m_logHandle, "Failed to write hostname to /etc/HOSTNAME");
+            return false;
+        }
+        return true;
+    }
+
+    std::string networkFile = Path("/etc/sysconfig/network");
+    std::vector<std::string> lines;
+    std::vector<std::string> kept;
+    ConfigFile::ReadLines(networkFile, lines);
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        // Only the HOSTNAME setting itself, not DHCP_HOSTNAME and the like
+        std::string::size_type start = iter->find_first_not_of(" \t");
+        if (std::string::npos == start || 0 != iter->compare(start, 9, "HOSTNAME="))
+        {
+            kept.push_back(*iter);
+        }
+    }
+    kept.push_back("HOSTNAME=" + hostName);
+    if (!ConfigFile::WriteLines(networkFile, kept))
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to write HOSTNAME entry to /etc/sysconfig/network");
+        return false;
+    }
+
+    if (ConfigFile::Exists(Path("/etc/hostname")) && !ConfigFile::Replace(Path("/etc/hostname"), hostName + "\n"))
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to write hostname to /etc/hostname");
+        return false;
+    }
+    return true;
+}
+
+bool HostDomainConfigurator::WriteResolvConf(const std::string& domainName)
+{
+    SCX_LOGINFO(m_logHandle, "Configuring search and domain entries in /etc/resolv.conf");
+
+    std::string resolvFile = Path("/etc/resolv.conf");
+    std::vector<std::string> lines;
+    std::vector<std::string> kept;
+    ConfigFile::ReadLines(resolvFile, lines);
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        if (!StartsWith(*iter, "search ") && !StartsWith(*iter, "domain "))
+        {
+            kept.push_back(*iter);
+        }
+    }
+    kept.push_back("search " + domainName);
+    kept.push_back("domain " + domainName);
+    return ConfigFile::WriteLines(resolvFile, kept);
+}
+
 std::string HostDomainConfigurator::RandomHostName()
 {
-    srand(time(NULL));
-    char rndCh = 'a';
-    std::string hostname(8, ' ');
-
-    do
-    {
-        rndCh = rand()/(RAND_MAX/('z' - 'a')) + 'a';
-        hostname[0] = rndCh;
-    }
-    while (!LegitimateCharacter(rndCh));
-
-    for (int i=1; i<8; i++)
-    {
-        do
-        {
-            int rnd = rand()/(RAND_MAX/('z' - 'a' + 10));
-            rndCh = rnd < 26 ? rnd + 'a' : (rnd - 26) + '0';
-            hostname[i] = rndCh;
-        }
-        while (!LegitimateCharacter(rndCh));
-    }
-
-    return hostname;
+    srand(time(NULL));
+    char rndCh = 'a';
+    std::string hostname(8, ' ');
+
+    do
+    {
+        rndCh = rand()/(RAND_MAX/('z' - 'a')) + 'a';
+        hostname[0] = rndCh;
+    }
+    while (!LegitimateCharacter(rndCh));
+
+    for (int i=1; i<8; i++)
+    {
+        do
+        {
+            int rnd = rand()/(RAND_MAX/('z' - 'a' + 10));
+            rndCh = rnd < 26 ? rnd + 'a' : (rnd - 26) + '0';
+            hostname[i] = rndCh;
+        }
+        while (!LegitimateCharacter(rndCh));
+    }
+
+    return hostname;
 }
 
 bool HostDomainConfigurator::LegitimateCharacter(char val)
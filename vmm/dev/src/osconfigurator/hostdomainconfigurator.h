@@ -20,8 +20,8 @@
 /**
    \file        hostdomainconfigurator.h
 
-   \brief       This class provides an abstraction layer to execute host/domain configuration
-                scripts based on 
+   \brief       This class sets the host name and DNS domain given in the XML
+                file, in the kernel and in the distro configuration files
                 
    \date        06-24-2012 19:46:03
 
@@ -38,6 +38,9 @@
 
 #include <osconfigurator.h>
 
+#include <string>
+#include <vector>
+
 namespace VMM
 {
 
@@ -58,10 +61,53 @@ namespace VMM
                 /** Const strings */
                 const std::string        m_componentName;
 
+                /** Directory the system files are under; empty for the running system */
+                const std::string        m_root;
+
                 std::string RandomHostName();
 
                 bool LegitimateCharacter(char val);
 
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Can the name be given to sethostname and written to the config files?
+
+                */
+                static bool ValidHostName(const std::string& hostName);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Drop the current host name from /etc/hosts, reading and writing it once
+
+                   \param      currentName    Host name being replaced
+
+                */
+                bool RemoveHostsEntries(const std::string& currentName);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Write the host name to the file the distro keeps it in
+
+                */
+                bool WriteHostNameFiles(const std::string& hostName);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Replace the search and domain entries of /etc/resolv.conf
+
+                */
+                bool WriteResolvConf(const std::string& domainName);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Path of a system file under the root
+
+                */
+                std::string Path(const std::string& path) const
+                {
+                    return m_root + path;
+                }
+
             public:
 
                 /*----------------------------------------------------------------------------*/
@@ -69,11 +115,15 @@ namespace VMM
                    
                    Constructor for Host/Domain Configurator
 
+                   \param  root    Directory the system files are under; empty for the
+                                   running system, which also gets its kernel host name set
+
                 */
-                HostDomainConfigurator()
+                HostDomainConfigurator(const std::string& root = std::string())
                   : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
                                 "scx.vmmguestagent.osconfigurator.hostdomainconfigurator"))
                   , m_componentName("HostDomain-Configurator")
+                  , m_root(root)
                 {}
 
                 /*----------------------------------------------------------------------------*/
@@ -98,7 +148,31 @@ namespace VMM
 
                 /*----------------------------------------------------------------------------*/
                 /**
-                   Function that invokes the host/domain configuration script
+                   Identify the configurator
+
+                   \return  Id of the configurator
+                */
+                inline ConfiguratorId GetId() const
+                {
+                    return HostDomainConfiguratorId;
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Runs once pre-configuration is done
+
+                   \param  dependencies    Receives the ids of the prerequisites
+                */
+                inline void GetDependencies(ConfiguratorIds& dependencies) const
+                {
+                    dependencies.clear();
+                    dependencies.push_back(PreConfiguratorId);
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Set the host name and DNS domain; a host name that cannot be set
+                   fails the specialization
 
                    \param      hostName      Hostname of the VM
                    
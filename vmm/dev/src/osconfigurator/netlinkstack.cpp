@@ -0,0 +1,481 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        netlinkstack.cpp
+
+   \brief       NetworkStack talking rtnetlink to the kernel
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <netlinkstack.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <sstream>
+
+#include <util/LogHandleCache.h>
+
+using VMM::GuestAgent::OSConfigurator::NetlinkStack;
+using VMM::GuestAgent::OSConfigurator::NetworkAddress;
+using VMM::GuestAgent::OSConfigurator::NetworkLink;
+
+namespace
+{
+
+/** Size of the buffer replies are received into */
+const size_t ReceiveBufferSize = 32768;
+
+/**
+   Start a netlink message
+
+   \param   type     Message type
+   \param   flags    NLM_F_* flags, NLM_F_REQUEST is added
+   \param   body     Fixed size header following the netlink header
+   \param   size     Size of body
+*/
+std::vector<char>
+NewMessage(unsigned short type, unsigned short flags, const void* body, size_t size)
+{
+    std::vector<char> message(NLMSG_SPACE(size), 0);
+
+    struct nlmsghdr header;
+    memset(&header, 0, sizeof(header));
+    header.nlmsg_len = NLMSG_LENGTH(size);
+    header.nlmsg_type = type;
+    header.nlmsg_flags = static_cast<unsigned short>(NLM_F_REQUEST | flags);
+    memcpy(&message[0], &header, sizeof(header));
+    memcpy(&message[NLMSG_HDRLEN], body, size);
+
+    return message;
+}
+
+/** Append a route attribute to a message started by NewMessage */
+void
+AddAttribute(std::vector<char>& message, unsigned short type, const void* data, size_t size)
+{
+    size_t offset = NLMSG_ALIGN(message.size());
+
+    struct rtattr attribute;
+    attribute.rta_len = static_cast<unsigned short>(RTA_LENGTH(size));
+    attribute.rta_type = type;
+
+    message.resize(offset + RTA_SPACE(size), 0);
+    memcpy(&message[offset], &attribute, sizeof(attribute));
+    memcpy(&message[offset + RTA_LENGTH(0)], data, size);
+
+    struct nlmsghdr* header = reinterpret_cast<struct nlmsghdr*>(&message[0]);
+    header->nlmsg_len = static_cast<unsigned int>(message.size());
+}
+
+/**
+   Walk the attributes of a reply
+
+   \param   message     Reply, netlink header included
+   \param   offset      Offset of the first attribute
+   \param   attributes  Receives the attributes by type; later ones win
+   \param   maxType     Highest attribute type of interest
+*/
+void
+ParseAttributes(const std::vector<char>& message,
+                size_t offset,
+                std::vector<const struct rtattr*>& attributes,
+                size_t maxType)
+{
+    attributes.assign(maxType + 1, static_cast<const struct rtattr*>(0));
+
+    if (message.size() <= offset)
+    {
+        return;
+    }
+
+    int remaining = static_cast<int>(message.size() - offset);
+    const struct rtattr* attribute = reinterpret_cast<const struct rtattr*>(&message[offset]);
+    for (; RTA_OK(attribute, remaining); attribute = RTA_NEXT(attribute, remaining))
+    {
+        if (attribute->rta_type <= maxType)
+        {
+            attributes[attribute->rta_type] = attribute;
+        }
+    }
+}
+
+std::string
+FormatMacAddress(const unsigned char* address, size_t size)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    std::string result;
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (i > 0)
+        {
+            result.push_back(':');
+        }
+        result.push_back(hex[address[i] >> 4]);
+        result.push_back(hex[address[i] & 0x0f]);
+    }
+    return result;
+}
+
+/** Parse an address; fills buffer and returns its size, 0 if invalid */
+size_t
+ParseAddress(int family, const std::string& address, unsigned char* buffer)
+{
+    if (1 != inet_pton(family, address.c_str(), buffer))
+    {
+        return 0;
+    }
+    return AF_INET == family ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+}
+
+}
+
+
+NetlinkStack::NetlinkStack()
+  : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
+                    "scx.vmmguestagent.osconfigurator.netlinkstack"))
+  , m_socket(socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE))
+  , m_sequence(0)
+{
+    if (m_socket < 0)
+    {
+        SCX_LOGERROR(m_logHandle, std::string("Unable to open rtnetlink socket: ") + strerror(errno));
+        return;
+    }
+
+    struct sockaddr_nl local;
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    if (0 != bind(m_socket, reinterpret_cast<struct sockaddr*>(&local), sizeof(local)))
+    {
+        SCX_LOGERROR(m_logHandle, std::string("Unable to bind rtnetlink socket: ") + strerror(errno));
+        close(m_socket);
+        m_socket = -1;
+    }
+}
+
+NetlinkStack::~NetlinkStack()
+{
+    if (m_socket >= 0)
+    {
+        close(m_socket);
+    }
+}
+
+bool NetlinkStack::GetLinks(std::vector<NetworkLink>& links)
+{
+    links.clear();
+
+    struct ifinfomsg request;
+    memset(&request, 0, sizeof(request));
+    request.ifi_family = AF_UNSPEC;
+
+    std::vector<char> message = NewMessage(RTM_GETLINK, NLM_F_DUMP, &request, sizeof(request));
+    std::vector< std::vector<char> > replies;
+    int error = 0;
+    if (!Transact(message, &replies, error))
+    {
+        SCX_LOGERROR(m_logHandle, std::string("Unable to list network interfaces: ") + strerror(error));
+        return false;
+    }
+
+    for (std::vector< std::vector<char> >::const_iterator iter = replies.begin();
+         iter != replies.end(); ++iter)
+    {
+        if (iter->size() < NLMSG_SPACE(sizeof(struct ifinfomsg)))
+        {
+            continue;
+        }
+
+        struct ifinfomsg info;
+        memcpy(&info, &(*iter)[NLMSG_HDRLEN], sizeof(info));
+
+        std::vector<const struct rtattr*> attributes;
+        ParseAttributes(*iter, NLMSG_SPACE(sizeof(struct ifinfomsg)), attributes, IFLA_MAX);
+
+        NetworkLink link;
+        link.index = info.ifi_index;
+        link.isEthernet = ARPHRD_ETHER == info.ifi_type;
+        link.isUp = 0 != (info.ifi_flags & IFF_UP);
+
+        const struct rtattr* name = attributes[IFLA_IFNAME];
+        if (0 == name)
+        {
+            continue;
+        }
+        link.name = std::string(static_cast<const char*>(RTA_DATA(name)),
+                                strnlen(static_cast<const char*>(RTA_DATA(name)), RTA_PAYLOAD(name)));
+
+        const struct rtattr* address = attributes[IFLA_ADDRESS];
+        if (0 != address)
+        {
+            link.macAddress = FormatMacAddress(static_cast<const unsigned char*>(RTA_DATA(address)),
+                                               RTA_PAYLOAD(address));
+        }
+
+        links.push_back(link);
+    }
+
+    return true;
+}
+
+bool NetlinkStack::GetAddresses(int index, std::vector<NetworkAddress>& addresses)
+{
+    addresses.clear();
+
+    struct ifaddrmsg request;
+    memset(&request, 0, sizeof(request));
+    request.ifa_family = AF_UNSPEC;
+
+    std::vector<char> message = NewMessage(RTM_GETADDR, NLM_F_DUMP, &request, sizeof(request));
+    std::vector< std::vector<char> > replies;
+    int error = 0;
+    if (!Transact(message, &replies, error))
+    {
+        SCX_LOGERROR(m_logHandle, std::string("Unable to list network addresses: ") + strerror(error));
+        return false;
+    }
+
+    for (std::vector< std::vector<char> >::const_iterator iter = replies.begin();
+         iter != replies.end(); ++iter)
+    {
+        if (iter->size() < NLMSG_SPACE(sizeof(struct ifaddrmsg)))
+        {
+            continue;
+        }
+
+        struct ifaddrmsg info;
+        memcpy(&info, &(*iter)[NLMSG_HDRLEN], sizeof(info));
+        if (static_cast<int>(info.ifa_index) != index ||
+            (AF_INET != info.ifa_family && AF_INET6 != info.ifa_family))
+        {
+            continue;
+        }
+
+        std::vector<const struct rtattr*> attributes;
+        ParseAttributes(*iter, NLMSG_SPACE(sizeof(struct ifaddrmsg)), attributes, IFA_MAX);
+
+        // IFA_LOCAL is the address of the interface on point-to-point links
+        const struct rtattr* address = 0 != attributes[IFA_LOCAL] ? attributes[IFA_LOCAL] : attributes[IFA_ADDRESS];
+        if (0 == address)
+        {
+            continue;
+        }
+
+        char buffer[INET6_ADDRSTRLEN];
+        if (0 == inet_ntop(info.ifa_family, RTA_DATA(address), buffer, sizeof(buffer)))
+        {
+            continue;
+        }
+
+        NetworkAddress result;
+        result.family = info.ifa_family;
+        result.address = buffer;
+        result.prefixLength = info.ifa_prefixlen;
+        addresses.push_back(result);
+    }
+
+    return true;
+}
+
+bool NetlinkStack::SetLinkUp(int index)
+{
+    struct ifinfomsg request;
+    memset(&request, 0, sizeof(request));
+    request.ifi_family = AF_UNSPEC;
+    request.ifi_index = index;
+    request.ifi_flags = IFF_UP;
+    request.ifi_change = IFF_UP;
+
+    std::vector<char> message = NewMessage(RTM_NEWLINK, NLM_F_ACK, &request, sizeof(request));
+    int error = 0;
+    if (!Transact(message, 0, error))
+    {
+        std::ostringstream strm;
+        strm << "Unable to bring up interface " << index << ": " << strerror(error);
+        SCX_LOGERROR(m_logHandle, strm.str());
+        return false;
+    }
+    return true;
+}
+
+bool NetlinkStack::AddAddress(int index, const NetworkAddress& address)
+{
+    unsigned char buffer[sizeof(struct in6_addr)];
+    size_t size = ParseAddress(address.family, address.address, buffer);
+    if (0 == size || address.prefixLength > size * 8)
+    {
+        SCX_LOGERROR(m_logHandle, "Invalid address " + address.address);
+        return false;
+    }
+
+    struct ifaddrmsg request;
+    memset(&request, 0, sizeof(request));
+    request.ifa_family = static_cast<unsigned char>(address.family);
+    request.ifa_prefixlen = static_cast<unsigned char>(address.prefixLength);
+    request.ifa_scope = RT_SCOPE_UNIVERSE;
+    request.ifa_index = index;
+
+    std::vector<char> message = NewMessage(RTM_NEWADDR, NLM_F_ACK | NLM_F_CREATE | NLM_F_EXCL,
+                                           &request, sizeof(request));
+    AddAttribute(message, IFA_LOCAL, buffer, size);
+    AddAttribute(message, IFA_ADDRESS, buffer, size);
+
+    if (AF_INET == address.family && address.prefixLength < 31)
+    {
+        // ip(8) only sets the broadcast address when asked; the distro scripts do
+        unsigned char broadcast[sizeof(struct in_addr)];
+        memcpy(broadcast, buffer, sizeof(broadcast));
+        for (unsigned int bit = address.prefixLength; bit < 32; ++bit)
+        {
+            broadcast[bit / 8] |= static_cast<unsigned char>(0x80 >> (bit % 8));
+        }
+        AddAttribute(message, IFA_BROADCAST, broadcast, sizeof(broadcast));
+    }
+
+    int error = 0;
+    if (!Transact(message, 0, error) && EEXIST != error)
+    {
+        SCX_LOGERROR(m_logHandle, "Unable to add address " + address.address + ": " + strerror(error));
+        return false;
+    }
+    return true;
+}
+
+bool NetlinkStack::AddDefaultRoute(int index, int family, const std::string& gateway)
+{
+    unsigned char buffer[sizeof(struct in6_addr)];
+    size_t size = ParseAddress(family, gateway, buffer);
+    if (0 == size)
+    {
+        SCX_LOGERROR(m_logHandle, "Invalid gateway " + gateway);
+        return false;
+    }
+
+    struct rtmsg request;
+    memset(&request, 0, sizeof(request));
+    request.rtm_family = static_cast<unsigned char>(family);
+    request.rtm_table = RT_TABLE_MAIN;
+    request.rtm_protocol = RTPROT_BOOT;
+    request.rtm_scope = RT_SCOPE_UNIVERSE;
+    request.rtm_type = RTN_UNICAST;
+
+    // There is one default route per family; replace the one the image booted with
+    std::vector<char> message = NewMessage(RTM_NEWROUTE, NLM_F_ACK | NLM_F_CREATE | NLM_F_REPLACE,
+                                           &request, sizeof(request));
+    AddAttribute(message, RTA_GATEWAY, buffer, size);
+    unsigned int outputInterface = static_cast<unsigned int>(index);
+    AddAttribute(message, RTA_OIF, &outputInterface, sizeof(outputInterface));
+
+    int error = 0;
+    if (!Transact(message, 0, error))
+    {
+        SCX_LOGERROR(m_logHandle, "Unable to add default route through " + gateway + ": " + strerror(error));
+        return false;
+    }
+    return true;
+}
+
+bool NetlinkStack::Transact(std::vector<char>& request,
+                            std::vector< std::vector<char> >* replies,
+                            int& error)
+{
+    error = 0;
+    if (m_socket < 0)
+    {
+        error = ENOTCONN;
+        return false;
+    }
+
+    unsigned int sequence = ++m_sequence;
+    struct nlmsghdr* header = reinterpret_cast<struct nlmsghdr*>(&request[0]);
+    header->nlmsg_seq = sequence;
+
+    struct sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    ssize_t sent = 0;
+    do
+    {
+        sent = sendto(m_socket, &request[0], request.size(), 0,
+                      reinterpret_cast<struct sockaddr*>(&kernel), sizeof(kernel));
+    }
+    while (sent < 0 && EINTR == errno);
+
+    if (sent < 0)
+    {
+        error = errno;
+        return false;
+    }
+
+    std::vector<char> buffer(ReceiveBufferSize);
+    while (true)
+    {
+        ssize_t received = recv(m_socket, &buffer[0], buffer.size(), 0);
+        if (received < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            error = errno;
+            return false;
+        }
+
+        int remaining = static_cast<int>(received);
+        for (struct nlmsghdr* reply = reinterpret_cast<struct nlmsghdr*>(&buffer[0]);
+             NLMSG_OK(reply, remaining); reply = NLMSG_NEXT(reply, remaining))
+        {
+            if (reply->nlmsg_seq != sequence)
+            {
+                continue;
+            }
+
+            if (NLMSG_DONE == reply->nlmsg_type)
+            {
+                return true;
+            }
+
+            if (NLMSG_ERROR == reply->nlmsg_type)
+            {
+                struct nlmsgerr result;
+                memcpy(&result, NLMSG_DATA(reply), sizeof(result));
+                // An error code of 0 acknowledges a request
+                error = -result.error;
+                return 0 == error;
+            }
+
+            if (0 != replies)
+            {
+                const char* begin = reinterpret_cast<const char*>(reply);
+                replies->push_back(std::vector<char>(begin, begin + reply->nlmsg_len));
+            }
+        }
+    }
+}
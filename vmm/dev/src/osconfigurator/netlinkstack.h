@@ -0,0 +1,124 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        netlinkstack.h
+
+   \brief       NetworkStack talking rtnetlink to the kernel
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef NETLINKSTACK_H
+#define NETLINKSTACK_H
+
+#include <scxcorelib/scxlog.h>
+
+#include <networkstack.h>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace OSConfigurator
+        {
+
+            class NetlinkStack : public VMM::GuestAgent::OSConfigurator::NetworkStack
+            {
+
+            public:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Constructor for NetlinkStack. Opens the rtnetlink socket.
+
+                */
+                NetlinkStack();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Destructor for NetlinkStack
+
+                */
+                virtual ~NetlinkStack();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Could the rtnetlink socket be opened?
+
+                */
+                bool IsOpen() const
+                {
+                    return m_socket >= 0;
+                }
+
+                virtual bool GetLinks(std::vector<NetworkLink>& links);
+
+                virtual bool GetAddresses(int index, std::vector<NetworkAddress>& addresses);
+
+                virtual bool SetLinkUp(int index);
+
+                virtual bool AddAddress(int index, const NetworkAddress& address);
+
+                virtual bool AddDefaultRoute(int index, int family, const std::string& gateway);
+
+            private:
+
+                /** Log Handle */
+                SCXCoreLib::SCXLogHandle m_logHandle;
+
+                /** rtnetlink socket */
+                int                      m_socket;
+
+                /** Sequence number of the last request */
+                unsigned int             m_sequence;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Send a request and collect the replies
+
+                   \param   request     Netlink message, header included
+                   \param   replies     Receives the payload messages of a dump;
+                                        may be null for requests that are acknowledged
+                   \param   error       Receives the errno reported by the kernel
+
+                   \return  False if the kernel rejected the request or the socket failed
+
+                */
+                bool Transact(std::vector<char>& request,
+                              std::vector< std::vector<char> >* replies,
+                              int& error);
+
+                /** Prevent copying of the socket */
+                NetlinkStack(const NetlinkStack&);
+                NetlinkStack& operator=(const NetlinkStack&);
+
+            }; // End of NetlinkStack class
+
+        } // End of OSConfigurator namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* NETLINKSTACK_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -0,0 +1,1155 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        networkconfigengine.cpp
+
+   \brief       Native counterpart of the cfgnetadapter and cfgdynnetadapter
+                scripts
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <networkconfigengine.h>
+#include <configfile.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+#include <util/LogHandleCache.h>
+#include <scxcorelib/stringaid.h>
+
+#include <commandexecutor.h>
+
+using VMM::GuestAgent::OSConfigurator::AdapterSettings;
+using VMM::GuestAgent::OSConfigurator::ConfigFile;
+using VMM::GuestAgent::OSConfigurator::NetworkAddress;
+using VMM::GuestAgent::OSConfigurator::NetworkConfigEngine;
+using VMM::GuestAgent::OSConfigurator::NetworkLink;
+
+namespace
+{
+
+/** Most name servers the agent adds to resolv.conf */
+const size_t MaxNameServers = 3;
+
+/** Comment marking the name servers added by the agent */
+const std::string AgentMark = "#vmm";
+
+std::vector<std::string>
+Tokenize(const std::string& line)
+{
+    std::vector<std::string> tokens;
+    std::istringstream strm(line);
+    std::string token;
+    while (strm >> token)
+    {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+bool
+StartsWith(const std::string& str, const std::string& prefix)
+{
+    return 0 == str.compare(0, prefix.length(), prefix);
+}
+
+/** Drop the lines starting with prefix; returns the last one dropped */
+std::string
+RemoveLinesStartingWith(std::vector<std::string>& lines, const std::string& prefix)
+{
+    std::string removed;
+    std::vector<std::string> kept;
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        if (StartsWith(*iter, prefix))
+        {
+            removed = *iter;
+        }
+        else
+        {
+            kept.push_back(*iter);
+        }
+    }
+    lines.swap(kept);
+    return removed;
+}
+
+/** Drop the lines that have field as one of their whitespace delimited fields */
+void
+RemoveLinesWithField(std::vector<std::string>& lines, const std::string& field)
+{
+    std::vector<std::string> kept;
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        std::vector<std::string> tokens = Tokenize(*iter);
+        if (tokens.end() == std::find(tokens.begin(), tokens.end(), field))
+        {
+            kept.push_back(*iter);
+        }
+    }
+    lines.swap(kept);
+}
+
+/** Drop the shell variable assignments to name */
+void
+RemoveAssignments(std::vector<std::string>& lines, const std::string& name)
+{
+    std::vector<std::string> kept;
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        std::vector<std::string> tokens = Tokenize(*iter);
+        if (tokens.empty() || !StartsWith(tokens[0], name + "="))
+        {
+            kept.push_back(*iter);
+        }
+    }
+    lines.swap(kept);
+}
+
+/** Lower case, colon separated form of a hardware address */
+std::string
+NormalizeMacAddress(const std::string& macAddress)
+{
+    std::string result;
+    for (std::string::const_iterator iter = macAddress.begin(); iter != macAddress.end(); ++iter)
+    {
+        if ('-' == *iter)
+        {
+            result.push_back(':');
+        }
+        else if (!isspace(static_cast<unsigned char>(*iter)))
+        {
+            result.push_back(static_cast<char>(tolower(static_cast<unsigned char>(*iter))));
+        }
+    }
+    return result;
+}
+
+/** Split address/prefix length; the prefix length defaults to the full address */
+bool
+SplitAddress(const std::string& value, unsigned int maxPrefixLength,
+             std::string& address, unsigned int& prefixLength)
+{
+    std::string::size_type slash = value.find('/');
+    address = value.substr(0, slash);
+    prefixLength = maxPrefixLength;
+
+    if (std::string::npos != slash)
+    {
+        std::string length = value.substr(slash + 1);
+        char* end = 0;
+        unsigned long parsed = strtoul(length.c_str(), &end, 10);
+        if (length.empty() || '\0' != *end || parsed > maxPrefixLength)
+        {
+            return false;
+        }
+        prefixLength = static_cast<unsigned int>(parsed);
+    }
+
+    return !address.empty();
+}
+
+std::string
+Netmask(unsigned int prefixLength)
+{
+    std::ostringstream strm;
+    for (unsigned int octet = 0; octet < 4; ++octet)
+    {
+        unsigned int bits = prefixLength > octet * 8 ? prefixLength - octet * 8 : 0;
+        unsigned int value = bits >= 8 ? 255 : (0xff00 >> bits) & 0xff;
+        strm << (octet > 0 ? "." : "") << value;
+    }
+    return strm.str();
+}
+
+/** Keywords that start a stanza in /etc/network/interfaces */
+bool
+IsDebianStanza(const std::string& keyword)
+{
+    return "iface" == keyword || "mapping" == keyword || "auto" == keyword ||
+        "source" == keyword || "source-directory" == keyword || StartsWith(keyword, "allow-");
+}
+
+/** Does the token name dev or one of its VLAN subinterfaces? */
+bool
+NamesInterface(const std::string& token, const std::string& dev)
+{
+    return token == dev || token == "#" + dev || StartsWith(token, dev + ".");
+}
+
+}
+
+
+NetworkConfigEngine::NetworkConfigEngine(NetworkStack& stack,
+                                         const std::string& root,
+                                         const std::string& definedAdapters)
+  : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
+                    "scx.vmmguestagent.osconfigurator.networkconfigengine"))
+  , m_stack(stack)
+  , m_root(root)
+  , m_definedAdapters(definedAdapters)
+  , m_distro(UnknownDistro)
+  , m_warnings(false)
+{
+    m_distro = DetectDistro();
+}
+
+NetworkConfigEngine::Result NetworkConfigEngine::Configure(
+    const std::vector<AdapterSettings>& settings,
+    bool includeUnspecified)
+{
+    m_warnings = false;
+
+    if (UnknownDistro == m_distro)
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to detect Linux distribution");
+        return Failed;
+    }
+
+    // One dump answers every hardware address lookup
+    std::vector<NetworkLink> links;
+    if (!m_stack.GetLinks(links))
+    {
+        return Failed;
+    }
+
+    std::vector<Adapter> adapters;
+    if (!ResolveAdapters(settings, links, includeUnspecified, adapters))
+    {
+        return Failed;
+    }
+
+    if (adapters.empty())
+    {
+        SCX_LOGINFO(m_logHandle, "No network adapters to configure");
+        return m_warnings ? SucceededWithWarnings : Succeeded;
+    }
+
+    ClearUnusedAdapters(links);
+    ReadDnsSettings();
+
+    // Write the configuration of every adapter before restarting the network
+    for (std::vector<Adapter>::const_iterator iter = adapters.begin(); iter != adapters.end(); ++iter)
+    {
+        SCX_LOGINFO(m_logHandle, "Beginning configuration for network adapter " + iter->link.name);
+
+        ConfigHostsEntry(*iter);
+
+        bool written = true;
+        switch (m_distro)
+        {
+        case DebianDistro:
+            written = WriteDebianConfig(*iter);
+            break;
+        case RHELDistro:
+            written = WriteRHELConfig(*iter);
+            break;
+        case SUSEDistro:
+            written = WriteSUSEConfig(*iter);
+            break;
+        case UnknownDistro:
+            break;
+        }
+        if (!written)
+        {
+            return Failed;
+        }
+
+        EnableResolvConfUpdates(*iter);
+    }
+
+    SCX_LOGINFO(m_logHandle, "Restarting network subsystem");
+    if (!RestartNetwork())
+    {
+        Warn("Errors encountered in network subsystem restart");
+    }
+
+    Result result = Succeeded;
+    for (std::vector<Adapter>::const_iterator iter = adapters.begin(); iter != adapters.end(); ++iter)
+    {
+        // The service may not manage the interface, e.g. under NetworkManager
+        ApplyStaticSettings(*iter);
+
+        if (!iter->settings.nameServers.empty() || !iter->settings.searchSuffixes.empty())
+        {
+            ConfigResolv(*iter);
+        }
+
+        std::vector<std::string> defined;
+        ConfigFile::ReadLines(m_definedAdapters, defined);
+        defined.push_back(iter->link.name);
+        if (!ConfigFile::WriteLines(m_definedAdapters, defined))
+        {
+            Warn("Failed to record adapter " + iter->link.name + " in " + m_definedAdapters);
+        }
+
+        if (!Validate(*iter))
+        {
+            if (iter->settings.optional)
+            {
+                Warn("Validation failed for optional adapter " + iter->link.name);
+            }
+            else
+            {
+                result = Failed;
+            }
+        }
+    }
+
+    if (Succeeded == result && m_warnings)
+    {
+        result = SucceededWithWarnings;
+    }
+    return result;
+}
+
+bool NetworkConfigEngine::RestartNetwork()
+{
+    std::vector<std::string> commands;
+    if (DebianDistro == m_distro)
+    {
+        commands.push_back("/etc/init.d/networking stop");
+        commands.push_back("/etc/init.d/networking start");
+    }
+    else
+    {
+        commands.push_back("service network restart");
+    }
+
+    bool succeeded = true;
+    for (std::vector<std::string>::const_iterator iter = commands.begin(); iter != commands.end(); ++iter)
+    {
+        VMM::GuestAgent::Utilities::CommandExecutor commandExec;
+        if (0 != commandExec.Execute(SCXCoreLib::StrFromMultibyte(*iter), "Network-Restart"))
+        {
+            succeeded = false;
+        }
+    }
+    return succeeded;
+}
+
+NetworkConfigEngine::Distro NetworkConfigEngine::DetectDistro() const
+{
+    struct utsname name;
+    bool ubuntu = m_root.empty() && 0 == uname(&name) && 0 != strstr(name.version, "Ubuntu");
+
+    if (ubuntu || ConfigFile::Exists(Path("/etc/debian_version")))
+    {
+        return DebianDistro;
+    }
+    if (!ConfigFile::Exists(Path("/etc/sysconfig/networking")) && !ConfigFile::Exists(Path("/etc/sysconfig/network-scripts")))
+    {
+        return ConfigFile::Exists(Path("/etc/sysconfig/network")) ? SUSEDistro : UnknownDistro;
+    }
+    return RHELDistro;
+}
+
+bool NetworkConfigEngine::ResolveAdapters(const std::vector<AdapterSettings>& settings,
+                                          const std::vector<NetworkLink>& links,
+                                          bool includeUnspecified,
+                                          std::vector<Adapter>& adapters)
+{
+    std::set<std::string> specified;
+
+    for (std::vector<AdapterSettings>::const_iterator iter = settings.begin(); iter != settings.end(); ++iter)
+    {
+        std::string macAddress = NormalizeMacAddress(iter->macAddress);
+        if (macAddress.empty())
+        {
+            SCX_LOGERROR(m_logHandle, "Network adapter without hardware address");
+            return false;
+        }
+
+        Adapter adapter;
+        adapter.settings = *iter;
+        adapter.ipv4PrefixLength = 0;
+        adapter.ipv6PrefixLength = 0;
+
+        std::vector<NetworkLink>::const_iterator link = links.begin();
+        while (link != links.end() && link->macAddress != macAddress)
+        {
+            ++link;
+        }
+        if (links.end() == link)
+        {
+            // The other adapters are still configured, as the per-adapter script did
+            Warn("Unable to identify a network adapter name for hwaddr " + macAddress + ", skipping it");
+            continue;
+        }
+        adapter.link = *link;
+
+        if (!iter->ipv4Address.empty())
+        {
+            if (!SplitAddress(iter->ipv4Address, 32, adapter.ipv4Address, adapter.ipv4PrefixLength))
+            {
+                SCX_LOGERROR(m_logHandle, "Invalid IPv4 address " + iter->ipv4Address);
+                return false;
+            }
+            adapter.ipv4Netmask = Netmask(adapter.ipv4PrefixLength);
+        }
+        if (!iter->ipv6Address.empty())
+        {
+            if (!SplitAddress(iter->ipv6Address, 128, adapter.ipv6Address, adapter.ipv6PrefixLength))
+            {
+                SCX_LOGERROR(m_logHandle, "Invalid IPv6 address " + iter->ipv6Address);
+                return false;
+            }
+        }
+
+        specified.insert(macAddress);
+        adapters.push_back(adapter);
+    }
+
+    if (!includeUnspecified)
+    {
+        return true;
+    }
+
+    // Configure unspecified network adapters as DHCP - parity with windows agent
+    std::vector<std::string> defined;
+    ConfigFile::ReadLines(m_definedAdapters, defined);
+    std::set<std::string> definedNames(defined.begin(), defined.end());
+
+    for (std::vector<NetworkLink>::const_iterator link = links.begin(); link != links.end(); ++link)
+    {
+        if (!link->isEthernet || link->macAddress.empty() ||
+            specified.end() != specified.find(link->macAddress) ||
+            definedNames.end() != definedNames.find(link->name))
+        {
+            continue;
+        }
+
+        SCX_LOGINFO(m_logHandle, "Configuring adapter " + link->name + " with dynamic settings");
+
+        Adapter adapter;
+        adapter.settings.macAddress = link->macAddress;
+        adapter.settings.ipv4AddressType = "dhcp";
+        adapter.settings.ipv6AddressType = "dhcp";
+        adapter.settings.optional = true;
+        adapter.link = *link;
+        adapter.ipv4PrefixLength = 0;
+        adapter.ipv6PrefixLength = 0;
+        adapters.push_back(adapter);
+    }
+
+    return true;
+}
+
+void NetworkConfigEngine::ClearUnusedAdapters(const std::vector<NetworkLink>& links)
+{
+    SCX_LOGINFO(m_logHandle, "Deleting old configuration for unused interfaces");
+
+    std::set<std::string> names;
+    for (std::vector<NetworkLink>::const_iterator iter = links.begin(); iter != links.end(); ++iter)
+    {
+        names.insert(iter->name);
+    }
+
+    if (DebianDistro == m_distro)
+    {
+        std::vector<std::string> lines;
+        ConfigFile::ReadLines(Path("/etc/network/interfaces"), lines);
+
+        std::set<std::string> unused;
+        for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+        {
+            std::vector<std::string> tokens = Tokenize(*iter);
+            if (tokens.size() > 1 && "iface" == tokens[0] && names.end() == names.find(tokens[1]))
+            {
+                unused.insert(tokens[1]);
+            }
+        }
+
+        for (std::set<std::string>::const_iterator iter = unused.begin(); iter != unused.end(); ++iter)
+        {
+            SCX_LOGINFO(m_logHandle, "Deleting unused interface " + *iter);
+            RemoveDebianInterface(*iter);
+        }
+        return;
+    }
+
+    std::string cfgDir = Path(RHELDistro == m_distro ? "/etc/sysconfig/network-scripts" : "/etc/sysconfig/network");
+    DIR* dir = opendir(cfgDir.c_str());
+    if (0 == dir)
+    {
+        return;
+    }
+
+    std::vector<std::string> unused;
+    for (struct dirent* entry = readdir(dir); 0 != entry; entry = readdir(dir))
+    {
+        std::string file = entry->d_name;
+        if (!StartsWith(file, "ifcfg-"))
+        {
+            continue;
+        }
+
+        // Same as the script: the name is the text between the first two dashes
+        std::string name = file.substr(6, file.find('-', 6) - 6);
+        if (names.end() == names.find(name))
+        {
+            unused.push_back(cfgDir + "/" + file);
+        }
+    }
+    closedir(dir);
+
+    for (std::vector<std::string>::const_iterator iter = unused.begin(); iter != unused.end(); ++iter)
+    {
+        SCX_LOGINFO(m_logHandle, "Deleting unused interface file " + *iter);
+        unlink(iter->c_str());
+    }
+}
+
+void NetworkConfigEngine::ReadDnsSettings()
+{
+    char hostName[256] = "";
+    if (0 != gethostname(hostName, sizeof(hostName) - 1))
+    {
+        hostName[0] = '\0';
+    }
+    m_hostName = hostName;
+
+    std::vector<std::string> lines;
+    ConfigFile::ReadLines(Path("/etc/resolv.conf"), lines);
+
+    m_dnsDomain.clear();
+    m_searchLine.clear();
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        std::vector<std::string> tokens = Tokenize(*iter);
+        if (StartsWith(*iter, "domain ") && tokens.size() > 1)
+        {
+            m_dnsDomain = tokens[1];
+        }
+        else if (StartsWith(*iter, "search "))
+        {
+            m_searchLine = *iter;
+        }
+    }
+}
+
+void NetworkConfigEngine::ConfigHostsEntry(const Adapter& adapter)
+{
+    std::vector<std::string> addresses;
+    if ("static" == adapter.settings.ipv4AddressType && !adapter.ipv4Address.empty())
+    {
+        addresses.push_back(adapter.ipv4Address);
+    }
+    if ("static" == adapter.settings.ipv6AddressType && !adapter.ipv6Address.empty())
+    {
+        addresses.push_back(adapter.ipv6Address);
+    }
+    if (addresses.empty())
+    {
+        return;
+    }
+
+    std::vector<std::string> lines;
+    ConfigFile::ReadLines(Path("/etc/hosts"), lines);
+
+    for (std::vector<std::string>::const_iterator iter = addresses.begin(); iter != addresses.end(); ++iter)
+    {
+        // Remove entries currently in /etc/hosts for this IP Address
+        RemoveLinesWithField(lines, *iter);
+
+        if (!m_hostName.empty())
+        {
+            std::string entry = *iter + "  ";
+            if (!m_dnsDomain.empty())
+            {
+                entry += m_hostName + "." + m_dnsDomain + "  ";
+            }
+            lines.push_back(entry + m_hostName);
+        }
+    }
+
+    if (!ConfigFile::WriteLines(Path("/etc/hosts"), lines))
+    {
+        Warn("Failed to write host entries for " + adapter.link.name + " to /etc/hosts");
+    }
+}
+
+bool NetworkConfigEngine::WriteDebianConfig(const Adapter& adapter)
+{
+    const AdapterSettings& settings = adapter.settings;
+    const std::string& dev = adapter.link.name;
+
+    if (settings.ipv4AddressType.empty() && settings.ipv6AddressType.empty())
+    {
+        return true;
+    }
+
+    // Remove old network interface configuration for this device
+    if (!RemoveDebianInterface(dev))
+    {
+        return false;
+    }
+
+    std::ostringstream netcfg;
+    netcfg << std::endl << "#" << dev << std::endl << "auto " << dev << std::endl;
+
+    if ("dhcp" == settings.ipv4AddressType)
+    {
+        netcfg << "iface " << dev << " inet dhcp" << std::endl;
+    }
+    else if ("static" == settings.ipv4AddressType)
+    {
+        netcfg << "iface " << dev << " inet static" << std::endl
+               << "     address " << adapter.ipv4Address << std::endl
+               << "     netmask " << adapter.ipv4Netmask << std::endl;
+
+        // gateway, use the first IPv4 gateway
+        for (std::vector<std::string>::const_iterator iter = settings.gateways.begin();
+             iter != settings.gateways.end(); ++iter)
+        {
+            if (std::string::npos == iter->find(':'))
+            {
+                netcfg << "     gateway " << *iter << std::endl;
+                break;
+            }
+        }
+    }
+
+    if ("static" == settings.ipv6AddressType)
+    {
+        netcfg << std::endl
+               << "iface " << dev << " inet6 static" << std::endl
+               << "pre-up modprobe ipv6" << std::endl
+               << "     address " << adapter.ipv6Address << std::endl
+               << "     netmask " << adapter.ipv6PrefixLength << std::endl;
+
+        // gateway, use the first IPv6 gateway
+        for (std::vector<std::string>::const_iterator iter = settings.gateways.begin();
+             iter != settings.gateways.end(); ++iter)
+        {
+            if (std::string::npos != iter->find(':'))
+            {
+                netcfg << "     gateway " << *iter << std::endl;
+                break;
+            }
+        }
+    }
+
+    SCX_LOGINFO(m_logHandle, "Writing configuration for adapter " + dev + " to /etc/network/interfaces");
+    std::string cfgFile = Path("/etc/network/interfaces");
+    std::vector<std::string> lines;
+    ConfigFile::ReadLines(cfgFile, lines);
+
+    std::ostringstream data;
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        data << *iter << std::endl;
+    }
+    data << netcfg.str() << std::endl;
+
+    if (!ConfigFile::Replace(cfgFile, data.str()))
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to write configuration for adapter " + dev + " to /etc/network/interfaces");
+        return false;
+    }
+    return true;
+}
+
+bool NetworkConfigEngine::RemoveDebianInterface(const std::string& dev)
+{
+    // Remove adapter, and any subinterfaces from the interfaces config file
+    std::string cfgFile = Path("/etc/network/interfaces");
+    SCX_LOGINFO(m_logHandle, "Removing old configuration for adapter " + dev + " from /etc/network/interfaces");
+
+    std::vector<std::string> lines;
+    if (!ConfigFile::ReadLines(cfgFile, lines))
+    {
+        return true;
+    }
+
+    std::vector<std::string> kept;
+    bool inStanza = false;
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        std::vector<std::string> tokens = Tokenize(*iter);
+        if (tokens.empty())
+        {
+            // Do not leave a growing run of blank lines where stanzas were removed
+            inStanza = false;
+            if (kept.empty() || !Tokenize(kept.back()).empty())
+            {
+                kept.push_back(*iter);
+            }
+            continue;
+        }
+
+        if (IsDebianStanza(tokens[0]))
+        {
+            inStanza = false;
+            if (("iface" == tokens[0] || "mapping" == tokens[0]) &&
+                tokens.size() > 1 && NamesInterface(tokens[1], dev))
+            {
+                // Drop the options of the stanza as well
+                inStanza = true;
+                continue;
+            }
+        }
+        else if (inStanza)
+        {
+            continue;
+        }
+
+        bool namesDev = false;
+        for (std::vector<std::string>::const_iterator token = tokens.begin(); !namesDev && token != tokens.end(); ++token)
+        {
+            namesDev = NamesInterface(*token, dev);
+        }
+        if (!namesDev)
+        {
+            kept.push_back(*iter);
+        }
+    }
+
+    if (!ConfigFile::WriteLines(cfgFile, kept))
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to remove old configuration for adapter " + dev + " from /etc/network/interfaces");
+        return false;
+    }
+    return true;
+}
+
+bool NetworkConfigEngine::WriteRHELConfig(const Adapter& adapter)
+{
+    const AdapterSettings& settings = adapter.settings;
+    const std::string& dev = adapter.link.name;
+
+    if (settings.ipv4AddressType.empty() && settings.ipv6AddressType.empty())
+    {
+        return true;
+    }
+
+    SCX_LOGINFO(m_logHandle, "Configuring scripts for network adapter " + dev);
+
+    // Make sure that networking is enabled
+    std::string networkFile = Path("/etc/sysconfig/network");
+    std::vector<std::string> network;
+    ConfigFile::ReadLines(networkFile, network);
+    RemoveAssignments(network, "NETWORKING");
+    network.push_back("NETWORKING=yes");
+    if (!settings.ipv6AddressType.empty())
+    {
+        RemoveAssignments(network, "NETWORKING_IPV6");
+        network.push_back("NETWORKING_IPV6=yes");
+    }
+    if (!settings.gateways.empty())
+    {
+        // Set first supplied gateway as global default gateway
+        RemoveAssignments(network, "gateway");
+        RemoveAssignments(network, "GATEWAY");
+        network.push_back("GATEWAY=" + settings.gateways[0]);
+    }
+    if (!ConfigFile::WriteLines(networkFile, network))
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to write /etc/sysconfig/network");
+        return false;
+    }
+
+    // remove old netconfig files for this interface
+    std::string cfgDir = Path("/etc/sysconfig/network-scripts");
+    unlink((cfgDir + "/ifcfg-" + dev).c_str());
+    unlink((cfgDir + "/route-" + dev).c_str());
+
+    std::vector<std::string> netcfg;
+    netcfg.push_back("DEVICE='" + dev + "'");
+    netcfg.push_back("STARTMODE='auto'");
+
+    if ("dhcp" == settings.ipv4AddressType)
+    {
+        netcfg.push_back("BOOTPROTO='dhcp'");
+        netcfg.push_back("DHCP_HOSTNAME='" + m_hostName + "'");
+    }
+    else if ("static" == settings.ipv4AddressType)
+    {
+        netcfg.push_back("BOOTPROTO='static'");
+        netcfg.push_back("IPADDR='" + adapter.ipv4Address + "'");
+        netcfg.push_back("NETMASK='" + adapter.ipv4Netmask + "'");
+        netcfg.push_back("PEERDNS='no'");
+    }
+
+    if ("dhcp" == settings.ipv6AddressType)
+    {
+        netcfg.push_back("IPV6INIT='yes'");
+        netcfg.push_back("IPV6_AUTOCONF='yes'");
+    }
+    else if ("static" == settings.ipv6AddressType)
+    {
+        std::ostringstream address;
+        address << adapter.ipv6Address << "/" << adapter.ipv6PrefixLength;
+        netcfg.push_back("IPV6INIT='yes'");
+        netcfg.push_back("IPV6_AUTOCONF='no'");
+        netcfg.push_back("IPV6ADDR='" + address.str() + "'");
+        if (settings.ipv4AddressType.empty())
+        {
+            netcfg.push_back("PEERDNS='no'");
+        }
+    }
+
+    SCX_LOGINFO(m_logHandle, "Writing configuration to /etc/sysconfig/network-scripts/ifcfg-" + dev);
+    if (!ConfigFile::WriteLines(cfgDir + "/ifcfg-" + dev, netcfg))
+    {
+        Warn("Failed to write adapter configuration to /etc/sysconfig/network-scripts/ifcfg-" + dev);
+    }
+    return true;
+}
+
+bool NetworkConfigEngine::WriteSUSEConfig(const Adapter& adapter)
+{
+    const AdapterSettings& settings = adapter.settings;
+    const std::string& dev = adapter.link.name;
+
+    if (settings.ipv4AddressType.empty() && settings.ipv6AddressType.empty())
+    {
+        return true;
+    }
+
+    std::string cfgDir = Path("/etc/sysconfig/network");
+
+    // SLES 10 names the files after the hardware address
+    bool sles10 = false;
+    std::vector<std::string> release;
+    ConfigFile::ReadLines(Path("/etc/SuSE-release"), release);
+    for (std::vector<std::string>::const_iterator iter = release.begin(); iter != release.end(); ++iter)
+    {
+        std::vector<std::string> tokens = Tokenize(*iter);
+        sles10 = sles10 || (tokens.size() > 2 && "VERSION" == tokens[0] && "10" == tokens[2]);
+    }
+
+    std::string cfgFile = cfgDir + "/ifcfg-" + dev;
+    std::string routeFile = cfgDir + "/ifroute-" + dev;
+    if (sles10)
+    {
+        cfgFile = cfgDir + "/ifcfg-eth-id-" + adapter.link.macAddress;
+        routeFile = cfgDir + "/ifroute-eth-id-" + adapter.link.macAddress;
+
+        std::vector<std::string> config;
+        ConfigFile::ReadLines(cfgDir + "/config", config);
+        for (std::vector<std::string>::iterator iter = config.begin(); iter != config.end(); ++iter)
+        {
+            if (StartsWith(*iter, "FORCE_PERSISTENT_NAMES="))
+            {
+                *iter = "FORCE_PERSISTENT_NAMES=yes";
+            }
+        }
+        ConfigFile::WriteLines(cfgDir + "/config", config);
+    }
+
+    // remove old netconfig files for this interface
+    unlink((cfgDir + "/ifcfg-" + dev).c_str());
+    unlink(cfgFile.c_str());
+
+    std::vector<std::string> netcfg;
+    netcfg.push_back("DEVICE='" + dev + "'");
+    netcfg.push_back("STARTMODE='auto'");
+
+    if ("dhcp" == settings.ipv4AddressType)
+    {
+        netcfg.push_back("BOOTPROTO='dhcp'");
+    }
+    else if ("static" == settings.ipv4AddressType)
+    {
+        netcfg.push_back("BOOTPROTO='static'");
+        netcfg.push_back("IPADDR='" + adapter.ipv4Address + "'");
+        netcfg.push_back("NETMASK='" + adapter.ipv4Netmask + "'");
+    }
+
+    if ("static" == settings.ipv6AddressType)
+    {
+        std::ostringstream prefixLength;
+        prefixLength << adapter.ipv6PrefixLength;
+        netcfg.push_back("LABEL_0='0'");
+        netcfg.push_back("IPADDR_0='" + adapter.ipv6Address + "'");
+        netcfg.push_back("PREFIXLEN_0='" + prefixLength.str() + "'");
+    }
+
+    SCX_LOGINFO(m_logHandle, "Writing configuration for adapter " + dev + " to " + cfgFile);
+    if (!ConfigFile::WriteLines(cfgFile, netcfg))
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to write configuration for adapter " + dev + " to " + cfgFile);
+        return false;
+    }
+
+    if (!settings.gateways.empty())
+    {
+        unlink(routeFile.c_str());
+
+        std::vector<std::string> routes;
+        routes.push_back("# Destination     gateway     Netmask            Device ");
+        routes.push_back("default\t" + settings.gateways[0] + "\t0.0.0.0\t\t" + dev + " ");
+        if (!ConfigFile::WriteLines(routeFile, routes))
+        {
+            SCX_LOGERROR(m_logHandle, "Failed to write default route to " + routeFile);
+            return false;
+        }
+
+        // Clean out old routing table, as it is expected to be invalid now
+        std::string routesFile = cfgDir + "/routes";
+        if (ConfigFile::Exists(routesFile) && 0 != rename(routesFile.c_str(), (routesFile + ".bak").c_str()))
+        {
+            Warn("Failed to move /etc/sysconfig/network/routes to routes.bak");
+        }
+    }
+    return true;
+}
+
+void NetworkConfigEngine::EnableResolvConfUpdates(const Adapter& adapter)
+{
+    if ("dhcp" != adapter.settings.ipv4AddressType)
+    {
+        return;
+    }
+
+    if (ConfigFile::Exists(Path("/sbin/dhclient-script")))
+    {
+        std::string hookFile = "/etc/dhclient-enter-hooks";
+        if (DebianDistro == m_distro)
+        {
+            hookFile = "/etc/dhcp3/dhclient-enter-hooks.d/nodnsupdate";
+        }
+        else if (ConfigFile::Exists(Path("/etc/dhcp")))
+        {
+            hookFile = "/etc/dhcp/dhclient-enter-hooks";
+        }
+
+        SCX_LOGINFO(m_logHandle, "Removing dhclient enter hooks to enable resolv.conf overwrites in: " + hookFile);
+        unlink(Path(hookFile).c_str());
+    }
+
+    std::string dhcpFile = Path("/etc/sysconfig/network/dhcp");
+    std::vector<std::string> dhcp;
+    if (ConfigFile::ReadLines(dhcpFile, dhcp))
+    {
+        SCX_LOGINFO(m_logHandle, "Setting DHCLIENT_MODIFY_RESOLV_CONF=yes in /etc/sysconfig/network/dhcp");
+        for (std::vector<std::string>::iterator iter = dhcp.begin(); iter != dhcp.end(); ++iter)
+        {
+            if (StartsWith(*iter, "DHCLIENT_MODIFY_RESOLV_CONF="))
+            {
+                *iter = "DHCLIENT_MODIFY_RESOLV_CONF=\"yes\"";
+            }
+        }
+        ConfigFile::WriteLines(dhcpFile, dhcp);
+    }
+
+    if (m_root.empty() && 0 == access("/sbin/resolvconf", X_OK))
+    {
+        SCX_LOGINFO(m_logHandle, "Enabling resolvconf updates to resolv.conf");
+        VMM::GuestAgent::Utilities::CommandExecutor commandExec;
+        commandExec.Execute(L"/sbin/resolvconf --enable-updates", "Network-Configurator");
+    }
+}
+
+void NetworkConfigEngine::ApplyStaticSettings(const Adapter& adapter)
+{
+    const AdapterSettings& settings = adapter.settings;
+    bool staticIPv4 = "static" == settings.ipv4AddressType && !adapter.ipv4Address.empty();
+    bool staticIPv6 = "static" == settings.ipv6AddressType && !adapter.ipv6Address.empty();
+    if (!staticIPv4 && !staticIPv6)
+    {
+        return;
+    }
+
+    m_stack.SetLinkUp(adapter.link.index);
+
+    if (staticIPv4)
+    {
+        NetworkAddress address;
+        address.family = AF_INET;
+        address.address = adapter.ipv4Address;
+        address.prefixLength = adapter.ipv4PrefixLength;
+        m_stack.AddAddress(adapter.link.index, address);
+    }
+    if (staticIPv6)
+    {
+        NetworkAddress address;
+        address.family = AF_INET6;
+        address.address = adapter.ipv6Address;
+        address.prefixLength = adapter.ipv6PrefixLength;
+        m_stack.AddAddress(adapter.link.index, address);
+    }
+
+    // Default routes through the first gateway of each family
+    bool ipv4Gateway = false;
+    bool ipv6Gateway = false;
+    for (std::vector<std::string>::const_iterator iter = settings.gateways.begin();
+         iter != settings.gateways.end(); ++iter)
+    {
+        bool ipv6 = std::string::npos != iter->find(':');
+        if (ipv6 && staticIPv6 && !ipv6Gateway)
+        {
+            ipv6Gateway = m_stack.AddDefaultRoute(adapter.link.index, AF_INET6, *iter);
+        }
+        else if (!ipv6 && staticIPv4 && !ipv4Gateway)
+        {
+            ipv4Gateway = m_stack.AddDefaultRoute(adapter.link.index, AF_INET, *iter);
+        }
+    }
+}
+
+void NetworkConfigEngine::ConfigResolv(const Adapter& adapter)
+{
+    std::string resolvFile = Path("/etc/resolv.conf");
+    std::vector<std::string> lines;
+    ConfigFile::ReadLines(resolvFile, lines);
+
+    // Re-write search suffix list in case it was overwritten during network restart
+    std::string searchLine = RemoveLinesStartingWith(lines, "search ");
+    if (!m_searchLine.empty())
+    {
+        searchLine = m_searchLine;
+    }
+
+    // Append new values to the suffix list
+    std::vector<std::string> search = Tokenize(searchLine);
+    if (!search.empty())
+    {
+        search.erase(search.begin());
+    }
+    for (std::vector<std::string>::const_iterator iter = adapter.settings.searchSuffixes.begin();
+         iter != adapter.settings.searchSuffixes.end(); ++iter)
+    {
+        if (search.end() == std::find(search.begin(), search.end(), *iter))
+        {
+            search.push_back(*iter);
+        }
+    }
+
+    // Keep the name servers added by scvmm-agent, add the supplied ones until there are three
+    std::vector<std::string> nameServers;
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        std::vector<std::string> tokens = Tokenize(*iter);
+        if (tokens.size() > 1 && std::string::npos != iter->find(AgentMark))
+        {
+            nameServers.push_back(tokens[1]);
+        }
+    }
+    for (std::vector<std::string>::const_iterator iter = adapter.settings.nameServers.begin();
+         iter != adapter.settings.nameServers.end() && nameServers.size() < MaxNameServers; ++iter)
+    {
+        nameServers.push_back(*iter);
+    }
+
+    RemoveLinesStartingWith(lines, "nameserver ");
+
+    std::string newSearchLine = "search";
+    for (std::vector<std::string>::const_iterator iter = search.begin(); iter != search.end(); ++iter)
+    {
+        newSearchLine += " " + *iter;
+    }
+    lines.push_back(newSearchLine);
+    for (std::vector<std::string>::const_iterator iter = nameServers.begin(); iter != nameServers.end(); ++iter)
+    {
+        lines.push_back("nameserver " + *iter + " " + AgentMark);
+    }
+
+    // Dhclient-script may have overwritten domain entry in resolv.conf. If so, restore it
+    if (!m_dnsDomain.empty())
+    {
+        RemoveLinesStartingWith(lines, "domain ");
+        lines.push_back("domain " + m_dnsDomain);
+    }
+
+    SCX_LOGINFO(m_logHandle, "Writing nameservers and search suffixes to /etc/resolv.conf");
+    if (!ConfigFile::WriteLines(resolvFile, lines))
+    {
+        Warn("Failed to write nameservers and search suffixes to /etc/resolv.conf");
+    }
+
+    // Keep the suffixes of this adapter when the next one rewrites the search line
+    m_searchLine = newSearchLine;
+}
+
+bool NetworkConfigEngine::Validate(const Adapter& adapter)
+{
+    const std::string& dev = adapter.link.name;
+
+    std::vector<NetworkLink> links;
+    bool isUp = false;
+    if (m_stack.GetLinks(links))
+    {
+        for (std::vector<NetworkLink>::const_iterator iter = links.begin(); iter != links.end(); ++iter)
+        {
+            isUp = isUp || (iter->index == adapter.link.index && iter->isUp);
+        }
+    }
+
+    if (!isUp)
+    {
+        SCX_LOGERROR(m_logHandle, "Interface " + dev + " is not configured or is not up");
+        return false;
+    }
+    SCX_LOGINFO(m_logHandle, "Interface " + dev + " is configured and up");
+
+    // Check static configs
+    if ("static" == adapter.settings.ipv4AddressType)
+    {
+        std::vector<NetworkAddress> addresses;
+        m_stack.GetAddresses(adapter.link.index, addresses);
+
+        bool hasAddress = false;
+        bool hasPrefix = false;
+        for (std::vector<NetworkAddress>::const_iterator iter = addresses.begin(); iter != addresses.end(); ++iter)
+        {
+            if (AF_INET == iter->family && iter->address == adapter.ipv4Address)
+            {
+                hasAddress = true;
+                hasPrefix = hasPrefix || iter->prefixLength == adapter.ipv4PrefixLength;
+            }
+        }
+
+        if (!hasAddress)
+        {
+            SCX_LOGERROR(m_logHandle, "Interface " + dev + " does not have the correct static IPv4 address");
+            return false;
+        }
+        if (!hasPrefix)
+        {
+            SCX_LOGERROR(m_logHandle, "Interface " + dev + " does not have the correct static IPv4 netmask");
+            return false;
+        }
+        SCX_LOGINFO(m_logHandle, "Interface " + dev + " has the correct static IPv4 address and netmask");
+    }
+
+    return true;
+}
+
+void NetworkConfigEngine::Warn(const std::string& message)
+{
+    SCX_LOGWARNING(m_logHandle, message);
+    m_warnings = true;
+}
+
+std::string NetworkConfigEngine::Path(const std::string& path) const
+{
+    return m_root + path;
+}
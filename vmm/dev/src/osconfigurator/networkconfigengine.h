@@ -0,0 +1,339 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        networkconfigengine.h
+
+   \brief       Native counterpart of the cfgnetadapter and cfgdynnetadapter
+                scripts: writes the distro network configuration files and
+                applies the settings through a NetworkStack
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef NETWORKCONFIGENGINE_H
+#define NETWORKCONFIGENGINE_H
+
+#include <string>
+#include <vector>
+
+#include <scxcorelib/scxlog.h>
+
+#include <networkstack.h>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace OSConfigurator
+        {
+
+            /** Settings of one adapter, as passed to cfgnetadapter */
+            struct AdapterSettings
+            {
+                AdapterSettings()
+                  : optional(false)
+                {}
+
+                /** Hardware address */
+                std::string                 macAddress;
+
+                /** "dhcp", "static" or empty to leave IPv4 alone */
+                std::string                 ipv4AddressType;
+
+                /** Static IPv4 address as address/prefix length */
+                std::string                 ipv4Address;
+
+                /** "dhcp", "static" or empty to leave IPv6 alone */
+                std::string                 ipv6AddressType;
+
+                /** Static IPv6 address as address/prefix length */
+                std::string                 ipv6Address;
+
+                /** Gateways, the first one becomes the default route */
+                std::vector<std::string>    gateways;
+
+                /** DNS servers */
+                std::vector<std::string>    nameServers;
+
+                /** DNS search suffixes */
+                std::vector<std::string>    searchSuffixes;
+
+                /** Only warn if the adapter does not come up */
+                bool                        optional;
+            };
+
+            class NetworkConfigEngine
+            {
+
+            public:
+
+                /** Distribution families with different network configuration files */
+                enum Distro
+                {
+                    UnknownDistro,
+                    DebianDistro,
+                    RHELDistro,
+                    SUSEDistro
+                };
+
+                /** Outcome of Configure, matching the exit codes of the scripts */
+                enum Result
+                {
+                    Succeeded,
+                    SucceededWithWarnings,
+                    Failed
+                };
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Constructor for NetworkConfigEngine
+
+                   \param   stack               Kernel network stack
+                   \param   root                Prefix of all system files; empty for /
+                   \param   definedAdapters     File listing the configured interfaces
+
+                */
+                NetworkConfigEngine(NetworkStack& stack,
+                                    const std::string& root,
+                                    const std::string& definedAdapters);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Virtual Destructor for NetworkConfigEngine
+
+                */
+                virtual ~NetworkConfigEngine()
+                {}
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Distribution family found under the root
+
+                */
+                Distro GetDistro() const
+                {
+                    return m_distro;
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Configure the adapters and restart the network once
+
+                   \param   adapters              Adapters from the specialization file
+                   \param   includeUnspecified    Also configure the other ethernet
+                                                  interfaces for DHCP
+
+                   \return  Result
+
+                */
+                Result Configure(const std::vector<AdapterSettings>& adapters, bool includeUnspecified);
+
+            protected:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Restart the distro network service so it picks up the new files
+
+                   \return  False if the restart reported errors
+
+                */
+                virtual bool RestartNetwork();
+
+            private:
+
+                /** An adapter resolved to its interface */
+                struct Adapter
+                {
+                    AdapterSettings     settings;
+                    NetworkLink         link;
+                    std::string         ipv4Address;
+                    unsigned int        ipv4PrefixLength;
+                    std::string         ipv4Netmask;
+                    std::string         ipv6Address;
+                    unsigned int        ipv6PrefixLength;
+                };
+
+                /** Log Handle */
+                SCXCoreLib::SCXLogHandle    m_logHandle;
+
+                /** Kernel network stack */
+                NetworkStack&               m_stack;
+
+                /** Prefix of all system files */
+                std::string                 m_root;
+
+                /** File listing the configured interfaces */
+                std::string                 m_definedAdapters;
+
+                /** Distribution family */
+                Distro                      m_distro;
+
+                /** Host name, used in the hosts file and for DHCP */
+                std::string                 m_hostName;
+
+                /** Domain line of resolv.conf before the network restart */
+                std::string                 m_dnsDomain;
+
+                /** Search line of resolv.conf before the network restart */
+                std::string                 m_searchLine;
+
+                /** Was a warning encountered? */
+                bool                        m_warnings;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Find the distribution family the same way the scripts do
+
+                */
+                Distro DetectDistro() const;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Map the adapters to interfaces by hardware address. An
+                   adapter whose address matches no interface is skipped with
+                   a warning.
+
+                   \param   settings              Adapters from the specialization file
+                   \param   links                 Interfaces of the system
+                   \param   includeUnspecified    Add the other ethernet interfaces for DHCP
+                   \param   adapters              Receives the adapters to configure
+
+                   \return  False if an adapter has no address or an invalid IP address
+
+                */
+                bool ResolveAdapters(const std::vector<AdapterSettings>& settings,
+                                     const std::vector<NetworkLink>& links,
+                                     bool includeUnspecified,
+                                     std::vector<Adapter>& adapters);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Delete the configuration of interfaces that no longer exist
+
+                */
+                void ClearUnusedAdapters(const std::vector<NetworkLink>& links);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Remember the host name and the resolv.conf entries that a network
+                   restart may overwrite
+
+                */
+                void ReadDnsSettings();
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Point the host name at the static addresses of the adapter in /etc/hosts
+
+                */
+                void ConfigHostsEntry(const Adapter& adapter);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Write the adapter stanza to /etc/network/interfaces
+
+                   \return  False on a fatal failure
+
+                */
+                bool WriteDebianConfig(const Adapter& adapter);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Remove an interface and its subinterfaces from /etc/network/interfaces
+
+                   \return  False on a fatal failure
+
+                */
+                bool RemoveDebianInterface(const std::string& dev);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Write the ifcfg file of the adapter and /etc/sysconfig/network
+
+                   \return  False on a fatal failure
+
+                */
+                bool WriteRHELConfig(const Adapter& adapter);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Write the ifcfg and ifroute files of the adapter
+
+                   \return  False on a fatal failure
+
+                */
+                bool WriteSUSEConfig(const Adapter& adapter);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Let the DHCP client of a DHCP adapter update resolv.conf
+
+                */
+                void EnableResolvConfUpdates(const Adapter& adapter);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Bring the adapter up with its static addresses and default routes
+
+                */
+                void ApplyStaticSettings(const Adapter& adapter);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Add the name servers and search suffixes of the adapter to resolv.conf
+
+                */
+                void ConfigResolv(const Adapter& adapter);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Check that the adapter is up and has its static IPv4 address
+
+                   \return  False if it does not
+
+                */
+                bool Validate(const Adapter& adapter);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Log a warning and remember it for the result
+
+                */
+                void Warn(const std::string& message);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Prefix a system file with the root
+
+                */
+                std::string Path(const std::string& path) const;
+
+            }; // End of NetworkConfigEngine class
+
+        } // End of OSConfigurator namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* NETWORKCONFIGENGINE_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -31,6 +31,11 @@
 /*----------------------------------------------------------------------------*/
 #include <networkconfigurator.h>
 
+#include <fstream>
+
+#include <netlinkstack.h>
+#include <networkconfigengine.h>
+
 #include <isofetcher.h>
 #include <argumentmanager.h>
 #include <commandexecutor.h>
@@ -38,6 +43,9 @@
 #include <statusmessagestrings.h>
 
 using VMM::GuestAgent::Fetcher::ISOFetcher;
+using VMM::GuestAgent::OSConfigurator::AdapterSettings;
+using VMM::GuestAgent::OSConfigurator::NetlinkStack;
+using VMM::GuestAgent::OSConfigurator::NetworkConfigEngine;
 using VMM::GuestAgent::OSConfigurator::NetworkConfigurator;
 using VMM::GuestAgent::StatusManager::StatusMessage;
 using VMM::GuestAgent::Utilities::ArgumentManager;
@@ -48,17 +56,26 @@ using SCX::Util::Utf8String;
 using namespace VMM::GuestAgent::SpecializationReader;
 using namespace VMM::GuestAgent::StatusManager;
 
+const std::string StatusDir                            = "status";
+const std::string NetAdapterManifest                   = "netadapters";
+const std::string DefinedAdapters                      = "definedadapters";
+
 void NetworkConfigurator::Execute(const std::vector<OSSpecializationReader::VNetAdapter>& vNetAdapters)
 {
     
     SCX_LOGINFO(m_logHandle, ("Executing network configuration"));
 
+    std::vector<AdapterSettings> adapters;
     if (vNetAdapters.size())
     {
         std::vector<OSSpecializationReader::VNetAdapter>::const_iterator iter;
         for (iter = vNetAdapters.begin(); iter != vNetAdapters.end(); ++iter)
         {
-            ConfigureNetworkAdapter(*iter);
+            AdapterSettings settings;
+            if (GetAdapterSettings(*iter, settings))
+            {
+                adapters.push_back(settings);
+            }
         }
     }
     else
@@ -66,22 +83,68 @@ void NetworkConfigurator::Execute(const std::vector<OSSpecializationReader::VNet
         SCX_LOGINFO(m_logHandle, ("Unable to find any network configurations in configuration file."));
     }
 
+    std::string statusDir = ArgumentManager::Instance().GetVMMHome() + "/" + StatusDir + "/";
+
+    NetlinkStack stack;
+    NetworkConfigEngine engine(stack, "", statusDir + DefinedAdapters);
+    if (!stack.IsOpen() || NetworkConfigEngine::UnknownDistro == engine.GetDistro())
+    {
+        SCX_LOGWARNING(m_logHandle, ("Native network configuration unavailable, using the network scripts"));
+        ExecuteScripts(adapters, statusDir + NetAdapterManifest);
+        return;
+    }
+
     // Configure unspecified network adapters as DHCP - parity with windows agent
-    ConfigureUnspecifiedNetAdaptersForDHCP();
+    NetworkConfigEngine::Result result = engine.Configure(adapters, true);
+    if (NetworkConfigEngine::Failed == result)
+    {
+        SCX_LOGERROR(m_logHandle, "Network configuration failed. Fatal failure");
+        FailSetup();
+    }
+    else if (NetworkConfigEngine::SucceededWithWarnings == result)
+    {
+        SCX_LOGWARNING(m_logHandle, m_componentName + " completed with warnings");
+    }
+    else
+    {
+        SCX_LOGINFO(m_logHandle, "Successfully configured " + m_componentName);
+    }
 
 }
 
-void NetworkConfigurator::ConfigureUnspecifiedNetAdaptersForDHCP()
+void NetworkConfigurator::ExecuteScripts(const std::vector<AdapterSettings>& adapters,
+                                         const std::string& manifest)
 {
 
-    SCX_LOGINFO(m_logHandle, ("Configuring unspecified network adapters as DHCP"));
-    if (setenv("HISTIGNORE", "*", 1) != 0)
+    // All adapters go into one manifest so that the scripts restart the
+    // network once instead of once per adapter
+    std::ofstream fileStream(manifest.c_str(), std::ios::out | std::ios::trunc);
+    std::vector<AdapterSettings>::const_iterator iter;
+    for (iter = adapters.begin(); fileStream.is_open() && iter != adapters.end(); ++iter)
+    {
+        fileStream << FormatAdapterParams(*iter) << std::endl;
+    }
+    fileStream.close();
+    if (fileStream.fail())
     {
-        SCX_LOGERROR(m_logHandle, ("failed to set HISTIGNORE"));
+        SCX_LOGERROR(m_logHandle, "Unable to write network adapter manifest " + manifest + ". Fatal failure");
+        FailSetup();
     }
 
-    std::string command = ArgumentManager::Instance().GetVMMHome() + "/bin/cfgdynnetadapter ";
-    SCX_LOGINFO(m_logHandle, "Shell Command:" + command);
+    // Configure unspecified network adapters as DHCP - parity with windows agent
+    SCX_LOGINFO(m_logHandle, ("Adding unspecified network adapters as DHCP"));
+    RunScript("cfgdynnetadapter", manifest);
+
+    SCX_LOGINFO(m_logHandle, ("Executing network configuration script"));
+    RunScript("cfgnetadapter", manifest);
+
+}
+
+void NetworkConfigurator::RunScript(const std::string& script, const std::string& manifest)
+{
+
+    std::string command = ArgumentManager::Instance().GetVMMHome() + "/bin/" + script + " manifest=" + manifest;
+    SCX_LOGINFO(m_logHandle, ("Shell Command:") + (command));
 
     // Execute
     VMM::GuestAgent::Utilities::CommandExecutor commandExec;
@@ -89,27 +152,33 @@ void NetworkConfigurator::ConfigureUnspecifiedNetAdaptersForDHCP()
                                   m_componentName);
     if (ret < 0)
     {
-        SCX_LOGERROR(m_logHandle, ("Network configuration failed. Fatal failure"));
-        
-        StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement(StatusMessageStrings::SpecializationStatus, 
-                                                                          StatusMessageStrings::SpecializationFailed)));
-        
-        ISOFetcher::Instance().TerminateSetup();
+        SCX_LOGERROR(m_logHandle, "Network configuration failed. Fatal failure");
+        FailSetup();
     }
-    
+
+}
+
+void NetworkConfigurator::FailSetup()
+{
+
+    StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement(StatusMessageStrings::SpecializationStatus, 
+                                                                      StatusMessageStrings::SpecializationFailed)));
+
+    ISOFetcher::Instance().TerminateSetup();
+
 }
 
-void NetworkConfigurator::ConfigureNetworkAdapter(const OSSpecializationReader::VNetAdapter& netAdapter)
+bool NetworkConfigurator::GetAdapterSettings(const OSSpecializationReader::VNetAdapter& netAdapter,
+                                             AdapterSettings& settings)
 {
     
-    std::string command;
-    std::string commandParams;
+    settings = AdapterSettings();
 
     // Add MACAddress if present
     Utf8String macAddress;
     if (netAdapter.GetMACAddress(macAddress))
     {
-        commandParams.append((" macaddress=") + macAddress.Str());
+        settings.macAddress = macAddress.Str();
     }
     else
     {
@@ -125,8 +194,8 @@ void NetworkConfigurator::ConfigureNetworkAdapter(const OSSpecializationReader::
             Utf8String staticIPAddress;
             if (ipv4.GetStaticIP(staticIPAddress))
             {
-                commandParams.append(" ipv4addresstype=static");
-                commandParams.append(" ipv4address=" +  staticIPAddress.Str());
+                settings.ipv4AddressType = "static";
+                settings.ipv4Address = staticIPAddress.Str();
             }
             else
             {
@@ -135,7 +204,7 @@ void NetworkConfigurator::ConfigureNetworkAdapter(const OSSpecializationReader::
         }
         else
         {
-            commandParams.append((" ipv4addresstype=dhcp"));
+            settings.ipv4AddressType = "dhcp";
         }
     }
     else
@@ -153,8 +222,8 @@ void NetworkConfigurator::ConfigureNetworkAdapter(const OSSpecializationReader::
             Utf8String staticIPAddress;
             if (ipv6.GetStaticIP(staticIPAddress))
             {
-                commandParams.append(" ipv6addresstype=static");
-                commandParams.append(" ipv6address=" +  staticIPAddress.Str());
+                settings.ipv6AddressType = "static";
+                settings.ipv6Address = staticIPAddress.Str();
             }
             else
             {
@@ -163,7 +232,7 @@ void NetworkConfigurator::ConfigureNetworkAdapter(const OSSpecializationReader::
         }
         else
         {
-            commandParams.append((" ipv6addresstype=dhcp"));
+            settings.ipv6AddressType = "dhcp";
         }
 
     }
@@ -180,15 +249,12 @@ void NetworkConfigurator::ConfigureNetworkAdapter(const OSSpecializationReader::
         // TODO - Handle cost associated with gateways later. Need more work 
         // from the script.
         std::vector<OSSpecializationReader::Gateway>::const_iterator iter;
-        commandParams.append(" gateways=");
         for (iter = gateways.begin(); iter != gateways.end(); iter++)
         {
-            // Comma seprated gateways
             Utf8String gatewayAddress;
             if (iter->GetAddress(gatewayAddress))
             {
-                commandParams.append(gatewayAddress.Str());
-                commandParams.append(",");
+                settings.gateways.push_back(gatewayAddress.Str());
             }
         }
     }
@@ -203,12 +269,9 @@ void NetworkConfigurator::ConfigureNetworkAdapter(const OSSpecializationReader::
     {
 
         std::vector<Utf8String>::const_iterator iter;
-        commandParams.append(" nameservers=");
         for (iter = nameServers.begin(); iter != nameServers.end(); iter++)
         {
-            // Comma seprated nameservers
-            commandParams.append(iter->Str());
-            commandParams.append(",");
+            settings.nameServers.push_back(iter->Str());
         }
         
     }
@@ -222,12 +285,9 @@ void NetworkConfigurator::ConfigureNetworkAdapter(const OSSpecializationReader::
     if (dnsSuffixes.size())
     {
         std::vector<Utf8String>::const_iterator iter;
-        commandParams.append(" dnssearchsuffix=");
         for (iter = dnsSuffixes.begin(); iter != dnsSuffixes.end(); iter++)
         {
-            // Comma seprated Search sufffixes
-            commandParams.append(iter->Str());
-            commandParams.append(",");
+            settings.searchSuffixes.push_back(iter->Str());
         }
 
     }
@@ -236,31 +296,59 @@ void NetworkConfigurator::ConfigureNetworkAdapter(const OSSpecializationReader::
         SCX_LOGWARNING(m_logHandle, ("No DNS Search suffixes to configure"));
     }
 
-    // Invoke script
-    if (!commandParams.empty())
+    if (settings.macAddress.empty() && settings.ipv4AddressType.empty() && settings.ipv6AddressType.empty() &&
+        settings.gateways.empty() && settings.nameServers.empty() && settings.searchSuffixes.empty())
     {
-        SCX_LOGINFO(m_logHandle, ("Executing network configuration script"));
-        if (setenv("HISTIGNORE", "*", 1) != 0)
-        {
-            SCX_LOGERROR(m_logHandle, "failed to set HISTIGNORE");
-        }
+        SCX_LOGWARNING(m_logHandle, ("Nothing to configure for network adapter"));
+        return false;
+    }
 
-        std::string command = ArgumentManager::Instance().GetVMMHome() + "/bin/cfgnetadapter " + commandParams;
-        SCX_LOGINFO(m_logHandle, ("Shell Command:") + (command));
+    return true;
 
-        // Execute
-        VMM::GuestAgent::Utilities::CommandExecutor commandExec;
-        int ret = commandExec.Execute(SCXCoreLib::StrFromMultibyte(command),
-                                      m_componentName);
-        if (ret < 0)
-        {
-            SCX_LOGERROR(m_logHandle, "Network configuration failed. Fatal failure");
-            
-            StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement(StatusMessageStrings::SpecializationStatus, 
-                                                                              StatusMessageStrings::SpecializationFailed)));
+}
+
+std::string NetworkConfigurator::FormatAdapterParams(const AdapterSettings& settings)
+{
+
+    std::string commandParams;
+    if (!settings.macAddress.empty())
+    {
+        commandParams.append(" macaddress=" + settings.macAddress);
+    }
+    if (!settings.ipv4AddressType.empty())
+    {
+        commandParams.append(" ipv4addresstype=" + settings.ipv4AddressType);
+    }
+    if (!settings.ipv4Address.empty())
+    {
+        commandParams.append(" ipv4address=" + settings.ipv4Address);
+    }
+    if (!settings.ipv6AddressType.empty())
+    {
+        commandParams.append(" ipv6addresstype=" + settings.ipv6AddressType);
+    }
+    if (!settings.ipv6Address.empty())
+    {
+        commandParams.append(" ipv6address=" + settings.ipv6Address);
+    }
 
-            ISOFetcher::Instance().TerminateSetup();
+    // Comma separated lists
+    const std::vector<std::string>* lists[] = { &settings.gateways, &settings.nameServers, &settings.searchSuffixes };
+    const char* names[] = { " gateways=", " nameservers=", " dnssearchsuffix=" };
+    for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); ++i)
+    {
+        if (!lists[i]->empty())
+        {
+            commandParams.append(names[i]);
+            std::vector<std::string>::const_iterator iter;
+            for (iter = lists[i]->begin(); iter != lists[i]->end(); ++iter)
+            {
+                commandParams.append(*iter + ",");
+            }
         }
     }
 
+    // The scripts read one adapter per line
+    return commandParams.empty() ? commandParams : commandParams.substr(1);
+
 }
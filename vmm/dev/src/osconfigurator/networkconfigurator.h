@@ -34,6 +34,7 @@
 
 #include <util/LogHandleCache.h>
 
+#include <networkconfigengine.h>
 #include <osconfigurator.h>
 #include <osspecializationreader.h>
 
@@ -93,7 +94,31 @@ namespace VMM
 
                 /*----------------------------------------------------------------------------*/
                 /**
-                   Function that invokes the networkconfig script
+                   Identify the configurator
+
+                   \return  Id of the configurator
+                */
+                inline ConfiguratorId GetId() const
+                {
+                    return NetworkConfiguratorId;
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   The network scripts pick up the host and domain name
+
+                   \param  dependencies    Receives the ids of the prerequisites
+                */
+                inline void GetDependencies(ConfiguratorIds& dependencies) const
+                {
+                    dependencies.clear();
+                    dependencies.push_back(HostDomainConfiguratorId);
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Function that configures all adapters with a single network restart,
+                   natively where possible and through the networkconfig scripts otherwise
 
                    \return     None
 
@@ -104,26 +129,64 @@ namespace VMM
             private:
                 /*----------------------------------------------------------------------------*/
                 /**
-                   Helper function that configures one network adapter configuration
+                   Helper function that collects the settings of one network adapter
 
                    \param      vNetAdapter    Network Adapter object
+                   \param      settings       Receives the settings
+
+                   \return     False if there is nothing to configure for the adapter
+
+                */
+                bool GetAdapterSettings(const VMM::GuestAgent::SpecializationReader::OSSpecializationReader::VNetAdapter&
+                                        vNetAdapter, AdapterSettings& settings);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Helper function that formats adapter settings as cfgnetadapter arguments
+
+                   \param      settings    Settings of the adapter
+
+                   \return     The arguments, one manifest line
+
+                */
+                std::string FormatAdapterParams(const AdapterSettings& settings);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Helper function that configures the adapters through the network scripts,
+                   for systems the native engine does not handle
+
+                   \param      adapters    Settings of the adapters
+                   \param      manifest    Manifest file passed to the scripts
+
+                   \return     None
+
+                */
+                void ExecuteScripts(const std::vector<AdapterSettings>& adapters,
+                                    const std::string& manifest);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Helper function that runs a network script on the adapter manifest
+
+                   \param      script      Script in the bin directory
+                   \param      manifest    Manifest file with one adapter per line
 
                    \return     None
 
                 */
-                void ConfigureNetworkAdapter(const VMM::GuestAgent::SpecializationReader::OSSpecializationReader::VNetAdapter&
-                                             vNetAdapter);
+                void RunScript(const std::string& script, const std::string& manifest);
 
                 /*----------------------------------------------------------------------------*/
                 /**
-                   Helper function that configures unspecified net adapters as DHCP
+                   Helper function that records the failure and terminates the setup
 
                    \param      None   
 
                    \return     None
 
                 */
-                void ConfigureUnspecifiedNetAdaptersForDHCP();
+                void FailSetup();
                 
 
             }; // End of NetworkConfigurator class
@@ -0,0 +1,160 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        networkstack.h
+
+   \brief       Operations on the kernel network stack used by the native network
+                configuration engine. Kept behind an interface so the engine can
+                run against an in-process fake.
+
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef NETWORKSTACK_H
+#define NETWORKSTACK_H
+
+#include <string>
+#include <vector>
+
+namespace VMM
+{
+
+    namespace GuestAgent
+    {
+
+        namespace OSConfigurator
+        {
+
+            /** A network interface */
+            struct NetworkLink
+            {
+                /** Interface index */
+                int             index;
+
+                /** Interface name, e.g. eth0 */
+                std::string     name;
+
+                /** Lower case, colon separated hardware address; empty if none */
+                std::string     macAddress;
+
+                /** Is it an ethernet interface? */
+                bool            isEthernet;
+
+                /** Is the interface administratively up? */
+                bool            isUp;
+            };
+
+            /** An address assigned to an interface */
+            struct NetworkAddress
+            {
+                /** AF_INET or AF_INET6 */
+                int             family;
+
+                /** Address in presentation format */
+                std::string     address;
+
+                /** Prefix length */
+                unsigned int    prefixLength;
+            };
+
+            class NetworkStack
+            {
+
+            public:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+
+                   Virtual Destructor for NetworkStack
+
+                */
+                virtual ~NetworkStack()
+                {}
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   List all interfaces
+
+                   \param   links    Receives the interfaces
+
+                   \return  False if the interfaces could not be listed
+
+                */
+                virtual bool GetLinks(std::vector<NetworkLink>& links) = 0;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   List the addresses of an interface
+
+                   \param   index        Interface to list the addresses of
+                   \param   addresses    Receives the addresses
+
+                   \return  False if the addresses could not be listed
+
+                */
+                virtual bool GetAddresses(int index, std::vector<NetworkAddress>& addresses) = 0;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Bring an interface up
+
+                   \param   index    Interface
+
+                   \return  False on failure
+
+                */
+                virtual bool SetLinkUp(int index) = 0;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Assign an address to an interface. Assigning an address the
+                   interface already has succeeds.
+
+                   \param   index      Interface
+                   \param   address    Address to assign
+
+                   \return  False on failure
+
+                */
+                virtual bool AddAddress(int index, const NetworkAddress& address) = 0;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Make a gateway the default route of its address family, replacing
+                   the current default route
+
+                   \param   index      Interface the gateway is reached through
+                   \param   family     AF_INET or AF_INET6
+                   \param   gateway    Gateway address in presentation format
+
+                   \return  False on failure
+
+                */
+                virtual bool AddDefaultRoute(int index, int family, const std::string& gateway) = 0;
+
+            }; // End of NetworkStack class
+
+        } // End of OSConfigurator namespace
+
+    } // End of GuestAgent namespace
+
+} // End of VMM namespace
+
+#endif /* NETWORKSTACK_H */
+/*----------------------------E-N-D---O-F---F-I-L-E---------------------------*/
@@ -32,6 +32,8 @@
 #ifndef OSCONFIGURATOR_H
 #define OSCONFIGURATOR_H
 
+#include <vector>
+
 #include <osconfiguratorvisitor.h>
 
 namespace VMM
@@ -43,6 +45,21 @@ namespace VMM
         namespace OSConfigurator
         {
 
+            /** Identifies a configurator in dependency declarations */
+            enum ConfiguratorId
+            {
+                PreConfiguratorId,
+                TimeZoneConfiguratorId,
+                HostDomainConfiguratorId,
+                UsersConfiguratorId,
+                NetworkConfiguratorId,
+                RunOnceCommandConfiguratorId,
+                PostConfiguratorId
+            };
+
+            /** Dependencies of a configurator */
+            typedef std::vector<ConfiguratorId> ConfiguratorIds;
+
             class OSConfigurator
             {
 
@@ -66,6 +83,26 @@ namespace VMM
                 */
                 virtual void Accept(VMM::GuestAgent::OSConfigurator::Visitor& v) = 0;
 
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Identify the configurator - pure virtual function
+
+                   \return  Id of the configurator
+                */
+                virtual ConfiguratorId GetId() const = 0;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Configurators that must have completed before this one runs. Configurators
+                   that do not depend on each other may run concurrently.
+
+                   \param  dependencies    Receives the ids of the prerequisites
+                */
+                virtual void GetDependencies(ConfiguratorIds& dependencies) const
+                {
+                    dependencies.clear();
+                }
+
             }; // End of OSConfigurator class
 
         } // End of OSConfigurator namespace
@@ -98,6 +98,34 @@ namespace VMM
                     visitor.Visit(this);
                 }
 
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Identify the configurator
+
+                   \return  Id of the configurator
+                */
+                inline ConfiguratorId GetId() const
+                {
+                    return PostConfiguratorId;
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Post-configuration finishes the setup, so it comes after everything
+
+                   \param  dependencies    Receives the ids of the prerequisites
+                */
+                inline void GetDependencies(ConfiguratorIds& dependencies) const
+                {
+                    dependencies.clear();
+                    dependencies.push_back(PreConfiguratorId);
+                    dependencies.push_back(TimeZoneConfiguratorId);
+                    dependencies.push_back(HostDomainConfiguratorId);
+                    dependencies.push_back(UsersConfiguratorId);
+                    dependencies.push_back(NetworkConfiguratorId);
+                    dependencies.push_back(RunOnceCommandConfiguratorId);
+                }
+
                 /*----------------------------------------------------------------------------*/
                 /**
                    Function that invokes the preconfig script
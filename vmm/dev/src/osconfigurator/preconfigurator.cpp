@@ -40,6 +40,7 @@
 #include <statusmessagestrings.h>
 
 #include <scxcorelib/stringaid.h>
+#include <util/SpanTracer.h>
 
 using VMM::GuestAgent::OSConfigurator::PreConfigurator;
 using VMM::GuestAgent::Fetcher::ISOFetcher;
@@ -72,11 +73,6 @@ void PreConfigurator::Execute()
     {
         SCX_LOGINFO(m_logHandle, "Pre-Configuration was never run before");
 
-        if (setenv("HISTIGNORE", "*", 1) != 0)
-        {
-            SCX_LOGERROR(m_logHandle, "failed to set HISTIGNORE");
-        }
-
         std::string command = ArgumentManager::Instance().GetVMMHome() + "/bin/cfgpre";
         SCX_LOGINFO(m_logHandle, "Shell Command:" + command);
     
@@ -97,6 +93,10 @@ void PreConfigurator::Execute()
             // Restart
             ISOFetcher::Instance().ModifyGrub();
 
+            // The process is replaced by shutdown; write the status file now
+            StatusMessage::Instance().Flush();
+            SCX::Util::SpanTracer::Instance().Flush();
+
             char const* args[] = { "shutdown", "-r", "now", 0 };
 
             execv ("/sbin/shutdown", const_cast<char * const*>(args));
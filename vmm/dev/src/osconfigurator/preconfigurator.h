@@ -94,6 +94,17 @@ namespace VMM
                     visitor.Visit(this);
                 }
 
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Identify the configurator
+
+                   \return  Id of the configurator
+                */
+                inline ConfiguratorId GetId() const
+                {
+                    return PreConfiguratorId;
+                }
+
                 /*----------------------------------------------------------------------------*/
                 /**
                    Function that invokes the preconfig script
@@ -30,55 +30,258 @@
 */
 /*----------------------------------------------------------------------------*/
 #include <runoncecommandconfigurator.h>
+#include <argumentmanager.h>
 #include <commandexecutor.h>
+#include <statusmessage.h>
+
+#include <sstream>
+#include <vector>
+
+#include <scxcorelib/scxthreadpool.h>
+
+#include <util/SpanTracer.h>
+#include <util/XElement.h>
 
 using VMM::GuestAgent::OSConfigurator::RunOnceCommandConfigurator;
+using VMM::GuestAgent::StatusManager::StatusMessage;
+using VMM::GuestAgent::Utilities::ArgumentManager;
 using VMM::GuestAgent::Utilities::CommandExecutor;
+using VMM::GuestAgent::Utilities::LogOutputSink;
+using SCX::Util::SpanTracer;
+using SCX::Util::Xml::XElement;
+using SCX::Util::Xml::XElementPtr;
 using namespace VMM::GuestAgent::Utilities;
 
 const std::string RunOnceCommandConfiguratorComponent = "RunOnceCommandConfigurator";
 
-void RunOnceCommandConfigurator::Execute(const std::map<int, SCX::Util::Utf8String>& commands)
+// Status element reported for every command
+const std::string RunOnceCommandResult = "RunOnceCommandResult";
+const std::string AttributeSequence = "Sequence";
+const std::string AttributeExitCode = "ExitCode";
+const std::string AttributeDurationMs = "DurationMs";
+const std::string AttributeStdoutBytes = "StdoutBytes";
+const std::string AttributeStderrBytes = "StderrBytes";
+const std::string ElementStdoutTail = "StdoutTail";
+const std::string ElementStderrTail = "StderrTail";
+
+// Overrides the number of commands of a parallel group run at a time
+const std::string RunOnceConcurrencyFile = "/etc/runonceconcurrency";
+unsigned int const DefaultRunOnceConcurrency = 4;
+unsigned int const MinimumRunOnceConcurrency = 1;
+unsigned int const MaximumRunOnceConcurrency = 64;
+
+namespace
+{
+
+// Only the tail kept by the sink goes into the status report
+void AddTail(XElementPtr& result, const std::string& name, const LogOutputSink& sink)
+{
+    std::string tail = sink.GetTail();
+    if (!tail.empty())
+    {
+        XElementPtr element(new XElement(name));
+        element->SetContent(tail);
+        result->AddChild(element);
+    }
+}
+
+class RunOnceTaskParam : public SCXCoreLib::SCXThreadParam
+{
+public:
+    RunOnceTaskParam(RunOnceCommandConfigurator* configurator, int sequence, const std::string& command)
+      : m_configurator(configurator)
+      , m_sequence(sequence)
+      , m_command(command)
+    {
+    }
+
+    RunOnceCommandConfigurator*  m_configurator;
+    int                          m_sequence;
+    std::string                  m_command;
+};
+
+}
+
+void RunOnceCommandConfigurator::Execute(const std::map<int, SCX::Util::Utf8String>& commands,
+                                         const std::map<int, int>& groups)
 {
-    CommandExecutor commandExecutor;
-    int exitstatus = 0;
+    // Read the configuration once for all commands
+    m_timeout = readConfig ();
+    if (DEFAULT_TIMEOUT != m_timeout)
+    {
+        std::ostringstream strm;
+        strm << "Timeout value overridden to " << m_timeout << " seconds";
+        SCX_LOGINFO (m_logHandle, strm.str ());
+    }
+    m_outputTailBytes = CommandExecutor::ReadOutputTailBytes();
 
+    std::string concurrencyFile = ArgumentManager::Instance().GetVMMHome() + RunOnceConcurrencyFile;
+    unsigned int concurrency = readConfig (concurrencyFile.c_str(), DefaultRunOnceConcurrency,
+                                           MinimumRunOnceConcurrency, MaximumRunOnceConcurrency);
+
+    // Batches of commands in Sequence order; a parallel group forms one batch
+    // at the position of its first command
+    std::vector< std::vector<int> > batches;
+    std::map<int, size_t> groupBatches;
     for (std::map<int, SCX::Util::Utf8String>::const_iterator it = commands.begin(); it != commands.end(); ++it)
     {
-        std::ostringstream st;
-        st << it->first;
-        SCX_LOGINFO(m_logHandle, "Executing run-once command item: " +
-                    st.str() +
-                    " command: " +
-                    it->second.Str());
-
-        if (setenv("HISTIGNORE", "*", 1) != 0)
+        std::map<int, int>::const_iterator group = groups.find(it->first);
+        if (group == groups.end())
         {
-            SCX_LOGERROR(m_logHandle, "failed to set HISTIGNORE");
+            batches.push_back(std::vector<int>(1, it->first));
         }
-        std::string command = it->second.Str();
+        else if (groupBatches.find(group->second) == groupBatches.end())
+        {
+            groupBatches[group->second] = batches.size();
+            batches.push_back(std::vector<int>(1, it->first));
+        }
+        else
+        {
+            batches[groupBatches[group->second]].push_back(it->first);
+        }
+    }
 
-        unsigned int timeout = readConfig ();
-        if (DEFAULT_TIMEOUT != timeout)
+    m_failed = false;
+
+    SCXCoreLib::SCXThreadPool pool;
+    pool.SetThreadLimit(static_cast<long>(concurrency));
+    pool.Start();
+
+    for (std::vector< std::vector<int> >::const_iterator batch = batches.begin(); batch != batches.end(); ++batch)
+    {
+        if (batch->size() == 1)
         {
-            std::ostringstream strm;
-            strm << "Timeout value overridden to " << timeout << " seconds";
-            SCX_LOGINFO (m_logHandle, strm.str ());
+            RunCommandGuarded(batch->front(), commands.find(batch->front())->second.Str());
+            continue;
         }
 
-        int ret = commandExecutor.Execute(SCXCoreLib::StrFromMultibyte(command), 
-                                          RunOnceCommandConfiguratorComponent,
-                                          timeout);
+        std::ostringstream strm;
+        strm << "Running " << batch->size() << " run-once commands concurrently, at most "
+             << concurrency << " at a time";
+        SCX_LOGINFO(m_logHandle, strm.str());
 
-        if (ret != 0)
+        SCXCoreLib::SCXConditionHandle h(m_cond);
+        m_running = batch->size();
+        for (std::vector<int>::const_iterator sequence = batch->begin(); sequence != batch->end(); ++sequence)
         {
-            SCX_LOGERROR(m_logHandle, "Failed Run once command: " + command);
-            exitstatus = 1;
+            SCXCoreLib::SCXThreadParamHandle param(
+                new RunOnceTaskParam(this, *sequence, commands.find(*sequence)->second.Str()));
+            pool.QueueTask(SCXCoreLib::SCXThreadPoolTaskHandle(
+                new SCXCoreLib::SCXThreadPoolTask(RunCommandTask, param)));
+        }
+
+        while (m_running > 0)
+        {
+            h.Wait();
         }
     }
 
-    if (exitstatus == 1)
+    pool.Shutdown();
+
+    if (m_failed)
     {
         SCX_LOGWARNING(m_logHandle, ("At least one run-once command failed."));
     }
 }
+
+void RunOnceCommandConfigurator::RunCommand(int sequence, const std::string& command)
+{
+    std::ostringstream st;
+    st << sequence;
+    SCX_LOGINFO(m_logHandle, "Executing run-once command item: " +
+                st.str() +
+                " command: " +
+                command);
+
+    CommandExecutor commandExecutor(m_outputTailBytes);
+    LogOutputSink stdoutSink(commandExecutor.CreateStdoutSink(RunOnceCommandConfiguratorComponent));
+    LogOutputSink stderrSink(commandExecutor.CreateStderrSink(RunOnceCommandConfiguratorComponent));
+    scxulong startUs = SpanTracer::Now();
+
+    int ret = commandExecutor.Execute(SCXCoreLib::StrFromMultibyte(command), 
+                                      RunOnceCommandConfiguratorComponent,
+                                      stdoutSink,
+                                      stderrSink,
+                                      m_timeout);
+
+    scxulong durationMs = (SpanTracer::Now() - startUs) / 1000;
+
+    if (ret != 0)
+    {
+        SCX_LOGERROR(m_logHandle, "Failed Run once command: " + command);
+    }
+
+    std::ostringstream exitCode;
+    exitCode << ret;
+    std::ostringstream duration;
+    duration << durationMs;
+
+    XElementPtr result(new XElement(RunOnceCommandResult));
+    result->SetAttributeValue(AttributeSequence, st.str());
+    result->SetAttributeValue(AttributeExitCode, exitCode.str());
+    result->SetAttributeValue(AttributeDurationMs, duration.str());
+    result->SetAttributeValue(AttributeStdoutBytes, SCXCoreLib::StrToMultibyte(SCXCoreLib::StrFrom(stdoutSink.GetByteCount())));
+    result->SetAttributeValue(AttributeStderrBytes, SCXCoreLib::StrToMultibyte(SCXCoreLib::StrFrom(stderrSink.GetByteCount())));
+    AddTail(result, ElementStdoutTail, stdoutSink);
+    AddTail(result, ElementStderrTail, stderrSink);
+    StatusMessage::Instance().AddChildToRoot(result);
+
+    SCXCoreLib::SCXConditionHandle h(m_cond);
+    if (ret != 0)
+    {
+        m_failed = true;
+    }
+}
+
+void RunOnceCommandConfigurator::RunCommandGuarded(int sequence, const std::string& command)
+{
+    std::ostringstream st;
+    st << sequence;
+
+    // The messages leave out the command, as logging it may be what threw
+    try
+    {
+        RunCommand(sequence, command);
+        return;
+    }
+    catch (SCXCoreLib::SCXException& e)
+    {
+        SCX_LOGERROR(m_logHandle, L"Run once command item " + SCXCoreLib::StrFromMultibyte(st.str()) +
+                     L" aborted: " + e.What());
+    }
+    catch (std::exception& e)
+    {
+        SCX_LOGERROR(m_logHandle, "Run once command item " + st.str() + " aborted: " + e.what());
+    }
+    catch (...)
+    {
+        SCX_LOGERROR(m_logHandle, "Run once command item " + st.str() + " aborted by an unknown exception");
+    }
+
+    {
+        SCXCoreLib::SCXConditionHandle h(m_cond);
+        m_failed = true;
+    }
+
+    try
+    {
+        XElementPtr result(new XElement(RunOnceCommandResult));
+        result->SetAttributeValue(AttributeSequence, st.str());
+        result->SetAttributeValue(AttributeExitCode, "-1");
+        StatusMessage::Instance().AddChildToRoot(result);
+    }
+    catch (...)
+    {
+        SCX_LOGERROR(m_logHandle, "Unable to report the result of run once command item " + st.str());
+    }
+}
+
+void RunOnceCommandConfigurator::RunCommandTask(SCXCoreLib::SCXThreadParamHandle& param)
+{
+    RunOnceTaskParam* p = static_cast<RunOnceTaskParam*>(param.GetData());
+    p->m_configurator->RunCommandGuarded(p->m_sequence, p->m_command);
+
+    SCXCoreLib::SCXConditionHandle h(p->m_configurator->m_cond);
+    --p->m_configurator->m_running;
+    h.Signal();
+}
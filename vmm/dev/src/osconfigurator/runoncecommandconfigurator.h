@@ -33,6 +33,10 @@
 #define RUNONCECOMMANDCONFIGURATOR_H
 
 #include <map>
+#include <string>
+
+#include <scxcorelib/scxcondition.h>
+#include <scxcorelib/scxthread.h>
 
 #include <util/Unicode.h>
 
@@ -56,6 +60,52 @@ namespace VMM
                 /** Log Handle */
                 SCXCoreLib::SCXLogHandle m_logHandle;
 
+                /** Guards m_running and m_failed and signals finished commands */
+                SCXCoreLib::SCXCondition m_cond;
+
+                /** Commands of the current group still running */
+                size_t                   m_running;
+
+                /** Did a command fail? */
+                bool                     m_failed;
+
+                /** Timeout of every command in seconds */
+                unsigned int             m_timeout;
+
+                /** Bytes of stdout and stderr kept of every command */
+                size_t                   m_outputTailBytes;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Run one command and report its exit code and duration
+
+                   \param   sequence    Sequence of the command
+                   \param   command     Command line
+
+                */
+                void RunCommand(int sequence, const std::string& command);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Run one command like RunCommand, but record a failed result
+                   instead of letting an exception escape, so neither Execute nor a
+                   pool thread is left waiting for it
+
+                   \param   sequence    Sequence of the command
+                   \param   command     Command line
+
+                */
+                void RunCommandGuarded(int sequence, const std::string& command);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Thread pool entry point
+
+                   \param   param    RunOnceTaskParam of the command to run
+
+                */
+                static void RunCommandTask(SCXCoreLib::SCXThreadParamHandle& param);
+
             public:
 
                 /*----------------------------------------------------------------------------*/
@@ -67,7 +117,13 @@ namespace VMM
                 RunOnceCommandConfigurator()
                   : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
                                     "scx.vmmguestagent.osconfigurator.runoncecommandconfigurator"))
-                {}
+                  , m_running(0)
+                  , m_failed(false)
+                  , m_timeout(0)
+                  , m_outputTailBytes(0)
+                {
+                    m_cond.SetSleep(0);
+                }
 
                 /*----------------------------------------------------------------------------*/
                 /**
@@ -91,12 +147,44 @@ namespace VMM
 
                 /*----------------------------------------------------------------------------*/
                 /**
-                   Function that executes the run-once commands
+                   Identify the configurator
+
+                   \return  Id of the configurator
+                */
+                inline ConfiguratorId GetId() const
+                {
+                    return RunOnceCommandConfiguratorId;
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Run-once commands expect a fully configured system
+
+                   \param  dependencies    Receives the ids of the prerequisites
+                */
+                inline void GetDependencies(ConfiguratorIds& dependencies) const
+                {
+                    dependencies.clear();
+                    dependencies.push_back(TimeZoneConfiguratorId);
+                    dependencies.push_back(HostDomainConfiguratorId);
+                    dependencies.push_back(UsersConfiguratorId);
+                    dependencies.push_back(NetworkConfiguratorId);
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Function that executes the run-once commands in Sequence order.
+                   The commands of a parallel group run concurrently, at the position
+                   of the group's lowest Sequence, at most runonceconcurrency at a time.
+
+                   \param      commands    Commands by Sequence
+                   \param      groups      Parallel group of the commands that have one
 
                    \return     None
 
                 */
-                void Execute(const std::map<int, SCX::Util::Utf8String>& commands);
+                void Execute(const std::map<int, SCX::Util::Utf8String>& commands,
+                             const std::map<int, int>& groups);
 
 
             }; // End of RunOnceCommandConfigurator class
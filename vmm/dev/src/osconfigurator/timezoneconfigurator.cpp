@@ -0,0 +1,269 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+/**
+   \file        timezoneconfigurator.cpp
+
+   \brief       This class sets the time zone given in the XML file, mapping
+                the Windows time zone index to an Olson zone
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <timezoneconfigurator.h>
+#include <configfile.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+using VMM::GuestAgent::OSConfigurator::ConfigFile;
+using VMM::GuestAgent::OSConfigurator::TimeZoneConfigurator;
+using VMM::GuestAgent::OSConfigurator::TimeZoneMapping;
+
+namespace
+{
+
+/** Directory of the compiled zone files */
+const std::string ZoneInfoDir = "/usr/share/zoneinfo/";
+
+/**
+   Windows time zone index to Olson zone, sorted by index. This used to be
+   the tztable file read by the cfgtimezone script.
+*/
+const TimeZoneMapping Mappings[] = {
+    {   0, "GMT",                      NULL },
+    {   1, "Pacific/Samoa",            NULL },
+    {   2, "HST",                      NULL },
+    {   3, "US/Alaska",                NULL },
+    {   4, "US/Pacific",               NULL },
+    {   5, "Mexico/BajaNorte",         NULL },
+    {  10, "MST",                      NULL },
+    {  13, "Mexico/BajaSur",           NULL },
+    {  15, "US/Mountain",              NULL },
+    {  20, "US/Central",               NULL },
+    {  25, "Canada/Central",           NULL },
+    {  30, "Mexico/General",           NULL },
+    {  33, "America/Guatemala",        NULL },
+    {  35, "EST",                      NULL },
+    {  40, "US/Eastern",               NULL },
+    {  41, "America/Caracas",          NULL },
+    {  45, "America/Bogota",           NULL },
+    {  46, "America/Asuncion",         NULL },
+    {  47, "Brazil/Acre",              NULL },
+    {  50, "Canada/Atlantic",          NULL },
+    {  55, "America/Caracas",          NULL },
+    {  56, "America/Santiago",         NULL },
+    {  60, "Canada/Newfoundland",      NULL },
+    {  65, "Brazil/East",              NULL },
+    {  66, "America/Buenos_Aires",     NULL },
+    {  67, "America/Montevideo",       NULL },
+    {  70, "America/Buenos_Aires",     NULL },
+    {  73, "America/Godthab",          NULL },
+    {  75, "America/Noronha",          NULL },
+    {  80, "Atlantic/Azores",          NULL },
+    {  83, "Atlantic/Cape_Verde",      NULL },
+    {  85, "GMT",                      NULL },
+    {  90, "Greenwich",                NULL },
+    {  91, "Africa/Casablanca",        NULL },
+    {  95, "CET",                      NULL },
+    { 100, "CST6CDT",                  NULL },
+    { 105, "Europe/Brussels",          NULL },
+    { 110, "WET",                      NULL },
+    { 113, "Africa/Bangui",            NULL },
+    { 115, "EET",                      NULL },
+    { 120, "Egypt",                    NULL },
+    { 125, "Europe/Kiev",              NULL },
+    { 130, "Europe/Istanbul",          NULL },
+    { 131, "Europe/Istanbul",          NULL },
+    { 132, "Africa/Windhoek",          NULL },
+    { 133, "Europe/Istanbul",          NULL },
+    { 135, "Israel",                   NULL },
+    { 140, "Africa/Johannesburg",      NULL },
+    { 145, "Europe/Moscow",            NULL },
+    { 150, "Asia/Riyadh",              NULL },
+    { 155, "Africa/Nairobi",           NULL },
+    { 156, "Asia/Tbilisi",             NULL },
+    { 158, "Asia/Baghdad",             NULL },
+    { 160, "Asia/Tehran",              NULL },
+    { 165, "Asia/Muscat",              NULL },
+    { 166, "Indian/Mauritius",         NULL },
+    { 167, "Asia/Baku",                NULL },
+    { 170, "Asia/Baku",                NULL },
+    { 175, "Asia/Kabul",               NULL },
+    { 180, "Asia/Yekaterinburg",       NULL },
+    { 185, "Asia/Karachi",             NULL },
+    { 186, "Asia/Karachi",             NULL },
+    { 190, "Asia/Kolkata",             "Asia/Calcutta" },
+    { 193, "Asia/Kathmandu",           "Asia/Katmandu" },
+    { 195, "Asia/Dhaka",               NULL },
+    { 200, "Asia/Colombo",             NULL },
+    { 201, "Asia/Novosibirsk",         NULL },
+    { 203, "Asia/Rangoon",             NULL },
+    { 205, "Asia/Bangkok",             NULL },
+    { 207, "Asia/Krasnoyarsk",         NULL },
+    { 210, "Asia/Beijing",             "Asia/Shanghai" },
+    { 215, "Asia/Singapore",           NULL },
+    { 220, "Asia/Taipei",              NULL },
+    { 225, "Australia/Perth",          NULL },
+    { 227, "Asia/Ulaanbaatar",         NULL },
+    { 230, "Asia/Seoul",               NULL },
+    { 235, "Asia/Tokyo",               NULL },
+    { 240, "Asia/Yakutsk",             NULL },
+    { 245, "Australia/Darwin",         NULL },
+    { 250, "Australia/Adelaide",       NULL },
+    { 255, "Australia/Sydney",         NULL },
+    { 260, "Australia/Brisbane",       NULL },
+    { 265, "Australia/Hobart",         NULL },
+    { 270, "Asia/Vladivostok",         NULL },
+    { 275, "Pacific/Guam",             NULL },
+    { 280, "Asia/Magadan",             NULL },
+    { 285, "Pacific/Fiji",             NULL },
+    { 290, "Pacific/Auckland",         NULL },
+    { 291, "Asia/Kamchatka",           NULL },
+    { 300, "Pacific/Tongatapu",        NULL },
+};
+
+const size_t MappingCount = sizeof(Mappings) / sizeof(Mappings[0]);
+
+bool
+MappingBefore(const TimeZoneMapping& mapping, int id)
+{
+    return mapping.id < id;
+}
+
+bool
+IsZoneFile(const std::string& path)
+{
+    struct stat statBuff;
+    return 0 == stat(path.c_str(), &statBuff) && S_ISREG(statBuff.st_mode);
+}
+
+}
+
+const TimeZoneMapping* TimeZoneConfigurator::FindMapping(int timezoneID)
+{
+    const TimeZoneMapping* mapping = std::lower_bound(Mappings, Mappings + MappingCount, timezoneID, MappingBefore);
+    if (mapping == Mappings + MappingCount || mapping->id != timezoneID)
+    {
+        return NULL;
+    }
+    return mapping;
+}
+
+const TimeZoneMapping* TimeZoneConfigurator::GetMappings(size_t& count)
+{
+    count = MappingCount;
+    return Mappings;
+}
+
+bool TimeZoneConfigurator::Execute(const int& timezoneID)
+{
+    SCX_LOGINFO(m_logHandle, ("Executing time zone configuration"));
+
+    const TimeZoneMapping* mapping = FindMapping(timezoneID);
+    if (NULL == mapping)
+    {
+        std::ostringstream oss;
+        oss << "Unknown time zone index " << timezoneID;
+        SCX_LOGERROR(m_logHandle, oss.str());
+        return false;
+    }
+
+    std::string zone = mapping->zone;
+    if (!IsZoneFile(Path(ZoneInfoDir + zone)))
+    {
+        if (NULL == mapping->alternateZone || !IsZoneFile(Path(ZoneInfoDir + mapping->alternateZone)))
+        {
+            SCX_LOGERROR(m_logHandle, "Unable to locate time zone file for " + zone);
+            return false;
+        }
+        SCX_LOGINFO(m_logHandle, "Time zone file for " + zone + " not found, using " + mapping->alternateZone);
+        zone = mapping->alternateZone;
+    }
+
+    // A new link renamed over the old one, so /etc/localtime never goes missing
+    std::string localtime = Path("/etc/localtime");
+    std::string tempLink = localtime + ".vmmtmp";
+    unlink(tempLink.c_str());
+    if (0 != symlink((ZoneInfoDir + zone).c_str(), tempLink.c_str()) ||
+        0 != rename(tempLink.c_str(), localtime.c_str()))
+    {
+        std::ostringstream oss;
+        oss << "Failed to link /etc/localtime to " << ZoneInfoDir << zone << " errno=" << errno;
+        SCX_LOGERROR(m_logHandle, oss.str());
+        unlink(tempLink.c_str());
+        return false;
+    }
+
+    bool ok = WriteTimezoneFile(zone) && WriteClockFile(zone);
+    if (ok)
+    {
+        SCX_LOGINFO(m_logHandle, "Time zone successfully set to " + zone);
+    }
+    else
+    {
+        SCX_LOGWARNING(m_logHandle, "Time zone set to " + zone + ", but the distro time zone setting was not updated");
+    }
+    return ok;
+}
+
+bool TimeZoneConfigurator::WriteTimezoneFile(const std::string& zone)
+{
+    std::string timezoneFile = Path("/etc/timezone");
+    if (!ConfigFile::Exists(timezoneFile))
+    {
+        return true;
+    }
+
+    return ConfigFile::Replace(timezoneFile, zone + "\n");
+}
+
+bool TimeZoneConfigurator::WriteClockFile(const std::string& zone)
+{
+    std::string clockFile = Path("/etc/sysconfig/clock");
+    std::vector<std::string> lines;
+    if (!ConfigFile::ReadLines(clockFile, lines))
+    {
+        return true;
+    }
+
+    // Red Hat uses ZONE, SUSE uses TIMEZONE; other settings are kept as they are
+    bool found = false;
+    for (std::vector<std::string>::iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        std::string& line = *iter;
+        std::string::size_type start = line.find_first_not_of(" \t");
+        std::string key = std::string::npos == start ? std::string() : line.substr(start, line.find('=', start) - start);
+        if (std::string::npos != line.find('=') && ("ZONE" == key || "TIMEZONE" == key))
+        {
+            line = key + "=\"" + zone + "\"";
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        lines.push_back("ZONE=\"" + zone + "\"");
+    }
+
+    return ConfigFile::WriteLines(clockFile, lines);
+}
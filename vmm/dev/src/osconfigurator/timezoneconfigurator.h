@@ -20,8 +20,8 @@
 /**
    \file        timezoneconfigurator.h
 
-   \brief       This class provides an abstraction layer to execute time zone configuraiton
-                scripts based on the values provided in the XML file
+   \brief       This class sets the time zone given in the XML file, mapping
+                the Windows time zone index to an Olson zone
                 
    \date        06-25-2012 04:46:03
 
@@ -32,13 +32,11 @@
 #ifndef TIMEZONECONFIGURATOR_H
 #define TIMEZONECONFIGURATOR_H
 
-#include <scxcorelib/stringaid.h>
+#include <string>
 
 #include <util/LogHandleCache.h>
 
-#include <argumentmanager.h>
 #include <osconfigurator.h>
-#include <commandexecutor.h>
 
 
 namespace VMM
@@ -50,6 +48,19 @@ namespace VMM
         namespace OSConfigurator
         {
 
+            /** Olson zones of a Windows time zone index */
+            struct TimeZoneMapping
+            {
+                /** Windows time zone index, as in the specialization file */
+                int                 id;
+
+                /** Zone under /usr/share/zoneinfo */
+                const char*         zone;
+
+                /** Older name of the zone for distros without it, may be NULL */
+                const char*         alternateZone;
+            };
+
             class TimeZoneConfigurator : public VMM::GuestAgent::OSConfigurator::OSConfigurator
             {
 
@@ -61,6 +72,9 @@ namespace VMM
                 // Const strings
                 const std::string        m_componentName;
 
+                /** Directory the system files are under; empty for the running system */
+                const std::string        m_root;
+
             public:
 
                 /*----------------------------------------------------------------------------*/
@@ -68,11 +82,15 @@ namespace VMM
                    
                    Constructor for Time Zone Configurator
 
+                   \param  root    Directory the system files are under; empty for the
+                                   running system
+
                 */
-                TimeZoneConfigurator()
+                TimeZoneConfigurator(const std::string& root = std::string())
                   : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
                                 "scx.vmmguestagent.osconfigurator.timezoneconfigurator"))
                   , m_componentName("TimeZone-Configurator")
+                  , m_root(root)
                 {}
 
                 /*----------------------------------------------------------------------------*/
@@ -97,32 +115,88 @@ namespace VMM
 
                 /*----------------------------------------------------------------------------*/
                 /**
-                   Function that invokes the timezone config script
+                   Identify the configurator
 
-                   \return     None
+                   \return  Id of the configurator
+                */
+                inline ConfiguratorId GetId() const
+                {
+                    return TimeZoneConfiguratorId;
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Runs once pre-configuration is done
 
+                   \param  dependencies    Receives the ids of the prerequisites
                 */
-                inline void Execute(const int& timezoneID)
+                inline void GetDependencies(ConfiguratorIds& dependencies) const
                 {
-                    using VMM::GuestAgent::Utilities::ArgumentManager;
-                    SCX_LOGINFO(m_logHandle, ("Executing time zone configuration script"));
-                    
-                    // Construct command
-                    if (setenv("HISTIGNORE", "*", 1) != 0)
-                    {
-                        SCX_LOGERROR(m_logHandle, ("failed to set HISTIGNORE"));
-                    }
-                    std::ostringstream oss;
-                    oss << ArgumentManager::Instance().GetVMMHome() << "/bin/cfgtimezone tzid=" << timezoneID;
-
-                    SCX_LOGINFO(m_logHandle, ("Shell command:") + (oss.str()));
-                    
-                    // Use execute script
-                    VMM::GuestAgent::Utilities::CommandExecutor commandExec;
-                    commandExec.Execute(SCXCoreLib::StrFromMultibyte(oss.str()), 
-                                        m_componentName);
-                    
+                    dependencies.clear();
+                    dependencies.push_back(PreConfiguratorId);
+                }
 
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Point /etc/localtime at the zone of a Windows time zone index and
+                   record the zone in /etc/timezone or /etc/sysconfig/clock, whichever
+                   the distro has
+
+                   \param  timezoneID    Windows time zone index
+
+                   \return  False if the index is unknown, its zone is not installed,
+                            /etc/localtime could not be replaced or the distro setting
+                            could not be updated
+
+                */
+                bool Execute(const int& timezoneID);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Look up the zones of a Windows time zone index
+
+                   \param  timezoneID    Windows time zone index
+
+                   \return  The mapping, NULL if the index is unknown
+
+                */
+                static const TimeZoneMapping* FindMapping(int timezoneID);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   All known mappings, sorted by index
+
+                   \param  count    Receives the number of mappings
+
+                   \return  First mapping
+
+                */
+                static const TimeZoneMapping* GetMappings(size_t& count);
+
+            private:
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Rewrite /etc/timezone, as Debian and Ubuntu keep it
+
+                */
+                bool WriteTimezoneFile(const std::string& zone);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Set ZONE or TIMEZONE in /etc/sysconfig/clock, as Red Hat and SUSE keep it
+
+                */
+                bool WriteClockFile(const std::string& zone);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Path of a system file under the root
+
+                */
+                std::string Path(const std::string& path) const
+                {
+                    return m_root + path;
                 }
 
             }; // End of TimeZoneConfigurator class
@@ -20,7 +20,7 @@
 /**
    \file        usersconfigurator.cpp
 
-   \brief       This class provides an abstraction layer to execute user config scripts
+   \brief       This class sets the credentials of root given in the XML file
                 
    \date        07-03-2012 20:46:03
 
@@ -29,20 +29,31 @@
 */
 /*----------------------------------------------------------------------------*/
 #include <usersconfigurator.h>
+#include <configfile.h>
+
+#include <crypt.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <shadow.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
 
-#include <argumentmanager.h>
 #include <Base64Helper.h>
-#include <commandexecutor.h>
 #include <isofetcher.h>
 #include <statusmessage.h>
 #include <statusmessagestrings.h>
 
-#include <scxcorelib/stringaid.h>
-
 using VMM::GuestAgent::Fetcher::ISOFetcher;
+using VMM::GuestAgent::OSConfigurator::ConfigFile;
 using VMM::GuestAgent::OSConfigurator::UsersConfigurator;
 using VMM::GuestAgent::StatusManager::StatusMessage;
-using VMM::GuestAgent::Utilities::ArgumentManager;
 using util::Base64Helper;
 using SCX::Util::Xml::XElement;
 using SCX::Util::Xml::XElementPtr;
@@ -50,10 +61,48 @@ using SCX::Util::Utf8String;
 
 using namespace VMM::GuestAgent::StatusManager;
 
+namespace
+{
+
+/** Characters crypt accepts in a salt */
+const char SaltCharacters[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+/** Length of the salt, the most SHA-512 crypt uses */
+const size_t SaltLength = 16;
+
+/** Seconds in a day, the unit of the last change field of /etc/shadow */
+const time_t SecondsPerDay = 24 * 60 * 60;
+
+/** Overwrite a string holding a secret before it is released */
+void
+Wipe(std::string& secret)
+{
+    std::fill(secret.begin(), secret.end(), '\0');
+    secret.clear();
+}
+
+/** Split a colon separated line of /etc/passwd or /etc/shadow */
+std::vector<std::string>
+SplitFields(const std::string& line)
+{
+    std::vector<std::string> fields;
+    std::string::size_type start = 0;
+    std::string::size_type colon;
+    while (std::string::npos != (colon = line.find(':', start)))
+    {
+        fields.push_back(line.substr(start, colon - start));
+        start = colon + 1;
+    }
+    fields.push_back(line.substr(start));
+    return fields;
+}
+
+}
+
 void UsersConfigurator::Execute(const VMM::GuestAgent::SpecializationReader::OSSpecializationReader::User& user)
 {
     
-    SCX_LOGINFO(m_logHandle, "Executing users-configuration script");
+    SCX_LOGINFO(m_logHandle, "Executing users-configuration");
     
     Utf8String password;
     Utf8String sshKey;
@@ -61,8 +110,12 @@ void UsersConfigurator::Execute(const VMM::GuestAgent::SpecializationReader::OSS
     bool gotPassword = user.GetPassword(password);
     bool gotSSHKey   = user.GetSSHKey(sshKey);
     
-    std::string command;
-    
+    if (!gotPassword)
+    {
+        SCX_LOGINFO(m_logHandle, "No root user to customize");
+        return;
+    }
+
     std::vector<unsigned char> outputBuffer;
     bool ret = Base64Helper::Decode(password.Str(), outputBuffer);
     if (ret == false)
@@ -73,46 +126,197 @@ void UsersConfigurator::Execute(const VMM::GuestAgent::SpecializationReader::OSS
                                         StatusMessageStrings::SpecializationFailed)));
 
         ISOFetcher::Instance().TerminateSetup();
+        return;
     }
 
     std::string decodedPassword(outputBuffer.begin(), outputBuffer.end());
+    std::fill(outputBuffer.begin(), outputBuffer.end(), 0);
+
+    bool succeeded = SetRootPassword(decodedPassword);
+    Wipe(decodedPassword);
 
-    if (gotPassword && gotSSHKey)
+    if (succeeded && gotSSHKey && 0 != sshKey.Size())
     {
-        command = ArgumentManager::Instance().GetVMMHome() + "/bin/cfgroot pw=\"" + decodedPassword + "\" sshkey=\"" + sshKey.Str() + "\""; 
-    }  
-    else if (gotPassword && (!gotSSHKey))
+        succeeded = AddRootSSHKey(sshKey.Str());
+    }
+
+    if (!succeeded)
     {
-        command = ArgumentManager::Instance().GetVMMHome() + "/bin/cfgroot pw=\"" + decodedPassword + "\""; 
+        SCX_LOGERROR(m_logHandle, "User configuration failed. Fatal failure");
+        
+        StatusMessage::Instance().AddChildToRoot(
+            XElementPtr(new XElement(StatusMessageStrings::SpecializationStatus, 
+                                     StatusMessageStrings::SpecializationFailed)));
+
+        ISOFetcher::Instance().TerminateSetup();
     }
     
-    // Execute command
-    if (!command.empty())
+}
+
+std::string UsersConfigurator::HashPassword(const std::string& password)
+{
+    unsigned char random[SaltLength];
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0)
     {
-        if (setenv("HISTIGNORE", "*", 1) != 0)
-        {
-            SCX_LOGERROR(m_logHandle, "failed to set HISTIGNORE");
-        }
+        return std::string();
+    }
+    ssize_t got = read(fd, random, sizeof(random));
+    close(fd);
+    if (static_cast<ssize_t>(sizeof(random)) != got)
+    {
+        return std::string();
+    }
+
+    std::string setting = "$6$";
+    for (size_t i = 0; i < SaltLength; ++i)
+    {
+        setting += SaltCharacters[random[i] % (sizeof(SaltCharacters) - 1)];
+    }
+    setting += "$";
+
+    struct crypt_data data;
+    data.initialized = 0;
+    const char* hash = crypt_r(password.c_str(), setting.c_str(), &data);
+
+    // Failures give NULL or a string starting with '*', never the $6$ prefix
+    std::string result;
+    if (NULL != hash && 0 == setting.compare(0, 3, hash, 3))
+    {
+        result = hash;
+    }
+    memset(&data, 0, sizeof(data));
+    return result;
+}
 
-        // Use execute script
-        VMM::GuestAgent::Utilities::CommandExecutor commandExec;
-        int ret = commandExec.Execute(SCXCoreLib::StrFromMultibyte(command), 
-                                      m_componentName);
-        if (ret < 0)
+bool UsersConfigurator::SetRootPassword(const std::string& password)
+{
+    SCX_LOGINFO(m_logHandle, "Setting root user password");
+
+    std::string hash = HashPassword(password);
+    if (hash.empty())
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to hash the root user password");
+        return false;
+    }
+
+    // The lock is the one passwd and chpasswd take; it only covers the running system
+    if (m_root.empty() && 0 != lckpwdf())
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to lock the password files");
+        return false;
+    }
+
+    std::string shadowFile = Path("/etc/shadow");
+    std::vector<std::string> lines;
+    bool found = false;
+    if (ConfigFile::ReadLines(shadowFile, lines))
+    {
+        for (std::vector<std::string>::iterator iter = lines.begin(); iter != lines.end(); ++iter)
         {
-            SCX_LOGERROR(m_logHandle, "User configuration failed. Fatal failure");
-            
-            StatusMessage::Instance().AddChildToRoot(
-                XElementPtr(new XElement(StatusMessageStrings::SpecializationStatus, 
-                                         StatusMessageStrings::SpecializationFailed)));
+            std::vector<std::string> fields = SplitFields(*iter);
+            if (fields.size() < 3 || "root" != fields[0])
+            {
+                continue;
+            }
 
-            ISOFetcher::Instance().TerminateSetup();
+            std::ostringstream lastChange;
+            lastChange << time(NULL) / SecondsPerDay;
+            fields[1] = hash;
+            fields[2] = lastChange.str();
+
+            std::string line = fields[0];
+            for (size_t i = 1; i < fields.size(); ++i)
+            {
+                line += ":" + fields[i];
+            }
+            *iter = line;
+            found = true;
+            break;
         }
-        
     }
-    else
+
+    bool succeeded = found && ConfigFile::WriteLines(shadowFile, lines);
+    int savedErrno = errno;
+    if (m_root.empty())
+    {
+        ulckpwdf();
+    }
+
+    if (!found)
     {
-        SCX_LOGINFO(m_logHandle, "No root user to customize");
+        SCX_LOGERROR(m_logHandle, "Failed to find root user in /etc/shadow");
     }
-    
+    else if (!succeeded)
+    {
+        std::ostringstream oss;
+        oss << "Failed to set root user password errno=" << savedErrno;
+        SCX_LOGERROR(m_logHandle, oss.str());
+    }
+    return succeeded;
+}
+
+bool UsersConfigurator::AddRootSSHKey(const std::string& sshKey)
+{
+    std::string sshDir = Path(RootHome() + "/.ssh");
+    std::string keysFile = sshDir + "/authorized_keys";
+    SCX_LOGINFO(m_logHandle, "Writing ssh key to " + keysFile);
+
+    if (0 == mkdir(sshDir.c_str(), S_IRWXU))
+    {
+        // mkdir applies the umask; the directory has to be 700 either way
+        chmod(sshDir.c_str(), S_IRWXU);
+    }
+    else if (EEXIST != errno)
+    {
+        SCX_LOGWARNING(m_logHandle, "Failed to create directory " + sshDir);
+    }
+
+    // Read access for the pread of the last byte below
+    int fd = open(keysFile.c_str(), O_RDWR | O_APPEND | O_CREAT, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to write ssh key to " + keysFile);
+        return false;
+    }
+
+    // Keep the key on a line of its own if the file does not end in a newline
+    std::string data = sshKey + "\n";
+    struct stat statBuff;
+    char last = '\n';
+    if (0 == fstat(fd, &statBuff) && statBuff.st_size > 0 && 1 != pread(fd, &last, 1, statBuff.st_size - 1))
+    {
+        last = '\n';
+    }
+    if ('\n' != last)
+    {
+        data = "\n" + data;
+    }
+
+    bool succeeded = static_cast<ssize_t>(data.length()) == write(fd, data.data(), data.length());
+    if (0 != fchmod(fd, S_IRUSR | S_IWUSR))
+    {
+        SCX_LOGWARNING(m_logHandle, "Failed to set access permissions on " + keysFile);
+    }
+    succeeded = 0 == close(fd) && succeeded;
+    if (!succeeded)
+    {
+        SCX_LOGERROR(m_logHandle, "Failed to write ssh key to " + keysFile);
+    }
+    return succeeded;
+}
+
+std::string UsersConfigurator::RootHome() const
+{
+    std::vector<std::string> lines;
+    ConfigFile::ReadLines(Path("/etc/passwd"), lines);
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        std::vector<std::string> fields = SplitFields(*iter);
+        if (fields.size() >= 6 && "root" == fields[0] && !fields[5].empty())
+        {
+            return fields[5];
+        }
+    }
+    return "/root";
 }
@@ -20,7 +20,7 @@
 /**
    \file        usersconfigurator.h
 
-   \brief       This class provides an abstraction layer to execute user config scripts
+   \brief       This class sets the credentials of root given in the XML file
                 
    \date        06-25-2012 04:46:03
 
@@ -31,13 +31,12 @@
 #ifndef USERSCONFIGURATOR_H
 #define USERSCONFIGURATOR_H
 
-#include <scxcorelib/stringaid.h>
-
 #include <util/LogHandleCache.h>
 #include <osconfigurator.h>
-#include <commandexecutor.h>
 #include <osspecializationreader.h>
 
+#include <string>
+
 namespace VMM
 {
 
@@ -58,18 +57,69 @@ namespace VMM
                 /** Const strings */
                 const std::string        m_componentName;
 
+                /** Directory the system files are under; empty for the running system */
+                const std::string        m_root;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Set the password of root in /etc/shadow, holding the shadow lock
+
+                   \param      password    Password in clear text
+
+                */
+                bool SetRootPassword(const std::string& password);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Append an SSH key to authorized_keys in the home of root
+
+                */
+                bool AddRootSSHKey(const std::string& sshKey);
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Home directory of root from /etc/passwd, /root if it has none
+
+                */
+                std::string RootHome() const;
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Path of a system file under the root
+
+                */
+                std::string Path(const std::string& path) const
+                {
+                    return m_root + path;
+                }
+
             public:
 
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Hash a password with SHA-512 crypt and a random salt
+
+                   \param      password    Password in clear text
+
+                   \return     Hash in the $6$ format of /etc/shadow, empty on failure
+
+                */
+                static std::string HashPassword(const std::string& password);
+
                 /*----------------------------------------------------------------------------*/
                 /**
                    
                    Constructor for Users-Configurator
 
+                   \param  root    Directory the system files are under; empty for the
+                                   running system
+
                 */
-                UsersConfigurator()
+                UsersConfigurator(const std::string& root = std::string())
                   : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
                                 "scx.vmmguestagent.osconfigurator.usersconfigurator"))
                   , m_componentName("User-Configurator")
+                  , m_root(root)
                 {}
 
                 /*----------------------------------------------------------------------------*/
@@ -94,7 +144,31 @@ namespace VMM
 
                 /*----------------------------------------------------------------------------*/
                 /**
-                   Function that invokes the users config script
+                   Identify the configurator
+
+                   \return  Id of the configurator
+                */
+                inline ConfiguratorId GetId() const
+                {
+                    return UsersConfiguratorId;
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Runs once pre-configuration is done
+
+                   \param  dependencies    Receives the ids of the prerequisites
+                */
+                inline void GetDependencies(ConfiguratorIds& dependencies) const
+                {
+                    dependencies.clear();
+                    dependencies.push_back(PreConfiguratorId);
+                }
+
+                /*----------------------------------------------------------------------------*/
+                /**
+                   Set the password and SSH key of root; failing to set the password
+                   fails the specialization
 
                    \param      user    User object that has to be applied
 
@@ -0,0 +1,502 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+        \file        osspecializationbinder.cpp
+
+        \brief       Binds the specialization XML into the OSSpecializationReader
+                     classes in a single pass over the parser events
+
+        \date        10-17-26 20:00:00
+
+*/
+/*----------------------------------------------------------------------------*/
+
+#include <osspecializationbinder.h>
+#include <osspecializationparserexception.h>
+
+#include <util/LogHandleCache.h>
+#include <util/XElement.h>
+#include <util/XMLReader.h>
+#include <util/XMLWriter.h>
+
+#include <ctype.h>
+#include <sstream>
+
+
+using namespace std;
+using namespace VMM::GuestAgent::SpecializationReader::Binding;
+
+using SCX::Util::LogHandleCache;
+using SCX::Util::Utf8String;
+using SCX::Util::Xml::CXElement;
+using SCX::Util::Xml::XMLReader;
+using SCX::Util::Xml::XML_Event;
+using SCX::Util::Xml::XmlException;
+
+using VMM::GuestAgent::SpecializationReader::Optional;
+using VMM::GuestAgent::SpecializationReader::OptionalString;
+using VMM::GuestAgent::SpecializationReader::OSSpecializationBinder;
+using VMM::GuestAgent::SpecializationReader::OSSpecializationParserException;
+using VMM::GuestAgent::SpecializationReader::OSSpecializationReader;
+
+namespace
+{
+    // Messages XElement::Load raised for input it did not accept
+    const char* const c_InputEmpty = "The input xml string is empty";
+    const char* const c_EmptyName = "The Element name is empty";
+    const char* const c_EmptyAttributeName = "The Attribute name cannot be negative";
+    const char* const c_InvalidName = "The name is not valid XML name";
+
+    // XElement accepts fewer names than the reader does; these are its rules
+    inline bool IsNameStartChar(char c)
+    {
+        return ((isalpha(c) || c == '_') || c == '?');
+    }
+
+    inline bool IsNameChar(char c)
+    {
+        return ((IsNameStartChar(c) || isdigit(c) || c == '-' || c =='.' || c == ':'));
+    }
+
+    bool IsValidName(const Utf8String& name)
+    {
+        if (name.Empty() || !IsNameStartChar(static_cast<char>(name[0])))
+        {
+            return false;
+        }
+
+        for (size_t pos = 1; pos < name.size(); pos++)
+        {
+            if (!IsNameChar(static_cast<char>(name[pos])))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Keep a field only if the element read set it
+    void MergeField(OptionalString& to, OptionalString& from)
+    {
+        if (from.IsValid())
+        {
+            to = from;
+        }
+    }
+}
+
+OSSpecializationBinder::OSSpecializationBinder() :
+    m_logHandle(LogHandleCache::Instance().GetLogHandle("scx.vmmguestagent.osspecializationreader")),
+    m_specialization(NULL),
+    m_depth(0),
+    m_rootFound(false),
+    m_failed(false),
+    m_userIsRoot(false)
+{
+}
+
+void OSSpecializationBinder::Bind(const Utf8String& xmlString, OSSpecializationReader::LinuxOSSpecialization& specialization)
+{
+    if (xmlString.Empty())
+    {
+        throw XmlException(c_InputEmpty, xmlString);
+    }
+
+    m_specialization = &specialization;
+    m_depth = 0;
+    m_rootFound = false;
+    m_failed = false;
+
+    XMLReader reader;
+    XML_Event event;
+
+    reader.XML_Init(true);
+    reader.XML_SetText(xmlString);
+
+    while (reader.XML_NextEvent(event) == 0)
+    {
+        switch (event.type)
+        {
+            case SCX::Util::Xml::XML_EVENT_START:
+                Start(event.name);
+                break;
+            case SCX::Util::Xml::XML_EVENT_ATTRIBUTE:
+                Attribute(event.name, event.value);
+                break;
+            case SCX::Util::Xml::XML_EVENT_TEXT:
+                if (!m_failed && m_depth > 0)
+                {
+                    // Only bound and serialized elements need their content
+                    Frame& frame = m_frames[m_depth - 1];
+                    if (FieldNone != frame.field || frame.capture)
+                    {
+                        frame.content = event.value;
+                    }
+                }
+                break;
+            case SCX::Util::Xml::XML_EVENT_END:
+                End();
+                break;
+        }
+    }
+
+    if (reader.XML_GetError())
+    {
+        throw XmlException(reader.XML_GetErrorMessage(), xmlString);
+    }
+
+    if (m_failed)
+    {
+        SCX_LOGERROR(m_logHandle, m_failLog);
+        throw OSSpecializationParserException(m_failMessage);
+    }
+
+    if (!m_rootFound)
+    {
+        SCX_LOGERROR(m_logHandle, "OSSpecializationReader::ParseChildNodes, null m_pXElementRoot");
+        throw OSSpecializationParserException("null m_pXElementRoot");
+    }
+}
+
+OSSpecializationBinder::Frame& OSSpecializationBinder::Push(const Utf8String& name)
+{
+    if (m_depth == m_frames.size())
+    {
+        m_frames.push_back(Frame());
+    }
+
+    Frame& frame = m_frames[m_depth++];
+    frame.tag = TagNone;
+    frame.type = TypeNone;
+    frame.field = FieldNone;
+    frame.target = NULL;
+    frame.name = name;
+    frame.content.Clear();
+    frame.attributeMask = 0;
+    frame.capture = false;
+    frame.captureAttributes.clear();
+    frame.xml.Clear();
+    frame.deferUnexpected = false;
+    frame.unexpected.Clear();
+    frame.unexpectedLog.clear();
+    frame.count = 0;
+    return frame;
+}
+
+void OSSpecializationBinder::Start(const Utf8String& name)
+{
+    if (name.Empty())
+    {
+        throw XmlException(c_EmptyName, name);
+    }
+    if (!IsValidName(name))
+    {
+        throw XmlException(c_InvalidName, name);
+    }
+
+    Frame& child = Push(name);
+    if (m_failed)
+    {
+        return;
+    }
+
+    if (1 == m_depth)
+    {
+        m_rootFound = true;
+        child.tag = LookupTag(name);
+        if (RootTag != child.tag)
+        {
+            Fail("Unrecognized XML Root element: " + name.Str(),
+                 "Unrecognized root element" + string(GetTagName(RootTag)));
+            return;
+        }
+
+        child.type = RootType;
+        child.target = m_specialization;
+        return;
+    }
+
+    Frame& parent = m_frames[m_depth - 2];
+    child.capture = parent.capture;
+    if (TypeNone != parent.type)
+    {
+        child.tag = LookupTag(name);
+        BindStart(parent, child);
+    }
+}
+
+void OSSpecializationBinder::Attribute(const Utf8String& name, const Utf8String& value)
+{
+    if (name.Empty())
+    {
+        throw XmlException(c_EmptyAttributeName, name);
+    }
+    if (!IsValidName(name))
+    {
+        throw XmlException(c_InvalidName, name);
+    }
+
+    if (m_failed || 0 == m_depth)
+    {
+        return;
+    }
+
+    Frame& frame = m_frames[m_depth - 1];
+    if (frame.capture)
+    {
+        frame.captureAttributes[name] = value;
+    }
+    if (TypeNone != frame.type)
+    {
+        Tag tag = LookupTag(name);
+        if (TagNone != tag)
+        {
+            BindAttribute(frame, tag, value);
+        }
+    }
+}
+
+void OSSpecializationBinder::End()
+{
+    if (!m_failed && m_depth > 1)
+    {
+        Frame& child = m_frames[m_depth - 1];
+        Frame& parent = m_frames[m_depth - 2];
+
+        if (child.capture)
+        {
+            if (parent.capture)
+            {
+                AppendElement(parent.xml, child);
+            }
+            else
+            {
+                Utf8String section;
+                AppendElement(section, child);
+                child.xml.swap(section);
+            }
+        }
+
+        if (TypeNone != parent.type)
+        {
+            BindEnd(parent, child);
+        }
+    }
+
+    m_depth--;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+    Serialize an element as XElement::ToString does: attributes sorted by name,
+    the content ahead of the children, and no separators
+*/
+void OSSpecializationBinder::AppendElement(Utf8String& out, const Frame& frame) const
+{
+    out += "<";
+    out += frame.name;
+
+    for (map<Utf8String, Utf8String>::const_iterator it = frame.captureAttributes.begin();
+         it != frame.captureAttributes.end();
+         ++it)
+    {
+        out += " ";
+        out += it->first;
+        out += "=\"";
+        CXElement::EncodeText(out, it->second);
+        out += "\"";
+    }
+
+    if (frame.content.Empty() && frame.xml.Empty())
+    {
+        out += "/>";
+        return;
+    }
+
+    out += ">";
+    CXElement::EncodeText(out, frame.content);
+    out += frame.xml;
+    out += "</";
+    out += frame.name;
+    out += ">";
+}
+
+void OSSpecializationBinder::Unexpected(Frame& parent, const Frame& child, const char* log)
+{
+    if (parent.deferUnexpected)
+    {
+        if (parent.unexpected.Empty())
+        {
+            parent.unexpected = child.name;
+            parent.unexpectedLog = log;
+        }
+        return;
+    }
+
+    Fail(log + child.name.Str(), "unexpected tag encountered: " + child.name.Str());
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+    Record the first validation error and stop binding; the rest of the
+    document is still read to find out whether it is well formed
+*/
+void OSSpecializationBinder::Fail(const string& log, const string& message)
+{
+    if (!m_failed)
+    {
+        m_failed = true;
+        m_failLog = log;
+        m_failMessage = message;
+    }
+}
+
+void OSSpecializationBinder::BeginUsers(Frame& parent, Frame& child)
+{
+    (void) parent;
+
+    static_cast<OSSpecializationReader::OSConfiguration*>(child.target)->m_root.IsValid() = false;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+    Only the root user is kept, so the tags of the other users are not checked
+*/
+void OSSpecializationBinder::BeginUser(Frame& parent, Frame& child)
+{
+    (void) parent;
+
+    m_user = OSSpecializationReader::User();
+    m_userIsRoot = false;
+    child.target = &m_user;
+    child.deferUnexpected = true;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+    As in the tree reader, the first UserName decides whether the user is
+    root, and a later one only renames it. Every root user is read into the
+    same root user, so an element a later one lacks keeps its earlier value.
+*/
+void OSSpecializationBinder::EndUser(Frame& parent, Frame& child)
+{
+    if (0 == child.count)
+    {
+        Fail("unexpected tag encountered when looking for value \"Name\"",
+             "unexpected tag encountered when looking for value \"Name\"");
+        return;
+    }
+
+    if (m_userIsRoot)
+    {
+        if (!child.unexpected.Empty())
+        {
+            Fail(child.unexpectedLog + child.unexpected.Str(), "unexpected tag encountered: " + child.unexpected.Str());
+            return;
+        }
+
+        Optional<OSSpecializationReader::User>& root =
+            static_cast<OSSpecializationReader::OSConfiguration*>(parent.target)->m_root;
+        root.IsValid() = true;
+        MergeField(root.inner().m_userName, m_user.m_userName);
+        MergeField(root.inner().m_password, m_user.m_password);
+        MergeField(root.inner().m_sshKey, m_user.m_sshKey);
+        MergeField(root.inner().m_UID, m_user.m_UID);
+        MergeField(root.inner().m_groupID, m_user.m_groupID);
+        MergeField(root.inner().m_primaryGroup, m_user.m_primaryGroup);
+    }
+}
+
+void OSSpecializationBinder::EndUserName(Frame& parent, Frame& child)
+{
+    if (0 == parent.count++)
+    {
+        m_userIsRoot = child.content.Str() == "root";
+    }
+}
+
+void OSSpecializationBinder::EndRunOnceCommand(Frame& parent, Frame& child)
+{
+    OSSpecializationReader::OSConfiguration* configuration = static_cast<OSSpecializationReader::OSConfiguration*>(parent.target);
+
+    Utf8String sequenceVal;
+    if (!child.GetAttribute(AttributeRunOnceCommandSequence, sequenceVal))
+    {
+        SCX_LOGERROR(m_logHandle, "required Sequence attribute missing in ReadRunOnceCommands: " + child.name.Str());
+        return;
+    }
+
+    int sequence = 0;
+    istringstream ( sequenceVal.Str() ) >> sequence;
+
+    if (configuration->RunOnceCommands.find(sequence) != configuration->RunOnceCommands.end())
+    {
+        SCX_LOGERROR(m_logHandle, "duplicate Sequence attribute encountered in ReadRunOnceCommands: " + child.name.Str());
+        return;
+    }
+
+    configuration->RunOnceCommands[sequence] = child.content;
+
+    SCX_LOGTRACE(m_logHandle, "Run Once Command read as: " + child.content.Str());
+
+    Utf8String groupVal;
+    if (child.GetAttribute(AttributeRunOnceCommandParallelGroup, groupVal))
+    {
+        int group = 0;
+        istringstream ( groupVal.Str() ) >> group;
+        configuration->RunOnceCommandGroups[sequence] = group;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+    The static address is only read for STATIC, and only from the first StaticIP
+*/
+void OSSpecializationBinder::BeginStaticIP(Frame& parent, Frame& child)
+{
+    OSSpecializationReader::NetworkProperties* properties = static_cast<OSSpecializationReader::NetworkProperties*>(parent.target);
+
+    if (!properties->m_isStatic || parent.count++ > 0)
+    {
+        child.type = TypeNone;
+        child.target = NULL;
+    }
+}
+
+void OSSpecializationBinder::OnAddressType(Frame& frame, AddressType addressType, const Utf8String& value)
+{
+    OSSpecializationReader::NetworkProperties* properties = static_cast<OSSpecializationReader::NetworkProperties*>(frame.target);
+
+    switch (addressType)
+    {
+        case AddressTypeSTATIC:
+            properties->m_isStatic = true;
+            SCX_LOGTRACE(m_logHandle, "IP Address is STATIC");
+            break;
+        case AddressTypeDHCP:
+            properties->m_isStatic = false;
+            SCX_LOGTRACE(m_logHandle, "IP Address is DHCP");
+            break;
+        case AddressTypeNone:
+            Fail("invalid address type value within NetworkProperties::Read :" + value.Str(),
+                 "unexpected attribute value encountered: " + value.Str());
+            break;
+    }
+}
@@ -0,0 +1,686 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+        \file        osspecializationbinding.cpp
+
+        \brief       Dispatch of OSSpecializationBinder on the names of
+                     LinuxOSSpecialization.xsd
+
+        Generated by xsdbindgen from LinuxOSSpecialization.xsd; do not edit, run
+        "make gen" in dev/tools/xsdbindgen instead.  @migen@
+
+*/
+/*----------------------------------------------------------------------------*/
+
+#include <osspecializationbinder.h>
+
+#include <sstream>
+
+
+using namespace VMM::GuestAgent::SpecializationReader::Binding;
+
+using SCX::Util::Utf8String;
+
+using VMM::GuestAgent::SpecializationReader::OSSpecializationBinder;
+using VMM::GuestAgent::SpecializationReader::OSSpecializationReader;
+
+namespace
+{
+    // Names by tag
+    const char* const c_TagNames[TagCount] =
+    {
+        "Address",
+        "AddressType",
+        "AgentVersion",
+        "DNSDomainName",
+        "DNSSearchSuffix",
+        "DNSSearchSuffixes",
+        "Gateway",
+        "Gateways",
+        "GroupID",
+        "HostName",
+        "IPV4Property",
+        "IPV6Property",
+        "LinuxOSSpecialization",
+        "MACAddress",
+        "Metric",
+        "NameServer",
+        "NameServers",
+        "OSConfiguration",
+        "ParallelGroup",
+        "Password",
+        "PrimaryGroup",
+        "RunOnceCommand",
+        "RunOnceCommands",
+        "SSHKey",
+        "SchemaVersion",
+        "Sequence",
+        "StaticIP",
+        "TimeZone",
+        "UID",
+        "User",
+        "UserName",
+        "Users",
+        "VNetAdapter",
+        "VNetAdapters",
+    };
+
+    const size_t c_TagLengths[TagCount] =
+    {
+        7,
+        11,
+        12,
+        13,
+        15,
+        17,
+        7,
+        8,
+        7,
+        8,
+        12,
+        12,
+        21,
+        10,
+        6,
+        10,
+        11,
+        15,
+        13,
+        8,
+        12,
+        14,
+        15,
+        6,
+        13,
+        8,
+        8,
+        8,
+        3,
+        4,
+        8,
+        5,
+        11,
+        12,
+    };
+
+    // Perfect hash of the names: no two names share a slot, which holds the tag + 1
+    const unsigned int c_TagSeed = 0x2d786f64u;
+    const unsigned int c_TagSlotMask = 63;
+    const unsigned char c_TagSlots[64] =
+    {
+        0, 0, 0, 0, 0, 0, 34, 28, 16, 1, 0, 24, 5, 18, 0, 15,
+        4, 19, 20, 29, 12, 23, 0, 11, 0, 0, 14, 0, 8, 0, 9, 27,
+        3, 2, 7, 0, 0, 25, 33, 0, 0, 26, 0, 0, 17, 0, 0, 22,
+        0, 13, 30, 21, 0, 0, 0, 0, 31, 0, 0, 0, 32, 0, 6, 10
+    };
+
+    inline unsigned int HashName(const Utf8String& name)
+    {
+        unsigned int hash = c_TagSeed;
+        for (size_t i = 0; i < name.size(); i++)
+        {
+            hash = (hash ^ name[i]) * 16777619u;
+        }
+        return hash ^ (hash >> 16);
+    }
+
+    bool Equals(const Utf8String& name, const char* str, size_t length)
+    {
+        if (name.size() != length)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < length; i++)
+        {
+            if (name[i] != static_cast<unsigned char>(str[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+Tag VMM::GuestAgent::SpecializationReader::Binding::LookupTag(const Utf8String& name)
+{
+    unsigned int slot = c_TagSlots[HashName(name) & c_TagSlotMask];
+    if (0 == slot || !Equals(name, c_TagNames[slot - 1], c_TagLengths[slot - 1]))
+    {
+        return TagNone;
+    }
+    return static_cast<Tag>(slot - 1);
+}
+
+const char* VMM::GuestAgent::SpecializationReader::Binding::GetTagName(Tag tag)
+{
+    return c_TagNames[tag];
+}
+
+AddressType VMM::GuestAgent::SpecializationReader::Binding::LookupAddressType(const Utf8String& value)
+{
+    if (Equals(value, "DHCP", 4))
+    {
+        return AddressTypeDHCP;
+    }
+    if (Equals(value, "STATIC", 6))
+    {
+        return AddressTypeSTATIC;
+    }
+    return AddressTypeNone;
+}
+
+void OSSpecializationBinder::BindStart(Frame& parent, Frame& child)
+{
+    switch (parent.type)
+    {
+        case TypeLinuxOSSpecialization:
+            {
+                OSSpecializationReader::LinuxOSSpecialization* target = static_cast<OSSpecializationReader::LinuxOSSpecialization*>(parent.target);
+                switch (child.tag)
+                {
+                    case TagSchemaVersion:
+                        child.field = FieldLinuxOSSpecializationSchemaVersion;
+                        break;
+                    case TagAgentVersion:
+                        child.field = FieldLinuxOSSpecializationAgentVersion;
+                        break;
+                    case TagOSConfiguration:
+                        child.field = FieldLinuxOSSpecializationOSConfiguration;
+                        child.type = TypeOSConfiguration;
+                        target->m_osConfiguration.IsValid() = true;
+                        child.target = &target->m_osConfiguration.inner();
+                        break;
+                    default:
+                        Unexpected(parent, child, "Unexpected tag encountered in LinuxOSSpecialization :");
+                        break;
+                }
+            }
+            break;
+        case TypeOSConfiguration:
+            {
+                OSSpecializationReader::OSConfiguration* target = static_cast<OSSpecializationReader::OSConfiguration*>(parent.target);
+                child.capture = true;
+                switch (child.tag)
+                {
+                    case TagHostName:
+                        child.field = FieldOSConfigurationHostName;
+                        break;
+                    case TagDNSDomainName:
+                        child.field = FieldOSConfigurationDNSDomainName;
+                        break;
+                    case TagTimeZone:
+                        child.field = FieldOSConfigurationTimeZone;
+                        break;
+                    case TagVNetAdapters:
+                        child.field = FieldOSConfigurationVNetAdapters;
+                        child.type = TypeVNetAdapters;
+                        target->VNetAdapters.clear();
+                        child.target = &target->VNetAdapters;
+                        break;
+                    case TagUsers:
+                        child.field = FieldOSConfigurationUsers;
+                        child.type = TypeUsers;
+                        child.target = parent.target;
+                        BeginUsers(parent, child);
+                        break;
+                    case TagRunOnceCommands:
+                        child.field = FieldOSConfigurationRunOnceCommands;
+                        child.type = TypeRunOnceCommands;
+                        child.target = parent.target;
+                        break;
+                    default:
+                        Unexpected(parent, child, "Unexpected tag encountered in OSConfiguration :");
+                        break;
+                }
+            }
+            break;
+        case TypeVNetAdapters:
+            {
+                std::vector<OSSpecializationReader::VNetAdapter >* target = static_cast<std::vector<OSSpecializationReader::VNetAdapter >*>(parent.target);
+                switch (child.tag)
+                {
+                    case TagVNetAdapter:
+                        child.field = FieldVNetAdaptersVNetAdapter;
+                        child.type = TypeVNetAdapter;
+                        target->push_back(OSSpecializationReader::VNetAdapter());
+                        child.target = &target->back();
+                        break;
+                    default:
+                        Unexpected(parent, child, "invalid tag encountered in ReadVNetAdapters: ");
+                        break;
+                }
+            }
+            break;
+        case TypeVNetAdapter:
+            {
+                OSSpecializationReader::VNetAdapter* target = static_cast<OSSpecializationReader::VNetAdapter*>(parent.target);
+                switch (child.tag)
+                {
+                    case TagMACAddress:
+                        child.field = FieldVNetAdapterMACAddress;
+                        break;
+                    case TagIPV4Property:
+                        child.field = FieldVNetAdapterIPV4Property;
+                        child.type = TypeNetworkProperties;
+                        target->m_ipV4.IsValid() = true;
+                        child.target = &target->m_ipV4.inner();
+                        break;
+                    case TagIPV6Property:
+                        child.field = FieldVNetAdapterIPV6Property;
+                        child.type = TypeNetworkProperties;
+                        target->m_ipV6.IsValid() = true;
+                        child.target = &target->m_ipV6.inner();
+                        break;
+                    case TagNameServers:
+                        child.field = FieldVNetAdapterNameServers;
+                        child.type = TypeNameServers;
+                        target->NameServers.clear();
+                        child.target = &target->NameServers;
+                        break;
+                    case TagGateways:
+                        child.field = FieldVNetAdapterGateways;
+                        child.type = TypeGateways;
+                        target->Gateways.clear();
+                        child.target = &target->Gateways;
+                        break;
+                    case TagDNSSearchSuffixes:
+                        child.field = FieldVNetAdapterDNSSearchSuffixes;
+                        child.type = TypeDNSSearchSuffixes;
+                        target->DNSSearchSuffixes.clear();
+                        child.target = &target->DNSSearchSuffixes;
+                        break;
+                    default:
+                        Unexpected(parent, child, "invalid tag encountered in ReadRunOnceCommands: ");
+                        break;
+                }
+            }
+            break;
+        case TypeNetworkProperties:
+            {
+                switch (child.tag)
+                {
+                    case TagStaticIP:
+                        child.field = FieldNetworkPropertiesStaticIP;
+                        child.type = TypeStaticNetworkProperties;
+                        child.target = parent.target;
+                        BeginStaticIP(parent, child);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            break;
+        case TypeStaticNetworkProperties:
+            {
+                switch (child.tag)
+                {
+                    case TagAddress:
+                        child.field = FieldStaticNetworkPropertiesAddress;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            break;
+        case TypeNameServers:
+            {
+                switch (child.tag)
+                {
+                    case TagNameServer:
+                        child.field = FieldNameServersNameServer;
+                        break;
+                    default:
+                        Unexpected(parent, child, "invalid tag encountered while reading NameServers: ");
+                        break;
+                }
+            }
+            break;
+        case TypeGateways:
+            {
+                std::vector<OSSpecializationReader::Gateway >* target = static_cast<std::vector<OSSpecializationReader::Gateway >*>(parent.target);
+                switch (child.tag)
+                {
+                    case TagGateway:
+                        child.field = FieldGatewaysGateway;
+                        child.type = TypeGateway;
+                        target->push_back(OSSpecializationReader::Gateway());
+                        child.target = &target->back();
+                        break;
+                    default:
+                        Unexpected(parent, child, "invalid tag encountered within ReadGateways: ");
+                        break;
+                }
+            }
+            break;
+        case TypeGateway:
+            {
+                switch (child.tag)
+                {
+                    case TagAddress:
+                        child.field = FieldGatewayAddress;
+                        break;
+                    case TagMetric:
+                        child.field = FieldGatewayMetric;
+                        break;
+                    default:
+                        Unexpected(parent, child, "invalid tag encountered within Gateway::Read: ");
+                        break;
+                }
+            }
+            break;
+        case TypeDNSSearchSuffixes:
+            {
+                switch (child.tag)
+                {
+                    case TagDNSSearchSuffix:
+                        child.field = FieldDNSSearchSuffixesDNSSearchSuffix;
+                        break;
+                    default:
+                        Unexpected(parent, child, "invalid tag encountered while reading DNSSearchSuffixes: ");
+                        break;
+                }
+            }
+            break;
+        case TypeUsers:
+            {
+                switch (child.tag)
+                {
+                    case TagUser:
+                        child.field = FieldUsersUser;
+                        child.type = TypeUser;
+                        BeginUser(parent, child);
+                        break;
+                    default:
+                        Unexpected(parent, child, "Expecting tag value \"User\", got: ");
+                        break;
+                }
+            }
+            break;
+        case TypeUser:
+            {
+                switch (child.tag)
+                {
+                    case TagUserName:
+                        child.field = FieldUserUserName;
+                        break;
+                    case TagPassword:
+                        child.field = FieldUserPassword;
+                        break;
+                    case TagSSHKey:
+                        child.field = FieldUserSSHKey;
+                        break;
+                    case TagUID:
+                        child.field = FieldUserUID;
+                        break;
+                    case TagGroupID:
+                        child.field = FieldUserGroupID;
+                        break;
+                    case TagPrimaryGroup:
+                        child.field = FieldUserPrimaryGroup;
+                        break;
+                    default:
+                        Unexpected(parent, child, "invalid tag encountered within User::Read: ");
+                        break;
+                }
+            }
+            break;
+        case TypeRunOnceCommands:
+            {
+                switch (child.tag)
+                {
+                    case TagRunOnceCommand:
+                        child.field = FieldRunOnceCommandsRunOnceCommand;
+                        child.type = TypeRunOnceCommand;
+                        child.target = parent.target;
+                        break;
+                    default:
+                        Unexpected(parent, child, "invalid tag encountered in ReadRunOnceCommands: ");
+                        break;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void OSSpecializationBinder::BindAttribute(Frame& frame, Tag tag, const Utf8String& value)
+{
+    switch (frame.type)
+    {
+        case TypeNetworkProperties:
+            switch (tag)
+            {
+                case TagAddressType:
+                    frame.SetAttribute(AttributeNetworkPropertiesAddressType, value);
+                    OnAddressType(frame, LookupAddressType(value), value);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case TypeRunOnceCommand:
+            switch (tag)
+            {
+                case TagSequence:
+                    frame.SetAttribute(AttributeRunOnceCommandSequence, value);
+                    break;
+                case TagParallelGroup:
+                    frame.SetAttribute(AttributeRunOnceCommandParallelGroup, value);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void OSSpecializationBinder::BindEnd(Frame& parent, Frame& child)
+{
+    switch (parent.type)
+    {
+        case TypeOSConfiguration:
+            static_cast<OSSpecializationReader::OSConfiguration*>(parent.target)->m_sections[child.name.Str()] = child.xml;
+            break;
+        default:
+            break;
+    }
+
+    switch (child.field)
+    {
+        case FieldLinuxOSSpecializationSchemaVersion:
+            {
+                OSSpecializationReader::LinuxOSSpecialization* target = static_cast<OSSpecializationReader::LinuxOSSpecialization*>(parent.target);
+                target->m_schemaVersion = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "Schema Version read as: " + child.content.Str());
+            }
+            break;
+        case FieldLinuxOSSpecializationAgentVersion:
+            {
+                OSSpecializationReader::LinuxOSSpecialization* target = static_cast<OSSpecializationReader::LinuxOSSpecialization*>(parent.target);
+                target->m_agentVersion = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "Agent Version read as: " + child.content.Str());
+            }
+            break;
+        case FieldLinuxOSSpecializationOSConfiguration:
+            SCX_LOGTRACE(m_logHandle, "Read of OS Configuration complete.");
+            break;
+        case FieldOSConfigurationHostName:
+            {
+                OSSpecializationReader::OSConfiguration* target = static_cast<OSSpecializationReader::OSConfiguration*>(parent.target);
+                target->m_hostName = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "Host Name read as: " + child.content.Str());
+            }
+            break;
+        case FieldOSConfigurationDNSDomainName:
+            {
+                OSSpecializationReader::OSConfiguration* target = static_cast<OSSpecializationReader::OSConfiguration*>(parent.target);
+                target->m_domainName = child.content;
+            }
+            break;
+        case FieldOSConfigurationTimeZone:
+            {
+                OSSpecializationReader::OSConfiguration* target = static_cast<OSSpecializationReader::OSConfiguration*>(parent.target);
+                int value = 0;
+                std::istringstream ( child.content.Str() ) >> value;
+                target->m_timeZone = value;
+
+                SCX_LOGTRACE(m_logHandle, "Time Zone read as: " + child.content.Str());
+            }
+            break;
+        case FieldOSConfigurationVNetAdapters:
+            SCX_LOGTRACE(m_logHandle, "Read of VNet Adapters complete.");
+            break;
+        case FieldOSConfigurationUsers:
+            SCX_LOGTRACE(m_logHandle, "Read of Root User complete.");
+            break;
+        case FieldOSConfigurationRunOnceCommands:
+            SCX_LOGTRACE(m_logHandle, "Read of Run Once Commands complete.");
+            break;
+        case FieldVNetAdaptersVNetAdapter:
+            SCX_LOGTRACE(m_logHandle, "Read of VNet Adapter complete.");
+            break;
+        case FieldVNetAdapterMACAddress:
+            {
+                OSSpecializationReader::VNetAdapter* target = static_cast<OSSpecializationReader::VNetAdapter*>(parent.target);
+                target->m_macAddress = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "MAC Address read as: " + child.content.Str());
+            }
+            break;
+        case FieldVNetAdapterIPV4Property:
+            SCX_LOGTRACE(m_logHandle, "Read of IP V4 address complete.");
+            break;
+        case FieldVNetAdapterIPV6Property:
+            SCX_LOGTRACE(m_logHandle, "Read of IP V6 address complete.");
+            break;
+        case FieldVNetAdapterGateways:
+            SCX_LOGTRACE(m_logHandle, "Read of Gateways complete.");
+            break;
+        case FieldStaticNetworkPropertiesAddress:
+            {
+                OSSpecializationReader::NetworkProperties* target = static_cast<OSSpecializationReader::NetworkProperties*>(parent.target);
+                if (!target->m_staticIP.IsValid())
+                {
+                    target->m_staticIP = child.content;
+
+                    SCX_LOGTRACE(m_logHandle, "Static IP address read as: " + child.content.Str());
+                }
+            }
+            break;
+        case FieldNameServersNameServer:
+            {
+                std::vector<SCX::Util::Utf8String >* target = static_cast<std::vector<SCX::Util::Utf8String >*>(parent.target);
+                target->push_back(child.content);
+
+                SCX_LOGTRACE(m_logHandle, "Name Server read as: " + child.content.Str());
+            }
+            break;
+        case FieldGatewaysGateway:
+            SCX_LOGTRACE(m_logHandle, "Read of Gateway complete.");
+            break;
+        case FieldGatewayAddress:
+            {
+                OSSpecializationReader::Gateway* target = static_cast<OSSpecializationReader::Gateway*>(parent.target);
+                target->m_address = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "Gateway Address read as: " + child.content.Str());
+            }
+            break;
+        case FieldGatewayMetric:
+            {
+                OSSpecializationReader::Gateway* target = static_cast<OSSpecializationReader::Gateway*>(parent.target);
+                target->m_metric = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "Gateway Metric read as: " + child.content.Str());
+            }
+            break;
+        case FieldDNSSearchSuffixesDNSSearchSuffix:
+            {
+                std::vector<SCX::Util::Utf8String >* target = static_cast<std::vector<SCX::Util::Utf8String >*>(parent.target);
+                target->push_back(child.content);
+
+                SCX_LOGTRACE(m_logHandle, "DNS Search Suffix read as: " + child.content.Str());
+            }
+            break;
+        case FieldUsersUser:
+            EndUser(parent, child);
+            break;
+        case FieldUserUserName:
+            {
+                OSSpecializationReader::User* target = static_cast<OSSpecializationReader::User*>(parent.target);
+                target->m_userName = child.content;
+                EndUserName(parent, child);
+
+                SCX_LOGTRACE(m_logHandle, "User Name read as: " + child.content.Str());
+            }
+            break;
+        case FieldUserPassword:
+            {
+                OSSpecializationReader::User* target = static_cast<OSSpecializationReader::User*>(parent.target);
+                target->m_password = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "Password read.");
+            }
+            break;
+        case FieldUserSSHKey:
+            {
+                OSSpecializationReader::User* target = static_cast<OSSpecializationReader::User*>(parent.target);
+                target->m_sshKey = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "SSH Key read.");
+            }
+            break;
+        case FieldUserUID:
+            {
+                OSSpecializationReader::User* target = static_cast<OSSpecializationReader::User*>(parent.target);
+                target->m_UID = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "UID read as: " + child.content.Str());
+            }
+            break;
+        case FieldUserGroupID:
+            {
+                OSSpecializationReader::User* target = static_cast<OSSpecializationReader::User*>(parent.target);
+                target->m_groupID = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "Group ID read as: " + child.content.Str());
+            }
+            break;
+        case FieldUserPrimaryGroup:
+            {
+                OSSpecializationReader::User* target = static_cast<OSSpecializationReader::User*>(parent.target);
+                target->m_primaryGroup = child.content;
+
+                SCX_LOGTRACE(m_logHandle, "Primary Group read as: " + child.content.Str());
+            }
+            break;
+        case FieldRunOnceCommandsRunOnceCommand:
+            EndRunOnceCommand(parent, child);
+            break;
+        default:
+            break;
+    }
+}
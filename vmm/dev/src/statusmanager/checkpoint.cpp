@@ -0,0 +1,135 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        checkpoint.cpp
+
+   \brief       Records the completion of a specialization step in the status
+                document
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <checkpoint.h>
+
+#include <stdio.h>
+
+#include <scxcorelib/scxcmn.h>
+
+#include <argumentmanager.h>
+#include <statusmessage.h>
+
+#include <util/LogHandleCache.h>
+#include <util/XElement.h>
+
+using VMM::GuestAgent::StatusManager::Checkpoint;
+using VMM::GuestAgent::StatusManager::StatusMessage;
+using VMM::GuestAgent::Utilities::ArgumentManager;
+using SCX::Util::Xml::XElement;
+using SCX::Util::Xml::XElementPtr;
+
+namespace
+{
+
+/** Suffix of the elements recording completed steps */
+const std::string CompletedSuffix = "Completed";
+
+/** Element recording the specialization the completed steps belong to */
+const std::string SpecializationElement = "SpecializationInput";
+
+/** 64 bit FNV-1a of the input; detects changed input, nothing more */
+std::string
+HashInput(const std::string& input)
+{
+    const scxulong prime = (static_cast<scxulong>(0x100) << 32) | 0x1b3;
+    scxulong hash = (static_cast<scxulong>(0xcbf29ce4) << 32) | 0x84222325;
+    for (std::string::const_iterator iter = input.begin(); iter != input.end(); ++iter)
+    {
+        hash ^= static_cast<unsigned char>(*iter);
+        hash *= prime;
+    }
+
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%08x%08x",
+             static_cast<unsigned int>(hash >> 32),
+             static_cast<unsigned int>(hash & 0xffffffff));
+    return buffer;
+}
+
+}
+
+Checkpoint::Checkpoint(const std::string& step, const std::string& input)
+  : m_logHandle(SCX::Util::LogHandleCache::Instance().GetLogHandle(
+                    "scx.vmmguestagent.statusmanager.checkpoint"))
+  , m_elementName(step + CompletedSuffix)
+  , m_inputHash(HashInput(input))
+{
+}
+
+void Checkpoint::BeginSpecialization(const std::string& input)
+{
+    SCXCoreLib::SCXLogHandle logHandle = SCX::Util::LogHandleCache::Instance().GetLogHandle(
+        "scx.vmmguestagent.statusmanager.checkpoint");
+
+    std::string inputHash = HashInput(input);
+    std::string previousHash;
+    if (StatusMessage::Instance().ReadLastChildOfRoot(SpecializationElement, previousHash) &&
+        previousHash == inputHash)
+    {
+        return;
+    }
+
+    // The new input is recorded only once the old steps are gone, so a
+    // failure here clears them again on the next start
+    SCX_LOGINFO(logHandle, "New specialization input, clearing completed steps");
+    if (!StatusMessage::Instance().RemoveChildrenOfRoot(CompletedSuffix))
+    {
+        SCX_LOGERROR(logHandle, "Unable to clear completed steps");
+        return;
+    }
+
+    StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement(SpecializationElement, inputHash)));
+}
+
+bool Checkpoint::IsCompleted() const
+{
+    if (!ArgumentManager::Instance().IsResumeEnabled())
+    {
+        return false;
+    }
+
+    std::string inputHash;
+    if (!StatusMessage::Instance().ReadLastChildOfRoot(m_elementName, inputHash))
+    {
+        return false;
+    }
+
+    if (inputHash != m_inputHash)
+    {
+        SCX_LOGINFO(m_logHandle, m_elementName + ": input changed since the step completed");
+        return false;
+    }
+
+    SCX_LOGINFO(m_logHandle, m_elementName + ": completed before with the same input");
+    return true;
+}
+
+void Checkpoint::MarkCompleted()
+{
+    StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement(m_elementName, m_inputHash)));
+}
@@ -30,18 +30,30 @@
 /*----------------------------------------------------------------------------*/
 #include <statusmessage.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <fstream>
+#include <sstream>
 
 #include <sys/stat.h>
 
 #include <argumentmanager.h>
+#include <filewriter.h>
+#include <util/SpanTracer.h>
 
 using VMM::GuestAgent::StatusManager::StatusMessage;
 using SCX::Util::Xml::XElementPtr;
 using SCX::Util::Xml::XElement;
 using SCX::Util::Xml::XmlException;
 using SCX::Util::Xml::XElementList;
+using SCX::Util::ScopedSpan;
 using SCX::Util::Utf8String;
+using VMM::GuestAgent::Utilities::FileWriter;
 
 const std::string ElementNameOSConfigurationStatusRoot = "OSConfigurationStatus";
 const std::string AttributeNameSchemaVersion           = "SchemaVersion";
@@ -49,57 +61,95 @@ const std::string SchemaVersion                        = "1.1";
 
 const std::string StatusDir                            = "status";
 const std::string StatusMessageXml                     = "statusmessage.xml";
+const std::string StatusJournal                        = "statusmessage.journal";
+const std::string StatusSnapshot                       = "statusmessage.snapshot";
 
-std::string StatusMessage::ReadStatusFileAsString()
-{
+// Journal records after which the document is written to the snapshot
+const unsigned long CompactionThreshold                = 32;
 
-    SCX_LOGINFO(m_logHandle,
-                L"Reading file:" + SCXCoreLib::StrFromMultibyte(m_statusFile));
+namespace
+{
 
-    //First we need to get our incoming Message
-    std::ifstream fileStream(m_statusFile.c_str());
+/** Read a whole file; empty if it does not exist */
+std::string
+ReadFile(const std::string& path)
+{
+    std::ifstream fileStream(path.c_str());
     std::ostringstream strStream;
-
     if (fileStream.is_open())
     {
         strStream << fileStream.rdbuf();
-        fileStream.close();
     }
-    else
+    return strStream.str();
+}
+
+}
+
+StatusMessage::~StatusMessage()
+{
+    // Not flushed here; the log and lock singletons may already be gone
+    if (m_journalFd >= 0)
     {
-        SCX_LOGINFO(m_logHandle, "Unable to open the file");
+        close(m_journalFd);
     }
+}
+
+std::string StatusMessage::ReadStatusFileAsString()
+{
+    ScopedSpan span("StatusMessage::Read", "status");
 
     SCX_LOGINFO(m_logHandle,
-                L"File read:" + SCXCoreLib::StrFromMultibyte(strStream.str()));
-    return strStream.str();
+                L"Reading file:" + SCXCoreLib::StrFromMultibyte(m_statusFile));
+
+    std::string xmlString = ReadFile(m_statusFile);
+    if (xmlString.empty())
+    {
+        SCX_LOGINFO(m_logHandle, "Unable to open the file");
+    }
+
+    SCX_LOGTRACE(m_logHandle,
+                 L"File read:" + SCXCoreLib::StrFromMultibyte(xmlString));
+    return xmlString;
     
 }
 
 bool StatusMessage::AddChildToRoot(const XElementPtr& element)
 {
 
-    SCX_LOGTRACE(m_logHandle, "Adding child element to root");
+    SCXCoreLib::SCXThreadLock lock(m_lockHandle);
 
-    mp_xelementRoot = NULL;
+    SCX_LOGTRACE(m_logHandle, "Adding child element to root");
 
-    std::string xmlString = ReadStatusFileAsString();
+    if (NULL == mp_xelementRoot)
+    {
+        SCX_LOGERROR(m_logHandle, "No status document to add to");
+        return false;
+    }
 
-    //Let's Load'em up!
-    try
+    // Without a journal every update rewrites the snapshot and the status
+    // file, as the agent did before the journal existed
+    if (m_journalFd < 0)
     {
-        XElement::Load(xmlString,
-                       mp_xelementRoot);
+        mp_xelementRoot->AddChild(element);
+        Write();
+        m_dirty = false;
+        return Compact();
     }
-    catch (XmlException& x)
+
+    // Journal first, so the document in memory never holds an element
+    // that a restart would not bring back
+    if (!AppendToJournal(element))
     {
-        SCX_LOGERROR(m_logHandle, L"XML Exception:" + x.What());
         return false;
     }
-    
+
     mp_xelementRoot->AddChild(element);
+    m_dirty = true;
 
-    Write();
+    if (m_journalRecords >= CompactionThreshold)
+    {
+        Compact();
+    }
     
     return true;
 }
@@ -107,22 +157,10 @@ bool StatusMessage::AddChildToRoot(const XElementPtr& element)
 bool StatusMessage::ReadChildOfRoot(const std::string& elementNameIn, 
                                     std::string&       elementValue)
 {
+    SCXCoreLib::SCXThreadLock lock(m_lockHandle);
 
-    // Reset root
-    mp_xelementRoot = NULL;
-    
-    std::string xmlString = ReadStatusFileAsString();
-    SCX_LOGINFO(m_logHandle, ("File read as:") + (xmlString));
-
-    //Let's Load'em up!
-    try
+    if (NULL == mp_xelementRoot)
     {
-        XElement::Load(xmlString,
-                       mp_xelementRoot);
-    }
-    catch (XmlException& x)
-    {
-        SCX_LOGERROR(m_logHandle, ("XML Exception:") + SCXCoreLib::StrToMultibyte(x.What()));
         return false;
     }
 
@@ -156,6 +194,86 @@ bool StatusMessage::ReadChildOfRoot(const std::string& elementNameIn,
     return false;
 }
 
+bool StatusMessage::ReadLastChildOfRoot(const std::string& elementNameIn, 
+                                        std::string&       elementValue)
+{
+    SCXCoreLib::SCXThreadLock lock(m_lockHandle);
+
+    if (NULL == mp_xelementRoot)
+    {
+        return false;
+    }
+
+    XElementList elementList;
+    mp_xelementRoot->GetChildren(elementList);
+
+    for (XElementList::reverse_iterator elementIter = elementList.rbegin();
+         elementIter != elementList.rend();
+         ++elementIter)
+    {
+        if ((*elementIter)->GetName().Str() == elementNameIn)
+        {
+            elementValue = (*elementIter)->GetContent().Str();
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool StatusMessage::RemoveChildrenOfRoot(const std::string& nameSuffix)
+{
+    SCXCoreLib::SCXThreadLock lock(m_lockHandle);
+
+    if (NULL == mp_xelementRoot)
+    {
+        return true;
+    }
+
+    XElementList elementList;
+    mp_xelementRoot->GetChildren(elementList);
+
+    XElementList kept;
+    for (XElementList::const_iterator elementIter = elementList.begin();
+         elementIter != elementList.end();
+         ++elementIter)
+    {
+        std::string elementName = (*elementIter)->GetName().Str();
+        if (elementName.length() < nameSuffix.length() ||
+            0 != elementName.compare(elementName.length() - nameSuffix.length(), nameSuffix.length(), nameSuffix))
+        {
+            kept.push_back(*elementIter);
+        }
+    }
+
+    if (kept.size() == elementList.size())
+    {
+        return true;
+    }
+
+    // XElement cannot drop a child, so the root is rebuilt from the others
+    AddRoot();
+    for (XElementList::const_iterator elementIter = kept.begin();
+         elementIter != kept.end();
+         ++elementIter)
+    {
+        mp_xelementRoot->AddChild(*elementIter);
+    }
+
+    return Compact();
+}
+
+void StatusMessage::Flush()
+{
+    SCXCoreLib::SCXThreadLock lock(m_lockHandle);
+
+    if (m_dirty && NULL != mp_xelementRoot)
+    {
+        Write();
+        m_dirty = false;
+    }
+}
+
 void StatusMessage::AddRoot()
 {
     // Create the Root Element
@@ -165,7 +283,7 @@ void StatusMessage::AddRoot()
     mp_xelementRoot->SetAttributeValue(AttributeNameSchemaVersion,
                                        SchemaVersion);
 
-    Write();
+    m_dirty = true;
 }
 
 void StatusMessage::SetUp()
@@ -193,48 +311,215 @@ void StatusMessage::SetUp()
         SCX_LOGINFO(m_logHandle, "Status dir existed from before");
     }
 
-    m_statusFile = installHome + 
-        std::string("/") +  
-        StatusDir  + 
-        std::string("/") +  
-        StatusMessageXml;
-    
-    // No file exists. So add root node.
-    if (stat(m_statusFile.c_str(), &statBuff) == -1)
+    m_statusFile = statusDir + std::string("/") + StatusMessageXml;
+    m_journalFile = statusDir + std::string("/") + StatusJournal;
+    m_snapshotFile = statusDir + std::string("/") + StatusSnapshot;
+
+    LoadDocument();
+
+    m_journalFd = open(m_journalFile.c_str(), O_WRONLY | O_APPEND | O_CREAT, S_IRUSR | S_IWUSR);
+    if (m_journalFd < 0)
+    {
+        SCX_LOGERROR(m_logHandle, "Unable to open status journal " + m_journalFile + ": " + strerror(errno));
+    }
+
+}
+
+void StatusMessage::LoadDocument()
+{
+    ScopedSpan span("StatusMessage::Load", "status");
+
+    mp_xelementRoot = NULL;
+
+    // The snapshot and journal are authoritative; the compatibility XML is
+    // only used when they do not exist yet, e.g. after an upgrade
+    struct stat statBuff;
+    bool journaled = stat(m_snapshotFile.c_str(), &statBuff) == 0 ||
+        stat(m_journalFile.c_str(), &statBuff) == 0;
+
+    std::string xmlString;
+    if (journaled)
+    {
+        std::string snapshot = ReadFile(m_snapshotFile);
+        std::string::size_type newline = snapshot.find('\n');
+        if (std::string::npos != newline)
+        {
+            m_sequence = strtoul(snapshot.substr(0, newline).c_str(), NULL, 10);
+            xmlString = snapshot.substr(newline + 1);
+        }
+    }
+    else
+    {
+        xmlString = ReadStatusFileAsString();
+    }
+
+    if (!xmlString.empty())
+    {
+        try
+        {
+            XElement::Load(xmlString,
+                           mp_xelementRoot);
+        }
+        catch (XmlException& x)
+        {
+            SCX_LOGERROR(m_logHandle, L"XML Exception:" + x.What());
+            mp_xelementRoot = NULL;
+        }
+    }
+
+    // No usable document. So add root node.
+    if (NULL == mp_xelementRoot)
     {
         SCX_LOGINFO(m_logHandle, "No status xml files. Adding a new one");
         AddRoot();
     }
+
+    if (journaled)
+    {
+        ReplayJournal();
+    }
     else
     {
-        SCX_LOGINFO(m_logHandle, "Status XML file exists.");
+        // Start the journal from the document read
+        Compact();
+    }
+}
+
+void StatusMessage::ReplayJournal()
+{
+    std::string journal = ReadFile(m_journalFile);
+    std::string::size_type pos = 0;
+    unsigned long replayed = 0;
+
+    // Records are "<sequence> <length>\n<element>\n"; a torn record ends the replay
+    while (pos < journal.length())
+    {
+        std::string::size_type newline = journal.find('\n', pos);
+        if (std::string::npos == newline)
+        {
+            break;
+        }
+
+        unsigned long sequence = 0;
+        unsigned long length = 0;
+        if (2 != sscanf(journal.substr(pos, newline - pos).c_str(), "%lu %lu", &sequence, &length) ||
+            newline + 1 + length + 1 > journal.length() ||
+            '\n' != journal[newline + 1 + length])
+        {
+            SCX_LOGWARNING(m_logHandle, "Ignoring incomplete status journal record");
+            break;
+        }
+
+        std::string record = journal.substr(newline + 1, length);
+        pos = newline + 1 + length + 1;
+
+        // Records up to the snapshot are already in the document
+        if (sequence <= m_sequence)
+        {
+            continue;
+        }
+
+        try
+        {
+            XElementPtr element(NULL);
+            XElement::Load(record, element);
+            mp_xelementRoot->AddChild(element);
+            m_sequence = sequence;
+            ++replayed;
+            m_dirty = true;
+        }
+        catch (XmlException& x)
+        {
+            SCX_LOGERROR(m_logHandle, L"XML Exception in status journal:" + x.What());
+            break;
+        }
     }
 
+    m_journalRecords = replayed;
+
+    std::ostringstream strm;
+    strm << "Replayed " << replayed << " status journal record(s)";
+    SCX_LOGINFO(m_logHandle, strm.str());
 }
 
-void StatusMessage::Write()
+bool StatusMessage::AppendToJournal(const XElementPtr& element)
 {
+    if (m_journalFd < 0)
+    {
+        return false;
+    }
 
-    std::ofstream fileStream(m_statusFile.c_str(), 
-                             std::ios::out |
-                             std::ios::trunc);
-    if (fileStream.is_open())
+    Utf8String xmlString;
+    element->ToString(xmlString, false);
+
+    std::ostringstream record;
+    record << (m_sequence + 1) << " " << xmlString.Str().length() << "\n"
+           << xmlString.Str() << "\n";
+
+    // The update is committed once it is on disk
+    if (!FileWriter::WriteAll(m_journalFd, record.str()) || 0 != fsync(m_journalFd))
     {
+        SCX_LOGERROR(m_logHandle, std::string("Unable to write status journal: ") + strerror(errno));
+        return false;
+    }
+
+    ++m_sequence;
+    ++m_journalRecords;
+    return true;
+}
 
-        Utf8String xmlString;
-        mp_xelementRoot->ToString(xmlString, false);
+bool StatusMessage::Compact()
+{
+    ScopedSpan span("StatusMessage::Compact", "status");
+
+    Utf8String xmlString;
+    mp_xelementRoot->ToString(xmlString, false);
 
-        SCX_LOGINFO(m_logHandle,
-                    L"Writing following to file:" + 
-                    SCXCoreLib::StrFromMultibyte(xmlString.Str()));
+    std::ostringstream snapshot;
+    snapshot << m_sequence << "\n" << xmlString.Str();
 
-        fileStream << xmlString.Str();
+    // Records up to the sequence in the snapshot are skipped on replay, so a
+    // crash before the truncation below loses nothing and duplicates nothing
+    if (!FileWriter::Replace(m_snapshotFile, snapshot.str(), 0600))
+    {
+        SCX_LOGERROR(m_logHandle, std::string("Unable to write status snapshot: ") + strerror(errno));
+        return false;
     }
-    else
+
+    // The snapshot is complete; a journal left behind is skipped on replay
+    if (m_journalFd >= 0 && 0 != ftruncate(m_journalFd, 0))
     {
-        SCX_LOGINFO(m_logHandle, "Unable to open status file");
+        SCX_LOGERROR(m_logHandle, std::string("Unable to truncate status journal: ") + strerror(errno));
+        return true;
+    }
+    if (m_journalFd < 0)
+    {
+        // Not opened yet; leave an empty journal behind
+        int fd = open(m_journalFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
     }
 
-    fileStream.close();
+    m_journalRecords = 0;
+    return true;
+}
+
+void StatusMessage::Write()
+{
+    ScopedSpan span("StatusMessage::Write", "status");
+
+    Utf8String xmlString;
+    mp_xelementRoot->ToString(xmlString, false);
+
+    SCX_LOGTRACE(m_logHandle,
+                 L"Writing following to file:" + 
+                 SCXCoreLib::StrFromMultibyte(xmlString.Str()));
+
+    if (!FileWriter::Replace(m_statusFile, xmlString.Str(), 0600, false))
+    {
+        SCX_LOGINFO(m_logHandle, "Unable to open status file");
+    }
 
 }
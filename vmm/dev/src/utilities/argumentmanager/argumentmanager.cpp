@@ -43,7 +43,8 @@ namespace
 char const VMM_HOME_ENV_VAR[] = "SCVMM_HOME";
 char const VMM_HOME_DEFAULT[] = "/opt/microsoft/scvmmguestagent/";
 char const CLI_CONFIG_FILENAME[] = "mntpath=";
-char const USAGE[] = "scvmmguestagent [mntpath=<PATH>]";
+char const CLI_NO_RESUME[] = "noresume";
+char const USAGE[] = "scvmmguestagent [mntpath=<PATH>] [noresume]";
 
 }
 
@@ -52,6 +53,7 @@ char const USAGE[] = "scvmmguestagent [mntpath=<PATH>]";
 ArgumentManager::ArgumentManager()
   : m_vmmHome(VMM_HOME_DEFAULT)
   , m_configFilename()
+  , m_resume(true)
 {
     // empty
 }
@@ -68,7 +70,7 @@ ArgumentManager::LoadArgs(
     char const* const* argv,
     Logger_t& logger)
 {
-    int result = 1 == argc ? EXIT_SUCCESS : EXIT_FAILURE;
+    int result = EXIT_SUCCESS;
 
     char const* const vmmHomeEnv = getenv(VMM_HOME_ENV_VAR);
     if (NULL != vmmHomeEnv)
@@ -76,30 +78,28 @@ ArgumentManager::LoadArgs(
         m_vmmHome = vmmHomeEnv;
     }
 
-    if (2 == argc &&
-        0 == strncmp (CLI_CONFIG_FILENAME, argv[1],
-                      strlen(CLI_CONFIG_FILENAME)))
+    for (int i = 1; i < argc && EXIT_SUCCESS == result; ++i)
     {
-        m_configFilename = argv[1] + strlen(CLI_CONFIG_FILENAME);
-        result = EXIT_SUCCESS;
-    }
-
-    if (EXIT_FAILURE == result)
-    {
-        std::ostringstream strm;
-        strm << "Error parsing commandline: ";
-        if (2 == argc &&
-            0 != strncmp(CLI_CONFIG_FILENAME, argv[1],
-                         strlen(CLI_CONFIG_FILENAME)))
+        if (0 == strncmp(CLI_CONFIG_FILENAME, argv[i],
+                         strlen(CLI_CONFIG_FILENAME)) &&
+            m_configFilename.empty())
         {
-            strm << "encountered unknown command \"" << argv[1];
+            m_configFilename = argv[i] + strlen(CLI_CONFIG_FILENAME);
+        }
+        else if (0 == strcmp(CLI_NO_RESUME, argv[i]))
+        {
+            m_resume = false;
         }
         else
         {
-            strm << "invalid args.";
+            std::ostringstream strm;
+            strm << "Error parsing commandline: "
+                 << "encountered unknown command \"" << argv[i] << "\""
+                 << std::endl << USAGE;
+            SCX_LOGERROR(logger, strm.str ());
+            result = EXIT_FAILURE;
         }
-        strm << std::endl << USAGE;
-        SCX_LOGERROR(logger, strm.str ());
     }
+
     return result;
 }
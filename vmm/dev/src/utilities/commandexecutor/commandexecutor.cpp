@@ -30,6 +30,8 @@
 /*----------------------------------------------------------------------------*/
 #include <commandexecutor.h>
 
+#include <util/SpanTracer.h>
+
 #include <algorithm>
 #include <cctype>
 #include <cerrno>
@@ -65,8 +67,26 @@ namespace Utilities
 unsigned int
 readConfig ()
 {
-    unsigned int timeout = DEFAULT_TIMEOUT;
-    std::fstream configFile (CONFIG_FILE_NAME);
+    return readConfig (CONFIG_FILE_NAME, DEFAULT_TIMEOUT);
+}
+
+unsigned int
+readConfig (
+    char const* fileName,
+    unsigned int const defaultTimeout)
+{
+    return readConfig (fileName, defaultTimeout, MINIMUM_TIMEOUT, MAXIMUM_TIMEOUT);
+}
+
+unsigned int
+readConfig (
+    char const* fileName,
+    unsigned int const defaultValue,
+    unsigned int const minimum,
+    unsigned int const maximum)
+{
+    unsigned int value = defaultValue;
+    std::fstream configFile (fileName);
     if (configFile.good ())
     {
         char buffer[BUFFSIZE] = "";
@@ -83,22 +103,22 @@ readConfig ()
                 !(ULONG_MAX == val &&
                   ERANGE == errno))
             {
-                if (MINIMUM_TIMEOUT > val)
+                if (minimum > val)
                 {
-                    timeout = MINIMUM_TIMEOUT;
+                    value = minimum;
                 }
-                else if (MAXIMUM_TIMEOUT < val)
+                else if (maximum < val)
                 {
-                    timeout = MAXIMUM_TIMEOUT;
+                    value = maximum;
                 }
                 else
                 {
-                    timeout = static_cast<unsigned int> (val);
+                    value = static_cast<unsigned int> (val);
                 }
             }
         }
     }
-    return timeout;
+    return value;
 }
 
 }
@@ -106,15 +126,27 @@ readConfig ()
 }
 
 using VMM::GuestAgent::Utilities::CommandExecutor;
+using VMM::GuestAgent::Utilities::LogOutputSink;
 
 int CommandExecutor::Execute(const std::wstring& command, 
                              const std::string& component,
                              unsigned int const timeoutSecs)
 {
+    LogOutputSink stdoutSink(CreateStdoutSink(component));
+    LogOutputSink stderrSink(CreateStderrSink(component));
+    return Execute(command, component, stdoutSink, stderrSink, timeoutSecs);
+}
+
+int CommandExecutor::Execute(const std::wstring& command,
+                             const std::string& component,
+                             LogOutputSink& stdoutSink,
+                             LogOutputSink& stderrSink,
+                             unsigned int const timeoutSecs)
+{
+    // Only the component goes into the trace; command lines may carry secrets
+    SCX::Util::ScopedSpan span(component, "process");
 
     std::istringstream stdInStream("");
-    std::ostringstream stdOutStream;
-    std::ostringstream stdErrStream;
     
     SCXCoreLib::SCXFilePath workingPath(L".");
     int exitStatus = 0;
@@ -124,8 +156,8 @@ int CommandExecutor::Execute(const std::wstring& command,
     {
         exitStatus = SCXCoreLib::SCXProcess::Run(command,
                                                  stdInStream,
-                                                 stdOutStream,
-                                                 stdErrStream,
+                                                 stdoutSink,
+                                                 stderrSink,
                                                  timeoutSecs * 1000,
                                                  workingPath
                                                  /* , ChrootPath */ );
@@ -142,6 +174,9 @@ int CommandExecutor::Execute(const std::wstring& command,
                      L" failed due to exceptions");
         exitStatus = -1;
     }
+
+    stdoutSink.Flush();
+    stderrSink.Flush();
     
     // Check return codes
     if (exitStatus == 0)
@@ -173,10 +208,25 @@ int CommandExecutor::Execute(const std::wstring& command,
             SCXCoreLib::StrToMultibyte(SCXCoreLib::StrFrom(exitStatus)));
     }
 
-    // Printing stderr/stdout
-    SCX_LOGINFO(m_logHandle, std::string("stdout as a result of running command:") + stdOutStream.str());
-    SCX_LOGERROR(m_logHandle, std::string("stderr as a result of running command:") + stdErrStream.str());
+    // The output itself was logged line by line as it arrived
+    std::ostringstream summary;
+    summary << component << " wrote " << stdoutSink.GetByteCount()
+            << " bytes to stdout and " << stderrSink.GetByteCount()
+            << " bytes to stderr";
+    SCX_LOGINFO(m_logHandle, summary.str());
 
     return exitStatus;
 
 }
+
+LogOutputSink CommandExecutor::CreateStdoutSink(const std::string& component) const
+{
+    return LogOutputSink(m_logHandle, component + " stdout: ", SCXCoreLib::eInfo,
+                         m_outputTailBytes);
+}
+
+LogOutputSink CommandExecutor::CreateStderrSink(const std::string& component) const
+{
+    return LogOutputSink(m_logHandle, component + " stderr: ", SCXCoreLib::eWarning,
+                         m_outputTailBytes);
+}
@@ -0,0 +1,241 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        logoutputsink.cpp
+
+   \brief       Output sink that logs the output of a command line by line and
+                keeps only its tail
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <logoutputsink.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+// Longer lines are logged in pieces so a runaway line cannot grow the buffer
+size_t const MaxLineBytes = 4096;
+
+// Length of the UTF-8 sequence at pos, 0 if it is not valid by the rules
+// Utf8String enforces: no overlong forms, surrogates or code points past
+// U+10FFFF, and no sequence cut short
+size_t
+Utf8SequenceLength(const std::string& text, size_t pos)
+{
+    unsigned char c = static_cast<unsigned char>(text[pos]);
+    if (c < 0x80)
+    {
+        return 1;
+    }
+
+    size_t length = 0;
+    unsigned int codePoint = 0;
+    if (c >= 0xc2 && c < 0xe0)
+    {
+        length = 2;
+        codePoint = c & 0x1f;
+    }
+    else if (c >= 0xe0 && c < 0xf0)
+    {
+        length = 3;
+        codePoint = c & 0x0f;
+    }
+    else if (c >= 0xf0 && c < 0xf5)
+    {
+        length = 4;
+        codePoint = c & 0x07;
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (pos + length > text.size())
+    {
+        return 0;
+    }
+    for (size_t i = 1; i < length; ++i)
+    {
+        unsigned char u = static_cast<unsigned char>(text[pos + i]);
+        if (0x80 != (u & 0xc0))
+        {
+            return 0;
+        }
+        codePoint = (codePoint << 6) | (u & 0x3f);
+    }
+
+    if ((3 == length && (codePoint < 0x800 || (codePoint >= 0xd800 && codePoint <= 0xdfff))) ||
+        (4 == length && (codePoint < 0x10000 || codePoint > 0x10ffff)))
+    {
+        return 0;
+    }
+    return length;
+}
+
+// Command output is arbitrary bytes, but the log and the status report only
+// take UTF-8; every byte that does not start a valid sequence becomes '?'
+void
+ReplaceInvalidUtf8(std::string& text)
+{
+    for (size_t pos = 0; pos < text.size(); )
+    {
+        size_t length = Utf8SequenceLength(text, pos);
+        if (0 == length)
+        {
+            text[pos] = '?';
+            length = 1;
+        }
+        pos += length;
+    }
+}
+
+}
+
+using VMM::GuestAgent::Utilities::LogOutputSink;
+
+LogOutputSink::LogOutputSink(const SCXCoreLib::SCXLogHandle& logHandle,
+                             const std::string& prefix,
+                             SCXCoreLib::SCXLogSeverity severity,
+                             size_t tailBytes)
+  : m_logHandle(logHandle)
+  , m_prefix(prefix)
+  , m_severity(severity)
+  , m_tail(tailBytes)
+  , m_tailPos(0)
+  , m_tailFull(false)
+  , m_bytes(0)
+  , m_lines(0)
+{
+}
+
+void LogOutputSink::Write(const char* data, size_t size)
+{
+    m_bytes += size;
+    AddToTail(data, size);
+
+    const char* end = data + size;
+    while (data < end)
+    {
+        const char* newline = static_cast<const char*>(memchr(data, '\n', end - data));
+        if (NULL == newline)
+        {
+            size_t room = MaxLineBytes - m_partial.size();
+            if (static_cast<size_t>(end - data) < room)
+            {
+                m_partial.append(data, end);
+                return;
+            }
+            LogLine(data, room);
+            data += room;
+            continue;
+        }
+
+        LogLine(data, newline - data);
+        data = newline + 1;
+    }
+}
+
+void LogOutputSink::Flush()
+{
+    if (!m_partial.empty())
+    {
+        LogLine(NULL, 0);
+    }
+}
+
+std::string LogOutputSink::GetTail() const
+{
+    std::string tail;
+    if (m_tailFull)
+    {
+        tail.assign(m_tail.begin() + m_tailPos, m_tail.end());
+    }
+    tail.append(m_tail.begin(), m_tail.begin() + m_tailPos);
+
+    // A full tail may start in the middle of a UTF-8 sequence
+    if (m_tailFull)
+    {
+        size_t start = 0;
+        while (start < tail.size() && 0x80 == (static_cast<unsigned char>(tail[start]) & 0xc0))
+        {
+            start++;
+        }
+        tail.erase(0, start);
+    }
+
+    ReplaceInvalidUtf8(tail);
+
+    // XML allows no C0 control characters other than tab and line breaks
+    for (std::string::iterator c = tail.begin(); c != tail.end(); ++c)
+    {
+        if (static_cast<unsigned char>(*c) < 0x20 && '\n' != *c && '\r' != *c && '\t' != *c)
+        {
+            *c = '?';
+        }
+    }
+    return tail;
+}
+
+void LogOutputSink::LogLine(const char* data, size_t size)
+{
+    m_lines++;
+    if (m_severity >= m_logHandle.GetSeverityThreshold())
+    {
+        std::string line(m_prefix);
+        line.append(m_partial);
+        line.append(data, size);
+        if (!line.empty() && '\r' == line[line.size() - 1])
+        {
+            line.resize(line.size() - 1);
+        }
+        ReplaceInvalidUtf8(line);
+        SCX_LOG(m_logHandle, m_severity, line);
+    }
+    m_partial.clear();
+}
+
+void LogOutputSink::AddToTail(const char* data, size_t size)
+{
+    if (m_tail.empty())
+    {
+        return;
+    }
+
+    // Only the last tail-size bytes of the chunk can survive
+    if (size >= m_tail.size())
+    {
+        data += size - m_tail.size();
+        size = m_tail.size();
+    }
+
+    size_t first = std::min(size, m_tail.size() - m_tailPos);
+    memcpy(&m_tail[m_tailPos], data, first);
+    memcpy(&m_tail[0], data + first, size - first);
+
+    m_tailPos += size;
+    if (m_tailPos >= m_tail.size())
+    {
+        m_tailPos -= m_tail.size();
+        m_tailFull = true;
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        filewriter.cpp
+
+   \brief       Writes files for the agent libraries that keep files on disk
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <filewriter.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+
+#include <vector>
+
+using VMM::GuestAgent::Utilities::FileWriter;
+
+namespace
+{
+
+// Extended attribute holding the SELinux context of a file
+char const SELinuxAttribute[] = "security.selinux";
+
+/** Give a new file the SELinux context of the file it replaces */
+bool
+CopySELinuxContext(const std::string& path, int fd)
+{
+    ssize_t size = getxattr(path.c_str(), SELinuxAttribute, NULL, 0);
+    if (size <= 0)
+    {
+        // No SELinux, or no context to keep
+        return true;
+    }
+
+    std::vector<char> context(static_cast<size_t>(size));
+    size = getxattr(path.c_str(), SELinuxAttribute, &context[0], context.size());
+    if (size <= 0)
+    {
+        return true;
+    }
+
+    // A file with the wrong context, /etc/shadow above all, can lock users
+    // out; keeping the old file is safer than installing it
+    return 0 == fsetxattr(fd, SELinuxAttribute, &context[0], static_cast<size_t>(size), 0) ||
+           ENOTSUP == errno;
+}
+
+/** Sync the directory holding a file so a rename into it is durable */
+void
+SyncDirectory(const std::string& path)
+{
+    std::string::size_type slash = path.rfind('/');
+    std::string dir = std::string::npos == slash ? "." : path.substr(0, slash + 1);
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+}
+
+bool FileWriter::WriteAll(int fd, const std::string& data)
+{
+    size_t written = 0;
+    while (written < data.length())
+    {
+        ssize_t ret = write(fd, data.data() + written, data.length() - written);
+        if (ret < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(ret);
+    }
+    return true;
+}
+
+bool FileWriter::Replace(const std::string& path, const std::string& data, unsigned int mode, bool sync)
+{
+    struct stat statBuff;
+    bool exists = 0 == stat(path.c_str(), &statBuff);
+
+    std::string tempFile = path + ".vmmtmp";
+    int fd = open(tempFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool ok = WriteAll(fd, data) &&
+              0 == fchmod(fd, exists ? statBuff.st_mode & 07777 : mode) &&
+              (!exists || 0 == fchown(fd, statBuff.st_uid, statBuff.st_gid)) &&
+              (!exists || CopySELinuxContext(path, fd)) &&
+              (!sync || 0 == fsync(fd));
+    ok = 0 == close(fd) && ok;
+    if (!ok || 0 != rename(tempFile.c_str(), path.c_str()))
+    {
+        int savedErrno = errno;
+        unlink(tempFile.c_str());
+        errno = savedErrno;
+        return false;
+    }
+
+    if (sync)
+    {
+        SyncDirectory(path);
+    }
+    return true;
+}
@@ -0,0 +1,216 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+/**
+   \file        hostdomain.cpp
+
+   \brief       Runs HostDomainConfigurator against a scratch root tree
+
+                usage: hostdomain
+
+                Each scenario lays out the files of a distribution under a
+                temporary root, sets a new host name and DNS domain and checks
+                the rewritten files. In /etc/sysconfig/network only the
+                HOSTNAME setting, indented or not, is replaced; DHCP_HOSTNAME
+                and comments mentioning HOSTNAME= survive. The exit code is 1
+                if a check fails.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <hostdomainconfigurator.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+using VMM::GuestAgent::OSConfigurator::HostDomainConfigurator;
+using SCX::Util::Utf8String;
+
+namespace
+{
+
+int s_failures = 0;
+
+void
+Check(bool condition, const std::string& what)
+{
+    printf("  %-60s %s\n", what.c_str(), condition ? "ok" : "FAILED");
+    if (!condition)
+    {
+        s_failures++;
+    }
+}
+
+void
+WriteFile(const std::string& path, const std::string& contents)
+{
+    std::ofstream fileStream(path.c_str(), std::ios::out | std::ios::trunc);
+    fileStream << contents;
+}
+
+std::vector<std::string>
+ReadFile(const std::string& path)
+{
+    std::vector<std::string> lines;
+    std::ifstream fileStream(path.c_str());
+    std::string line;
+    while (std::getline(fileStream, line))
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+bool
+HasLine(const std::vector<std::string>& lines, const std::string& line)
+{
+    return lines.end() != std::find(lines.begin(), lines.end(), line);
+}
+
+bool
+Exists(const std::string& path)
+{
+    struct stat statBuff;
+    return 0 == stat(path.c_str(), &statBuff);
+}
+
+std::string
+MakeRoot()
+{
+    char dir[] = "/tmp/hostdomainXXXXXX";
+    if (0 == mkdtemp(dir))
+    {
+        perror("mkdtemp");
+        exit(2);
+    }
+    std::string root = dir;
+    mkdir((root + "/etc").c_str(), 0755);
+    return root;
+}
+
+void
+RemoveRoot(const std::string& root)
+{
+    std::string command = "rm -rf '" + root + "'";
+    if (0 != system(command.c_str()))
+    {
+        fprintf(stderr, "Failed to remove %s\n", root.c_str());
+    }
+}
+
+void
+RunRHEL()
+{
+    printf("RHEL\n");
+    std::string root = MakeRoot();
+    mkdir((root + "/etc/sysconfig").c_str(), 0755);
+    mkdir((root + "/etc/sysconfig/network-scripts").c_str(), 0755);
+    WriteFile(root + "/etc/sysconfig/network",
+              "NETWORKING=yes\n"
+              "DHCP_HOSTNAME=dhcpname\n"
+              "# HOSTNAME= is set by the agent\n"
+              "  HOSTNAME=oldname\n");
+    WriteFile(root + "/etc/resolv.conf", "search old.example.com\nnameserver 10.0.0.53\n");
+
+    HostDomainConfigurator configurator(root);
+    Utf8String hostName("newname");
+    Utf8String domainName("example.com");
+    configurator.Execute(hostName, domainName);
+
+    std::vector<std::string> network = ReadFile(root + "/etc/sysconfig/network");
+    Check(HasLine(network, "HOSTNAME=newname"), "HOSTNAME set");
+    Check(!HasLine(network, "  HOSTNAME=oldname"), "indented old HOSTNAME removed");
+    Check(HasLine(network, "DHCP_HOSTNAME=dhcpname"), "DHCP_HOSTNAME kept");
+    Check(HasLine(network, "# HOSTNAME= is set by the agent"), "comment kept");
+    Check(HasLine(network, "NETWORKING=yes"), "NETWORKING kept");
+    Check(4 == network.size(), "no other lines added or dropped");
+    Check(!Exists(root + "/etc/hostname"), "/etc/hostname not created");
+
+    std::vector<std::string> resolv = ReadFile(root + "/etc/resolv.conf");
+    Check(HasLine(resolv, "search example.com") && !HasLine(resolv, "search old.example.com"), "search replaced");
+    Check(HasLine(resolv, "domain example.com"), "domain set");
+    Check(HasLine(resolv, "nameserver 10.0.0.53"), "nameserver kept");
+
+    RemoveRoot(root);
+}
+
+void
+RunDebian()
+{
+    printf("Debian\n");
+    std::string root = MakeRoot();
+    WriteFile(root + "/etc/debian_version", "12.0\n");
+    WriteFile(root + "/etc/hostname", "oldname\n");
+
+    HostDomainConfigurator configurator(root);
+    Utf8String hostName("newname");
+    Utf8String domainName;
+    configurator.Execute(hostName, domainName);
+
+    std::vector<std::string> hostname = ReadFile(root + "/etc/hostname");
+    Check(1 == hostname.size() && "newname" == hostname[0], "/etc/hostname replaced");
+    Check(!Exists(root + "/etc/resolv.conf"), "resolv.conf untouched without a domain");
+
+    RemoveRoot(root);
+}
+
+}
+
+int main()
+{
+    RunRHEL();
+    RunDebian();
+
+    printf("%d check(s) failed\n", s_failures);
+    return 0 == s_failures ? 0 : 1;
+}
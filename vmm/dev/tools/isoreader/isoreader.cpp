@@ -0,0 +1,298 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        isoreader.cpp
+
+   \brief       Builds ISO9660 images and reads a file from their root
+                directory with ISO9660Reader
+
+                usage: isoreader
+
+                The images are written to temporary files and removed again.
+                Each has a primary volume and, optionally, a Joliet one whose
+                root directory holds enough filler entries to span several
+                logical blocks, with the file to read last. They are built
+                with 2048 and 512 byte logical blocks, so directory records
+                are padded to a block boundary that is not a sector boundary.
+                The exit code is 1 if a check fails.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <iso9660reader.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+using VMM::GuestAgent::Fetcher::ISO9660Reader;
+
+namespace
+{
+
+int s_failures = 0;
+
+size_t const SECTOR_SIZE = 2048;
+size_t const FIRST_DESCRIPTOR_SECTOR = 16;
+
+const char FileName[] = "linuxosconfiguration.xml";
+const char ShortFileName[] = "LINUXOSC.XML;1";
+const char FileContents[] = "<LinuxOSSpecialization/>\n";
+
+void
+Check(bool condition, const std::string& what)
+{
+    printf("  %-60s %s\n", what.c_str(), condition ? "ok" : "FAILED");
+    if (!condition)
+    {
+        s_failures++;
+    }
+}
+
+void
+PutBoth32(std::vector<unsigned char>& image, size_t pos, unsigned int value)
+{
+    for (size_t i = 0; i < 4; ++i)
+    {
+        image[pos + i] = static_cast<unsigned char>(value >> (8 * i));
+        image[pos + 7 - i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+void
+PutBoth16(std::vector<unsigned char>& image, size_t pos, unsigned int value)
+{
+    image[pos] = static_cast<unsigned char>(value);
+    image[pos + 1] = static_cast<unsigned char>(value >> 8);
+    image[pos + 2] = static_cast<unsigned char>(value >> 8);
+    image[pos + 3] = static_cast<unsigned char>(value);
+}
+
+/** A directory record; the identifier is already encoded */
+std::vector<unsigned char>
+Record(const std::string& identifier, unsigned int location, unsigned int length, bool directory)
+{
+    size_t size = 33 + identifier.size();
+    size += size % 2;
+
+    std::vector<unsigned char> record(size, 0);
+    record[0] = static_cast<unsigned char>(size);
+    PutBoth32(record, 2, location);
+    PutBoth32(record, 10, length);
+    record[25] = directory ? 0x02 : 0x00;
+    PutBoth16(record, 28, 1);
+    record[32] = static_cast<unsigned char>(identifier.size());
+    memcpy(&record[33], identifier.data(), identifier.size());
+    return record;
+}
+
+std::string
+Ucs2(const std::string& name)
+{
+    std::string encoded;
+    for (size_t i = 0; i < name.size(); ++i)
+    {
+        encoded.push_back('\0');
+        encoded.push_back(name[i]);
+    }
+    return encoded;
+}
+
+/** Directory records packed into blocks; a record never spans two */
+std::vector<unsigned char>
+Directory(const std::vector< std::vector<unsigned char> >& records, size_t blockSize)
+{
+    std::vector<unsigned char> extent;
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        size_t used = extent.size() % blockSize;
+        if (0 != used && used + records[i].size() > blockSize)
+        {
+            extent.resize(extent.size() + blockSize - used, 0);
+        }
+        extent.insert(extent.end(), records[i].begin(), records[i].end());
+    }
+    extent.resize((extent.size() + blockSize - 1) / blockSize * blockSize, 0);
+    return extent;
+}
+
+/** Build an image in memory */
+std::vector<unsigned char>
+BuildImage(size_t blockSize, bool joliet, size_t fillers)
+{
+    size_t descriptors = joliet ? 3 : 2;
+    size_t dataStart = (FIRST_DESCRIPTOR_SECTOR + descriptors) * SECTOR_SIZE;
+    unsigned int fileLocation = static_cast<unsigned int>(dataStart / blockSize);
+    unsigned int fileBlocks = 1;
+
+    // Directories follow the file; their size depends only on the names
+    std::vector< std::vector<unsigned char> > primary;
+    std::vector< std::vector<unsigned char> > supplementary;
+    for (size_t pass = 0; pass < 2; ++pass)
+    {
+        std::vector< std::vector<unsigned char> >& records = 0 == pass ? primary : supplementary;
+        records.push_back(Record(std::string(1, '\0'), 0, 0, true));
+        records.push_back(Record(std::string(1, '\1'), 0, 0, true));
+
+        // Neither record size divides 512, so every block ends in padding
+        for (size_t i = 0; i < fillers; ++i)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), 0 == pass ? "FILL%04u.TXT;1" : "filler-%04u.text", static_cast<unsigned int>(i));
+            records.push_back(Record(0 == pass ? name : Ucs2(name), fileLocation, 0, false));
+        }
+        records.push_back(Record(0 == pass ? ShortFileName : Ucs2(FileName),
+                                 fileLocation, sizeof(FileContents) - 1, false));
+    }
+
+    unsigned int primaryLocation = fileLocation + fileBlocks;
+    std::vector<unsigned char> primaryExtent = Directory(primary, blockSize);
+    unsigned int supplementaryLocation = primaryLocation + static_cast<unsigned int>(primaryExtent.size() / blockSize);
+    std::vector<unsigned char> supplementaryExtent = Directory(supplementary, blockSize);
+
+    std::vector<unsigned char> image(supplementaryLocation * blockSize + supplementaryExtent.size(), 0);
+    memcpy(&image[fileLocation * blockSize], FileContents, sizeof(FileContents) - 1);
+    memcpy(&image[primaryLocation * blockSize], &primaryExtent[0], primaryExtent.size());
+    if (joliet)
+    {
+        memcpy(&image[supplementaryLocation * blockSize], &supplementaryExtent[0], supplementaryExtent.size());
+    }
+
+    for (size_t i = 0; i < descriptors; ++i)
+    {
+        size_t pos = (FIRST_DESCRIPTOR_SECTOR + i) * SECTOR_SIZE;
+        bool terminator = i + 1 == descriptors;
+        image[pos] = terminator ? 255 : static_cast<unsigned char>(i + 1);
+        memcpy(&image[pos + 1], "CD001", 5);
+        image[pos + 6] = 1;
+        if (terminator)
+        {
+            continue;
+        }
+
+        PutBoth16(image, pos + 128, static_cast<unsigned int>(blockSize));
+        if (1 == i)
+        {
+            memcpy(&image[pos + 88], "%/E", 3);
+        }
+        std::vector<unsigned char> root = 0 == i ?
+            Record(std::string(1, '\0'), primaryLocation, static_cast<unsigned int>(primaryExtent.size()), true) :
+            Record(std::string(1, '\0'), supplementaryLocation, static_cast<unsigned int>(supplementaryExtent.size()), true);
+        memcpy(&image[pos + 156], &root[0], root.size());
+    }
+
+    return image;
+}
+
+/** Write an image to a temporary file and read a file from it */
+ISO9660Reader::Result
+Read(const std::vector<unsigned char>& image, const std::string& fileName, std::string& contents)
+{
+    char path[] = "/tmp/isoreaderXXXXXX";
+    int fd = mkstemp(path);
+    if (-1 == fd || static_cast<ssize_t>(image.size()) != write(fd, &image[0], image.size()))
+    {
+        perror("isoreader");
+        exit(1);
+    }
+    close(fd);
+
+    std::vector<unsigned char> data;
+    ISO9660Reader::Result result;
+    {
+        ISO9660Reader reader(path);
+        result = reader.ReadRootFile(fileName, data);
+    }
+    unlink(path);
+
+    contents.assign(data.begin(), data.end());
+    return result;
+}
+
+void
+Run(size_t blockSize, bool joliet, size_t fillers)
+{
+    std::vector<unsigned char> image = BuildImage(blockSize, joliet, fillers);
+    size_t rootBlocks = 0;
+    {
+        // The root directory of the volume read, from its descriptor
+        size_t pos = (FIRST_DESCRIPTOR_SECTOR + (joliet ? 1 : 0)) * SECTOR_SIZE + 156 + 10;
+        rootBlocks = (image[pos] | (image[pos + 1] << 8) | (image[pos + 2] << 16)) / blockSize;
+    }
+
+    printf("%s, %u byte blocks, root directory of %u blocks\n", joliet ? "Joliet" : "primary only",
+           static_cast<unsigned int>(blockSize), static_cast<unsigned int>(rootBlocks));
+    Check(rootBlocks > 1, "root directory spans blocks");
+
+    std::string contents;
+    ISO9660Reader::Result result = Read(image, joliet ? FileName : "LINUXOSC.XML", contents);
+    Check(ISO9660Reader::FileFound == result, "last file found");
+    Check(FileContents == contents, "contents read");
+
+    if (joliet)
+    {
+        result = Read(image, "missing.xml", contents);
+        Check(ISO9660Reader::FileNotFound == result, "missing file not found");
+    }
+}
+
+}
+
+int main()
+{
+    Run(2048, true, 100);
+    Run(512, true, 36);
+    Run(512, false, 30);
+
+    printf("%d check(s) failed\n", s_failures);
+    return 0 == s_failures ? 0 : 1;
+}
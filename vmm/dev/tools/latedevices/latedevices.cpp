@@ -0,0 +1,334 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        latedevices.cpp
+
+   \brief       Simulates CD-ROM devices that show up late and measures how
+                soon DeviceWatcher reports them
+
+                usage: latedevices [devices] [delay ms]
+
+                A child process creates the device nodes, as plain files in a
+                temporary directory, one every delay ms. Each report is timed
+                against the moment its node was created, next to when the 30
+                second retry passes that DeviceWatcher replaced would have found
+                it. Then the directory is flooded past the inotify queue limit
+                with devices created in the middle of the flood, which must all
+                still be reported. Last, a device that was reported and re-armed
+                must be reported again within two rescan intervals while unrelated
+                files keep appearing next to it. The exit code is 1 if a device
+                is missed.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <devicewatcher.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+namespace
+{
+
+using VMM::GuestAgent::Fetcher::DeviceWatcher;
+
+/** Interval of the retry passes DeviceWatcher replaced */
+unsigned int const c_RetryPassSecs = 30;
+
+/** Seconds DeviceWatcher waits in each scenario */
+unsigned int const c_TimeoutSecs = 20;
+
+/** How long and how often unrelated events arrive while a device is re-armed */
+int const c_EventStreamMs = 8000;
+int const c_EventIntervalMs = 200;
+
+/** Longest wait for a re-armed device to be reported again; twice the rescan interval */
+scxulong const c_RearmLimitMs = 4000;
+
+scxulong
+NowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<scxulong>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void
+SleepUntilUs(scxulong us)
+{
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(us / 1000000);
+    ts.tv_nsec = static_cast<long>(us % 1000000) * 1000;
+    while (0 != clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL))
+    {
+    }
+}
+
+void
+CreateFile(const std::string& path)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (-1 != fd)
+    {
+        close(fd);
+    }
+}
+
+std::vector<std::string>
+MakeCandidates(const std::string& dir, int count)
+{
+    std::vector<std::string> candidates;
+    for (int i = 0; i < count; ++i)
+    {
+        std::ostringstream path;
+        path << dir << "/cdrom" << i;
+        candidates.push_back(path.str());
+    }
+    return candidates;
+}
+
+/** Wait for all candidates; returns how many were reported and the report time of each */
+size_t
+Collect(DeviceWatcher& watcher, const std::vector<std::string>& candidates, std::vector<scxulong>& reportedAt)
+{
+    reportedAt.assign(candidates.size(), 0);
+    size_t reported = 0;
+
+    std::vector<std::string> devices;
+    while (reported < candidates.size() && watcher.WaitForDevices(devices))
+    {
+        scxulong now = NowUs();
+        for (size_t i = 0; i < devices.size(); ++i)
+        {
+            size_t index = std::find(candidates.begin(), candidates.end(), devices[i]) - candidates.begin();
+            if (index < candidates.size() && 0 == reportedAt[index])
+            {
+                reportedAt[index] = now;
+                reported++;
+            }
+        }
+    }
+    return reported;
+}
+
+/** Devices created one every delay ms; returns the number missed */
+size_t
+RunLateDevices(const std::string& dir, int count, int delayMs)
+{
+    std::vector<std::string> candidates = MakeCandidates(dir, count);
+    DeviceWatcher watcher(candidates, c_TimeoutSecs);
+
+    scxulong start = NowUs() + 100000;
+    pid_t pid = fork();
+    if (0 == pid)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            SleepUntilUs(start + static_cast<scxulong>(i) * delayMs * 1000);
+            CreateFile(candidates[i]);
+        }
+        _exit(0);
+    }
+
+    std::vector<scxulong> reportedAt;
+    size_t reported = Collect(watcher, candidates, reportedAt);
+    waitpid(pid, NULL, 0);
+
+    printf("device  created s  reported after ms  30 s passes would find it at s\n");
+    for (int i = 0; i < count; ++i)
+    {
+        double created = static_cast<double>(i) * delayMs / 1000;
+        unsigned int pass = (static_cast<unsigned int>(created) / c_RetryPassSecs + 1) * c_RetryPassSecs;
+        if (0 == reportedAt[i])
+        {
+            printf("cdrom%-2d %9.2f  %17s  %u\n", i, created, "missed", pass);
+            continue;
+        }
+        scxulong createdAt = start + static_cast<scxulong>(i) * delayMs * 1000;
+        printf("cdrom%-2d %9.2f  %17.2f  %u\n", i, created,
+               static_cast<double>(reportedAt[i] - std::min(reportedAt[i], createdAt)) / 1000, pass);
+    }
+    return candidates.size() - reported;
+}
+
+unsigned int
+MaxQueuedEvents()
+{
+    unsigned int events = 16384;
+    std::ifstream file("/proc/sys/fs/inotify/max_queued_events");
+    file >> events;
+    return events;
+}
+
+/** Devices created before and in the middle of more events than inotify queues; returns the number missed */
+size_t
+RunOverflow(const std::string& dir, int count)
+{
+    std::vector<std::string> candidates = MakeCandidates(dir, count);
+    DeviceWatcher watcher(candidates, c_TimeoutSecs);
+
+    unsigned int flood = MaxQueuedEvents() + 1000;
+    std::vector<std::string> junk;
+    for (unsigned int i = 0; i < flood; ++i)
+    {
+        if (0 == i % (flood / count + 1))
+        {
+            CreateFile(candidates[i / (flood / count + 1)]);
+        }
+        std::ostringstream path;
+        path << dir << "/junk" << i;
+        junk.push_back(path.str());
+        CreateFile(junk.back());
+    }
+
+    std::vector<scxulong> reportedAt;
+    size_t reported = Collect(watcher, candidates, reportedAt);
+    for (size_t i = 0; i < junk.size(); ++i)
+    {
+        unlink(junk[i].c_str());
+    }
+
+    printf("%u events queued for %d devices, %lu reported\n", flood, count, static_cast<unsigned long>(reported));
+    return candidates.size() - reported;
+}
+
+/** A re-armed device while unrelated events keep arriving; returns 1 if it is not reported again in time */
+size_t
+RunRearmUnderEvents(const std::string& dir)
+{
+    std::vector<std::string> candidates = MakeCandidates(dir, 1);
+    CreateFile(candidates[0]);
+    DeviceWatcher watcher(candidates, c_TimeoutSecs);
+
+    std::vector<std::string> devices;
+    watcher.GetPresentDevices(devices);
+    watcher.Rearm(candidates[0]);
+
+    // Unrelated files appear more often than the rescan interval, for longer
+    // than a re-armed device may wait for its rescan
+    pid_t pid = fork();
+    if (0 == pid)
+    {
+        for (int i = 0; i < c_EventStreamMs / c_EventIntervalMs; ++i)
+        {
+            std::ostringstream path;
+            path << dir << "/noise" << i;
+            CreateFile(path.str());
+            unlink(path.str().c_str());
+            usleep(c_EventIntervalMs * 1000);
+        }
+        _exit(0);
+    }
+
+    scxulong start = NowUs();
+    bool reported = watcher.WaitForDevices(devices);
+    scxulong elapsedMs = (NowUs() - start) / 1000;
+    waitpid(pid, NULL, 0);
+
+    printf("re-armed device reported again after %lu ms under a stream of events\n",
+           static_cast<unsigned long>(elapsedMs));
+    return reported && elapsedMs < c_RearmLimitMs ? 0 : 1;
+}
+
+void
+RemoveCandidates(const std::string& dir, int count)
+{
+    std::vector<std::string> candidates = MakeCandidates(dir, count);
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        unlink(candidates[i].c_str());
+    }
+}
+
+}
+
+int
+main(
+    int const argc,
+    char const* const* argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 6;
+    int delayMs = argc > 2 ? atoi(argv[2]) : 500;
+
+    if (count <= 0 || delayMs < 0)
+    {
+        fprintf(stderr, "usage: latedevices [devices] [delay ms]\n");
+        return 1;
+    }
+
+    char dirTemplate[] = "/tmp/latedevicesXXXXXX";
+    if (NULL == mkdtemp(dirTemplate))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string dir(dirTemplate);
+
+    size_t missed = RunLateDevices(dir, count, delayMs);
+    RemoveCandidates(dir, count);
+
+    missed += RunOverflow(dir, count);
+    RemoveCandidates(dir, count);
+
+    missed += RunRearmUnderEvents(dir);
+    RemoveCandidates(dir, 1);
+    rmdir(dir.c_str());
+
+    printf("%lu devices missed\n", static_cast<unsigned long>(missed));
+    return missed ? 1 : 0;
+}
@@ -0,0 +1,448 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        netconfigengine.cpp
+
+   \brief       Runs NetworkConfigEngine against an in-process fake network
+                stack and a scratch root tree
+
+                usage: netconfigengine
+
+                Each scenario lays out the files of a distribution under a
+                temporary root, configures adapters on a fake stack and
+                compares the rewritten files, the addresses and routes applied
+                and the number of network restarts with what cfgnetadapter
+                produces. Neighbouring entries that only share a prefix with
+                the adapter (10.0.0.10 next to 10.0.0.1, eth10 next to eth1,
+                GATEWAYDEV next to GATEWAY) must survive, and rewritten files
+                keep their mode. An adapter whose hardware address is not
+                found is skipped with a warning. The exit code is 1 if a check
+                fails.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <networkconfigengine.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+using VMM::GuestAgent::OSConfigurator::AdapterSettings;
+using VMM::GuestAgent::OSConfigurator::NetworkAddress;
+using VMM::GuestAgent::OSConfigurator::NetworkConfigEngine;
+using VMM::GuestAgent::OSConfigurator::NetworkLink;
+using VMM::GuestAgent::OSConfigurator::NetworkStack;
+
+namespace
+{
+
+/** A default route set on the fake stack */
+struct FakeRoute
+{
+    int             index;
+    int             family;
+    std::string     gateway;
+};
+
+/** Keeps links, addresses and routes in memory */
+class FakeStack : public NetworkStack
+{
+public:
+    void AddLink(int index, const std::string& name, const std::string& macAddress)
+    {
+        NetworkLink link;
+        link.index = index;
+        link.name = name;
+        link.macAddress = macAddress;
+        link.isEthernet = true;
+        link.isUp = false;
+        m_links.push_back(link);
+    }
+
+    virtual bool GetLinks(std::vector<NetworkLink>& links)
+    {
+        links = m_links;
+        return true;
+    }
+
+    virtual bool GetAddresses(int index, std::vector<NetworkAddress>& addresses)
+    {
+        addresses.clear();
+        for (size_t i = 0; i < m_addresses.size(); ++i)
+        {
+            if (m_addressLinks[i] == index)
+            {
+                addresses.push_back(m_addresses[i]);
+            }
+        }
+        return true;
+    }
+
+    virtual bool SetLinkUp(int index)
+    {
+        for (std::vector<NetworkLink>::iterator iter = m_links.begin(); iter != m_links.end(); ++iter)
+        {
+            if (iter->index == index)
+            {
+                iter->isUp = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    virtual bool AddAddress(int index, const NetworkAddress& address)
+    {
+        m_addressLinks.push_back(index);
+        m_addresses.push_back(address);
+        return true;
+    }
+
+    virtual bool AddDefaultRoute(int index, int family, const std::string& gateway)
+    {
+        FakeRoute route;
+        route.index = index;
+        route.family = family;
+        route.gateway = gateway;
+        m_routes.push_back(route);
+        return true;
+    }
+
+    std::vector<NetworkLink>        m_links;
+    std::vector<int>                m_addressLinks;
+    std::vector<NetworkAddress>     m_addresses;
+    std::vector<FakeRoute>          m_routes;
+};
+
+/** Counts network restarts instead of running the service */
+class FakeEngine : public NetworkConfigEngine
+{
+public:
+    FakeEngine(NetworkStack& stack, const std::string& root)
+      : NetworkConfigEngine(stack, root, root + "/definedadapters")
+      , m_restarts(0)
+    {
+    }
+
+    int m_restarts;
+
+protected:
+    virtual bool RestartNetwork()
+    {
+        m_restarts++;
+        return true;
+    }
+};
+
+int s_failures = 0;
+
+void
+Check(bool condition, const std::string& what)
+{
+    printf("  %-60s %s\n", what.c_str(), condition ? "ok" : "FAILED");
+    if (!condition)
+    {
+        s_failures++;
+    }
+}
+
+void
+WriteFile(const std::string& path, const std::string& contents)
+{
+    std::ofstream fileStream(path.c_str(), std::ios::out | std::ios::trunc);
+    fileStream << contents;
+}
+
+std::vector<std::string>
+ReadFile(const std::string& path)
+{
+    std::vector<std::string> lines;
+    std::ifstream fileStream(path.c_str());
+    std::string line;
+    while (std::getline(fileStream, line))
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+bool
+HasLine(const std::vector<std::string>& lines, const std::string& line)
+{
+    return lines.end() != std::find(lines.begin(), lines.end(), line);
+}
+
+bool
+HasLineStartingWith(const std::vector<std::string>& lines, const std::string& prefix)
+{
+    for (std::vector<std::string>::const_iterator iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+        if (0 == iter->compare(0, prefix.length(), prefix))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+Exists(const std::string& path)
+{
+    struct stat statBuff;
+    return 0 == stat(path.c_str(), &statBuff);
+}
+
+/** Permission bits of a file, or -1 if it does not exist */
+int
+Mode(const std::string& path)
+{
+    struct stat statBuff;
+    return 0 == stat(path.c_str(), &statBuff) ? static_cast<int>(statBuff.st_mode & 07777) : -1;
+}
+
+std::string
+MakeRoot()
+{
+    char dir[] = "/tmp/netconfigengineXXXXXX";
+    if (0 == mkdtemp(dir))
+    {
+        perror("mkdtemp");
+        exit(2);
+    }
+    std::string root = dir;
+    mkdir((root + "/etc").c_str(), 0755);
+    return root;
+}
+
+void
+RemoveRoot(const std::string& root)
+{
+    std::string command = "rm -rf '" + root + "'";
+    if (0 != system(command.c_str()))
+    {
+        fprintf(stderr, "Failed to remove %s\n", root.c_str());
+    }
+}
+
+AdapterSettings
+StaticAdapter(const std::string& macAddress, const std::string& address, const std::string& gateway)
+{
+    AdapterSettings settings;
+    settings.macAddress = macAddress;
+    settings.ipv4AddressType = "static";
+    settings.ipv4Address = address;
+    settings.gateways.push_back(gateway);
+    return settings;
+}
+
+void
+RunRHEL()
+{
+    printf("RHEL\n");
+    std::string root = MakeRoot();
+    mkdir((root + "/etc/sysconfig").c_str(), 0755);
+    mkdir((root + "/etc/sysconfig/network-scripts").c_str(), 0755);
+    WriteFile(root + "/etc/sysconfig/network",
+              "NETWORKING=no\nGATEWAYDEV=eth9\nGATEWAY=192.168.0.1\nHOSTNAME=guest\n");
+    WriteFile(root + "/etc/sysconfig/network-scripts/ifcfg-eth7", "DEVICE=eth7\n");
+    WriteFile(root + "/etc/sysconfig/network-scripts/ifcfg-lo", "DEVICE=lo\n");
+    WriteFile(root + "/etc/hosts", "127.0.0.1  localhost\n10.0.0.1  stale\n10.0.0.10  neighbour\n");
+    WriteFile(root + "/etc/resolv.conf", "search example.com\n");
+    chmod((root + "/etc/hosts").c_str(), 0640);
+
+    FakeStack stack;
+    stack.AddLink(1, "lo", "");
+    stack.AddLink(2, "eth0", "00:15:5d:00:00:01");
+
+    FakeEngine engine(stack, root);
+    Check(NetworkConfigEngine::RHELDistro == engine.GetDistro(), "distribution detected");
+
+    std::vector<AdapterSettings> adapters;
+    adapters.push_back(StaticAdapter("00-15-5D-00-00-01", "10.0.0.1/24", "10.0.0.254"));
+    NetworkConfigEngine::Result result = engine.Configure(adapters, false);
+
+    Check(NetworkConfigEngine::Succeeded == result, "configured");
+    Check(1 == engine.m_restarts, "network restarted once");
+
+    std::vector<std::string> ifcfg = ReadFile(root + "/etc/sysconfig/network-scripts/ifcfg-eth0");
+    Check(HasLine(ifcfg, "BOOTPROTO='static'"), "ifcfg-eth0 is static");
+    Check(HasLine(ifcfg, "IPADDR='10.0.0.1'"), "ifcfg-eth0 has the address");
+    Check(HasLine(ifcfg, "NETMASK='255.255.255.0'"), "ifcfg-eth0 has the netmask");
+    Check(!Exists(root + "/etc/sysconfig/network-scripts/ifcfg-eth7"), "ifcfg of a missing interface removed");
+    Check(Exists(root + "/etc/sysconfig/network-scripts/ifcfg-lo"), "ifcfg-lo kept");
+
+    std::vector<std::string> network = ReadFile(root + "/etc/sysconfig/network");
+    Check(HasLine(network, "NETWORKING=yes") && !HasLine(network, "NETWORKING=no"), "networking enabled");
+    Check(HasLine(network, "GATEWAY=10.0.0.254") && !HasLine(network, "GATEWAY=192.168.0.1"), "default gateway replaced");
+    Check(HasLine(network, "GATEWAYDEV=eth9"), "GATEWAYDEV kept");
+    Check(HasLine(network, "HOSTNAME=guest"), "HOSTNAME kept");
+
+    std::vector<std::string> hosts = ReadFile(root + "/etc/hosts");
+    Check(!HasLine(hosts, "10.0.0.1  stale"), "old hosts entry of the address removed");
+    Check(HasLine(hosts, "10.0.0.10  neighbour"), "hosts entry of 10.0.0.10 kept");
+    Check(HasLine(hosts, "127.0.0.1  localhost"), "hosts entry of localhost kept");
+    Check(0640 == Mode(root + "/etc/hosts"), "mode of hosts kept");
+
+    bool hasAddress = false;
+    for (size_t i = 0; i < stack.m_addresses.size(); ++i)
+    {
+        hasAddress = hasAddress || (2 == stack.m_addressLinks[i] && AF_INET == stack.m_addresses[i].family &&
+                                    "10.0.0.1" == stack.m_addresses[i].address &&
+                                    24 == stack.m_addresses[i].prefixLength);
+    }
+    Check(hasAddress, "address applied to eth0");
+    Check(1 == stack.m_routes.size() && 2 == stack.m_routes[0].index &&
+          "10.0.0.254" == stack.m_routes[0].gateway, "default route applied through eth0");
+
+    std::vector<std::string> defined = ReadFile(root + "/definedadapters");
+    Check(HasLine(defined, "eth0"), "eth0 recorded as defined");
+
+    RemoveRoot(root);
+}
+
+void
+RunDebian()
+{
+    printf("Debian\n");
+    std::string root = MakeRoot();
+    mkdir((root + "/etc/network").c_str(), 0755);
+    WriteFile(root + "/etc/debian_version", "12.0\n");
+    WriteFile(root + "/etc/network/interfaces",
+              "auto lo\n"
+              "iface lo inet loopback\n"
+              "\n"
+              "#eth1\n"
+              "auto eth1\n"
+              "iface eth1 inet static\n"
+              "     address 192.168.1.5\n"
+              "     netmask 255.255.255.0\n"
+              "\n"
+              "auto eth10\n"
+              "iface eth10 inet dhcp\n"
+              "\n"
+              "auto eth3\n"
+              "iface eth3 inet dhcp\n");
+    chmod((root + "/etc/network/interfaces").c_str(), 0600);
+
+    FakeStack stack;
+    stack.AddLink(1, "lo", "");
+    stack.AddLink(2, "eth1", "00:15:5d:00:00:02");
+    stack.AddLink(3, "eth10", "00:15:5d:00:00:0a");
+
+    FakeEngine engine(stack, root);
+    Check(NetworkConfigEngine::DebianDistro == engine.GetDistro(), "distribution detected");
+
+    std::vector<AdapterSettings> adapters;
+    adapters.push_back(StaticAdapter("00:15:5d:00:00:02", "10.1.0.5/16", "10.1.0.1"));
+    NetworkConfigEngine::Result result = engine.Configure(adapters, false);
+
+    Check(NetworkConfigEngine::Succeeded == result, "configured");
+    Check(1 == engine.m_restarts, "network restarted once");
+
+    std::vector<std::string> interfaces = ReadFile(root + "/etc/network/interfaces");
+    Check(HasLine(interfaces, "iface eth1 inet static"), "eth1 stanza written");
+    Check(HasLine(interfaces, "     address 10.1.0.5"), "eth1 has the new address");
+    Check(HasLine(interfaces, "     netmask 255.255.0.0"), "eth1 has the new netmask");
+    Check(HasLine(interfaces, "     gateway 10.1.0.1"), "eth1 has the gateway");
+    Check(!HasLine(interfaces, "     address 192.168.1.5"), "old eth1 stanza removed");
+    Check(HasLine(interfaces, "iface eth10 inet dhcp"), "eth10 stanza kept");
+    Check(!HasLineStartingWith(interfaces, "iface eth3 "), "stanza of a missing interface removed");
+    Check(HasLine(interfaces, "iface lo inet loopback"), "loopback stanza kept");
+    Check(0600 == Mode(root + "/etc/network/interfaces"), "mode of interfaces kept");
+    Check(1 == stack.m_routes.size() && 2 == stack.m_routes[0].index, "default route applied through eth1");
+
+    RemoveRoot(root);
+}
+
+void
+RunUnknownAdapter()
+{
+    printf("Unknown hardware address\n");
+    std::string root = MakeRoot();
+    mkdir((root + "/etc/sysconfig").c_str(), 0755);
+    mkdir((root + "/etc/sysconfig/network-scripts").c_str(), 0755);
+    WriteFile(root + "/etc/sysconfig/network", "NETWORKING=yes\n");
+
+    FakeStack stack;
+    stack.AddLink(2, "eth0", "00:15:5d:00:00:01");
+
+    FakeEngine engine(stack, root);
+    std::vector<AdapterSettings> adapters;
+    adapters.push_back(StaticAdapter("00:15:5d:00:00:99", "10.0.0.9/24", "10.0.0.254"));
+    adapters.push_back(StaticAdapter("00:15:5d:00:00:01", "10.0.0.1/24", "10.0.0.254"));
+    NetworkConfigEngine::Result result = engine.Configure(adapters, false);
+
+    Check(NetworkConfigEngine::SucceededWithWarnings == result, "configured with warnings");
+    Check(1 == engine.m_restarts, "network restarted once");
+    Check(1 == stack.m_addresses.size() && "10.0.0.1" == stack.m_addresses[0].address,
+          "only the known adapter applied");
+    Check(Exists(root + "/etc/sysconfig/network-scripts/ifcfg-eth0"), "known adapter written");
+
+    RemoveRoot(root);
+}
+
+}
+
+int main()
+{
+    RunRHEL();
+    RunDebian();
+    RunUnknownAdapter();
+
+    printf("%d check(s) failed\n", s_failures);
+    return 0 == s_failures ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        outputtail.cpp
+
+   \brief       Feeds LogOutputSink command output that is not valid UTF-8 and
+                checks that the tail it keeps can go into the status report
+
+                usage: outputtail
+
+                Each case writes bytes to a sink, compares GetTail with the
+                expected text and puts the tail into an XElement, which throws
+                on invalid UTF-8. The exit code is 1 if a check fails.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxexception.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <logoutputsink.h>
+#include <util/XElement.h>
+
+#include <locale.h>
+#include <stdio.h>
+
+#include <string>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+using VMM::GuestAgent::Utilities::LogOutputSink;
+using SCX::Util::Xml::XElement;
+
+namespace
+{
+
+int s_failures = 0;
+
+void
+Check(bool condition, const std::string& what)
+{
+    printf("  %-60s %s\n", what.c_str(), condition ? "ok" : "FAILED");
+    if (!condition)
+    {
+        s_failures++;
+    }
+}
+
+/** Write output to a sink with the given tail size and check the tail */
+void
+Run(const std::string& name, const std::string& output, size_t tailBytes, const std::string& expected)
+{
+    printf("%s\n", name.c_str());
+
+    LogOutputSink sink(SCXCoreLib::SCXLogHandleFactory::GetLogHandle(L"scx.vmmguestagent.tools.outputtail"),
+                       "outputtail: ", SCXCoreLib::eInfo, tailBytes);
+    bool written = true;
+    try
+    {
+        sink.Write(output.data(), output.size());
+        sink.Flush();
+    }
+    catch (SCXCoreLib::SCXException&)
+    {
+        written = false;
+    }
+    Check(written, "output logged");
+
+    std::string tail = sink.GetTail();
+    Check(expected == tail, "tail is \"" + expected + "\"");
+
+    bool accepted = true;
+    try
+    {
+        XElement element("StdoutTail");
+        element.SetContent(tail);
+    }
+    catch (SCXCoreLib::SCXException&)
+    {
+        accepted = false;
+    }
+    Check(accepted, "tail accepted by XElement");
+}
+
+}
+
+int main()
+{
+    // The agent logs in a UTF-8 locale
+    setlocale(LC_ALL, "C.UTF-8");
+
+    Run("UTF-8", "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\n", 64, "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\n");
+    Run("Latin-1", "caf\xe9\n", 64, "caf?\n");
+    Run("sequence cut short at the end", "price \xe2\x82", 64, "price ??");
+    Run("sequence cut at the start of the tail", "xx\xc3\xa9\xe2\x82\xac", 4, "\xe2\x82\xac");
+    Run("overlong form", "\xc0\xaf\xe0\x80\xaf", 64, "?????");
+    Run("surrogate", "\xed\xa0\x80", 64, "???");
+    Run("past U+10FFFF", "\xf4\x90\x80\x80", 64, "????");
+    Run("control characters", "a\x01\x1b[0m\x7f\tb\r\n", 64, "a??[0m\x7f\tb\r\n");
+
+    printf("%d check(s) failed\n", s_failures);
+    return 0 == s_failures ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        runonce.cpp
+
+   \brief       Runs run-once commands whose log line throws and checks that
+                RunOnceCommandConfigurator still returns and reports them
+
+                usage: runonce
+
+                The tool leaves the locale at "C", where logging a command
+                line with non-ASCII characters throws. It runs such a command
+                on its own, then in a parallel group next to a plain one, under
+                SCVMM_HOME set to a new temporary directory that is left for
+                inspection, and looks for the results in statusmessage.xml. A
+                hang is ended by an alarm after 60 seconds. The exit code is 1
+                if a check fails.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <argumentmanager.h>
+#include <runoncecommandconfigurator.h>
+#include <statusmessage.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+using VMM::GuestAgent::OSConfigurator::RunOnceCommandConfigurator;
+using VMM::GuestAgent::StatusManager::StatusMessage;
+using VMM::GuestAgent::Utilities::ArgumentManager;
+
+namespace
+{
+
+int s_failures = 0;
+
+// Logging this command line throws outside a UTF-8 locale
+const char ThrowingCommand[] = "echo caf\xc3\xa9";
+
+void
+Check(bool condition, const std::string& what)
+{
+    printf("  %-60s %s\n", what.c_str(), condition ? "ok" : "FAILED");
+    if (!condition)
+    {
+        s_failures++;
+    }
+}
+
+/** Does the status file hold a result of a sequence with an exit code? */
+bool
+HasResult(int sequence, const std::string& exitCode)
+{
+    StatusMessage::Instance().Flush();
+    std::ifstream file((ArgumentManager::Instance().GetVMMHome() + "status/statusmessage.xml").c_str());
+    std::ostringstream content;
+    content << file.rdbuf();
+    std::string status = content.str();
+
+    std::ostringstream strm;
+    strm << " Sequence=\"" << sequence << "\"";
+
+    size_t start = status.find("<RunOnceCommandResult ");
+    while (std::string::npos != start)
+    {
+        std::string element = status.substr(start, status.find('>', start) - start);
+        if (std::string::npos != element.find(strm.str()))
+        {
+            return std::string::npos != element.find(" ExitCode=\"" + exitCode + "\"");
+        }
+        start = status.find("<RunOnceCommandResult ", start + 1);
+    }
+    return false;
+}
+
+/** Run commands and check that Execute returns */
+void
+Run(const std::string& name,
+    const std::map<int, SCX::Util::Utf8String>& commands,
+    const std::map<int, int>& groups)
+{
+    printf("%s\n", name.c_str());
+
+    bool returned = true;
+    try
+    {
+        RunOnceCommandConfigurator configurator;
+        configurator.Execute(commands, groups);
+    }
+    catch (...)
+    {
+        returned = false;
+    }
+    Check(returned, "Execute returned without an exception");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    char home[] = "/tmp/runonceXXXXXX";
+    if (NULL == mkdtemp(home))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    setenv("SCVMM_HOME", (std::string(home) + "/").c_str(), 1);
+
+    SCXCoreLib::SCXLogHandle logHandle(SCXCoreLib::SCXLogHandleFactory::GetLogHandle(L"scx.vmmguestagent.tools.runonce"));
+    if (EXIT_SUCCESS != ArgumentManager::Instance().LoadArgs(1, argv, logHandle))
+    {
+        return 1;
+    }
+    (void) argc;
+
+    // A command that never returns is reported as a hang by the alarm, so
+    // the checks done so far must not sit in a buffer
+    setvbuf(stdout, NULL, _IONBF, 0);
+    alarm(60);
+
+    std::map<int, SCX::Util::Utf8String> commands;
+    std::map<int, int> groups;
+
+    commands[1] = SCX::Util::Utf8String(ThrowingCommand);
+    Run("serial command", commands, groups);
+    Check(HasResult(1, "-1"), "command reported as failed");
+
+    commands.clear();
+    commands[2] = SCX::Util::Utf8String(ThrowingCommand);
+    commands[3] = SCX::Util::Utf8String("true");
+    groups[2] = 1;
+    groups[3] = 1;
+    Run("parallel group", commands, groups);
+    Check(HasResult(2, "-1"), "command reported as failed");
+    Check(HasResult(3, "0"), "command next to it reported as run");
+
+    printf("%d check(s) failed\n", s_failures);
+    return 0 == s_failures ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        scheduler.cpp
+
+   \brief       Runs ConfiguratorScheduler over fake configurators and checks
+                what it dispatches
+
+                usage: scheduler
+
+                The fake configurators record that they ran and what
+                HISTIGNORE held at that point, and may sleep or throw. After a
+                configurator fails, including with an exception that is not an
+                SCXException, the configurators that depend on it or on a
+                configurator still running must not start. A hang is ended by
+                an alarm after 60 seconds. The exit code is 1 if a check fails.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxexception.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <configuratorscheduler.h>
+#include <osconfigurator.h>
+#include <osconfiguratorvisitor.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+using namespace VMM::GuestAgent::OSConfigurator;
+
+namespace
+{
+
+int s_failures = 0;
+
+void
+Check(bool condition, const std::string& what)
+{
+    printf("  %-60s %s\n", what.c_str(), condition ? "ok" : "FAILED");
+    if (!condition)
+    {
+        s_failures++;
+    }
+}
+
+/** The fake configurators do their work in Accept */
+class NullVisitor : public Visitor
+{
+public:
+    virtual void Visit(PreConfigurator*) {}
+    virtual void Visit(HostDomainConfigurator*) {}
+    virtual void Visit(TimeZoneConfigurator*) {}
+    virtual void Visit(NetworkConfigurator*) {}
+    virtual void Visit(UsersConfigurator*) {}
+    virtual void Visit(RunOnceCommandConfigurator*) {}
+    virtual void Visit(PostConfigurator*) {}
+};
+
+class FakeConfigurator : public OSConfigurator
+{
+public:
+    enum Behaviour
+    {
+        Succeed,
+        Sleep,
+        ThrowSCXException,
+        ThrowOther
+    };
+
+    FakeConfigurator(ConfiguratorId id, Behaviour behaviour)
+      : m_id(id)
+      , m_behaviour(behaviour)
+      , m_ran(false)
+      , m_histIgnoreSet(false)
+    {
+    }
+
+    void DependOn(ConfiguratorId id)
+    {
+        m_dependencies.push_back(id);
+    }
+
+    virtual void Accept(Visitor&)
+    {
+        m_ran = true;
+        const char* histIgnore = getenv("HISTIGNORE");
+        m_histIgnoreSet = NULL != histIgnore && 0 == strcmp("*", histIgnore);
+
+        switch (m_behaviour)
+        {
+        case Succeed:
+            break;
+        case Sleep:
+            usleep(200 * 1000);
+            break;
+        case ThrowSCXException:
+            throw SCXCoreLib::SCXInternalErrorException(L"fake failure", SCXSRCLOCATION);
+        case ThrowOther:
+            throw 42;
+        }
+    }
+
+    virtual ConfiguratorId GetId() const
+    {
+        return m_id;
+    }
+
+    virtual void GetDependencies(ConfiguratorIds& dependencies) const
+    {
+        dependencies = m_dependencies;
+    }
+
+    ConfiguratorId    m_id;
+    Behaviour         m_behaviour;
+    ConfiguratorIds   m_dependencies;
+    bool              m_ran;
+    bool              m_histIgnoreSet;
+};
+
+/** Run the configurators; returns false if Run threw */
+bool
+Run(std::vector<FakeConfigurator*>& fakes)
+{
+    NullVisitor visitor;
+    std::vector<OSConfigurator*> configurators(fakes.begin(), fakes.end());
+    try
+    {
+        ConfiguratorScheduler scheduler(visitor, configurators);
+        scheduler.Run();
+    }
+    catch (SCXCoreLib::SCXException&)
+    {
+        return false;
+    }
+    return true;
+}
+
+void
+RunAll()
+{
+    printf("all succeed\n");
+    FakeConfigurator pre(PreConfiguratorId, FakeConfigurator::Succeed);
+    FakeConfigurator timeZone(TimeZoneConfiguratorId, FakeConfigurator::Sleep);
+    FakeConfigurator hostDomain(HostDomainConfiguratorId, FakeConfigurator::Succeed);
+    timeZone.DependOn(PreConfiguratorId);
+    hostDomain.DependOn(PreConfiguratorId);
+
+    std::vector<FakeConfigurator*> fakes;
+    fakes.push_back(&pre);
+    fakes.push_back(&timeZone);
+    fakes.push_back(&hostDomain);
+
+    Check(Run(fakes), "Run returned");
+    Check(pre.m_ran && timeZone.m_ran && hostDomain.m_ran, "every configurator ran");
+    Check(pre.m_histIgnoreSet && timeZone.m_histIgnoreSet && hostDomain.m_histIgnoreSet,
+          "HISTIGNORE set before any configurator ran");
+}
+
+void
+RunFailure(const std::string& name, FakeConfigurator::Behaviour failure)
+{
+    printf("%s\n", name.c_str());
+
+    // Users waits for HostDomain, which is still sleeping when Pre fails
+    FakeConfigurator pre(PreConfiguratorId, failure);
+    FakeConfigurator hostDomain(HostDomainConfiguratorId, FakeConfigurator::Sleep);
+    FakeConfigurator users(UsersConfiguratorId, FakeConfigurator::Succeed);
+    FakeConfigurator timeZone(TimeZoneConfiguratorId, FakeConfigurator::Succeed);
+    users.DependOn(HostDomainConfiguratorId);
+    timeZone.DependOn(PreConfiguratorId);
+
+    std::vector<FakeConfigurator*> fakes;
+    fakes.push_back(&pre);
+    fakes.push_back(&hostDomain);
+    fakes.push_back(&users);
+    fakes.push_back(&timeZone);
+
+    Check(!Run(fakes), "Run threw");
+    Check(hostDomain.m_ran, "configurator running at the failure finished");
+    Check(!timeZone.m_ran, "dependant of the failed configurator not started");
+    Check(!users.m_ran, "dependant of the running configurator not started");
+}
+
+}
+
+int main()
+{
+    // A scheduler waiting forever is reported as a hang by the alarm, so the
+    // checks done so far must not sit in a buffer
+    setvbuf(stdout, NULL, _IONBF, 0);
+    alarm(60);
+
+    unsetenv("HISTIGNORE");
+
+    RunAll();
+    RunFailure("configurator throws an SCXException", FakeConfigurator::ThrowSCXException);
+    RunFailure("configurator throws something else", FakeConfigurator::ThrowOther);
+
+    printf("%d check(s) failed\n", s_failures);
+    return 0 == s_failures ? 0 : 1;
+}
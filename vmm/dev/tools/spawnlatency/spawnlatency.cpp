@@ -0,0 +1,181 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        spawnlatency.cpp
+
+   \brief       Measures how long SCXProcess takes to run a trivial command,
+                launched with a vfork-style clone and with fork(), and how
+                long SCXProcessLoop takes to run the same number of them
+                concurrently from one thread
+
+                usage: spawnlatency [iterations] [ballast MB]
+
+                The ballast is touched heap that makes the process as large
+                as a busy agent, which is what makes fork() slow.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxprocess.h>
+#include <scxcorelib/scxprocessloop.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+namespace
+{
+
+scxulong
+NowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<scxulong>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void
+Measure(const char* method, bool forceFork, int iterations)
+{
+    SCXCoreLib::SCXProcess::ForceFork(forceFork);
+
+    std::vector<scxulong> samples;
+    for (int i = 0; i < iterations; ++i)
+    {
+        std::istringstream in("");
+        std::ostringstream out;
+        std::ostringstream err;
+
+        scxulong start = NowUs();
+        int ret = SCXCoreLib::SCXProcess::Run(L"/bin/true", in, out, err);
+        samples.push_back(NowUs() - start);
+
+        if (0 != ret)
+        {
+            fprintf(stderr, "%s: /bin/true returned %d\n", method, ret);
+        }
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    scxulong total = 0;
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        total += samples[i];
+    }
+
+    printf("%-6s  mean %8lu us  median %8lu us  p90 %8lu us\n",
+           method,
+           static_cast<unsigned long>(total / samples.size()),
+           static_cast<unsigned long>(samples[samples.size() / 2]),
+           static_cast<unsigned long>(samples[samples.size() * 9 / 10]));
+}
+
+void
+MeasureLoop(int iterations)
+{
+    SCXCoreLib::SCXProcess::ForceFork(false);
+
+    std::vector<std::wstring> args(1, L"/bin/true");
+    std::vector<SCXCoreLib::SCXHandle<SCXCoreLib::SCXProcessResult> > results;
+
+    // The timeout only has to be long enough never to fire; it makes the
+    // loop register and cancel a deadline per child as a real caller would
+    SCXCoreLib::SCXProcessLoop loop;
+    scxulong start = NowUs();
+    for (int i = 0; i < iterations; ++i)
+    {
+        results.push_back(loop.Start(args, std::string(), 60000));
+    }
+    loop.Run();
+    scxulong total = NowUs() - start;
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        if (!results[i]->exited || 0 != results[i]->exitCode)
+        {
+            fprintf(stderr, "loop: /bin/true pid %d returned %d%s\n",
+                    static_cast<int>(results[i]->pid), results[i]->exitCode,
+                    results[i]->timedOut ? " (timed out)" : "");
+        }
+    }
+
+    printf("%-6s  mean %8lu us  total %8lu us\n",
+           "loop",
+           static_cast<unsigned long>(total / results.size()),
+           static_cast<unsigned long>(total));
+}
+
+}
+
+int
+main(
+    int const argc,
+    char const* const* argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    size_t ballastMB = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 256;
+
+    if (iterations <= 0)
+    {
+        fprintf(stderr, "usage: spawnlatency [iterations] [ballast MB]\n");
+        return 1;
+    }
+
+    std::vector<char> ballast(ballastMB * 1024 * 1024, 1);
+
+    printf("%d launches of /bin/true, %lu MB ballast\n", iterations, static_cast<unsigned long>(ballastMB));
+    Measure("vfork", false, iterations);
+    Measure("fork", true, iterations);
+    MeasureLoop(iterations);
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        specusers.cpp
+
+   \brief       Loads specialization documents with unusual Users sections and
+                checks the root user the reader picks
+
+                usage: specusers
+
+                The expectations are what the reader returned when it walked
+                an XElement tree: the first UserName decides whether a user is
+                root, root users are merged into one, a User without UserName
+                is rejected, and unknown tags only matter in root users. The
+                exit code is 1 if a check fails.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <osspecializationparserexception.h>
+#include <osspecializationreader.h>
+
+#include <stdio.h>
+
+#include <string>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+using VMM::GuestAgent::SpecializationReader::OSSpecializationParserException;
+using VMM::GuestAgent::SpecializationReader::OSSpecializationReader;
+using SCX::Util::Utf8String;
+
+namespace
+{
+
+int s_failures = 0;
+
+void
+Check(bool condition, const std::string& what)
+{
+    printf("  %-60s %s\n", what.c_str(), condition ? "ok" : "FAILED");
+    if (!condition)
+    {
+        s_failures++;
+    }
+}
+
+/** Load a document with the given Users section; returns the error, or "" */
+std::string
+Load(const std::string& users)
+{
+    std::string xml =
+        "<LinuxOSSpecialization xmlns=\"http://www.microsoft.com/schema/linuxvmmst\">"
+        "<OSConfiguration><HostName>guest</HostName><Users>" + users + "</Users></OSConfiguration>"
+        "</LinuxOSSpecialization>";
+    try
+    {
+        OSSpecializationReader::Instance().LoadXML(Utf8String(xml));
+    }
+    catch (OSSpecializationParserException& e)
+    {
+        return e.What();
+    }
+    return "";
+}
+
+/** The root user of the last document loaded */
+bool
+GetRoot(OSSpecializationReader::User& user)
+{
+    OSSpecializationReader::LinuxOSSpecialization specialization;
+    OSSpecializationReader::OSConfiguration configuration;
+    return OSSpecializationReader::Instance().GetLinuxOSSpecialization(specialization) &&
+        specialization.GetOSConfiguration(configuration) &&
+        configuration.GetRoot(user);
+}
+
+/** A field of the root user, or "-" if it is not set */
+std::string
+Field(bool (OSSpecializationReader::User::*getter)(Utf8String&) const)
+{
+    OSSpecializationReader::User user;
+    Utf8String value;
+    if (!GetRoot(user) || !(user.*getter)(value))
+    {
+        return "-";
+    }
+    return value.Str();
+}
+
+void
+RunDuplicateRoot()
+{
+    printf("two root users\n");
+    std::string error = Load(
+        "<User><UserName>root</UserName><Password>first</Password><SSHKey>ssh-rsa AAAA</SSHKey></User>"
+        "<User><UserName>root</UserName><Password>second</Password></User>");
+    Check(error.empty(), "accepted");
+    Check("second" == Field(&OSSpecializationReader::User::GetPassword), "password of the second user");
+    Check("ssh-rsa AAAA" == Field(&OSSpecializationReader::User::GetSSHKey), "SSH key of the first user kept");
+}
+
+void
+RunTwoNames()
+{
+    printf("two UserName children\n");
+    Check(Load("<User><UserName>root</UserName><UserName>bob</UserName><Password>pw</Password></User>").empty(),
+          "root then bob accepted");
+    Check("bob" == Field(&OSSpecializationReader::User::GetUserName), "root user named bob");
+    Check("pw" == Field(&OSSpecializationReader::User::GetPassword), "root user has the password");
+
+    Check(Load("<User><UserName>bob</UserName><UserName>root</UserName><Password>pw</Password></User>").empty(),
+          "bob then root accepted");
+    OSSpecializationReader::User user;
+    Check(!GetRoot(user), "no root user");
+}
+
+void
+RunMissingName()
+{
+    printf("User without UserName\n");
+    Check("unexpected tag encountered when looking for value \"Name\"" == Load("<User><Password>pw</Password></User>"),
+          "rejected with the old message");
+}
+
+void
+RunUnknownTags()
+{
+    printf("unknown tags\n");
+    Check(Load("<User><UserName>bob</UserName><Shell>/bin/sh</Shell></User>"
+               "<User><UserName>root</UserName></User>").empty(),
+          "accepted in another user");
+    Check("unexpected tag encountered: Shell" == Load("<User><UserName>root</UserName><Shell>/bin/sh</Shell></User>"),
+          "rejected in the root user");
+}
+
+}
+
+int main()
+{
+    RunDuplicateRoot();
+    RunTwoNames();
+    RunMissingName();
+    RunUnknownTags();
+
+    printf("%d check(s) failed\n", s_failures);
+    return 0 == s_failures ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        statusjournal.cpp
+
+   \brief       Checks that status updates are persisted when the status
+                journal cannot be opened
+
+                usage: statusjournal
+
+                The tool sets SCVMM_HOME to a new temporary directory and puts
+                a directory where statusmessage.journal belongs, so opening the
+                journal fails. Added elements must still be accepted and show
+                up in statusmessage.xml and statusmessage.snapshot without a
+                Flush. The temporary directory is left for inspection. The exit
+                code is 1 if a check fails.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <argumentmanager.h>
+#include <statusmessage.h>
+#include <util/XElement.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+using VMM::GuestAgent::StatusManager::StatusMessage;
+using VMM::GuestAgent::Utilities::ArgumentManager;
+using SCX::Util::Xml::XElement;
+using SCX::Util::Xml::XElementPtr;
+
+namespace
+{
+
+int s_failures = 0;
+
+void
+Check(bool condition, const std::string& what)
+{
+    printf("  %-60s %s\n", what.c_str(), condition ? "ok" : "FAILED");
+    if (!condition)
+    {
+        s_failures++;
+    }
+}
+
+std::string
+ReadFile(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    char home[] = "/tmp/statusjournalXXXXXX";
+    if (NULL == mkdtemp(home))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string statusDir = std::string(home) + "/status";
+    mkdir(statusDir.c_str(), 0700);
+    mkdir((statusDir + "/statusmessage.journal").c_str(), 0700);
+    setenv("SCVMM_HOME", (std::string(home) + "/").c_str(), 1);
+
+    SCXCoreLib::SCXLogHandle logHandle(SCXCoreLib::SCXLogHandleFactory::GetLogHandle(L"scx.vmmguestagent.tools.statusjournal"));
+    if (EXIT_SUCCESS != ArgumentManager::Instance().LoadArgs(1, argv, logHandle))
+    {
+        return 1;
+    }
+    (void) argc;
+
+    printf("journal cannot be opened\n");
+    Check(StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement("First", "one"))),
+          "first element accepted");
+    Check(StatusMessage::Instance().AddChildToRoot(XElementPtr(new XElement("Second", "two"))),
+          "second element accepted");
+
+    std::string value;
+    Check(StatusMessage::Instance().ReadChildOfRoot("Second", value) && "two" == value,
+          "element readable from the document");
+
+    std::string status = ReadFile(statusDir + "/statusmessage.xml");
+    Check(std::string::npos != status.find("<First>one</First><Second>two</Second>"),
+          "elements written to statusmessage.xml");
+
+    std::string snapshot = ReadFile(statusDir + "/statusmessage.snapshot");
+    Check(std::string::npos != snapshot.find("<First>one</First><Second>two</Second>"),
+          "elements written to statusmessage.snapshot");
+
+    printf("%d check(s) failed\n", s_failures);
+    return 0 == s_failures ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        tzmapping.cpp
+
+   \brief       Checks the time zone table compiled into TimeZoneConfigurator
+                against tztable, the table cfgtimezone used to read
+
+                usage: tzmapping <tztable>
+
+                Every index in tztable must map to the same zone and
+                alternate zone, the table must hold nothing else and be sorted,
+                and every other index from -1 to one past the largest must be
+                unknown. Each zone is then applied to a scratch root, once with
+                the zone installed and, for zones with an alternate, once with
+                only the alternate installed; /etc/localtime, /etc/timezone and
+                /etc/sysconfig/clock must name the zone used. The exit code is
+                1 if a check fails.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <timezoneconfigurator.h>
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+using VMM::GuestAgent::OSConfigurator::TimeZoneConfigurator;
+using VMM::GuestAgent::OSConfigurator::TimeZoneMapping;
+
+namespace
+{
+
+std::string const ZoneInfoDir = "/usr/share/zoneinfo/";
+
+/** Zone and alternate zone of a tztable line; the alternate may be empty */
+typedef std::map<int, std::pair<std::string, std::string> > ZoneTable;
+
+int s_checks = 0;
+int s_failures = 0;
+
+/** Only failures are printed; the table has too many entries to list them all */
+void
+Check(bool condition, const std::string& what)
+{
+    s_checks++;
+    if (!condition)
+    {
+        printf("  %-60s FAILED\n", what.c_str());
+        s_failures++;
+    }
+}
+
+std::string
+Index(int id)
+{
+    std::ostringstream strm;
+    strm << "index " << id;
+    return strm.str();
+}
+
+bool
+ReadTable(const char* path, ZoneTable& table)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string id, zone, alternateZone;
+        std::getline(fields, id, ',');
+        std::getline(fields, zone, ',');
+        std::getline(fields, alternateZone, ',');
+        table[atoi(id.c_str())] = std::make_pair(zone, alternateZone);
+    }
+    return true;
+}
+
+std::string
+ReadFile(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    std::ostringstream strm;
+    strm << file.rdbuf();
+    return strm.str();
+}
+
+void
+WriteFile(const std::string& path, const std::string& data)
+{
+    std::ofstream file(path.c_str());
+    file << data;
+}
+
+/** mkdir -p of the directory a file goes into */
+void
+MakeParents(const std::string& path)
+{
+    for (std::string::size_type slash = path.find('/', 1); std::string::npos != slash;
+         slash = path.find('/', slash + 1))
+    {
+        mkdir(path.substr(0, slash).c_str(), 0755);
+    }
+}
+
+std::string
+LinkTarget(const std::string& path)
+{
+    char buffer[PATH_MAX];
+    ssize_t length = readlink(path.c_str(), buffer, sizeof(buffer) - 1);
+    return length < 0 ? std::string() : std::string(buffer, static_cast<size_t>(length));
+}
+
+void
+CheckTable(const ZoneTable& table)
+{
+    printf("Comparing the compiled table with tztable\n");
+
+    size_t count = 0;
+    const TimeZoneMapping* mappings = TimeZoneConfigurator::GetMappings(count);
+    Check(table.size() == count, "number of mappings matches tztable");
+    for (size_t i = 1; i < count; ++i)
+    {
+        Check(mappings[i - 1].id < mappings[i].id, Index(mappings[i].id) + " sorted after its predecessor");
+    }
+
+    for (ZoneTable::const_iterator entry = table.begin(); entry != table.end(); ++entry)
+    {
+        const TimeZoneMapping* mapping = TimeZoneConfigurator::FindMapping(entry->first);
+        Check(NULL != mapping, Index(entry->first) + " found");
+        if (NULL == mapping)
+        {
+            continue;
+        }
+        Check(entry->second.first == mapping->zone, Index(entry->first) + " zone " + entry->second.first);
+        Check(entry->second.second == (NULL == mapping->alternateZone ? "" : mapping->alternateZone),
+              Index(entry->first) + " alternate zone " + entry->second.second);
+    }
+
+    int last = table.empty() ? 0 : table.rbegin()->first;
+    for (int id = -1; id <= last + 1; ++id)
+    {
+        if (table.end() == table.find(id))
+        {
+            Check(NULL == TimeZoneConfigurator::FindMapping(id), Index(id) + " unknown");
+        }
+    }
+}
+
+/** Apply one index with only the given zone installed */
+void
+CheckApply(const std::string& root, int id, const std::string& installed)
+{
+    std::string zoneFile = root + ZoneInfoDir + installed;
+    MakeParents(zoneFile);
+    WriteFile(zoneFile, "TZif");
+    WriteFile(root + "/etc/timezone", "Etc/UTC\n");
+    WriteFile(root + "/etc/sysconfig/clock", "ZONE=\"Etc/UTC\"\nUTC=true\n");
+
+    TimeZoneConfigurator configurator(root);
+    std::string what = Index(id) + " as " + installed;
+    Check(configurator.Execute(id), what + " applied");
+    Check(ZoneInfoDir + installed == LinkTarget(root + "/etc/localtime"), what + " /etc/localtime");
+    Check(installed + "\n" == ReadFile(root + "/etc/timezone"), what + " /etc/timezone");
+    Check("ZONE=\"" + installed + "\"\nUTC=true\n" == ReadFile(root + "/etc/sysconfig/clock"),
+          what + " /etc/sysconfig/clock");
+
+    unlink(zoneFile.c_str());
+}
+
+void
+CheckApplyAll(const ZoneTable& table)
+{
+    printf("Applying every zone to a scratch root\n");
+
+    char dir[] = "/tmp/tzmappingXXXXXX";
+    if (NULL == mkdtemp(dir))
+    {
+        Check(false, "scratch root created");
+        return;
+    }
+    std::string root(dir);
+    MakeParents(root + "/etc/sysconfig/clock");
+
+    for (ZoneTable::const_iterator entry = table.begin(); entry != table.end(); ++entry)
+    {
+        CheckApply(root, entry->first, entry->second.first);
+        if (!entry->second.second.empty())
+        {
+            CheckApply(root, entry->first, entry->second.second);
+        }
+    }
+
+    TimeZoneConfigurator configurator(root);
+    Check(!configurator.Execute(table.empty() ? 0 : table.begin()->first), "index without installed zone fails");
+    Check(!configurator.Execute(-1), "unknown index fails");
+
+    std::string command = "rm -rf " + root;
+    if (0 != system(command.c_str()))
+    {
+        printf("Unable to remove %s\n", root.c_str());
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    ZoneTable table;
+    if (argc != 2 || !ReadTable(argv[1], table) || table.empty())
+    {
+        fprintf(stderr, "usage: tzmapping <tztable>\n");
+        return 2;
+    }
+
+    CheckTable(table);
+    CheckApplyAll(table);
+
+    printf("%d of %d check(s) failed\n", s_failures, s_checks);
+    return 0 == s_failures ? 0 : 1;
+}
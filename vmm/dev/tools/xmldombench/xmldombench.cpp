@@ -0,0 +1,266 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        xmldombench.cpp
+
+   \brief       Compares parse time and peak memory of XElement::Load with
+                XArenaDocument::Load on a large document
+
+                usage: xmldombench [adapters] [parses]
+
+                The document is shaped like the specialization file; adapters
+                sets how many VNetAdapter elements it has. Each mode runs in
+                its own child process so its peak resident set size can be
+                read from the rusage of that child alone. The idle row is a
+                child that only builds the document, the baseline for the
+                other two.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <util/XArenaDocument.h>
+#include <util/XElement.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sstream>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+namespace
+{
+
+enum Mode
+{
+    ModeIdle,
+    ModeXElement,
+    ModeArena
+};
+
+scxulong
+NowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<scxulong>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+std::string
+MakeDocument(int adapters)
+{
+    std::ostringstream xml;
+    xml << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        << "<LinuxOSConfiguration xmlns=\"http://schemas.microsoft.com/virtualization/vmm/linux\" Version=\"1.0\">\n"
+        << "  <ComputerName>bench-host</ComputerName>\n"
+        << "  <TimeZone>85</TimeZone>\n"
+        << "  <VNetAdapters>\n";
+    for (int i = 0; i < adapters; ++i)
+    {
+        xml << "    <VNetAdapter>\n"
+            << "      <MACAddress>00-15-5D-00-" << 10 + i % 90 << "-" << 10 + i / 90 % 90 << "</MACAddress>\n"
+            << "      <IPv4Settings DHCP=\"false\">\n"
+            << "        <IPAddress>10.0." << i / 250 << "." << i % 250 + 1 << "</IPAddress>\n"
+            << "        <Subnet>255.255.255.0</Subnet>\n"
+            << "        <Gateway>10.0.0.254</Gateway>\n"
+            << "        <DNSServers><Server>10.0.0.1</Server><Server>10.0.0.2</Server></DNSServers>\n"
+            << "      </IPv4Settings>\n"
+            << "    </VNetAdapter>\n";
+    }
+    xml << "  </VNetAdapters>\n"
+        << "  <RunOnceCommands><Command Order=\"1\">echo &quot;done&quot; &amp;&amp; true</Command></RunOnceCommands>\n"
+        << "</LinuxOSConfiguration>\n";
+    return xml.str();
+}
+
+size_t
+CountElements(const SCX::Util::Xml::XElementPtr& elem)
+{
+    SCX::Util::Xml::XElementList children;
+    elem->GetChildren(children);
+
+    size_t count = 1;
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        count += CountElements(children[i]);
+    }
+    return count;
+}
+
+size_t
+CountElements(const SCX::Util::Xml::XArenaElement* elem)
+{
+    size_t count = 1;
+    for (const SCX::Util::Xml::XArenaElement* child = elem->GetFirstChild(); child != NULL; child = child->GetNextSibling())
+    {
+        count += CountElements(child);
+    }
+    return count;
+}
+
+/** Parse the document repeatedly in one mode, keeping the last tree alive at exit */
+int
+RunMode(Mode mode, const std::string& xml, int parses)
+{
+    size_t elements = 0;
+    scxulong elapsed = 0;
+
+    try
+    {
+        if (ModeXElement == mode)
+        {
+            SCX::Util::Xml::XElementPtr root;
+            scxulong start = NowUs();
+            for (int i = 0; i < parses; ++i)
+            {
+                // Converting the input is part of what a caller of XElement::Load pays
+                SCX::Util::Xml::XElement::Load(SCX::Util::Utf8String(xml), root);
+            }
+            elapsed = NowUs() - start;
+            elements = CountElements(root);
+        }
+        else if (ModeArena == mode)
+        {
+            SCX::Util::Xml::XArenaDocument doc;
+            scxulong start = NowUs();
+            for (int i = 0; i < parses; ++i)
+            {
+                doc.Load(xml.data(), xml.size());
+            }
+            elapsed = NowUs() - start;
+            elements = CountElements(doc.GetRoot());
+        }
+    }
+    catch (SCXCoreLib::SCXException& e)
+    {
+        fprintf(stderr, "parse failed: %ls\n", e.What().c_str());
+        return 1;
+    }
+
+    if (ModeIdle == mode)
+    {
+        printf("%9s  %9s", "-", "-");
+    }
+    else
+    {
+        printf("%9lu  %9.1f", static_cast<unsigned long>(elements), static_cast<double>(elapsed) / parses / 1000);
+    }
+    fflush(stdout);
+    return 0;
+}
+
+/** Run a mode in a child process; returns its peak RSS in KiB, -1 on failure */
+long
+Measure(Mode mode, const char* name, const std::string& xml, int parses)
+{
+    printf("%-9s  ", name);
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+    if (0 == pid)
+    {
+        _exit(RunMode(mode, xml, parses));
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || 0 != WEXITSTATUS(status))
+    {
+        printf("\n");
+        return -1;
+    }
+    return usage.ru_maxrss;
+}
+
+}
+
+int
+main(
+    int const argc,
+    char const* const* argv)
+{
+    int adapters = argc > 1 ? atoi(argv[1]) : 2000;
+    int parses = argc > 2 ? atoi(argv[2]) : 10;
+
+    if (adapters < 0 || parses <= 0)
+    {
+        fprintf(stderr, "usage: xmldombench [adapters] [parses]\n");
+        return 1;
+    }
+
+    std::string xml = MakeDocument(adapters);
+    printf("%lu byte document, %d parses per mode\n", static_cast<unsigned long>(xml.size()), parses);
+    printf("mode        elements  ms/parse  peak RSS KiB  above idle KiB\n");
+
+    long idle = Measure(ModeIdle, "idle", xml, parses);
+    if (idle >= 0)
+    {
+        printf("  %12ld  %14d\n", idle, 0);
+    }
+
+    long xelement = Measure(ModeXElement, "XElement", xml, parses);
+    if (xelement >= 0)
+    {
+        printf("  %12ld  %14ld\n", xelement, xelement - idle);
+    }
+
+    long arena = Measure(ModeArena, "arena", xml, parses);
+    if (arena >= 0)
+    {
+        printf("  %12ld  %14ld\n", arena, arena - idle);
+    }
+
+    return (idle < 0 || xelement < 0 || arena < 0) ? 1 : 0;
+}
@@ -0,0 +1,226 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        xmlparsebench.cpp
+
+   \brief       Measures how XElement::Load scales when several threads parse
+                documents at the same time
+
+                usage: xmlparsebench [max threads] [parses per thread] [adapters]
+
+                Every thread parses its own copy of a document shaped like the
+                specialization file; adapters sets how many VNetAdapter
+                elements it has. Each thread count is run once with the
+                parses running freely and once serialized on one lock, which
+                is how XElement::Load behaved with its global load lock.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+#include <scxcorelib/scxthread.h>
+#include <scxcorelib/scxthreadlock.h>
+
+#include <util/XElement.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <sstream>
+#include <vector>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+namespace
+{
+
+/** Parameters of one parsing thread */
+class ParseParam : public SCXCoreLib::SCXThreadParam
+{
+public:
+    ParseParam(const std::string& xml, int parses, const SCXCoreLib::SCXThreadLockHandle& lock, bool serialize)
+        : m_xml(xml), m_parses(parses), m_lock(lock), m_serialize(serialize), m_failures(0)
+    {
+    }
+
+    std::string m_xml;                          //!< Document to parse
+    int m_parses;                               //!< Number of times to parse it
+    SCXCoreLib::SCXThreadLockHandle m_lock;     //!< Lock shared by all threads
+    bool m_serialize;                           //!< Take the shared lock around each parse
+    int m_failures;                             //!< Parses that threw
+};
+
+scxulong
+NowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<scxulong>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+std::string
+MakeDocument(int adapters)
+{
+    std::ostringstream xml;
+    xml << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        << "<LinuxOSConfiguration xmlns=\"http://schemas.microsoft.com/virtualization/vmm/linux\" Version=\"1.0\">\n"
+        << "  <ComputerName>bench-host</ComputerName>\n"
+        << "  <TimeZone>85</TimeZone>\n"
+        << "  <VNetAdapters>\n";
+    for (int i = 0; i < adapters; ++i)
+    {
+        xml << "    <VNetAdapter>\n"
+            << "      <MACAddress>00-15-5D-00-" << 10 + i % 90 << "-" << 10 + i / 90 % 90 << "</MACAddress>\n"
+            << "      <IPv4Settings DHCP=\"false\">\n"
+            << "        <IPAddress>10.0." << i / 250 << "." << i % 250 + 1 << "</IPAddress>\n"
+            << "        <Subnet>255.255.255.0</Subnet>\n"
+            << "        <Gateway>10.0.0.254</Gateway>\n"
+            << "        <DNSServers><Server>10.0.0.1</Server><Server>10.0.0.2</Server></DNSServers>\n"
+            << "      </IPv4Settings>\n"
+            << "    </VNetAdapter>\n";
+    }
+    xml << "  </VNetAdapters>\n"
+        << "  <RunOnceCommands><Command Order=\"1\">echo &quot;done&quot; &amp;&amp; true</Command></RunOnceCommands>\n"
+        << "</LinuxOSConfiguration>\n";
+    return xml.str();
+}
+
+void
+ParseBody(SCXCoreLib::SCXThreadParamHandle& param)
+{
+    ParseParam* p = static_cast<ParseParam*>(param.GetData());
+    SCX::Util::Utf8String xml(p->m_xml);
+
+    for (int i = 0; i < p->m_parses; ++i)
+    {
+        try
+        {
+            SCX::Util::Xml::XElementPtr root;
+            if (p->m_serialize)
+            {
+                SCXCoreLib::SCXThreadLock lock(p->m_lock);
+                SCX::Util::Xml::XElement::Load(xml, root);
+            }
+            else
+            {
+                SCX::Util::Xml::XElement::Load(xml, root);
+            }
+        }
+        catch (SCXCoreLib::SCXException&)
+        {
+            p->m_failures++;
+        }
+    }
+}
+
+/** Parse with a number of threads; returns parses per second */
+double
+Measure(const std::string& xml, int threads, int parses, bool serialize)
+{
+    std::vector<SCXCoreLib::SCXHandle<SCXCoreLib::SCXThread> > workers;
+    std::vector<ParseParam*> params;
+    SCXCoreLib::SCXThreadLockHandle lock = SCXCoreLib::ThreadLockHandleGet();
+
+    scxulong start = NowUs();
+    for (int i = 0; i < threads; ++i)
+    {
+        ParseParam* param = new ParseParam(xml, parses, lock, serialize);
+        params.push_back(param);
+        workers.push_back(SCXCoreLib::SCXHandle<SCXCoreLib::SCXThread>(new SCXCoreLib::SCXThread(ParseBody, param)));
+    }
+
+    int failures = 0;
+    for (int i = 0; i < threads; ++i)
+    {
+        workers[i]->Wait();
+        failures += params[i]->m_failures;
+    }
+    scxulong elapsed = NowUs() - start;
+
+    if (0 != failures)
+    {
+        fprintf(stderr, "%d parses failed\n", failures);
+    }
+    return static_cast<double>(threads) * parses * 1000000 / (elapsed ? elapsed : 1);
+}
+
+}
+
+int
+main(
+    int const argc,
+    char const* const* argv)
+{
+    int maxThreads = argc > 1 ? atoi(argv[1]) : 8;
+    int parses = argc > 2 ? atoi(argv[2]) : 200;
+    int adapters = argc > 3 ? atoi(argv[3]) : 8;
+
+    if (maxThreads <= 0 || parses <= 0 || adapters < 0)
+    {
+        fprintf(stderr, "usage: xmlparsebench [max threads] [parses per thread] [adapters]\n");
+        return 1;
+    }
+
+    std::string xml = MakeDocument(adapters);
+    printf("%lu byte document, %d parses per thread\n", static_cast<unsigned long>(xml.size()), parses);
+    printf("threads  parallel parses/s  speedup  serialized parses/s  speedup\n");
+
+    double parallelBase = 0;
+    double serialBase = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        double parallel = Measure(xml, threads, parses, false);
+        double serial = Measure(xml, threads, parses, true);
+        if (1 == threads)
+        {
+            parallelBase = parallel;
+            serialBase = serial;
+        }
+        printf("%7d  %18.0f  %6.2fx  %19.0f  %6.2fx\n",
+               threads, parallel, parallel / parallelBase, serial, serial / serialBase);
+    }
+
+    return 0;
+}
@@ -0,0 +1,271 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        xmlscanbench.cpp
+
+   \brief       Checks the vector code unit scanning kernels against the
+                scalar ones and measures what they gain in XElement::Load
+
+                usage: xmlscanbench [commands] [parses] [rounds]
+
+                First every kernel version the CPU supports is run on random
+                code units next to the scalar version, and on every mismatch
+                the input is printed and the exit code is 1. Then a text heavy
+                document, with commands long scripts, is loaded with
+                XElement::Load under each version; the trees must be
+                identical, and the time per parse is printed.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <util/XElement.h>
+#include <util/CodeUnitScan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <sstream>
+#include <vector>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+namespace
+{
+
+using SCX::Util::Utf16Char;
+using SCX::Util::CodeUnitScan;
+
+const char* const c_LevelNames[] = { "scalar", "SSE2", "AVX2" };
+
+/** Code units the kernels treat specially, and look-alikes that differ only in the high byte */
+const Utf16Char c_Alphabet[] =
+{
+    'a', 'z', ' ', '\t', '\r', '\n', '<', '&', '"', '\'', '\0',
+    0x013C, 0x3C00, 0x0A0A, 0x2020, 0x00E9, 0xD83D, 0xDE00, 0xDFFF, 0xE000, 0xFFFF
+};
+const size_t c_AlphabetSize = sizeof(c_Alphabet) / sizeof(c_Alphabet[0]);
+
+scxulong
+NowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<scxulong>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** A code unit, biased towards letters so runs get long enough to need several vectors */
+Utf16Char
+RandomUnit(bool spacesOnly)
+{
+    if (spacesOnly)
+    {
+        return c_Alphabet[2 + rand() % 4];
+    }
+    return rand() % 4 ? 'a' : c_Alphabet[rand() % c_AlphabetSize];
+}
+
+void
+PrintUnits(const std::vector<Utf16Char>& units)
+{
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        printf(" %04x", units[i]);
+    }
+    printf("\n");
+}
+
+/** Compare every kernel version with the scalar one; returns the number of mismatches */
+int
+CheckKernels(int rounds)
+{
+    CodeUnitScan::Level best = CodeUnitScan::GetBestLevel();
+    int mismatches = 0;
+
+    for (int round = 0; round < rounds; ++round)
+    {
+        // Mostly whitespace in half the rounds so SkipSpaces gets past the first vector
+        bool spaces = round % 2;
+        std::vector<Utf16Char> units(1 + rand() % 100);
+        for (size_t i = 0; i < units.size(); ++i)
+        {
+            units[i] = RandomUnit(spaces && rand() % 64);
+        }
+        Utf16Char a = c_Alphabet[rand() % c_AlphabetSize];
+        Utf16Char b = c_Alphabet[rand() % c_AlphabetSize];
+        Utf16Char c = c_Alphabet[rand() % c_AlphabetSize];
+        size_t offset = rand() % units.size();
+
+        CodeUnitScan::SetLevel(CodeUnitScan::LevelScalar);
+        size_t findLines = 0;
+        size_t spaceLines = 0;
+        size_t find = CodeUnitScan::FindAny(&units[offset], units.size() - offset, a, b, c, findLines);
+        size_t space = CodeUnitScan::SkipSpaces(&units[offset], units.size() - offset, spaceLines);
+        size_t surrogate = CodeUnitScan::FindSurrogate(&units[offset], units.size() - offset);
+
+        for (int level = CodeUnitScan::LevelScalar + 1; level <= best; ++level)
+        {
+            CodeUnitScan::SetLevel(static_cast<CodeUnitScan::Level>(level));
+            size_t vecFindLines = 0;
+            size_t vecSpaceLines = 0;
+            size_t vecFind = CodeUnitScan::FindAny(&units[offset], units.size() - offset, a, b, c, vecFindLines);
+            size_t vecSpace = CodeUnitScan::SkipSpaces(&units[offset], units.size() - offset, vecSpaceLines);
+            size_t vecSurrogate = CodeUnitScan::FindSurrogate(&units[offset], units.size() - offset);
+
+            if (vecFind != find || vecFindLines != findLines || vecSpace != space || vecSpaceLines != spaceLines ||
+                vecSurrogate != surrogate)
+            {
+                printf("%s differs at offset %lu, stop %04x %04x %04x: find %lu/%lu lines %lu/%lu, spaces %lu/%lu lines %lu/%lu, surrogate %lu/%lu\n",
+                       c_LevelNames[level], static_cast<unsigned long>(offset), a, b, c,
+                       static_cast<unsigned long>(vecFind), static_cast<unsigned long>(find),
+                       static_cast<unsigned long>(vecFindLines), static_cast<unsigned long>(findLines),
+                       static_cast<unsigned long>(vecSpace), static_cast<unsigned long>(space),
+                       static_cast<unsigned long>(vecSpaceLines), static_cast<unsigned long>(spaceLines),
+                       static_cast<unsigned long>(vecSurrogate), static_cast<unsigned long>(surrogate));
+                PrintUnits(units);
+                mismatches++;
+            }
+        }
+    }
+
+    CodeUnitScan::SetLevel(best);
+    return mismatches;
+}
+
+std::string
+MakeDocument(int commands)
+{
+    std::ostringstream xml;
+    xml << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        << "<LinuxOSConfiguration xmlns=\"http://schemas.microsoft.com/virtualization/vmm/linux\" Version=\"1.0\">\n"
+        << "  <ComputerName>bench-host</ComputerName>\n"
+        << "  <RunOnceCommands>\n";
+    for (int i = 0; i < commands; ++i)
+    {
+        xml << "    <Command Order=\"" << i << "\" Description=\"Configure the application tier, step " << i
+            << " of " << commands << ", and report the result to the management server\">\n";
+        for (int line = 0; line < 40; ++line)
+        {
+            xml << "        if [ -f /etc/app/step" << line << ".conf ]; then /opt/app/bin/configure --step " << line
+                << " --config /etc/app/step" << line << ".conf --log /var/log/app/configure.log; fi";
+            xml << (line % 10 ? "\n" : " &amp;&amp; true\n");
+        }
+        xml << "    </Command>\n";
+    }
+    xml << "  </RunOnceCommands>\n"
+        << "</LinuxOSConfiguration>\n";
+    return xml.str();
+}
+
+/** Load the document under one kernel version; returns the time per parse in ms */
+double
+MeasureParse(CodeUnitScan::Level level, const SCX::Util::Utf8String& xml, int parses, std::string& tree)
+{
+    CodeUnitScan::SetLevel(level);
+
+    SCX::Util::Xml::XElementPtr root;
+    scxulong start = NowUs();
+    for (int i = 0; i < parses; ++i)
+    {
+        SCX::Util::Xml::XElement::Load(xml, root);
+    }
+    scxulong elapsed = NowUs() - start;
+
+    SCX::Util::Utf8String out;
+    root->ToString(out, false);
+    tree = out.Str();
+    return static_cast<double>(elapsed) / parses / 1000;
+}
+
+}
+
+int
+main(
+    int const argc,
+    char const* const* argv)
+{
+    int commands = argc > 1 ? atoi(argv[1]) : 200;
+    int parses = argc > 2 ? atoi(argv[2]) : 10;
+    int rounds = argc > 3 ? atoi(argv[3]) : 200000;
+
+    if (commands < 0 || parses <= 0 || rounds < 0)
+    {
+        fprintf(stderr, "usage: xmlscanbench [commands] [parses] [rounds]\n");
+        return 1;
+    }
+
+    CodeUnitScan::Level best = CodeUnitScan::GetBestLevel();
+    printf("best kernels: %s\n", c_LevelNames[best]);
+
+    int mismatches = CheckKernels(rounds);
+    printf("%d random inputs, %d mismatches against scalar\n", rounds, mismatches);
+
+    SCX::Util::Utf8String xml(MakeDocument(commands));
+    printf("%lu code unit document, %d parses per version\n", static_cast<unsigned long>(xml.Size()), parses);
+    printf("kernels  ms/parse  speedup\n");
+
+    std::string scalarTree;
+    double scalar = 0;
+    for (int level = CodeUnitScan::LevelScalar; level <= best; ++level)
+    {
+        std::string tree;
+        double ms = MeasureParse(static_cast<CodeUnitScan::Level>(level), xml, parses, tree);
+        if (CodeUnitScan::LevelScalar == level)
+        {
+            scalar = ms;
+            scalarTree = tree;
+        }
+        else if (tree != scalarTree)
+        {
+            printf("%s loads a different tree than scalar\n", c_LevelNames[level]);
+            mismatches++;
+        }
+        printf("%-7s  %8.2f  %6.2fx\n", c_LevelNames[level], ms, scalar / ms);
+    }
+
+    CodeUnitScan::SetLevel(best);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,1226 @@
+/**
+ *  Copyright (c) Microsoft Corporation
+ *
+ *  All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ *  use this file except in compliance with the License. You may obtain a copy
+ *  of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+ *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+ *  MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ *  See the Apache Version 2.0 License for specific language governing
+ *  permissions and limitations under the License.
+ *
+ **/
+
+/**
+   \file        xsdbindgen.cpp
+
+   \brief       Generates the dispatch of a streaming binder from an XSD
+                annotated with bind: attributes
+
+                usage: xsdbindgen schema header source
+
+                The header gets the names, contents and fields of the schema as
+                enums; the source gets a perfect hash from names to tags and the
+                BindStart, BindAttribute and BindEnd members of the binder class
+                the schema names, which switch on them. The annotations are
+                described at the top of LinuxOSSpecialization.xsd. Files whose
+                content does not change are left alone.
+
+*/
+/*----------------------------------------------------------------------------*/
+#include <scxcorelib/scxcmn.h>
+#include <scxcorelib/scxlogpolicy.h>
+#include <scxcorelib/scxproductdependencies.h>
+
+#include <util/XElement.h>
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace SCXCoreLib
+{
+    namespace SCXProductDependencies
+    {
+        void WriteLogFileHeader( SCXHandle<std::wfstream> &stream, int logFileRunningNumber, SCXCalendarTime& procStartTimestamp )
+        {
+            (void) stream;
+            (void) logFileRunningNumber;
+            (void) procStartTimestamp;
+        }
+
+        void WrtieItemToLog( SCXHandle<std::wfstream> &stream, const SCXLogItem& item, const std::wstring& message )
+        {
+            (void) item;
+
+            (*stream) << message << std::endl;
+        }
+    }
+}
+
+SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy> CustomLogPolicyFactory()
+{
+    return SCXCoreLib::SCXHandle<SCXCoreLib::SCXLogPolicy>(new SCXCoreLib::SCXLogPolicy());
+}
+
+namespace
+{
+
+using SCX::Util::Utf8String;
+using SCX::Util::Xml::XElement;
+using SCX::Util::Xml::XElementList;
+using SCX::Util::Xml::XElementPtr;
+
+/** Multiplier of the name hash, the 32 bit FNV prime */
+const unsigned int c_HashPrime = 16777619u;
+
+/** How an element is bound within the content of its parent */
+enum Kind
+{
+    KindNone,           //!< Only hooks and traces
+    KindValue,          //!< Content assigned to an Optional member
+    KindOptional,       //!< Object in an Optional member
+    KindList,           //!< Vector member the element's children are appended to
+    KindItem,           //!< Object appended to the parent's vector
+    KindItemValue,      //!< Content appended to the parent's vector
+    KindPass,           //!< Children bound into the parent's object
+    KindObject          //!< Object a begin hook provides
+};
+
+struct Content;
+
+/** An attribute of a content */
+struct Attr
+{
+    std::string tag;            //!< Name
+    std::string enumeration;    //!< Simple type with enumerations, if the hook gets the value looked up
+    std::string on;             //!< Hook
+};
+
+/** An element within the content of its parent */
+struct Field
+{
+    std::string tag;            //!< Name
+    std::string member;         //!< bind:member
+    std::string as;             //!< bind:as
+    std::string trace;          //!< bind:trace
+    std::string traceValue;     //!< bind:traceValue
+    std::string begin;          //!< bind:begin
+    std::string end;            //!< bind:end
+    bool first;                 //!< bind:first
+    bool unbounded;             //!< maxOccurs above 1
+    std::string xsType;         //!< Built-in type of a simple element
+    Content* content;           //!< Content, NULL for simple elements without attributes
+    Kind kind;                  //!< How it is bound
+};
+
+/** The content of an element: the children and attributes it dispatches */
+struct Content
+{
+    std::string key;            //!< Type name, or element name for an anonymous type
+    std::string cls;            //!< bind:class
+    std::string unexpected;     //!< bind:unexpected
+    std::string sections;       //!< bind:sections
+    std::vector<Field> fields;  //!< Child elements
+    std::vector<Attr> attributes; //!< Attributes
+    bool simple;                //!< Has simple content
+    bool bound;                 //!< Reached from the root
+    std::string target;         //!< C++ type of the object bound into
+};
+
+std::string
+GetAttr(const XElementPtr& elem, const char* name)
+{
+    std::string value;
+    elem->GetAttributeValue(std::string(name), value);
+    return value;
+}
+
+/** Local part of a qualified name */
+std::string
+Local(const std::string& qname)
+{
+    size_t colon = qname.find(':');
+    return colon == std::string::npos ? qname : qname.substr(colon + 1);
+}
+
+std::string
+Escape(const std::string& str)
+{
+    std::string out;
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        if ('"' == str[i] || '\\' == str[i])
+        {
+            out += '\\';
+        }
+        out += str[i];
+    }
+    return out;
+}
+
+std::string
+BaseName(const std::string& path)
+{
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+/** Name hash, the same as HashName in the generated source */
+unsigned int
+HashName(const std::string& name, unsigned int seed)
+{
+    unsigned int hash = seed;
+    for (size_t i = 0; i < name.size(); ++i)
+    {
+        hash = (hash ^ static_cast<unsigned char>(name[i])) * c_HashPrime;
+    }
+    return hash ^ (hash >> 16);
+}
+
+class Generator
+{
+public:
+    Generator() : m_root(NULL), m_slotBits(0), m_seed(0) {}
+
+    void Load(const std::string& path);
+    void Resolve();
+    std::string Header(const std::string& name) const;
+    std::string Source(const std::string& name) const;
+
+private:
+    // Schema
+    std::string m_schemaName;
+    std::string m_namespace;
+    std::string m_scope;
+    std::string m_binder;
+    std::string m_rootName;
+    std::map<std::string, XElementPtr> m_elements;
+    std::map<std::string, XElementPtr> m_complexTypes;
+    std::map<std::string, std::vector<std::string> > m_simpleTypes;
+
+    // Binding
+    std::map<std::string, Content> m_contents;
+    std::vector<Content*> m_order;
+    Content* m_root;
+    std::set<std::string> m_tags;
+    std::set<std::string> m_enumerations;
+    size_t m_attributeCount;
+
+    // Perfect hash
+    unsigned int m_slotBits;
+    unsigned int m_seed;
+    std::vector<unsigned int> m_slots;
+
+    Field ResolveParticle(const XElementPtr& particle);
+    Content* GetContent(const std::string& key, const XElementPtr& type, const XElementPtr& annotations);
+    void ReadParticles(Content& content, const XElementPtr& group);
+    void ReadAttribute(Content& content, const XElementPtr& attribute);
+    void SetTarget(Content* content, const std::string& target);
+    void BindContent(Content& content);
+    void FindPerfectHash();
+
+    std::string Scoped(const std::string& cls) const { return m_scope + "::" + cls; }
+    std::string TagId(const std::string& tag) const { return "Tag" + tag; }
+    std::string TypeId(const Content& content) const { return "Type" + content.key; }
+    std::string FieldId(const Content& parent, const Field& field) const { return "Field" + parent.key + field.tag; }
+
+    void EmitStart(std::ostringstream& out) const;
+    void EmitAttribute(std::ostringstream& out) const;
+    void EmitEnd(std::ostringstream& out) const;
+};
+
+void
+Generator::Load(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        throw std::runtime_error("cannot read " + path);
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+
+    XElementPtr schema;
+    XElement::Load(Utf8String(text.str()), schema);
+
+    m_schemaName = BaseName(path);
+    m_namespace = GetAttr(schema, "namespace");
+    m_scope = GetAttr(schema, "scope");
+    m_binder = GetAttr(schema, "binder");
+    m_rootName = GetAttr(schema, "root");
+    if (m_namespace.empty() || m_scope.empty() || m_binder.empty() || m_rootName.empty())
+    {
+        throw std::runtime_error("the schema needs bind:namespace, bind:scope, bind:binder and bind:root");
+    }
+
+    XElementList children;
+    schema->GetChildren(children);
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        std::string kind = children[i]->GetName().Str();
+        std::string name = GetAttr(children[i], "name");
+        if ("element" == kind)
+        {
+            m_elements[name] = children[i];
+        }
+        else if ("complexType" == kind)
+        {
+            m_complexTypes[name] = children[i];
+        }
+        else if ("simpleType" == kind)
+        {
+            std::vector<std::string>& values = m_simpleTypes[name];
+            XElementPtr restriction;
+            if (children[i]->GetChild(std::string("restriction"), restriction))
+            {
+                XElementList facets;
+                restriction->GetChildren(facets);
+                for (size_t j = 0; j < facets.size(); ++j)
+                {
+                    if ("enumeration" == facets[j]->GetName().Str())
+                    {
+                        values.push_back(GetAttr(facets[j], "value"));
+                    }
+                }
+            }
+        }
+    }
+}
+
+/** An element in a sequence, or a global element */
+Field
+Generator::ResolveParticle(const XElementPtr& particle)
+{
+    Field field;
+    field.member = GetAttr(particle, "member");
+    field.as = GetAttr(particle, "as");
+    field.trace = GetAttr(particle, "trace");
+    field.traceValue = GetAttr(particle, "traceValue");
+    field.begin = GetAttr(particle, "begin");
+    field.end = GetAttr(particle, "end");
+    field.first = "true" == GetAttr(particle, "first");
+    std::string maxOccurs = GetAttr(particle, "maxOccurs");
+    field.unbounded = "unbounded" == maxOccurs || atoi(maxOccurs.c_str()) > 1;
+    field.content = NULL;
+    field.kind = KindNone;
+
+    XElementPtr decl = particle;
+    std::string ref = GetAttr(particle, "ref");
+    if (!ref.empty())
+    {
+        std::map<std::string, XElementPtr>::const_iterator it = m_elements.find(Local(ref));
+        if (it == m_elements.end())
+        {
+            throw std::runtime_error("no element " + ref);
+        }
+        decl = it->second;
+    }
+    field.tag = GetAttr(decl, "name");
+
+    std::string type = Local(GetAttr(decl, "type"));
+    XElementPtr anonymous;
+    if (type.empty() && decl->GetChild(std::string("complexType"), anonymous))
+    {
+        field.content = GetContent(field.tag, anonymous, decl);
+    }
+    else if (m_complexTypes.find(type) != m_complexTypes.end())
+    {
+        XElementPtr complexType = m_complexTypes[type];
+        field.content = GetContent(type, complexType, complexType);
+    }
+    else if (type.empty() || m_simpleTypes.find(type) != m_simpleTypes.end() || "string" == type)
+    {
+        field.xsType = "string";
+    }
+    else if ("int" == type)
+    {
+        field.xsType = "int";
+    }
+    else
+    {
+        throw std::runtime_error("unsupported type " + type + " of " + field.tag);
+    }
+    return field;
+}
+
+Content*
+Generator::GetContent(const std::string& key, const XElementPtr& type, const XElementPtr& annotations)
+{
+    std::map<std::string, Content>::iterator it = m_contents.find(key);
+    if (it != m_contents.end())
+    {
+        return &it->second;
+    }
+
+    Content& content = m_contents[key];
+    content.key = key;
+    content.cls = GetAttr(annotations, "class");
+    content.unexpected = GetAttr(annotations, "unexpected");
+    content.sections = GetAttr(annotations, "sections");
+    content.simple = false;
+    content.bound = false;
+
+    XElementList children;
+    type->GetChildren(children);
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        std::string kind = children[i]->GetName().Str();
+        if ("sequence" == kind || "choice" == kind || "all" == kind)
+        {
+            ReadParticles(content, children[i]);
+        }
+        else if ("attribute" == kind)
+        {
+            ReadAttribute(content, children[i]);
+        }
+        else if ("simpleContent" == kind)
+        {
+            content.simple = true;
+            XElementList derivations;
+            children[i]->GetChildren(derivations);
+            for (size_t j = 0; j < derivations.size(); ++j)
+            {
+                XElementList attributes;
+                derivations[j]->GetChildren(attributes);
+                for (size_t k = 0; k < attributes.size(); ++k)
+                {
+                    if ("attribute" == attributes[k]->GetName().Str())
+                    {
+                        ReadAttribute(content, attributes[k]);
+                    }
+                }
+            }
+        }
+        else if ("annotation" != kind)
+        {
+            throw std::runtime_error("unsupported " + kind + " in " + key);
+        }
+    }
+    return &content;
+}
+
+void
+Generator::ReadParticles(Content& content, const XElementPtr& group)
+{
+    XElementList particles;
+    group->GetChildren(particles);
+    for (size_t i = 0; i < particles.size(); ++i)
+    {
+        std::string kind = particles[i]->GetName().Str();
+        if ("element" == kind)
+        {
+            Field field = ResolveParticle(particles[i]);
+            content.fields.push_back(field);
+        }
+        else if ("sequence" == kind || "choice" == kind || "all" == kind)
+        {
+            ReadParticles(content, particles[i]);
+        }
+        else if ("annotation" != kind)
+        {
+            throw std::runtime_error("unsupported " + kind + " in " + content.key);
+        }
+    }
+}
+
+void
+Generator::ReadAttribute(Content& content, const XElementPtr& attribute)
+{
+    Attr attr;
+    attr.tag = GetAttr(attribute, "name");
+    attr.on = GetAttr(attribute, "on");
+    std::string type = Local(GetAttr(attribute, "type"));
+    std::map<std::string, std::vector<std::string> >::const_iterator simple = m_simpleTypes.find(type);
+    if (simple != m_simpleTypes.end() && !simple->second.empty())
+    {
+        attr.enumeration = type;
+    }
+    content.attributes.push_back(attr);
+}
+
+void
+Generator::SetTarget(Content* content, const std::string& target)
+{
+    if (NULL == content)
+    {
+        return;
+    }
+    if (!content->target.empty() && content->target != target)
+    {
+        throw std::runtime_error(content->key + " binds into both " + content->target + " and " + target);
+    }
+    content->target = target;
+}
+
+/** A content without a class whose only child repeats, bound as a vector */
+bool
+IsList(const Content* content)
+{
+    return NULL != content && content->cls.empty() && !content->simple && content->attributes.empty() &&
+           1 == content->fields.size() && content->fields[0].unbounded;
+}
+
+void
+Generator::BindContent(Content& content)
+{
+    if (content.bound)
+    {
+        return;
+    }
+    content.bound = true;
+    m_order.push_back(&content);
+
+    bool list = 0 == content.target.compare(0, 12, "std::vector<");
+    for (size_t i = 0; i < content.fields.size(); ++i)
+    {
+        Field& field = content.fields[i];
+        Content* child = field.content;
+        m_tags.insert(field.tag);
+
+        if (list)
+        {
+            field.kind = NULL != child && !child->cls.empty() ? KindItem : KindItemValue;
+            SetTarget(child, NULL != child && !child->cls.empty() ? Scoped(child->cls) : content.target);
+        }
+        else if (!field.member.empty() && IsList(child))
+        {
+            field.kind = KindList;
+            const Field& item = child->fields[0];
+            std::string itemType = NULL != item.content && !item.content->cls.empty() ?
+                Scoped(item.content->cls) : std::string("SCX::Util::Utf8String");
+            SetTarget(child, "std::vector<" + itemType + " >");
+        }
+        else if (NULL != child && !child->cls.empty())
+        {
+            field.kind = field.member.empty() ? KindObject : KindOptional;
+            if (KindObject == field.kind && field.begin.empty())
+            {
+                throw std::runtime_error(field.tag + " has a class but neither a member nor a begin hook");
+            }
+            SetTarget(child, Scoped(child->cls));
+        }
+        else if (!field.member.empty())
+        {
+            if (NULL != child && !child->simple)
+            {
+                throw std::runtime_error(field.tag + " has a member but no class");
+            }
+            field.kind = KindValue;
+            SetTarget(child, content.target);
+        }
+        else if (NULL != child)
+        {
+            field.kind = KindPass;
+            SetTarget(child, content.target);
+        }
+        else if (field.end.empty() && field.trace.empty() && field.traceValue.empty())
+        {
+            throw std::runtime_error(field.tag + " is not bound to anything");
+        }
+
+        if (NULL != child)
+        {
+            BindContent(*child);
+        }
+    }
+
+    for (size_t i = 0; i < content.attributes.size(); ++i)
+    {
+        m_tags.insert(content.attributes[i].tag);
+        if (!content.attributes[i].on.empty() && !content.attributes[i].enumeration.empty())
+        {
+            m_enumerations.insert(content.attributes[i].enumeration);
+        }
+    }
+    m_attributeCount = std::max(m_attributeCount, content.attributes.size());
+}
+
+void
+Generator::Resolve()
+{
+    std::map<std::string, XElementPtr>::const_iterator root = m_elements.find(m_rootName);
+    if (root == m_elements.end())
+    {
+        throw std::runtime_error("no root element " + m_rootName);
+    }
+
+    Field field = ResolveParticle(root->second);
+    if (NULL == field.content || field.content->cls.empty())
+    {
+        throw std::runtime_error("the root element needs a bind:class");
+    }
+    m_root = field.content;
+    m_tags.insert(field.tag);
+    m_attributeCount = 1;
+    SetTarget(m_root, Scoped(m_root->cls));
+    BindContent(*m_root);
+
+    for (std::set<std::string>::const_iterator it = m_tags.begin(); it != m_tags.end(); ++it)
+    {
+        for (size_t i = 0; i < it->size(); ++i)
+        {
+            if (static_cast<unsigned char>((*it)[i]) >= 0x80)
+            {
+                throw std::runtime_error("name " + *it + " is not ASCII");
+            }
+        }
+    }
+    FindPerfectHash();
+}
+
+/** Smallest power of two table, and the first seed, with no two names in one slot */
+void
+Generator::FindPerfectHash()
+{
+    unsigned int bits = 0;
+    while ((1u << bits) < m_tags.size())
+    {
+        bits++;
+    }
+
+    for (unsigned int tries = 0; tries < 4; ++tries, ++bits)
+    {
+        size_t size = 1u << bits;
+        for (unsigned int candidate = 1; candidate < 200000; ++candidate)
+        {
+            unsigned int seed = 2166136261u ^ (candidate * 0x9E3779B9u);
+            std::vector<unsigned int> slots(size, 0);
+            bool collision = false;
+            unsigned int tag = 0;
+            for (std::set<std::string>::const_iterator it = m_tags.begin(); it != m_tags.end() && !collision; ++it, ++tag)
+            {
+                unsigned int& slot = slots[HashName(*it, seed) & (size - 1)];
+                collision = 0 != slot;
+                slot = tag + 1;
+            }
+            if (!collision)
+            {
+                m_slotBits = bits;
+                m_seed = seed;
+                m_slots = slots;
+                return;
+            }
+        }
+    }
+    throw std::runtime_error("no perfect hash found");
+}
+
+const char* const c_License =
+    "/**\n"
+    " *  Copyright (c) Microsoft Corporation\n"
+    " *\n"
+    " *  All rights reserved.\n"
+    " *\n"
+    " *  Licensed under the Apache License, Version 2.0 (the \"License\"); you may not\n"
+    " *  use this file except in compliance with the License. You may obtain a copy\n"
+    " *  of the License at http://www.apache.org/licenses/LICENSE-2.0\n"
+    " *\n"
+    " *  THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY\n"
+    " *  KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED\n"
+    " *  WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,\n"
+    " *  MERCHANTABLITY OR NON-INFRINGEMENT.\n"
+    " *\n"
+    " *  See the Apache Version 2.0 License for specific language governing\n"
+    " *  permissions and limitations under the License.\n"
+    " *\n"
+    " **/\n"
+    "\n";
+
+std::string
+Generator::Header(const std::string& name) const
+{
+    std::string guard;
+    for (size_t i = 0; i < name.size(); ++i)
+    {
+        guard += '.' == name[i] ? '_' : static_cast<char>(toupper(name[i]));
+    }
+
+    std::ostringstream out;
+    out << c_License
+        << "/**\n"
+        << "        \\file        " << name << "\n"
+        << "\n"
+        << "        \\brief       Names, contents and fields of " << m_schemaName << " for\n"
+        << "                     " << m_binder << "\n"
+        << "\n"
+        << "        Generated by xsdbindgen from " << m_schemaName << "; do not edit, run\n"
+        << "        \"make gen\" in dev/tools/xsdbindgen instead.  @migen@\n"
+        << "\n"
+        << "*/\n"
+        << "/*----------------------------------------------------------------------------*/\n"
+        << "#ifndef " << guard << "\n"
+        << "#define " << guard << "\n"
+        << "\n"
+        << "#include <util/Unicode.h>\n"
+        << "\n";
+
+    // Open the namespaces of the binder
+    std::vector<std::string> namespaces;
+    std::string ns = m_namespace;
+    for (size_t pos; (pos = ns.find("::")) != std::string::npos; ns = ns.substr(pos + 2))
+    {
+        namespaces.push_back(ns.substr(0, pos));
+    }
+    namespaces.push_back(ns);
+    namespaces.push_back("Binding");
+
+    std::string indent;
+    for (size_t i = 0; i < namespaces.size(); ++i)
+    {
+        out << indent << "namespace " << namespaces[i] << "\n" << indent << "{\n";
+        indent += "    ";
+    }
+
+    out << indent << "/** Element and attribute names of the schema */\n"
+        << indent << "enum Tag\n" << indent << "{\n"
+        << indent << "    TagNone = -1,\n";
+    for (std::set<std::string>::const_iterator it = m_tags.begin(); it != m_tags.end(); ++it)
+    {
+        out << indent << "    " << TagId(*it) << ",\n";
+    }
+    out << indent << "    TagCount\n" << indent << "};\n\n";
+
+    out << indent << "/** Contents that dispatch the children and attributes of their elements */\n"
+        << indent << "enum Type\n" << indent << "{\n"
+        << indent << "    TypeNone = 0";
+    for (size_t i = 0; i < m_order.size(); ++i)
+    {
+        out << ",\n" << indent << "    " << TypeId(*m_order[i]);
+    }
+    out << "\n" << indent << "};\n\n";
+
+    out << indent << "/** Elements bound within the content of their parent */\n"
+        << indent << "enum Field\n" << indent << "{\n"
+        << indent << "    FieldNone = 0";
+    for (size_t i = 0; i < m_order.size(); ++i)
+    {
+        for (size_t j = 0; j < m_order[i]->fields.size(); ++j)
+        {
+            out << ",\n" << indent << "    " << FieldId(*m_order[i], m_order[i]->fields[j]);
+        }
+    }
+    out << "\n" << indent << "};\n\n";
+
+    out << indent << "/** Attributes kept on the frame of their element, numbered within each content */\n"
+        << indent << "enum AttributeIndex\n" << indent << "{\n";
+    for (size_t i = 0; i < m_order.size(); ++i)
+    {
+        for (size_t j = 0; j < m_order[i]->attributes.size(); ++j)
+        {
+            out << indent << "    Attribute" << m_order[i]->key << m_order[i]->attributes[j].tag << " = " << j << ",\n";
+        }
+    }
+    out << indent << "    AttributeCount = " << m_attributeCount << "\n" << indent << "};\n\n";
+
+    for (std::set<std::string>::const_iterator it = m_enumerations.begin(); it != m_enumerations.end(); ++it)
+    {
+        const std::vector<std::string>& values = m_simpleTypes.find(*it)->second;
+        out << indent << "/** Values of the " << *it << " enumeration */\n"
+            << indent << "enum " << *it << "\n" << indent << "{\n"
+            << indent << "    " << *it << "None = -1";
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            out << ",\n" << indent << "    " << *it << values[i];
+        }
+        out << "\n" << indent << "};\n\n";
+    }
+
+    out << indent << "const Tag RootTag = " << TagId(m_rootName) << ";  //!< Element the document starts with\n"
+        << indent << "const Type RootType = " << TypeId(*m_root) << ";  //!< Content of the root element\n"
+        << "\n"
+        << indent << "/*----------------------------------------------------------------------------*/\n"
+        << indent << "/**\n"
+        << indent << "    Look up a name with the perfect hash of the schema names\n"
+        << "\n"
+        << indent << "    \\param [in] name  element or attribute name\n"
+        << indent << "    \\returns the tag of the name, TagNone if the schema does not have it\n"
+        << indent << "*/\n"
+        << indent << "Tag LookupTag(const SCX::Util::Utf8String& name);\n"
+        << "\n"
+        << indent << "/*----------------------------------------------------------------------------*/\n"
+        << indent << "/**\n"
+        << indent << "    Get the name of a tag\n"
+        << indent << "*/\n"
+        << indent << "const char* GetTagName(Tag tag);\n";
+
+    for (std::set<std::string>::const_iterator it = m_enumerations.begin(); it != m_enumerations.end(); ++it)
+    {
+        out << "\n"
+            << indent << "/*----------------------------------------------------------------------------*/\n"
+            << indent << "/**\n"
+            << indent << "    Look up a value of the " << *it << " enumeration\n"
+            << "\n"
+            << indent << "    \\param [in] value  attribute value\n"
+            << indent << "    \\returns the value, " << *it << "None if the enumeration does not have it\n"
+            << indent << "*/\n"
+            << indent << *it << " Lookup" << *it << "(const SCX::Util::Utf8String& value);\n";
+    }
+
+    for (size_t i = namespaces.size(); i > 0; --i)
+    {
+        indent.erase(indent.size() - 4);
+        out << indent << "} // namespace " << namespaces[i - 1] << "\n";
+    }
+
+    out << "\n"
+        << "#endif // " << guard << "\n";
+    return out.str();
+}
+
+std::string
+Generator::Source(const std::string& name) const
+{
+    std::string binderHeader;
+    for (size_t i = 0; i < m_binder.size(); ++i)
+    {
+        binderHeader += static_cast<char>(tolower(m_binder[i]));
+    }
+    binderHeader += ".h";
+
+    std::ostringstream out;
+    out << c_License
+        << "/**\n"
+        << "        \\file        " << name << "\n"
+        << "\n"
+        << "        \\brief       Dispatch of " << m_binder << " on the names of\n"
+        << "                     " << m_schemaName << "\n"
+        << "\n"
+        << "        Generated by xsdbindgen from " << m_schemaName << "; do not edit, run\n"
+        << "        \"make gen\" in dev/tools/xsdbindgen instead.  @migen@\n"
+        << "\n"
+        << "*/\n"
+        << "/*----------------------------------------------------------------------------*/\n"
+        << "\n"
+        << "#include <" << binderHeader << ">\n"
+        << "\n"
+        << "#include <sstream>\n"
+        << "\n"
+        << "\n"
+        << "using namespace " << m_namespace << "::Binding;\n"
+        << "\n"
+        << "using SCX::Util::Utf8String;\n"
+        << "\n"
+        << "using " << m_namespace << "::" << m_binder << ";\n"
+        << "using " << m_namespace << "::" << m_scope << ";\n"
+        << "\n"
+        << "namespace\n"
+        << "{\n"
+        << "    // Names by tag\n"
+        << "    const char* const c_TagNames[TagCount] =\n"
+        << "    {\n";
+    for (std::set<std::string>::const_iterator it = m_tags.begin(); it != m_tags.end(); ++it)
+    {
+        out << "        \"" << *it << "\",\n";
+    }
+    out << "    };\n"
+        << "\n"
+        << "    const size_t c_TagLengths[TagCount] =\n"
+        << "    {\n";
+    for (std::set<std::string>::const_iterator it = m_tags.begin(); it != m_tags.end(); ++it)
+    {
+        out << "        " << it->size() << ",\n";
+    }
+    out << "    };\n"
+        << "\n"
+        << "    // Perfect hash of the names: no two names share a slot, which holds the tag + 1\n"
+        << "    const unsigned int c_TagSeed = 0x" << std::hex << m_seed << std::dec << "u;\n"
+        << "    const unsigned int c_TagSlotMask = " << (1u << m_slotBits) - 1 << ";\n"
+        << "    const unsigned char c_TagSlots[" << (1u << m_slotBits) << "] =\n"
+        << "    {";
+    for (size_t i = 0; i < m_slots.size(); ++i)
+    {
+        out << (0 == i % 16 ? "\n        " : " ") << m_slots[i] << (i + 1 < m_slots.size() ? "," : "");
+    }
+    out << "\n"
+        << "    };\n"
+        << "\n"
+        << "    inline unsigned int HashName(const Utf8String& name)\n"
+        << "    {\n"
+        << "        unsigned int hash = c_TagSeed;\n"
+        << "        for (size_t i = 0; i < name.size(); i++)\n"
+        << "        {\n"
+        << "            hash = (hash ^ name[i]) * " << c_HashPrime << "u;\n"
+        << "        }\n"
+        << "        return hash ^ (hash >> 16);\n"
+        << "    }\n"
+        << "\n"
+        << "    bool Equals(const Utf8String& name, const char* str, size_t length)\n"
+        << "    {\n"
+        << "        if (name.size() != length)\n"
+        << "        {\n"
+        << "            return false;\n"
+        << "        }\n"
+        << "        for (size_t i = 0; i < length; i++)\n"
+        << "        {\n"
+        << "            if (name[i] != static_cast<unsigned char>(str[i]))\n"
+        << "            {\n"
+        << "                return false;\n"
+        << "            }\n"
+        << "        }\n"
+        << "        return true;\n"
+        << "    }\n"
+        << "}\n"
+        << "\n"
+        << "Tag " << m_namespace << "::Binding::LookupTag(const Utf8String& name)\n"
+        << "{\n"
+        << "    unsigned int slot = c_TagSlots[HashName(name) & c_TagSlotMask];\n"
+        << "    if (0 == slot || !Equals(name, c_TagNames[slot - 1], c_TagLengths[slot - 1]))\n"
+        << "    {\n"
+        << "        return TagNone;\n"
+        << "    }\n"
+        << "    return static_cast<Tag>(slot - 1);\n"
+        << "}\n"
+        << "\n"
+        << "const char* " << m_namespace << "::Binding::GetTagName(Tag tag)\n"
+        << "{\n"
+        << "    return c_TagNames[tag];\n"
+        << "}\n";
+
+    for (std::set<std::string>::const_iterator it = m_enumerations.begin(); it != m_enumerations.end(); ++it)
+    {
+        const std::vector<std::string>& values = m_simpleTypes.find(*it)->second;
+        out << "\n"
+            << *it << " " << m_namespace << "::Binding::Lookup" << *it << "(const Utf8String& value)\n"
+            << "{\n";
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            out << "    if (Equals(value, \"" << Escape(values[i]) << "\", " << values[i].size() << "))\n"
+                << "    {\n"
+                << "        return " << *it << values[i] << ";\n"
+                << "    }\n";
+        }
+        out << "    return " << *it << "None;\n"
+            << "}\n";
+    }
+
+    EmitStart(out);
+    EmitAttribute(out);
+    EmitEnd(out);
+    return out.str();
+}
+
+void
+Generator::EmitStart(std::ostringstream& out) const
+{
+    out << "\n"
+        << "void " << m_binder << "::BindStart(Frame& parent, Frame& child)\n"
+        << "{\n"
+        << "    switch (parent.type)\n"
+        << "    {\n";
+
+    for (size_t i = 0; i < m_order.size(); ++i)
+    {
+        const Content& content = *m_order[i];
+        if (content.fields.empty() && content.sections.empty() && content.unexpected.empty())
+        {
+            continue;
+        }
+
+        bool useTarget = false;
+        for (size_t j = 0; j < content.fields.size(); ++j)
+        {
+            Kind kind = content.fields[j].kind;
+            useTarget = useTarget || KindOptional == kind || KindList == kind || KindItem == kind;
+        }
+
+        out << "        case " << TypeId(content) << ":\n"
+            << "            {\n";
+        if (useTarget)
+        {
+            out << "                " << content.target << "* target = static_cast<" << content.target << "*>(parent.target);\n";
+        }
+        if (!content.sections.empty())
+        {
+            out << "                child.capture = true;\n";
+        }
+        out << "                switch (child.tag)\n"
+            << "                {\n";
+
+        for (size_t j = 0; j < content.fields.size(); ++j)
+        {
+            const Field& field = content.fields[j];
+            out << "                    case " << TagId(field.tag) << ":\n"
+                << "                        child.field = " << FieldId(content, field) << ";\n";
+            if (NULL != field.content)
+            {
+                out << "                        child.type = " << TypeId(*field.content) << ";\n";
+            }
+            switch (field.kind)
+            {
+                case KindOptional:
+                    out << "                        target->" << field.member << ".IsValid() = true;\n"
+                        << "                        child.target = &target->" << field.member << ".inner();\n";
+                    break;
+                case KindList:
+                    out << "                        target->" << field.member << ".clear();\n"
+                        << "                        child.target = &target->" << field.member << ";\n";
+                    break;
+                case KindItem:
+                    out << "                        target->push_back(" << field.content->target << "());\n"
+                        << "                        child.target = &target->back();\n";
+                    break;
+                case KindValue:
+                case KindPass:
+                    if (NULL != field.content)
+                    {
+                        out << "                        child.target = parent.target;\n";
+                    }
+                    break;
+                case KindNone:
+                case KindItemValue:
+                case KindObject:
+                    break;
+            }
+            if (!field.begin.empty())
+            {
+                out << "                        Begin" << field.begin << "(parent, child);\n";
+            }
+            out << "                        break;\n";
+        }
+
+        out << "                    default:\n";
+        if (!content.unexpected.empty())
+        {
+            out << "                        Unexpected(parent, child, \"" << Escape(content.unexpected) << "\");\n";
+        }
+        out << "                        break;\n"
+            << "                }\n"
+            << "            }\n"
+            << "            break;\n";
+    }
+
+    out << "        default:\n"
+        << "            break;\n"
+        << "    }\n"
+        << "}\n";
+}
+
+void
+Generator::EmitAttribute(std::ostringstream& out) const
+{
+    out << "\n"
+        << "void " << m_binder << "::BindAttribute(Frame& frame, Tag tag, const Utf8String& value)\n"
+        << "{\n"
+        << "    switch (frame.type)\n"
+        << "    {\n";
+
+    for (size_t i = 0; i < m_order.size(); ++i)
+    {
+        const Content& content = *m_order[i];
+        if (content.attributes.empty())
+        {
+            continue;
+        }
+
+        out << "        case " << TypeId(content) << ":\n"
+            << "            switch (tag)\n"
+            << "            {\n";
+        for (size_t j = 0; j < content.attributes.size(); ++j)
+        {
+            const Attr& attr = content.attributes[j];
+            out << "                case " << TagId(attr.tag) << ":\n"
+                << "                    frame.SetAttribute(Attribute" << content.key << attr.tag << ", value);\n";
+            if (!attr.on.empty())
+            {
+                out << "                    On" << attr.on << "(frame, ";
+                if (!attr.enumeration.empty())
+                {
+                    out << "Lookup" << attr.enumeration << "(value), ";
+                }
+                out << "value);\n";
+            }
+            out << "                    break;\n";
+        }
+        out << "                default:\n"
+            << "                    break;\n"
+            << "            }\n"
+            << "            break;\n";
+    }
+
+    out << "        default:\n"
+        << "            break;\n"
+        << "    }\n"
+        << "}\n";
+}
+
+void
+Generator::EmitEnd(std::ostringstream& out) const
+{
+    out << "\n"
+        << "void " << m_binder << "::BindEnd(Frame& parent, Frame& child)\n"
+        << "{\n";
+
+    bool sections = false;
+    for (size_t i = 0; i < m_order.size(); ++i)
+    {
+        const Content& content = *m_order[i];
+        if (content.sections.empty())
+        {
+            continue;
+        }
+        if (!sections)
+        {
+            out << "    switch (parent.type)\n"
+                << "    {\n";
+            sections = true;
+        }
+        out << "        case " << TypeId(content) << ":\n"
+            << "            static_cast<" << content.target << "*>(parent.target)->" << content.sections
+            << "[child.name.Str()] = child.xml;\n"
+            << "            break;\n";
+    }
+    if (sections)
+    {
+        out << "        default:\n"
+            << "            break;\n"
+            << "    }\n"
+            << "\n";
+    }
+
+    out << "    switch (child.field)\n"
+        << "    {\n";
+
+    for (size_t i = 0; i < m_order.size(); ++i)
+    {
+        const Content& content = *m_order[i];
+        for (size_t j = 0; j < content.fields.size(); ++j)
+        {
+            const Field& field = content.fields[j];
+            bool assign = KindValue == field.kind || KindItemValue == field.kind;
+            if (!assign && field.end.empty() && field.trace.empty() && field.traceValue.empty())
+            {
+                continue;
+            }
+
+            std::string indent = assign ? "                " : "            ";
+            out << "        case " << FieldId(content, field) << ":\n";
+            if (assign)
+            {
+                out << "            {\n"
+                    << indent << content.target << "* target = static_cast<" << content.target << "*>(parent.target);\n";
+            }
+            if (field.first)
+            {
+                out << indent << "if (!target->" << field.member << ".IsValid())\n"
+                    << indent << "{\n";
+                indent += "    ";
+            }
+            bool statements = assign || !field.end.empty();
+            if (KindItemValue == field.kind)
+            {
+                out << indent << "target->push_back(child.content);\n";
+            }
+            else if (KindValue == field.kind && "int" == field.xsType && "string" != field.as)
+            {
+                out << indent << "int value = 0;\n"
+                    << indent << "std::istringstream ( child.content.Str() ) >> value;\n"
+                    << indent << "target->" << field.member << " = value;\n";
+            }
+            else if (KindValue == field.kind)
+            {
+                out << indent << "target->" << field.member << " = child.content;\n";
+            }
+            if (!field.end.empty())
+            {
+                out << indent << "End" << field.end << "(parent, child);\n";
+            }
+            if (!field.trace.empty())
+            {
+                out << (statements ? "\n" : "") << indent << "SCX_LOGTRACE(m_logHandle, \"" << Escape(field.trace) << "\");\n";
+            }
+            if (!field.traceValue.empty())
+            {
+                out << (statements ? "\n" : "") << indent << "SCX_LOGTRACE(m_logHandle, \"" << Escape(field.traceValue) << "\" + child.content.Str());\n";
+            }
+            if (field.first)
+            {
+                indent.erase(indent.size() - 4);
+                out << indent << "}\n";
+            }
+            if (assign)
+            {
+                out << "            }\n";
+            }
+            out << "            break;\n";
+        }
+    }
+
+    out << "        default:\n"
+        << "            break;\n"
+        << "    }\n"
+        << "}\n";
+}
+
+/** Write a file unless it already has the content, so unchanged files keep their time stamp */
+void
+WriteIfChanged(const std::string& path, const std::string& text)
+{
+    std::ifstream in(path.c_str());
+    if (in)
+    {
+        std::ostringstream current;
+        current << in.rdbuf();
+        if (current.str() == text)
+        {
+            return;
+        }
+    }
+
+    std::ofstream out(path.c_str());
+    out << text;
+    if (!out)
+    {
+        throw std::runtime_error("cannot write " + path);
+    }
+    printf("wrote %s\n", path.c_str());
+}
+
+}
+
+int
+main(
+    int const argc,
+    char const* const* argv)
+{
+    if (argc != 4)
+    {
+        fprintf(stderr, "usage: xsdbindgen schema header source\n");
+        return 1;
+    }
+
+    try
+    {
+        Generator generator;
+        generator.Load(argv[1]);
+        generator.Resolve();
+        WriteIfChanged(argv[2], generator.Header(BaseName(argv[2])));
+        WriteIfChanged(argv[3], generator.Source(BaseName(argv[3])));
+    }
+    catch (std::exception& e)
+    {
+        fprintf(stderr, "xsdbindgen: %s\n", e.what());
+        return 1;
+    }
+    catch (SCXCoreLib::SCXException& e)
+    {
+        fprintf(stderr, "xsdbindgen: %ls\n", e.What().c_str());
+        return 1;
+    }
+    return 0;
+}